@@ -7,141 +7,319 @@
 #include <ctype.h>
 #include <math.h>
 #include "MathFunctions.h"
+#include "Arena.h"
+#include "FunctionRegistry.h"
+#include "Stats.h"
+#include "NumberParser.h"
+
+// Kinds of tokens produced by the tokeniser
+typedef enum TokenKind
+{
+    TOKEN_NUMBER,     // Numeric literal, value decoded into Token.number
+    TOKEN_IDENTIFIER, // Function or variable name, functions resolved into Token.function
+    TOKEN_PLUS,
+    TOKEN_MINUS,
+    TOKEN_STAR,
+    TOKEN_SLASH,
+    TOKEN_CARET,
+    TOKEN_LPAREN,
+    TOKEN_RPAREN,
+    TOKEN_COMMA,
+    TOKEN_KIND_COUNT
+} TokenKind;
+
+// Token: a typed span of the source text (nothing is copied)
+typedef struct Token
+{
+    TokenKind kind;
+    int offset; // Start of the token in the source
+    int length; // Length of the token in the source
+    union
+    {
+        double number;       // Value of a TOKEN_NUMBER
+        FunctionId function; // Function named by a TOKEN_IDENTIFIER
+    };
+} Token;
+
+// Kinds of AST nodes
+typedef enum NodeType
+{
+    NODE_NUMBER,   // Leaf holding a number
+    NODE_VARIABLE, // Leaf reading a variable
+    NODE_ADD,      // left + right
+    NODE_SUB,      // left - right
+    NODE_MUL,      // left * right
+    NODE_DIV,      // left / right
+    NODE_POW,      // left ^ right
+    NODE_NEG,      // -left
+    NODE_FUNCTION  // function(left) or function(left, right)
+} NodeType;
 
 //  AST node structure
 typedef struct ASTNode
 {
-    char *value;           // Can be a number, operator, or function name (e.g., sin, cos, tan)
-    struct ASTNode *left;  // Left child in AST
-    struct ASTNode *right; // Right child in AST
+    NodeType type;
+    FunctionId function;     // Function called by a NODE_FUNCTION
+    int variable;            // Index of a NODE_VARIABLE in the VariableTable
+    double number;           // Value of a NODE_NUMBER
+    struct ASTNode *left;    // Left child in AST
+    struct ASTNode *right;   // Right child in AST
+    int uses;                // Number of parents, set by the compiler (above 1 once subtrees are shared)
+    int slot;                // Temporary holding the value of a shared node, set by the compiler
+    struct ASTNode *partner; // Sibling call that a fused kernel computes together with this one, set by the compiler
 } ASTNode;
 
+// Hash set of the distinct nodes built by optimizeTree, used to share identical subtrees
+typedef struct NodeSet
+{
+    ASTNode **slots; // Open addressing table, NULL for empty
+    size_t mask;     // Table size - 1 (the size is a power of two)
+} NodeSet;
+
+// Error reported by the tokeniser or parser instead of terminating the process
+typedef struct ParseError
+{
+    int position;     // Character offset of the error in the source
+    char message[96]; // Description, empty when no error occurred
+} ParseError;
+
+#define MAX_VARIABLES 32         // Maximum number of distinct variables in one expression
+#define MAX_VARIABLE_NAME 32     // Maximum variable name length, including the terminator
+#define MAX_NESTING 1000         // Deepest syntax tree and parser recursion accepted, so the recursive tree walks stay
+                                 // well within the stack whatever the length of the input
+
+// Names of the variables an expression may use; a variable's index is its position in names
+typedef struct VariableTable
+{
+    char names[MAX_VARIABLES][MAX_VARIABLE_NAME];
+    int count;       // Number of names in use
+    int allowNew;    // Add unknown identifiers as new variables instead of rejecting them
+} VariableTable;
+
 // Parser structure
 typedef struct Parser
 {
-    char **tokens; // Tokenized input
-    int pos;       // Tracks current position in tokens
-    int numTokens; // Number of tokens
+    const char *source;       // Source text the tokens refer to
+    Token *tokens;            // Tokenized input
+    int pos;                  // Tracks current position in tokens
+    int numTokens;            // Number of tokens
+    Arena *arena;             // Arena that tokens and nodes are allocated from
+    VariableTable *variables; // Variables the expression may use (NULL if none)
+    ParseError error;         // First syntax error encountered, if any
+    int depth;                // Nesting of the parseBinary calls in progress
+    int height;               // Height of the subtree the last parseBinary or parsePrefix call returned
 } Parser;
 
+// How a token continues an expression when it follows a complete operand
+typedef struct InfixRule
+{
+    int leftPower;  // Binding power towards the left operand (0 = token cannot continue an expression)
+    int rightPower; // Minimum binding power when parsing the right operand
+    NodeType node;  // Node built from both operands
+    int implicit;   // Token starts the right operand itself (implicit multiplication, e.g. 2(3) or 2sin(1))
+} InfixRule;
+
+// Precedence table of the Pratt parser, indexed by TokenKind
+// Left-associative operators use rightPower == leftPower, right-associative ones rightPower == leftPower - 1
+static const InfixRule infixRules[TOKEN_KIND_COUNT] = {
+    [TOKEN_NUMBER] = {20, 20, NODE_MUL, 1},
+    [TOKEN_IDENTIFIER] = {20, 20, NODE_MUL, 1},
+    [TOKEN_PLUS] = {10, 10, NODE_ADD, 0},
+    [TOKEN_MINUS] = {10, 10, NODE_SUB, 0},
+    [TOKEN_STAR] = {20, 20, NODE_MUL, 0},
+    [TOKEN_SLASH] = {20, 20, NODE_DIV, 0},
+    [TOKEN_CARET] = {30, 29, NODE_POW, 0},
+    [TOKEN_LPAREN] = {20, 20, NODE_MUL, 1},
+};
+
+#define PREFIX_MINUS_POWER 25 // Unary minus binds tighter than * and / but looser than ^, so -(2)^2 = -4
+
 // Function declarations
-ASTNode *createNode(const char *value, ASTNode *left, ASTNode *right);
-void freeNode(ASTNode *node);
-ASTNode *parseExpression(Parser *parser);
-ASTNode *parseTerm(Parser *parser);
-ASTNode *parseExponentiation(Parser *parser);
-ASTNode *parseFactor(Parser *parser);
-int match(Parser *parser, char *expected);
-char *previous(Parser *parser);
-void consume(Parser *parser, char *expected);
-char *consumeNumber(Parser *parser);
-int implicitMultiplication(Parser *parser);
-double evaluate(ASTNode *node);
-char **tokenise(const char *expression, int *numTokens);
-void freeTokens(char **tokens, int numTokens);
-
-// Create a new AST node
-ASTNode *createNode(const char *value, ASTNode *left, ASTNode *right)
-{
-    ASTNode *node = (ASTNode *)malloc(sizeof(ASTNode));
-    node->value = strdup(value);
+static inline ASTNode *createNode(Parser *parser, NodeType type, ASTNode *left, ASTNode *right);
+static inline ASTNode *parseExpression(Parser *parser);
+static inline ASTNode *parseBinary(Parser *parser, int minPower);
+static inline ASTNode *parsePrefix(Parser *parser);
+static inline int match(Parser *parser, TokenKind expected);
+static inline const Token *previous(Parser *parser);
+static inline void consume(Parser *parser, TokenKind expected);
+static inline void parserError(Parser *parser, const char *message);
+static inline int parserFailed(const Parser *parser);
+static inline double evaluate(ASTNode *node, const double *variables);
+static inline double evaluateTier(ASTNode *node, const double *variables, PrecisionTier tier);
+static inline ASTNode *optimizeTree(ASTNode *root, Arena *arena, PrecisionTier tier);
+static inline int findVariable(const VariableTable *table, const char *name, int length);
+static inline int addVariable(VariableTable *table, const char *name, int length);
+static inline Token *tokenise(const char *source, int length, int *numTokens, Arena *arena, ParseError *error);
+static inline int evaluateExpression(const char *expression, Arena *arena, double *result, ParseError *error);
+static inline int evaluateSpan(const char *expression, int length, Arena *arena, double *result, ParseError *error);
+
+// Create a new AST node in the parser's arena, or record an error and return NULL if it is full
+static inline ASTNode *createNode(Parser *parser, NodeType type, ASTNode *left, ASTNode *right)
+{
+    ASTNode *node = (ASTNode *)arenaAlloc(parser->arena, sizeof(ASTNode));
+    if (node == NULL)
+    {
+        if (!parserFailed(parser))
+        {
+            parser->error.position = parser->pos < parser->numTokens ? parser->tokens[parser->pos].offset : 0;
+            snprintf(parser->error.message, sizeof(parser->error.message), "Out of memory");
+        }
+        return NULL;
+    }
+    STATS_ADD(nodes, 1);
+    node->type = type;
+    node->function = FN_UNKNOWN;
+    node->variable = -1;
+    node->number = 0.0;
     node->left = left;
     node->right = right;
+    node->uses = 0;
+    node->slot = -1;
+    node->partner = NULL;
     return node;
 }
 
-// Free an AST node
-void freeNode(ASTNode *node)
+// Parse a complete expression
+static inline ASTNode *parseExpression(Parser *parser)
 {
-    if (node == NULL)
-        return;
-    free(node->value);
-    freeNode(node->left);
-    freeNode(node->right);
-    free(node);
+    return parseBinary(parser, 0);
 }
 
-// Parse an expression (handles + and -)
-ASTNode *parseExpression(Parser *parser)
+// Record that the expression nests deeper than MAX_NESTING, at the current token
+static inline void nestingError(Parser *parser)
 {
-    ASTNode *node = parseTerm(parser); // Start with higher precedence
-    while (match(parser, "+") || match(parser, "-"))
-    {
-        char *op = previous(parser);        // Store operator
-        ASTNode *right = parseTerm(parser); // Parse right-hand side
-        node = createNode(op, node, right);
-    }
-    return node;
+    if (parserFailed(parser))
+        return;
+    const Token *last = &parser->tokens[parser->numTokens - 1]; // There is at least the token being parsed
+    parser->error.position =
+        parser->pos < parser->numTokens ? parser->tokens[parser->pos].offset : last->offset + last->length;
+    snprintf(parser->error.message, sizeof(parser->error.message), "Expression too deeply nested");
 }
 
-// Parse a term (handles *, /, and implicit multiplication)
-ASTNode *parseTerm(Parser *parser)
+// Parse an operand followed by every infix operator that binds tighter than minPower
+// Both the recursion (parentheses, unary minus, right operands) and the height of the tree built
+// (which also grows along left-associative chains such as 1+1+...+1) are limited to MAX_NESTING
+static inline ASTNode *parseBinary(Parser *parser, int minPower)
 {
-    ASTNode *node = parseExponentiation(parser); // Higher precedence than + and -
-    while (match(parser, "*") || match(parser, "/") || implicitMultiplication(parser))
-    {
-        const char *op = implicitMultiplication(parser) ? "*" : previous(parser);
-        ASTNode *right = parseExponentiation(parser);
-        node = createNode(op, node, right);
-    }
+    if (++parser->depth > MAX_NESTING)
+    {
+        nestingError(parser);
+        parser->depth--;
+        return NULL;
+    }
+    ASTNode *node = parsePrefix(parser);
+    int height = parser->height;
+    while (!parserFailed(parser) && parser->pos < parser->numTokens)
+    {
+        const InfixRule *rule = &infixRules[parser->tokens[parser->pos].kind];
+        if (rule->leftPower <= minPower)
+            break;
+        if (!rule->implicit)
+            parser->pos++; // Consume the operator
+        ASTNode *right = parseBinary(parser, rule->rightPower);
+        height = 1 + (height > parser->height ? height : parser->height);
+        if (height > MAX_NESTING)
+            nestingError(parser);
+        node = createNode(parser, rule->node, node, right);
+    }
+    parser->height = height;
+    parser->depth--;
     return node;
 }
 
-// Parse exponentiation (handles ^, right-associative)
-ASTNode *parseExponentiation(Parser *parser)
+// Parse an operand (handles numbers, functions, parentheses and unary minus)
+static inline ASTNode *parsePrefix(Parser *parser)
 {
-    ASTNode *node = parseFactor(parser);
-    while (match(parser, "^"))
+    if (match(parser, TOKEN_NUMBER))
     {
-        char *op = previous(parser);
-        ASTNode *right = parseFactor(parser);
-        node = createNode(op, node, right);
+        ASTNode *node = createNode(parser, NODE_NUMBER, NULL, NULL); // Create node for number
+        if (node != NULL)
+            node->number = previous(parser)->number;
+        parser->height = 1;
+        return node;
     }
-    return node;
-}
 
-// Parse a factor (handles numbers, functions, and parentheses)
-ASTNode *parseFactor(Parser *parser)
-{
     // Check for function identifiers: sin, cos, tan, etc.
-    if (parser->pos < parser->numTokens)
+    if (match(parser, TOKEN_IDENTIFIER))
     {
-        char *token = parser->tokens[parser->pos];
-        if (strcmp(token, "sin") == 0 || strcmp(token, "cos") == 0 || strcmp(token, "tan") == 0 ||
-            strcmp(token, "ln") == 0 || strcmp(token, "exp") == 0 || strcmp(token, "sinh") == 0 ||
-            strcmp(token, "cosh") == 0 || strcmp(token, "tanh") == 0 || strcmp(token, "asin") == 0 ||
-            strcmp(token, "acos") == 0 || strcmp(token, "atan") == 0 || strcmp(token, "asinh") == 0 ||
-            strcmp(token, "acosh") == 0 || strcmp(token, "atanh") == 0 || strcmp(token, "pow") == 0 ||
-            strcmp(token, "log_base") == 0)
+        const Token *token = previous(parser);
+        FunctionId function = token->function;
+        int isCall = parser->pos < parser->numTokens && parser->tokens[parser->pos].kind == TOKEN_LPAREN;
+        if (function == FN_UNKNOWN && !isCall)
         {
-            parser->pos++;        // Consume the function name
-            consume(parser, "("); // Search for '('
-            ASTNode *arg = parseExpression(parser);
-            if (strcmp(token, "pow") == 0 || strcmp(token, "log_base") == 0)
+            // A name that is not followed by '(' is a variable
+            const char *name = parser->source + token->offset;
+            int variable = -1;
+            if (parser->variables != NULL)
             {
-                consume(parser, ","); // Expect ',' for pow and log_base
-                ASTNode *arg2 = parseExpression(parser);
-                consume(parser, ")");                // Expect ')'
-                return createNode(token, arg, arg2); // Two arguments for pow and log_base
+                variable = findVariable(parser->variables, name, token->length);
+                if (variable < 0 && parser->variables->allowNew)
+                    variable = addVariable(parser->variables, name, token->length);
             }
-            consume(parser, ")");                // Expect ')'
-            return createNode(token, arg, NULL); // Single argument for other functions
+            if (variable < 0)
+            {
+                parser->height = 0;
+                parser->pos--; // Report the error at the identifier
+                parserError(parser, parser->variables && parser->variables->allowNew ? "Too many variables or name too long" : "Unknown variable");
+                return NULL;
+            }
+            ASTNode *node = createNode(parser, NODE_VARIABLE, NULL, NULL);
+            if (node != NULL)
+                node->variable = variable;
+            parser->height = 1;
+            return node;
+        }
+        if (function == FN_UNKNOWN)
+        {
+            parser->height = 0;
+            parser->pos--; // Report the error at the identifier
+            parserError(parser, "Unknown function");
+            return NULL;
+        }
+
+        consume(parser, TOKEN_LPAREN); // Search for '('
+        ASTNode *arg = parseExpression(parser);
+        int height = parser->height;
+        ASTNode *arg2 = NULL;
+        if (functionRegistry[function].arity == 2)
+        {
+            consume(parser, TOKEN_COMMA); // Expect ',' for pow and log_base
+            arg2 = parseExpression(parser);
+            if (parser->height > height)
+                height = parser->height;
         }
+        consume(parser, TOKEN_RPAREN); // Expect ')'
+
+        ASTNode *node = createNode(parser, NODE_FUNCTION, arg, arg2);
+        if (node != NULL)
+            node->function = function;
+        parser->height = height + 1;
+        return node;
     }
 
-    if (match(parser, "("))
+    if (match(parser, TOKEN_LPAREN))
     {
         ASTNode *node = parseExpression(parser);
-        consume(parser, ")"); // Ensure closing brackets
+        consume(parser, TOKEN_RPAREN); // Ensure closing brackets
         return node;
     }
-    return createNode(consumeNumber(parser), NULL, NULL); // Create node for number
+
+    if (match(parser, TOKEN_MINUS))
+    {
+        ASTNode *operand = parseBinary(parser, PREFIX_MINUS_POWER);
+        parser->height++;
+        return createNode(parser, NODE_NEG, operand, NULL);
+    }
+
+    parserError(parser, "Expected a number");
+    parser->height = 0;
+    return NULL;
 }
 
 // Check if the current token matches an expected token
-int match(Parser *parser, char *expected)
+static inline int match(Parser *parser, TokenKind expected)
 {
-    if (parser->pos < parser->numTokens && strcmp(parser->tokens[parser->pos], expected) == 0)
+    if (parser->pos < parser->numTokens && parser->tokens[parser->pos].kind == expected)
     {
         parser->pos++;
         return 1;
@@ -150,165 +328,135 @@ int match(Parser *parser, char *expected)
 }
 
 // Get the previous token
-char *previous(Parser *parser)
+static inline const Token *previous(Parser *parser)
 {
-    return parser->tokens[parser->pos - 1];
+    return &parser->tokens[parser->pos - 1];
 }
 
-// Consume a specific token
-void consume(Parser *parser, char *expected)
+// Record a syntax error at the current token (only the first error is kept)
+static inline void parserError(Parser *parser, const char *message)
 {
-    if (!match(parser, expected))
+    if (parserFailed(parser))
+        return;
+    if (parser->pos < parser->numTokens)
+    {
+        const Token *token = &parser->tokens[parser->pos];
+        parser->error.position = token->offset;
+        snprintf(parser->error.message, sizeof(parser->error.message), "%s, got '%.*s'",
+                 message, token->length, parser->source + token->offset);
+    }
+    else
     {
-        fprintf(stderr, "Syntax error: Expected '%s', got '%s'\n", expected, parser->tokens[parser->pos]);
-        exit(1);
+        const Token *last = parser->numTokens > 0 ? &parser->tokens[parser->numTokens - 1] : NULL;
+        parser->error.position = last ? last->offset + last->length : 0;
+        snprintf(parser->error.message, sizeof(parser->error.message), "%s, got 'end of input'", message);
     }
 }
 
-// Consume a number token
-char *consumeNumber(Parser *parser)
+// Check whether a syntax error has been recorded
+static inline int parserFailed(const Parser *parser)
 {
-    char *num = parser->tokens[parser->pos];
-    parser->pos++;
-    return num;
+    return parser->error.message[0] != '\0';
 }
 
-// Detect implicit multiplication (e.g., between a number and a parenthesis or function)
-int implicitMultiplication(Parser *parser)
+// Consume a specific token
+static inline void consume(Parser *parser, TokenKind expected)
 {
-    if (parser->pos < parser->numTokens)
-    {
-        char *prev = previous(parser);            // Last token
-        char *curr = parser->tokens[parser->pos]; // Current token
-        return (isdigit(prev[0]) || strcmp(prev, ")") == 0) &&
-               (isdigit(curr[0]) || strcmp(curr, "(") == 0 ||
-                strcmp(curr, "sin") == 0 || strcmp(curr, "cos") == 0 ||
-                strcmp(curr, "tan") == 0 || strcmp(curr, "ln") == 0 || strcmp(curr, "exp") == 0 ||
-                strcmp(curr, "sinh") == 0 || strcmp(curr, "cosh") == 0 || strcmp(curr, "tanh") == 0 ||
-                strcmp(curr, "asin") == 0 || strcmp(curr, "acos") == 0 || strcmp(curr, "atan") == 0 ||
-                strcmp(curr, "asinh") == 0 || strcmp(curr, "acosh") == 0 || strcmp(curr, "atanh") == 0 ||
-                strcmp(curr, "pow") == 0 || strcmp(curr, "log_base") == 0);
-    }
-    return 0;
+    static const char *const expectedText[] = {
+        "Expected a number", "Expected a function", "Expected '+'", "Expected '-'", "Expected '*'",
+        "Expected '/'", "Expected '^'", "Expected '('", "Expected ')'", "Expected ','"};
+    if (!match(parser, expected))
+        parserError(parser, expectedText[expected]);
 }
 
-// Evaluate the AST
-double evaluate(ASTNode *node)
+// Evaluate both operands of a binary node. Sibling calls such as sin(e) and cos(e) on the same argument
+// node (optimizeTree shares identical arguments) are computed together by their fused kernel
+static void evaluateOperands(ASTNode *node, const double *variables, PrecisionTier tier, double *left, double *right)
 {
-    // If leaf node (a number), convert it to a double
-    if (node->left == NULL && node->right == NULL)
+    ASTNode *a = node->left;
+    ASTNode *b = node->right;
+    if (a->type == NODE_FUNCTION && b->type == NODE_FUNCTION && a->left == b->left)
     {
-        return atof(node->value);
+        int pair = findFusedPair(a->function, b->function);
+        if (pair >= 0)
+        {
+            double first, second;
+            kernelTables[tier].pairs[pair].kernel(evaluateTier(a->left, variables, tier), &first, &second);
+            STATS_CALLS(a->function, 1);
+            STATS_CALLS(b->function, 1);
+            *left = a->function == fusedPairs[pair].first ? first : second;
+            *right = b->function == fusedPairs[pair].first ? first : second;
+            return;
+        }
     }
+    *left = evaluateTier(a, variables, tier);
+    *right = evaluateTier(b, variables, tier);
+}
 
-    // Check for function nodes first
-    if (strcmp(node->value, "sin") == 0)
-    {
-        double arg = evaluate(node->left);
-        return customSIN(arg);
-    }
-    if (strcmp(node->value, "cos") == 0)
-    {
-        double arg = evaluate(node->left);
-        return customCOS(arg);
-    }
-    if (strcmp(node->value, "tan") == 0)
-    {
-        double arg = evaluate(node->left);
-        return customTAN(arg);
-    }
-    if (strcmp(node->value, "ln") == 0)
-    {
-        double arg = evaluate(node->left);
-        return customLN(arg);
-    }
-    if (strcmp(node->value, "exp") == 0)
-    {
-        double arg = evaluate(node->left);
-        return customEXP(arg);
-    }
-    if (strcmp(node->value, "sinh") == 0)
-    {
-        double arg = evaluate(node->left);
-        return customSINH(arg);
-    }
-    if (strcmp(node->value, "cosh") == 0)
-    {
-        double arg = evaluate(node->left);
-        return customCOSH(arg);
-    }
-    if (strcmp(node->value, "tanh") == 0)
-    {
-        double arg = evaluate(node->left);
-        return customTANH(arg);
-    }
-    if (strcmp(node->value, "asin") == 0)
-    {
-        double arg = evaluate(node->left);
-        return customASIN(arg);
-    }
-    if (strcmp(node->value, "acos") == 0)
-    {
-        double arg = evaluate(node->left);
-        return customACOS(arg);
-    }
-    if (strcmp(node->value, "atan") == 0)
-    {
-        double arg = evaluate(node->left);
-        return customATAN(arg);
-    }
-    if (strcmp(node->value, "asinh") == 0)
-    {
-        double arg = evaluate(node->left);
-        return customASINH(arg);
-    }
-    if (strcmp(node->value, "acosh") == 0)
+// Evaluate the AST (the tree must come from a parser that reported no error) with the default tier's kernels
+// variables holds the value of each variable, indexed like the parser's VariableTable
+static inline double evaluate(ASTNode *node, const double *variables)
+{
+    return evaluateTier(node, variables, precisionTier());
+}
+
+// Evaluate the AST with the kernels of the given precision tier
+static inline double evaluateTier(ASTNode *node, const double *variables, PrecisionTier tier)
+{
+    // If leaf node (a number), return its decoded value
+    if (node->type == NODE_NUMBER)
     {
-        double arg = evaluate(node->left);
-        return customACOSH(arg);
+        return node->number;
     }
-    if (strcmp(node->value, "atanh") == 0)
+    if (node->type == NODE_VARIABLE)
     {
-        double arg = evaluate(node->left);
-        return customATANH(arg);
+        return variables[node->variable];
     }
-    if (strcmp(node->value, "pow") == 0)
+
+    // Check for function nodes first
+    if (node->type == NODE_FUNCTION)
     {
-        double base = evaluate(node->left);
-        double exponent = evaluate(node->right);
-        return customPOW(base, exponent);
+        const FunctionKernels *kernels = &kernelTables[tier].functions[node->function];
+        STATS_CALLS(node->function, 1);
+        if (functionRegistry[node->function].arity == 2)
+        {
+            double a, b;
+            evaluateOperands(node, variables, tier, &a, &b);
+            return kernels->binary(a, b);
+        }
+        return kernels->unary(evaluateTier(node->left, variables, tier));
     }
-    if (strcmp(node->value, "log_base") == 0)
+
+    if (node->type == NODE_NEG)
     {
-        double a = evaluate(node->left);
-        double b = evaluate(node->right);
-        return customLogBase(a, b);
+        double result = -evaluateTier(node->left, variables, tier);
+        return result == 0 ? 0.0 : result; // Avoid negative zero, as for 0 - x
     }
 
     // Otherwise, it is an operator.
-    double left_val = evaluate(node->left);
-    double right_val = evaluate(node->right);
+    double left_val, right_val;
+    evaluateOperands(node, variables, tier, &left_val, &right_val);
     double result = 0.0;
 
-    if (strcmp(node->value, "+") == 0)
+    switch (node->type)
     {
+    case NODE_ADD:
         result = left_val + right_val;
-    }
-    else if (strcmp(node->value, "-") == 0)
-    {
+        break;
+    case NODE_SUB:
         result = left_val - right_val;
-    }
-    else if (strcmp(node->value, "*") == 0)
-    {
+        break;
+    case NODE_MUL:
         result = left_val * right_val;
-    }
-    else if (strcmp(node->value, "/") == 0)
-    {
+        break;
+    case NODE_DIV:
         result = left_val / right_val;
-    }
-    else if (strcmp(node->value, "^") == 0)
-    {
-        result = customPOW(left_val, right_val);
+        break;
+    case NODE_POW:
+        result = kernelTables[tier].functions[FN_POW].binary(left_val, right_val);
+        break;
+    default:
+        break;
     }
 
     // Correct negative zero if needed
@@ -320,101 +468,312 @@ double evaluate(ASTNode *node)
     return result;
 }
 
-// Tokenize the input expression with support for numbers, decimals, negatives, and identifiers (sin, cos, tan, log_base, etc.)
-char **tokenise(const char *expression, int *numTokens)
+// Count the nodes of a tree
+static size_t countNodes(const ASTNode *node)
+{
+    if (node == NULL)
+        return 0;
+    return 1 + countNodes(node->left) + countNodes(node->right);
+}
+
+// Hash of everything that identifies a node; children are compared by address since they are already shared
+static size_t hashNode(const ASTNode *node)
+{
+    unsigned long long bits;
+    memcpy(&bits, &node->number, sizeof(bits));
+    unsigned long long hash = (unsigned long long)node->type * 0x9E3779B97F4A7C15ull;
+    hash ^= bits + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+    hash ^= (unsigned long long)(node->function + 1) * 31 + (unsigned long long)(node->variable + 1) * 131;
+    hash ^= (unsigned long long)(size_t)node->left * 0xFF51AFD7ED558CCDull;
+    hash ^= (unsigned long long)(size_t)node->right * 0xC4CEB9FE1A85EC53ull;
+    return (size_t)(hash ^ (hash >> 29));
+}
+
+// Return the node already in the set that is identical to node, or add node and return it
+static ASTNode *internNode(NodeSet *set, ASTNode *node)
+{
+    size_t index = hashNode(node) & set->mask;
+    ASTNode *existing;
+    while ((existing = set->slots[index]) != NULL)
+    {
+        // Numbers are compared bitwise so 0 and -0 (or different NaNs) stay distinct
+        if (existing->type == node->type && existing->function == node->function &&
+            existing->variable == node->variable && existing->left == node->left &&
+            existing->right == node->right && memcmp(&existing->number, &node->number, sizeof(double)) == 0)
+            return existing;
+        index = (index + 1) & set->mask;
+    }
+    set->slots[index] = node;
+    return node;
+}
+
+// Check whether a node is the number value
+static int isNumber(const ASTNode *node, double value)
+{
+    return node->type == NODE_NUMBER && node->number == value;
+}
+
+// Check whether a node can produce -0: operators already replace it with 0
+static int canBeNegativeZero(const ASTNode *node)
+{
+    switch (node->type)
+    {
+    case NODE_NUMBER:
+        return node->number == 0 && signbit(node->number);
+    case NODE_ADD:
+    case NODE_SUB:
+    case NODE_MUL:
+    case NODE_DIV:
+    case NODE_NEG:
+        return 0;
+    default:
+        return 1;
+    }
+}
+
+// Apply identities that leave every result unchanged, returning the replacement node
+// x + 0, x - 0, x * 1, x / 1 and --x become x only when x cannot be -0, since the operator would turn -0 into 0
+static ASTNode *simplifyNode(ASTNode *node)
+{
+    ASTNode *left = node->left;
+    ASTNode *right = node->right;
+    switch (node->type)
+    {
+    case NODE_ADD:
+        if (isNumber(right, 0) && !canBeNegativeZero(left))
+            return left;
+        if (isNumber(left, 0) && !canBeNegativeZero(right))
+            return right;
+        break;
+    case NODE_SUB:
+        if (isNumber(right, 0) && !canBeNegativeZero(left))
+            return left;
+        break;
+    case NODE_MUL:
+        if (isNumber(right, 1) && !canBeNegativeZero(left))
+            return left;
+        if (isNumber(left, 1) && !canBeNegativeZero(right))
+            return right;
+        break;
+    case NODE_DIV:
+        if (isNumber(right, 1) && !canBeNegativeZero(left))
+            return left;
+        break;
+    case NODE_POW:
+        // x^2 = x*x, exact and also defined for negative x, unlike exp(2 ln x)
+        if (isNumber(right, 2))
+        {
+            node->type = NODE_MUL;
+            node->right = left;
+        }
+        break;
+    case NODE_NEG:
+        if (left->type == NODE_NEG && !canBeNegativeZero(left->left))
+            return left->left;
+        break;
+    default:
+        break;
+    }
+    return node;
+}
+
+// Optimize a subtree whose children are not yet optimized
+static ASTNode *optimizeNode(ASTNode *node, NodeSet *set, PrecisionTier tier)
+{
+    if (node->left != NULL)
+        node->left = optimizeNode(node->left, set, tier);
+    if (node->right != NULL)
+        node->right = optimizeNode(node->right, set, tier);
+
+    ASTNode *simplified = simplifyNode(node);
+    if (simplified != node)
+        return simplified; // A child, already optimized and shared
+
+    // Fold operators whose operands are all numbers with the tier's kernels, so results are unchanged
+    if (node->left != NULL && node->left->type == NODE_NUMBER &&
+        (node->right == NULL || node->right->type == NODE_NUMBER))
+    {
+        node->number = evaluateTier(node, NULL, tier);
+        node->type = NODE_NUMBER;
+        node->function = FN_UNKNOWN;
+        node->left = NULL;
+        node->right = NULL;
+    }
+    return internNode(set, node);
+}
+
+// Optimize a parsed tree in place before it is evaluated or compiled: fold constant subtrees,
+// apply identities such as x*1 and x^2 = x*x, and share identical subtrees so the result is a DAG.
+// A tree without variables folds down to a single number, computed with the kernels of tier
+static inline ASTNode *optimizeTree(ASTNode *root, Arena *arena, PrecisionTier tier)
+{
+    // Every original node yields at most one distinct node, so a table twice that size never fills up
+    size_t size = 16;
+    while (size < 2 * countNodes(root))
+        size *= 2;
+    NodeSet set = {(ASTNode **)arenaAlloc(arena, size * sizeof(ASTNode *)), size - 1};
+    if (set.slots == NULL)
+        return root; // Out of memory: the tree is still correct, only unoptimized
+    memset(set.slots, 0, size * sizeof(ASTNode *));
+    return optimizeNode(root, &set, tier);
+}
+
+// Find a variable by name, returning its index or -1
+static inline int findVariable(const VariableTable *table, const char *name, int length)
+{
+    for (int i = 0; i < table->count; i++)
+    {
+        if (strncmp(table->names[i], name, length) == 0 && table->names[i][length] == '\0')
+            return i;
+    }
+    return -1;
+}
+
+// Add a variable, returning its index, or -1 if the table is full or the name too long
+static inline int addVariable(VariableTable *table, const char *name, int length)
+{
+    int existing = findVariable(table, name, length);
+    if (existing >= 0)
+        return existing;
+    if (table->count == MAX_VARIABLES || length >= MAX_VARIABLE_NAME)
+        return -1;
+    memcpy(table->names[table->count], name, length);
+    table->names[table->count][length] = '\0';
+    return table->count++;
+}
+
+// Tokenize the first length characters of source with support for numbers (decimals, exponents, hex floats), negatives, and identifiers (sin, cos, tan, log_base, etc.)
+// Tokens refer to the source by offset and are allocated from the arena; numbers are decoded here once
+// Returns NULL and fills in error if the expression contains an invalid character or number
+static inline Token *tokenise(const char *source, int length, int *numTokens, Arena *arena, ParseError *error)
 {
-    char **tokens = NULL;
-    int capacity = 10;
     int count = 0;
-    tokens = (char **)malloc(capacity * sizeof(char *));
+    // Every token uses at least one character, so this is always large enough
+    Token *tokens = (Token *)arenaAlloc(arena, (length + 1) * sizeof(Token));
+    if (tokens == NULL)
+    {
+        error->position = 0;
+        snprintf(error->message, sizeof(error->message), "Out of memory");
+        *numTokens = 0;
+        return NULL;
+    }
 
     int i = 0;
-    while (expression[i] != '\0')
+    while (i < length)
     {
+        char c = source[i];
+
         // Skip whitespace
-        if (isspace(expression[i]))
+        if (isspace((unsigned char)c))
         {
             i++;
             continue;
         }
 
+        Token *token = &tokens[count];
+        token->offset = i;
+
         // If the token starts with a digit, a decimal point, or a '-' sign in a valid context, it is a number.
-        if (isdigit(expression[i]) ||
-            expression[i] == '.' ||
-            (expression[i] == '-' &&
-             ((i == 0) || (expression[i - 1] == '(') || strchr("+-*/^", expression[i - 1]) != NULL)))
+        int signedNumber = c == '-' && i + 1 < length &&
+                           (isdigit((unsigned char)source[i + 1]) || source[i + 1] == '.') &&
+                           ((i == 0) || (source[i - 1] == '(') || strchr("+-*/^", source[i - 1]) != NULL);
+        if (isdigit((unsigned char)c) || c == '.' || signedNumber)
         {
-            int start = i;
-            int dotCount = 0;
-            if (expression[i] == '-')
+            if (c == '-')
             {
                 i++;
             }
-            while (isdigit(expression[i]) || expression[i] == '.')
+            // Decimal (with an optional exponent) or hex float, decoded once here
+            int consumed;
+            double value;
+            NumberStatus status = parseNumber(source + i, length - i, &consumed, &value);
+            if (status != NUMBER_OK)
             {
-                if (expression[i] == '.')
-                {
-                    dotCount++;
-                    if (dotCount > 1)
-                    {
-                        fprintf(stderr, "Invalid number: multiple decimal points in token\n");
-                        exit(1);
-                    }
-                }
-                i++;
+                error->position = i + consumed;
+                snprintf(error->message, sizeof(error->message), "%s", numberErrors[status]);
+                *numTokens = 0;
+                return NULL;
             }
-            int len = i - start;
-            char *num = (char *)malloc((len + 1) * sizeof(char));
-            strncpy(num, expression + start, len);
-            num[len] = '\0';
-            tokens[count++] = num;
+            i += consumed;
+
+            token->kind = TOKEN_NUMBER;
+            token->number = c == '-' ? -value : value;
         }
         // If the token starts with an alphabetic character or underscore, it is an identifier (e.g., sin, cos, tan, log_base).
-        else if (isalpha(expression[i]) || expression[i] == '_')
+        else if (isalpha((unsigned char)c) || c == '_')
         {
-            int start = i;
-            while (isalpha(expression[i]) || isdigit(expression[i]) || expression[i] == '_')
+            while (i < length && (isalnum((unsigned char)source[i]) || source[i] == '_'))
                 i++;
-            int len = i - start;
-            char *id = (char *)malloc((len + 1) * sizeof(char));
-            strncpy(id, expression + start, len);
-            id[len] = '\0';
-            tokens[count++] = id;
+            token->kind = TOKEN_IDENTIFIER;
+            token->function = lookupFunction(source + token->offset, i - token->offset);
         }
         // Otherwise, it must be an operator, parenthesis, or comma.
-        else if (strchr("+-*/^(),", expression[i]) != NULL)
+        else if (c != '\0' && strchr("+-*/^(),", c) != NULL)
         {
-            char *op = (char *)malloc(2 * sizeof(char));
-            op[0] = expression[i];
-            op[1] = '\0';
-            tokens[count++] = op;
+            static const char operators[] = "+-*/^(),";
+            static const TokenKind operatorKinds[] = {TOKEN_PLUS, TOKEN_MINUS, TOKEN_STAR, TOKEN_SLASH,
+                                                      TOKEN_CARET, TOKEN_LPAREN, TOKEN_RPAREN, TOKEN_COMMA};
+            token->kind = operatorKinds[strchr(operators, c) - operators];
             i++;
         }
         else
         {
-            fprintf(stderr, "Unexpected character: %c\n", expression[i]);
-            exit(1);
+            error->position = i;
+            snprintf(error->message, sizeof(error->message), "Unexpected character: %c", c);
+            *numTokens = 0;
+            return NULL;
         }
 
-        if (count >= capacity)
-        {
-            capacity *= 2;
-            tokens = (char **)realloc(tokens, capacity * sizeof(char *));
-        }
+        token->length = i - token->offset;
+        count++;
     }
 
     *numTokens = count;
+    STATS_ADD(tokens, count);
     return tokens;
 }
 
-// Free the tokens array
-void freeTokens(char **tokens, int numTokens)
+// Tokenise, parse and evaluate a complete expression, using arena for all temporary data
+// The arena is reset afterwards, so it can be reused for the next expression
+// Returns 1 on success, or 0 with error filled in if the expression is invalid
+static inline int evaluateExpression(const char *expression, Arena *arena, double *result, ParseError *error)
+{
+    return evaluateSpan(expression, (int)strlen(expression), arena, result, error);
+}
+
+// Like evaluateExpression, for the first length characters of expression (which need no terminator)
+static inline int evaluateSpan(const char *expression, int length, Arena *arena, double *result, ParseError *error)
 {
-    for (int i = 0; i < numTokens; i++)
+    int numTokens;
+    STATS_TIMER_START(tokeniseStart);
+    Token *tokens = tokenise(expression, length, &numTokens, arena, error);
+    STATS_TIMER_STOP(tokeniseStart, PHASE_TOKENISE);
+    if (tokens == NULL)
     {
-        free(tokens[i]);
+        arenaReset(arena);
+        return 0;
     }
-    free(tokens);
+
+    STATS_TIMER_START(parseStart);
+    Parser parser = {expression, tokens, 0, numTokens, arena, NULL, {0}, 0, 0};
+    ASTNode *ast = parseExpression(&parser);
+    if (!parserFailed(&parser) && parser.pos < parser.numTokens)
+        parserError(&parser, "Unexpected token");
+    STATS_TIMER_STOP(parseStart, PHASE_PARSE);
+
+    int ok = !parserFailed(&parser);
+    if (ok)
+    {
+        STATS_TIMER_START(evaluateStart);
+        PrecisionTier tier = precisionTier();
+        *result = evaluateTier(optimizeTree(ast, arena, tier), NULL, tier);
+        STATS_TIMER_STOP(evaluateStart, PHASE_EVALUATE);
+    }
+    else
+        *error = parser.error;
+
+    arenaReset(arena);
+    return ok;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,152 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Stats.h"
+
+#define ARENA_DEFAULT_SIZE (1 << 16) // Initial arena capacity in bytes
+#define ARENA_ALIGNMENT 16           // Alignment of every allocation
+
+// One contiguous block of arena memory
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *next; // Previously filled block
+    size_t capacity;         // Usable bytes in data
+    size_t used;             // Bytes handed out from data
+    char data[];             // Allocation space
+} ArenaBlock;
+
+// Bump allocator for per-expression data: allocations are never freed individually,
+// everything is released at once by arenaReset()
+typedef struct Arena
+{
+    ArenaBlock *current;  // Block allocations are taken from
+    size_t used;          // Bytes allocated since the last reset
+    size_t highWater;     // Largest number of bytes used between two resets
+    size_t heapCalls;     // Number of blocks requested from malloc
+    size_t maxBlocks;     // Largest number of blocks alive at once
+    size_t blocks;        // Blocks currently alive
+} Arena;
+
+// Function declarations
+static inline void arenaInit(Arena *arena, size_t capacity);
+static inline void *arenaAlloc(Arena *arena, size_t size);
+static inline char *arenaStrndup(Arena *arena, const char *text, size_t length);
+static inline void arenaReset(Arena *arena);
+static inline void arenaFree(Arena *arena);
+
+// Request a new block from the heap and make it the current block
+// Returns NULL, leaving the arena as it was, if the heap is exhausted
+static ArenaBlock *arenaNewBlock(Arena *arena, size_t capacity)
+{
+    if (capacity > SIZE_MAX - sizeof(ArenaBlock))
+        return NULL;
+    ArenaBlock *block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + capacity);
+    if (block == NULL)
+        return NULL;
+    block->next = arena->current;
+    block->capacity = capacity;
+    block->used = 0;
+    arena->current = block;
+    arena->heapCalls++;
+    STATS_ADD(heapAllocations, 1);
+    arena->blocks++;
+    if (arena->blocks > arena->maxBlocks)
+        arena->maxBlocks = arena->blocks;
+    return block;
+}
+
+// Set up an arena with one block of the given capacity
+// If the block cannot be allocated, the arena starts empty and the first arenaAlloc tries again
+static inline void arenaInit(Arena *arena, size_t capacity)
+{
+    memset(arena, 0, sizeof(*arena));
+    arenaNewBlock(arena, capacity > 0 ? capacity : ARENA_DEFAULT_SIZE);
+}
+
+// Allocate size bytes, aligned to ARENA_ALIGNMENT
+// Returns NULL if the arena needs a new block and the heap cannot provide one
+static inline void *arenaAlloc(Arena *arena, size_t size)
+{
+    STATS_ADD(allocations, 1);
+    if (size > SIZE_MAX - ARENA_ALIGNMENT)
+        return NULL;
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    ArenaBlock *block = arena->current;
+    if (block == NULL || block->used + size > block->capacity)
+    {
+        // Out of space: chain a block at least twice as large as the current one
+        size_t capacity = block != NULL ? block->capacity * 2 : ARENA_DEFAULT_SIZE;
+        if (capacity < size)
+            capacity = size;
+        block = arenaNewBlock(arena, capacity);
+        if (block == NULL)
+            return NULL;
+    }
+
+    void *memory = block->data + block->used;
+    block->used += size;
+    arena->used += size;
+    if (arena->used > arena->highWater)
+        arena->highWater = arena->used;
+    return memory;
+}
+
+// Copy length bytes of text into the arena as a NUL-terminated string, or return NULL if it is full
+static inline char *arenaStrndup(Arena *arena, const char *text, size_t length)
+{
+    char *copy = (char *)arenaAlloc(arena, length + 1);
+    if (copy == NULL)
+        return NULL;
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+// Release every allocation at once
+// If the arena had to grow, its blocks are merged into one large enough for the high-water mark,
+// so later expressions of the same size need no heap calls at all. Should that block not be available,
+// the newest (largest) block is kept instead
+static inline void arenaReset(Arena *arena)
+{
+    ArenaBlock *block = arena->current;
+    if (block == NULL)
+        return;
+    if (block->next != NULL)
+    {
+        ArenaBlock *old = block->next;
+        while (old != NULL)
+        {
+            ArenaBlock *next = old->next;
+            free(old);
+            old = next;
+        }
+        block->next = NULL;
+        arena->blocks = 1;
+        if (arenaNewBlock(arena, arena->highWater) != NULL)
+        {
+            arena->current->next = NULL;
+            arena->blocks = 1;
+            free(block);
+        }
+    }
+    arena->current->used = 0;
+    arena->used = 0;
+}
+
+// Free all memory owned by the arena
+static inline void arenaFree(Arena *arena)
+{
+    ArenaBlock *block = arena->current;
+    while (block != NULL)
+    {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    memset(arena, 0, sizeof(*arena));
+}
+
+#endif
@@ -0,0 +1,630 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ASTFunctions.h"
+#include "ExpressionCache.h"
+#include "Arena.h"
+#include "WorkPool.h"
+#include "NumberFormat.h"
+#include <limits.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#define BATCH_MAPPED_INPUT 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#define BATCH_MAPPED_INPUT 0
+#endif
+
+#define BATCH_CHUNK_SIZE (1 << 20)   // Bytes read from the input per fread call
+#define OUTPUT_BUFFER_SIZE (1 << 16) // Bytes collected before results are written out
+#define BATCH_TASK_SIZE (1 << 16)    // Input bytes per task in threaded batch mode
+#define BATCH_TASKS_PER_THREAD 8     // Tasks per worker in each block of input read by threaded batch mode
+#define BATCH_MAP_WINDOW (64 << 20)  // Bytes of a file mapped at once by runBatchMapped
+
+// How results are written
+typedef enum OutputFormat
+{
+    FORMAT_FIXED,    // precision decimals, like printf("%.*f") (the default, with 6 decimals)
+    FORMAT_SHORTEST, // Text that reads back as the same double, shortest in nearly all cases
+    FORMAT_BINARY    // Raw little-endian doubles, 8 bytes per line (errors become NaN)
+} OutputFormat;
+
+// Buffered writer so results are written in large blocks instead of one call per line
+typedef struct OutputBuffer
+{
+    FILE *stream;        // Destination stream, or NULL to collect everything in memory
+    char *data;          // Pending output
+    size_t length;       // Number of pending bytes
+    size_t capacity;     // Size of data
+    OutputFormat format; // How outputResult writes results
+    int precision;       // Decimals of FORMAT_FIXED
+} OutputBuffer;
+
+// A run of complete input lines evaluated by one worker; results stay in out until they are written in order
+typedef struct BatchTask
+{
+    const char *start;  // First line
+    size_t length;      // Bytes of input, ending with a newline except for the last line of the input
+    OutputBuffer out;   // Results of the task (in memory)
+    long failures;      // Lines that failed to evaluate
+    int done;           // Set by the worker when out is complete
+} BatchTask;
+
+// State shared between the reading thread and the workers of a threaded batch
+typedef struct BatchShared
+{
+    Arena *arenas;           // One arena per worker
+    ExpressionCache *caches; // One cache per worker, or NULL when caching is off
+    pthread_mutex_t lock;    // Protects the done flags
+    pthread_cond_t done;     // Signalled whenever a task completes
+} BatchShared;
+
+// Worker pool and task lists of a threaded batch, shared by the stdio and mapped input paths
+typedef struct BatchRunner
+{
+    WorkPool pool;
+    BatchShared shared;
+    int numThreads;
+    BatchTask *tasks[2];   // Tasks of the block being evaluated and of the block before it
+    int taskCapacities[2]; // Allocated entries in tasks
+    void **items;          // Task pointers handed to the pool
+    int itemCapacity;      // Allocated entries in items
+} BatchRunner;
+
+// Function declarations
+static inline void outputInit(OutputBuffer *out, FILE *stream, size_t capacity);
+static inline void outputFlush(OutputBuffer *out);
+static inline void outputWrite(OutputBuffer *out, const char *data, size_t length);
+static inline void outputResult(OutputBuffer *out, double result);
+static inline void outputError(OutputBuffer *out, const ParseError *error);
+static inline void outputFree(OutputBuffer *out);
+static inline void processLine(const char *line, size_t length, Arena *arena, ExpressionCache *cache, OutputBuffer *out,
+                               long *failures);
+static inline void processLines(const char *data, size_t length, Arena *arena, ExpressionCache *cache,
+                                OutputBuffer *out, long *failures);
+static inline long runBatch(FILE *input, Arena *arena, ExpressionCache *cache, OutputBuffer *out);
+static inline long runBatchThreaded(FILE *input, int numThreads, ExpressionCache *cache, OutputBuffer *out);
+#if BATCH_MAPPED_INPUT
+static inline int runBatchMapped(const char *path, int numThreads, ExpressionCache *cache, OutputBuffer *out,
+                                 long *failures);
+#endif
+
+// Set up an output buffer writing to stream
+static inline void outputInit(OutputBuffer *out, FILE *stream, size_t capacity)
+{
+    out->stream = stream;
+    out->data = (char *)malloc(capacity);
+    out->length = 0;
+    out->capacity = capacity;
+    out->format = FORMAT_FIXED;
+    out->precision = 6;
+}
+
+// Write all pending output to the stream (memory buffers keep their contents)
+static inline void outputFlush(OutputBuffer *out)
+{
+    if (out->length > 0 && out->stream != NULL)
+    {
+        fwrite(out->data, 1, out->length, out->stream);
+        out->length = 0;
+    }
+}
+
+// Append bytes to the output buffer, flushing when it is full
+static inline void outputWrite(OutputBuffer *out, const char *data, size_t length)
+{
+    if (out->length + length > out->capacity && out->stream == NULL)
+    {
+        while (out->length + length > out->capacity)
+            out->capacity *= 2;
+        out->data = (char *)realloc(out->data, out->capacity);
+    }
+    else if (out->length + length > out->capacity)
+    {
+        outputFlush(out);
+        if (length > out->capacity)
+        {
+            fwrite(data, 1, length, out->stream); // Too large to buffer, write directly
+            return;
+        }
+    }
+    memcpy(out->data + out->length, data, length);
+    out->length += length;
+}
+
+// Append a result line (or 8 bytes in binary format)
+static inline void outputResult(OutputBuffer *out, double result)
+{
+    char line[FORMAT_BUFFER_SIZE + 1];
+    STATS_TIMER_START(outputStart);
+    int length;
+    if (out->format == FORMAT_BINARY)
+    {
+        uint64_t bits;
+        memcpy(&bits, &result, sizeof(bits));
+        for (length = 0; length < 8; length++)
+            line[length] = (char)(bits >> (8 * length));
+    }
+    else
+    {
+        length = out->format == FORMAT_SHORTEST ? formatShortest(result, line) : formatFixed(result, out->precision, line);
+        line[length++] = '\n';
+    }
+    outputWrite(out, line, (size_t)length);
+    STATS_TIMER_STOP(outputStart, PHASE_OUTPUT);
+}
+
+// Append an error line so the output stays aligned with the input lines (a NaN in binary format)
+static inline void outputError(OutputBuffer *out, const ParseError *error)
+{
+    if (out->format == FORMAT_BINARY)
+    {
+        outputResult(out, NAN);
+        return;
+    }
+    char line[160];
+    STATS_TIMER_START(outputStart);
+    int length = snprintf(line, sizeof(line), "Error: %s (at %d)\n", error->message, error->position);
+    outputWrite(out, line, (size_t)length);
+    STATS_TIMER_STOP(outputStart, PHASE_OUTPUT);
+}
+
+// Flush and release the output buffer
+static inline void outputFree(OutputBuffer *out)
+{
+    outputFlush(out);
+    free(out->data);
+    out->data = NULL;
+    out->capacity = 0;
+}
+
+// First newline in [start, end), or end if there is none; scans 16 bytes at a time with SSE2
+static inline const char *findNewline(const char *start, const char *end)
+{
+#ifdef __SSE2__
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - start >= 16)
+    {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)start), newline));
+        if (mask != 0)
+            return start + __builtin_ctz(mask);
+        start += 16;
+    }
+#endif
+    while (start < end && *start != '\n')
+        start++;
+    return start;
+}
+
+// Evaluate one input line in place (it needs no terminator) and append its result or error
+// Lines go through cache when one is given
+static inline void processLine(const char *line, size_t length, Arena *arena, ExpressionCache *cache, OutputBuffer *out,
+                               long *failures)
+{
+    if (length > 0 && line[length - 1] == '\r')
+        length--; // Accept CRLF line endings
+
+    double result;
+    ParseError error = {0};
+    int ok;
+    if (cache != NULL)
+    {
+        ok = cacheEvaluate(cache, line, length, arena, &result, &error);
+    }
+    else if (length > INT_MAX)
+    {
+        snprintf(error.message, sizeof(error.message), "Line too long");
+        ok = 0;
+    }
+    else
+    {
+        ok = evaluateSpan(line, (int)length, arena, &result, &error);
+    }
+    if (ok)
+    {
+        outputResult(out, result);
+    }
+    else
+    {
+        outputError(out, &error);
+        (*failures)++;
+    }
+}
+
+// Evaluate every line of data, including a final line without a newline
+static inline void processLines(const char *data, size_t length, Arena *arena, ExpressionCache *cache,
+                                OutputBuffer *out, long *failures)
+{
+    const char *line = data;
+    const char *end = data + length;
+    while (line < end)
+    {
+        const char *newline = findNewline(line, end);
+        processLine(line, (size_t)(newline - line), arena, cache, out, failures);
+        line = newline + 1;
+    }
+}
+
+// Evaluate newline-delimited expressions from input until end of file
+// All per-line allocations come from arena, which is reset after every line; repeated lines are
+// answered from cache (NULL evaluates every line from scratch)
+// Returns the number of lines that failed to evaluate
+static inline long runBatch(FILE *input, Arena *arena, ExpressionCache *cache, OutputBuffer *out)
+{
+    size_t capacity = BATCH_CHUNK_SIZE;
+    char *buffer = (char *)malloc(capacity + 1); // +1 so the last line can always be terminated
+    size_t filled = 0;
+    long failures = 0;
+
+    while (1)
+    {
+        if (filled == capacity)
+        {
+            // A single line fills the whole buffer, grow it so the line fits
+            capacity *= 2;
+            buffer = (char *)realloc(buffer, capacity + 1);
+        }
+
+        size_t bytesRead = fread(buffer + filled, 1, capacity - filled, input);
+        if (bytesRead == 0)
+            break;
+        filled += bytesRead;
+
+        // Process every complete line in the buffer
+        const char *start = buffer;
+        const char *end = buffer + filled;
+        const char *newline;
+        while ((newline = findNewline(start, end)) != end)
+        {
+            processLine(start, (size_t)(newline - start), arena, cache, out, &failures);
+            start = newline + 1;
+        }
+
+        // Keep the incomplete last line for the next read
+        filled = (size_t)(end - start);
+        memmove(buffer, start, filled);
+    }
+
+    if (filled > 0)
+        processLine(buffer, filled, arena, cache, out, &failures); // Final line without a trailing newline
+
+    free(buffer);
+    return failures;
+}
+
+// Evaluate every line of a task into its own output buffer (run on a worker thread)
+static void runBatchTask(void *item, int worker, void *context)
+{
+    BatchTask *task = (BatchTask *)item;
+    BatchShared *shared = (BatchShared *)context;
+    processLines(task->start, task->length, &shared->arenas[worker], shared->caches ? &shared->caches[worker] : NULL,
+                 &task->out, &task->failures);
+
+    pthread_mutex_lock(&shared->lock);
+    task->done = 1;
+    pthread_cond_broadcast(&shared->done);
+    pthread_mutex_unlock(&shared->lock);
+}
+
+// Read into buffer after the filled bytes until it is full or the input ends, growing it while it
+// holds no complete line. Returns the bytes in the buffer and sets *complete to the length of its
+// complete lines (everything once the input has ended)
+static size_t readBatchBlock(FILE *input, char **buffer, size_t *capacity, size_t filled, int *eof, size_t *complete)
+{
+    while (1)
+    {
+        if (!*eof)
+        {
+            size_t wanted = *capacity - filled;
+            size_t bytesRead = fread(*buffer + filled, 1, wanted, input);
+            filled += bytesRead;
+            if (bytesRead < wanted)
+                *eof = 1;
+        }
+        if (*eof)
+        {
+            *complete = filled;
+            return filled;
+        }
+
+        size_t end = filled;
+        while (end > 0 && (*buffer)[end - 1] != '\n')
+            end--;
+        if (end > 0)
+        {
+            *complete = end;
+            return filled;
+        }
+
+        // A single line fills the whole buffer, grow it so the line fits
+        *capacity *= 2;
+        *buffer = (char *)realloc(*buffer, *capacity + 1);
+    }
+}
+
+// Split the first length bytes of buffer (complete lines) into tasks of about BATCH_TASK_SIZE bytes
+// Task results are formatted like out
+static int splitBatchBlock(const char *buffer, size_t length, BatchTask **tasks, int *capacity, const OutputBuffer *out)
+{
+    int count = 0;
+    size_t position = 0;
+    while (position < length)
+    {
+        size_t end = length;
+        if (length - position > BATCH_TASK_SIZE)
+        {
+            const char *newline = findNewline(buffer + position + BATCH_TASK_SIZE, buffer + length);
+            if (newline != buffer + length)
+                end = (size_t)(newline - buffer) + 1;
+        }
+
+        if (count == *capacity)
+        {
+            *capacity = *capacity ? *capacity * 2 : 64;
+            *tasks = (BatchTask *)realloc(*tasks, *capacity * sizeof(BatchTask));
+            for (int i = count; i < *capacity; i++)
+                outputInit(&(*tasks)[i].out, NULL, BATCH_TASK_SIZE);
+        }
+        BatchTask *task = &(*tasks)[count++];
+        task->start = buffer + position;
+        task->length = end - position;
+        task->out.length = 0;
+        task->out.format = out->format;
+        task->out.precision = out->precision;
+        task->failures = 0;
+        task->done = 0;
+        position = end;
+    }
+    return count;
+}
+
+// Free the per-worker caches, adding their counters to cache
+static void batchRunnerFreeCaches(BatchRunner *runner, ExpressionCache *cache)
+{
+    if (runner->shared.caches == NULL)
+        return;
+    for (int i = 0; i < runner->numThreads; i++)
+    {
+        cacheAddCounters(cache, &runner->shared.caches[i]);
+        cacheFree(&runner->shared.caches[i]);
+    }
+    free(runner->shared.caches);
+}
+
+// Start the workers of a threaded batch; returns 0 (with nothing left allocated) if no threads could start
+// With a cache, every worker gets its own with an equal share of its budget
+static int batchRunnerInit(BatchRunner *runner, int numThreads, ExpressionCache *cache)
+{
+    memset(runner, 0, sizeof(*runner));
+    runner->numThreads = numThreads;
+    runner->shared.arenas = (Arena *)malloc(numThreads * sizeof(Arena));
+    for (int i = 0; i < numThreads; i++)
+        arenaInit(&runner->shared.arenas[i], ARENA_DEFAULT_SIZE);
+    if (cache != NULL)
+    {
+        runner->shared.caches = (ExpressionCache *)malloc(numThreads * sizeof(ExpressionCache));
+        for (int i = 0; i < numThreads; i++)
+            cacheInit(&runner->shared.caches[i], cache->budget / numThreads, cache->variables);
+    }
+    pthread_mutex_init(&runner->shared.lock, NULL);
+    pthread_cond_init(&runner->shared.done, NULL);
+    if (workPoolInit(&runner->pool, numThreads, runBatchTask, &runner->shared))
+        return 1;
+
+    for (int i = 0; i < numThreads; i++)
+        arenaFree(&runner->shared.arenas[i]);
+    free(runner->shared.arenas);
+    batchRunnerFreeCaches(runner, cache);
+    pthread_mutex_destroy(&runner->shared.lock);
+    pthread_cond_destroy(&runner->shared.done);
+    return 0;
+}
+
+// Split complete lines into the tasks of one side and hand them to the workers; returns the number of tasks
+static int batchRunnerSubmit(BatchRunner *runner, int side, const char *data, size_t length, const OutputBuffer *out)
+{
+    int numTasks = splitBatchBlock(data, length, &runner->tasks[side], &runner->taskCapacities[side], out);
+    if (numTasks > runner->itemCapacity)
+    {
+        runner->itemCapacity = numTasks;
+        runner->items = (void **)realloc(runner->items, runner->itemCapacity * sizeof(void *));
+    }
+    for (int i = 0; i < numTasks; i++)
+        runner->items[i] = &runner->tasks[side][i];
+    workPoolSubmit(&runner->pool, runner->items, numTasks);
+    return numTasks;
+}
+
+// Reorder buffer: write the results of one side's tasks in input order as they finish
+// Returns the number of lines that failed to evaluate
+static long batchRunnerCollect(BatchRunner *runner, int side, int numTasks, OutputBuffer *out)
+{
+    long failures = 0;
+    for (int i = 0; i < numTasks; i++)
+    {
+        BatchTask *task = &runner->tasks[side][i];
+        pthread_mutex_lock(&runner->shared.lock);
+        while (!task->done)
+            pthread_cond_wait(&runner->shared.done, &runner->shared.lock);
+        pthread_mutex_unlock(&runner->shared.lock);
+        outputWrite(out, task->out.data, task->out.length);
+        failures += task->failures;
+    }
+    return failures;
+}
+
+// Stop the workers and release the runner, adding the counters of the worker caches to cache
+static void batchRunnerFree(BatchRunner *runner, ExpressionCache *cache)
+{
+    workPoolFree(&runner->pool);
+    for (int side = 0; side < 2; side++)
+    {
+        for (int i = 0; i < runner->taskCapacities[side]; i++)
+            outputFree(&runner->tasks[side][i].out);
+        free(runner->tasks[side]);
+    }
+    for (int i = 0; i < runner->numThreads; i++)
+        arenaFree(&runner->shared.arenas[i]);
+    free(runner->shared.arenas);
+    batchRunnerFreeCaches(runner, cache);
+    free(runner->items);
+    pthread_mutex_destroy(&runner->shared.lock);
+    pthread_cond_destroy(&runner->shared.done);
+}
+
+// Evaluate newline-delimited expressions like runBatch, on numThreads worker threads
+// Input is read in blocks split into tasks that a work-stealing pool evaluates; while the workers run,
+// the next block is read and finished tasks are written out in input order, so the output is
+// byte-identical to runBatch. Each worker has its own arena (and cache) and every task its own output buffer.
+// Returns the number of lines that failed to evaluate
+static inline long runBatchThreaded(FILE *input, int numThreads, ExpressionCache *cache, OutputBuffer *out)
+{
+    BatchRunner runner;
+    if (!batchRunnerInit(&runner, numThreads, cache))
+    {
+        // No threads available, evaluate on this thread instead
+        Arena arena;
+        arenaInit(&arena, ARENA_DEFAULT_SIZE);
+        long failures = runBatch(input, &arena, cache, out);
+        arenaFree(&arena);
+        return failures;
+    }
+
+    // Two blocks alternate: one is being evaluated while the next one is read
+    size_t blockSize = (size_t)numThreads * BATCH_TASKS_PER_THREAD * BATCH_TASK_SIZE;
+    if (blockSize < BATCH_CHUNK_SIZE)
+        blockSize = BATCH_CHUNK_SIZE;
+    char *buffers[2];
+    size_t capacities[2] = {blockSize, blockSize};
+    buffers[0] = (char *)malloc(blockSize + 1); // +1 so the last line can always be terminated
+    buffers[1] = (char *)malloc(blockSize + 1);
+
+    int eof = 0;
+    size_t complete;
+    size_t filled = readBatchBlock(input, &buffers[0], &capacities[0], 0, &eof, &complete);
+    long failures = 0;
+    int current = 0;
+
+    while (filled > 0)
+    {
+        int numTasks = batchRunnerSubmit(&runner, current, buffers[current], complete, out);
+
+        // Carry the incomplete last line over and read the next block while the workers run
+        int next = 1 - current;
+        size_t carried = filled - complete;
+        if (carried + 1 > capacities[next])
+        {
+            capacities[next] = carried * 2;
+            buffers[next] = (char *)realloc(buffers[next], capacities[next] + 1);
+        }
+        memcpy(buffers[next], buffers[current] + complete, carried);
+        filled = readBatchBlock(input, &buffers[next], &capacities[next], carried, &eof, &complete);
+
+        failures += batchRunnerCollect(&runner, current, numTasks, out);
+        current = next;
+    }
+
+    batchRunnerFree(&runner, cache);
+    free(buffers[0]);
+    free(buffers[1]);
+    return failures;
+}
+
+#if BATCH_MAPPED_INPUT
+
+// Evaluate a regular file through read-only memory mappings instead of stdio, on numThreads threads
+// The file is mapped BATCH_MAP_WINDOW bytes at a time (more if a single line is longer), so resident
+// memory stays flat whatever the file size; lines are evaluated in place straight from the mapping,
+// and with several threads each window is split into tasks by byte range. Output is byte-identical
+// to runBatch. Returns 1 with *failures set, 0 if the file cannot be mapped (not a regular file, or
+// empty as /proc files claim to be) so the caller can read it with stdio instead, or -1 if it
+// cannot be opened
+static inline int runBatchMapped(const char *path, int numThreads, ExpressionCache *cache, OutputBuffer *out, long *failures)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    BatchRunner runner;
+    int threaded = numThreads > 1 && batchRunnerInit(&runner, numThreads, cache);
+    Arena arena;
+    if (!threaded)
+        arenaInit(&arena, ARENA_DEFAULT_SIZE);
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (size_t)info.st_size;
+    size_t window = BATCH_MAP_WINDOW;
+    size_t position = 0; // First byte not evaluated yet
+    int status = 1;
+    *failures = 0;
+
+    while (position < size)
+    {
+        size_t mapStart = position - position % page;
+        size_t mapLength = size - mapStart < window ? size - mapStart : window;
+        void *map = mmap(NULL, mapLength, PROT_READ, MAP_PRIVATE, fd, (off_t)mapStart);
+        if (map == MAP_FAILED)
+        {
+            status = position == 0 ? 0 : -1; // Before any output the caller can still fall back to stdio
+            break;
+        }
+        madvise(map, mapLength, MADV_SEQUENTIAL);
+        const char *data = (const char *)map + (position - mapStart);
+        size_t length = mapStart + mapLength - position;
+
+        // Stop at the last newline unless the window reaches the end of the file
+        if (mapStart + mapLength < size)
+        {
+            while (length > 0 && data[length - 1] != '\n')
+                length--;
+            if (length == 0)
+            {
+                // One line is longer than the window, retry with a larger one
+                munmap(map, mapLength);
+                window *= 2;
+                continue;
+            }
+#ifdef POSIX_FADV_WILLNEED
+            // Start reading the next window while this one is evaluated
+            posix_fadvise(fd, (off_t)(position + length), (off_t)window, POSIX_FADV_WILLNEED);
+#endif
+        }
+
+        if (threaded)
+        {
+            int numTasks = batchRunnerSubmit(&runner, 0, data, length, out);
+            *failures += batchRunnerCollect(&runner, 0, numTasks, out);
+        }
+        else
+        {
+            processLines(data, length, &arena, cache, out, failures);
+        }
+        munmap(map, mapLength);
+        position += length;
+    }
+
+    if (threaded)
+        batchRunnerFree(&runner, cache);
+    else
+        arenaFree(&arena);
+    close(fd);
+    return status;
+}
+
+#endif
+
+#endif
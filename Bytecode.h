@@ -0,0 +1,485 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ASTFunctions.h"
+#include "MathFunctions.h"
+
+#define PROGRAM_STACK_SIZE 128 // Maximum value stack depth of a compiled program
+#define PROGRAM_TEMP_SIZE 64   // Maximum number of shared subexpression values a program keeps
+#define COLUMN_BLOCK_SIZE 256  // Rows evaluated together by evaluateColumns, sized so the working set stays in L1
+
+// Instruction set of the postfix evaluator
+typedef enum OpCode
+{
+    OP_CONST, // Push constants[operand], followed by the operand
+    OP_VAR,   // Push the value of a variable, followed by its index
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_POW,
+    OP_NEG,
+    OP_CALL1, // Apply a one-argument function, followed by its FunctionId
+    OP_CALL2, // Apply a two-argument function, followed by its FunctionId
+    OP_STORE, // Copy the top of the stack into temporary operand, leaving it on the stack
+    OP_LOAD,  // Push temporary operand
+    OP_PAIR,  // Pop x and run fused pair operand 1 on it, storing both results in the temporaries of operands 2 and 3
+    OP_RETURN // Stop and return the top of the stack
+} OpCode;
+
+// Compiled expression: flat postfix code plus a pool of decoded constants
+typedef struct Program
+{
+    int *code;          // Opcodes, each OP_CONST/OP_VAR/OP_CALL/OP_STORE/OP_LOAD followed by its operand (OP_PAIR by three)
+    int codeLength;     // Number of entries used in code
+    int codeCapacity;   // Allocated entries in code
+    double *constants;  // Constant pool
+    int numConstants;   // Number of entries used in constants
+    int constCapacity;  // Allocated entries in constants
+    int maxStack;       // Deepest value stack the program needs
+    int numVariables;   // Number of variables the program reads
+    int numTemps;       // Number of temporaries holding shared subexpressions
+    PrecisionTier tier; // Kernels that fold constants and evaluate function calls
+} Program;
+
+// Function declarations
+static inline void initProgram(Program *program);
+static inline void freeProgram(Program *program);
+static inline int compileProgram(ASTNode *ast, Program *program, ParseError *error);
+static inline int compileExpression(const char *expression, VariableTable *variables, Arena *arena, Program *program,
+                                    ParseError *error);
+static inline int compileSpan(const char *expression, int length, VariableTable *variables, Arena *arena,
+                              Program *program, ParseError *error);
+static inline double runProgram(const Program *program, const double *variables);
+static inline int evaluateColumns(const Program *program, const double *const *columns, double *out, size_t rows);
+
+// Opcodes for each operator node type, indexed by NodeType
+static const OpCode operatorOpcodes[] = {OP_CONST, OP_VAR, OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_POW, OP_NEG};
+
+// Prepare an empty program using the default precision tier (set program->tier afterwards to choose another)
+static inline void initProgram(Program *program)
+{
+    memset(program, 0, sizeof(*program));
+    program->tier = precisionTier();
+}
+
+// Release the code and constant pool of a program, which keeps its precision tier
+static inline void freeProgram(Program *program)
+{
+    PrecisionTier tier = program->tier;
+    free(program->code);
+    free(program->constants);
+    initProgram(program);
+    program->tier = tier;
+}
+
+// Append one code entry
+static void emitCode(Program *program, int value)
+{
+    if (program->codeLength == program->codeCapacity)
+    {
+        program->codeCapacity = program->codeCapacity ? program->codeCapacity * 2 : 32;
+        program->code = (int *)realloc(program->code, program->codeCapacity * sizeof(int));
+    }
+    program->code[program->codeLength++] = value;
+}
+
+// Append a constant to the pool and return its index
+static int addConstant(Program *program, double value)
+{
+    if (program->numConstants == program->constCapacity)
+    {
+        program->constCapacity = program->constCapacity ? program->constCapacity * 2 : 16;
+        program->constants = (double *)realloc(program->constants, program->constCapacity * sizeof(double));
+    }
+    program->constants[program->numConstants] = value;
+    return program->numConstants++;
+}
+
+// Clear the bookkeeping fields of every node
+static void resetUses(ASTNode *node)
+{
+    if (node == NULL)
+        return;
+    node->uses = 0;
+    node->slot = -1;
+    node->partner = NULL;
+    resetUses(node->left);
+    resetUses(node->right);
+}
+
+// Count the parents of every node, visiting each shared node's children only once
+// Distinct calls of functions that have a fused kernel are collected in calls
+static void countUses(ASTNode *node, ASTNode **calls, int *numCalls)
+{
+    if (node == NULL || node->uses++ > 0)
+        return;
+    if (node->type == NODE_FUNCTION && isFusable(node->function) && *numCalls < PROGRAM_TEMP_SIZE)
+        calls[(*numCalls)++] = node;
+    countUses(node->left, calls, numCalls);
+    countUses(node->right, calls, numCalls);
+}
+
+// Link calls on the same argument that one fused kernel computes together, e.g. sin(e) and cos(e)
+static void pairCalls(ASTNode **calls, int numCalls)
+{
+    for (int i = 0; i < numCalls; i++)
+    {
+        for (int j = i + 1; j < numCalls && calls[i]->partner == NULL; j++)
+        {
+            if (calls[j]->partner == NULL && calls[i]->left == calls[j]->left &&
+                findFusedPair(calls[i]->function, calls[j]->function) >= 0)
+            {
+                calls[i]->partner = calls[j];
+                calls[j]->partner = calls[i];
+            }
+        }
+    }
+}
+
+// Emit postfix code for a subtree, tracking the stack depth (returns 0 if the stack would overflow)
+// A shared subtree is computed once and stored in a temporary, later uses just load it
+static int compileNode(ASTNode *node, Program *program, int depth, ParseError *error)
+{
+    // Leaf node: copy the decoded number into the constant pool, read the variable, or load a computed value
+    if (node->type == NODE_NUMBER || node->type == NODE_VARIABLE || node->slot >= 0)
+    {
+        if (depth + 1 > PROGRAM_STACK_SIZE)
+        {
+            snprintf(error->message, sizeof(error->message), "Expression too deeply nested to compile");
+            return 0;
+        }
+        if (depth + 1 > program->maxStack)
+            program->maxStack = depth + 1;
+        if (node->slot >= 0)
+        {
+            emitCode(program, OP_LOAD);
+            emitCode(program, node->slot);
+            return 1;
+        }
+        if (node->type == NODE_VARIABLE)
+        {
+            emitCode(program, OP_VAR);
+            emitCode(program, node->variable);
+            if (node->variable + 1 > program->numVariables)
+                program->numVariables = node->variable + 1;
+            return 1;
+        }
+        emitCode(program, OP_CONST);
+        emitCode(program, addConstant(program, node->number));
+        return 1;
+    }
+
+    if (!compileNode(node->left, program, depth, error))
+        return 0;
+    if (node->right != NULL && !compileNode(node->right, program, depth + 1, error))
+        return 0;
+
+    if (node->type == NODE_FUNCTION && node->partner != NULL && program->numTemps + 2 <= PROGRAM_TEMP_SIZE)
+    {
+        // First of two sibling calls: compute both, the partner later just loads its result
+        int pair = findFusedPair(node->function, node->partner->function);
+        int first = program->numTemps++;
+        int second = program->numTemps++;
+        int own = node->function == fusedPairs[pair].first;
+        node->slot = own ? first : second;
+        node->partner->slot = own ? second : first;
+        emitCode(program, OP_PAIR);
+        emitCode(program, pair);
+        emitCode(program, first);
+        emitCode(program, second);
+        emitCode(program, OP_LOAD);
+        emitCode(program, node->slot);
+        return 1;
+    }
+    else if (node->type == NODE_FUNCTION)
+    {
+        emitCode(program, functionRegistry[node->function].arity == 2 ? OP_CALL2 : OP_CALL1);
+        emitCode(program, node->function);
+    }
+    else
+    {
+        emitCode(program, operatorOpcodes[node->type]);
+    }
+
+    // Keep the value of a shared subtree (when temporaries run out, later uses recompute it)
+    if (node->uses > 1 && program->numTemps < PROGRAM_TEMP_SIZE)
+    {
+        node->slot = program->numTemps++;
+        emitCode(program, OP_STORE);
+        emitCode(program, node->slot);
+    }
+    return 1;
+}
+
+// Compile a parsed tree into program (any previous contents are discarded)
+// Returns 1 on success, or 0 with error filled in
+static inline int compileProgram(ASTNode *ast, Program *program, ParseError *error)
+{
+    freeProgram(program);
+    ASTNode *calls[PROGRAM_TEMP_SIZE];
+    int numCalls = 0;
+    resetUses(ast);
+    countUses(ast, calls, &numCalls);
+    pairCalls(calls, numCalls);
+    if (!compileNode(ast, program, 0, error))
+    {
+        freeProgram(program);
+        return 0;
+    }
+    emitCode(program, OP_RETURN);
+    return 1;
+}
+
+// Tokenise, parse and compile an expression so it can be run repeatedly with runProgram
+// Names that are not functions are looked up in variables (NULL allows none)
+// Temporary data comes from arena, which is reset afterwards; the program owns its own memory
+static inline int compileExpression(const char *expression, VariableTable *variables, Arena *arena, Program *program,
+                                    ParseError *error)
+{
+    return compileSpan(expression, (int)strlen(expression), variables, arena, program, error);
+}
+
+// Like compileExpression, for the first length characters of expression (which need no terminator)
+static inline int compileSpan(const char *expression, int length, VariableTable *variables, Arena *arena,
+                              Program *program, ParseError *error)
+{
+    int numTokens;
+    STATS_TIMER_START(tokeniseStart);
+    Token *tokens = tokenise(expression, length, &numTokens, arena, error);
+    STATS_TIMER_STOP(tokeniseStart, PHASE_TOKENISE);
+    if (tokens == NULL)
+    {
+        arenaReset(arena);
+        return 0;
+    }
+
+    STATS_TIMER_START(parseStart);
+    Parser parser = {expression, tokens, 0, numTokens, arena, variables, {0}, 0, 0};
+    ASTNode *ast = parseExpression(&parser);
+    if (!parserFailed(&parser) && parser.pos < parser.numTokens)
+        parserError(&parser, "Unexpected token");
+    STATS_TIMER_STOP(parseStart, PHASE_PARSE);
+
+    int ok;
+    if (parserFailed(&parser))
+    {
+        *error = parser.error;
+        ok = 0;
+    }
+    else
+    {
+        ok = compileProgram(optimizeTree(ast, arena, program->tier), program, error);
+    }
+
+    arenaReset(arena);
+    return ok;
+}
+
+// Replace negative zero with zero, as evaluate() does for operators
+static inline double positiveZero(double x)
+{
+    return (x == 0 && signbit(x)) ? 0.0 : x;
+}
+
+// Run a compiled program and return its result
+// variables holds the value of each variable, indexed like the VariableTable it was compiled with
+static inline double runProgram(const Program *program, const double *variables)
+{
+    double stack[PROGRAM_STACK_SIZE];
+    double temps[PROGRAM_TEMP_SIZE];
+    double *sp = stack; // Points one past the top of the stack
+    const int *pc = program->code;
+    const double *constants = program->constants;
+    const KernelTable *kernels = &kernelTables[program->tier];
+
+    for (;;)
+    {
+        switch (*pc++)
+        {
+        case OP_CONST:
+            *sp++ = constants[*pc++];
+            break;
+        case OP_VAR:
+            *sp++ = variables[*pc++];
+            break;
+        case OP_ADD:
+            sp--;
+            sp[-1] = positiveZero(sp[-1] + sp[0]);
+            break;
+        case OP_SUB:
+            sp--;
+            sp[-1] = positiveZero(sp[-1] - sp[0]);
+            break;
+        case OP_MUL:
+            sp--;
+            sp[-1] = positiveZero(sp[-1] * sp[0]);
+            break;
+        case OP_DIV:
+            sp--;
+            sp[-1] = positiveZero(sp[-1] / sp[0]);
+            break;
+        case OP_POW:
+            sp--;
+            sp[-1] = kernels->functions[FN_POW].binary(sp[-1], sp[0]);
+            break;
+        case OP_NEG:
+            sp[-1] = positiveZero(-sp[-1]);
+            break;
+        case OP_CALL1:
+            STATS_CALLS(*pc, 1);
+            sp[-1] = kernels->functions[*pc++].unary(sp[-1]);
+            break;
+        case OP_CALL2:
+            STATS_CALLS(*pc, 1);
+            sp--;
+            sp[-1] = kernels->functions[*pc++].binary(sp[-1], sp[0]);
+            break;
+        case OP_STORE:
+            temps[*pc++] = sp[-1];
+            break;
+        case OP_LOAD:
+            *sp++ = temps[*pc++];
+            break;
+        case OP_PAIR:
+            STATS_CALLS(fusedPairs[pc[0]].first, 1);
+            STATS_CALLS(fusedPairs[pc[0]].second, 1);
+            sp--;
+            kernels->pairs[pc[0]].kernel(sp[0], &temps[pc[1]], &temps[pc[2]]);
+            pc += 3;
+            break;
+        case OP_RETURN:
+        default:
+            return sp[-1];
+        }
+    }
+}
+
+// Evaluate a program over rows of columnar data: row i reads variable v from columns[v][i]
+// and its result is stored in out[i]. Rows are processed COLUMN_BLOCK_SIZE at a time, each
+// instruction running as one loop or array kernel over the whole block.
+// Returns 1 on success, or 0 if the block workspace could not be allocated
+static inline int evaluateColumns(const Program *program, const double *const *columns, double *out, size_t rows)
+{
+    // One block-sized buffer per stack slot, plus a spare so array kernels never run in place, then one per temporary
+    int numBuffers = program->maxStack + 1;
+    double *workspace = (double *)malloc((size_t)(numBuffers + program->numTemps) * COLUMN_BLOCK_SIZE * sizeof(double));
+    if (workspace == NULL)
+        return 0;
+
+    double *buffers[PROGRAM_STACK_SIZE + 1]; // Buffer owned by each stack slot
+    const double *stack[PROGRAM_STACK_SIZE]; // Block of values in each slot: its buffer or a column
+    for (int i = 0; i < numBuffers; i++)
+        buffers[i] = workspace + (size_t)i * COLUMN_BLOCK_SIZE;
+    double *spare = buffers[program->maxStack];
+    double *temps = workspace + (size_t)numBuffers * COLUMN_BLOCK_SIZE;
+    const KernelTable *kernels = &kernelTables[program->tier];
+
+    for (size_t row = 0; row < rows; row += COLUMN_BLOCK_SIZE)
+    {
+        size_t n = rows - row < COLUMN_BLOCK_SIZE ? rows - row : COLUMN_BLOCK_SIZE;
+        int sp = 0; // Number of slots in use
+        const int *pc = program->code;
+        int running = 1;
+
+        while (running)
+        {
+            int op = *pc++;
+            double *dst;
+            const double *a, *b;
+            switch (op)
+            {
+            case OP_CONST:
+                dst = buffers[sp];
+                for (size_t i = 0; i < n; i++)
+                    dst[i] = program->constants[*pc];
+                pc++;
+                stack[sp++] = dst;
+                break;
+            case OP_VAR:
+                stack[sp++] = columns[*pc++] + row; // Read the column directly, no copy
+                break;
+            case OP_ADD:
+            case OP_SUB:
+            case OP_MUL:
+            case OP_DIV:
+                sp--;
+                a = stack[sp - 1];
+                b = stack[sp];
+                dst = buffers[sp - 1];
+                if (op == OP_ADD)
+                    for (size_t i = 0; i < n; i++)
+                        dst[i] = positiveZero(a[i] + b[i]);
+                else if (op == OP_SUB)
+                    for (size_t i = 0; i < n; i++)
+                        dst[i] = positiveZero(a[i] - b[i]);
+                else if (op == OP_MUL)
+                    for (size_t i = 0; i < n; i++)
+                        dst[i] = positiveZero(a[i] * b[i]);
+                else
+                    for (size_t i = 0; i < n; i++)
+                        dst[i] = positiveZero(a[i] / b[i]);
+                stack[sp - 1] = dst;
+                break;
+            case OP_NEG:
+                a = stack[sp - 1];
+                dst = buffers[sp - 1];
+                for (size_t i = 0; i < n; i++)
+                    dst[i] = positiveZero(-a[i]);
+                stack[sp - 1] = dst;
+                break;
+            case OP_POW:
+            case OP_CALL1:
+            case OP_CALL2:
+                // Array kernels write to the spare buffer, which then swaps with the slot's own
+                if (op != OP_POW)
+                    STATS_CALLS(*pc, n);
+                if (op == OP_CALL1)
+                {
+                    kernels->functions[*pc++].vectorUnary(stack[sp - 1], spare, n);
+                }
+                else
+                {
+                    sp--;
+                    if (op == OP_POW)
+                        kernels->functions[FN_POW].vectorBinary(stack[sp - 1], stack[sp], spare, n);
+                    else
+                        kernels->functions[*pc++].vectorBinary(stack[sp - 1], stack[sp], spare, n);
+                }
+                dst = spare;
+                spare = buffers[sp - 1];
+                buffers[sp - 1] = dst;
+                stack[sp - 1] = dst;
+                break;
+            case OP_STORE:
+                memcpy(temps + (size_t)*pc++ * COLUMN_BLOCK_SIZE, stack[sp - 1], n * sizeof(double));
+                break;
+            case OP_LOAD:
+                stack[sp++] = temps + (size_t)*pc++ * COLUMN_BLOCK_SIZE;
+                break;
+            case OP_PAIR:
+                STATS_CALLS(fusedPairs[pc[0]].first, n);
+                STATS_CALLS(fusedPairs[pc[0]].second, n);
+                sp--;
+                kernels->pairs[pc[0]].vectorKernel(stack[sp], temps + (size_t)pc[1] * COLUMN_BLOCK_SIZE,
+                                                   temps + (size_t)pc[2] * COLUMN_BLOCK_SIZE, n);
+                pc += 3;
+                break;
+            case OP_RETURN:
+            default:
+                memcpy(out + row, stack[sp - 1], n * sizeof(double));
+                running = 0;
+                break;
+            }
+        }
+    }
+
+    free(workspace);
+    return 1;
+}
+
+#endif
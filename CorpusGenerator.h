@@ -0,0 +1,164 @@
+#ifndef CORPUS_GENERATOR_H
+#define CORPUS_GENERATOR_H
+
+#include <stdio.h>
+#include <string.h>
+#include "FunctionRegistry.h"
+
+#define CORPUS_MAX_EXPRESSION 4096 // Longest expression the generator writes, including the terminator
+
+// Shape of a generated expression corpus; the same options and seed always give the same corpus
+typedef struct CorpusOptions
+{
+    unsigned long long seed; // Random seed
+    int maxDepth;            // Deepest nesting of operators and calls
+    int maxLength;           // Longest expression in characters (expressions are regenerated until they fit)
+    int functionPercent;     // Share of inner nodes that are function calls rather than operators (0-100)
+    unsigned functions;      // Functions to call, bit (1 << FunctionId) per function
+} CorpusOptions;
+
+// State of a corpus generator
+typedef struct CorpusGenerator
+{
+    CorpusOptions options;
+    unsigned long long state; // xorshift64* state
+    FunctionId functionList[FN_COUNT];
+    int numFunctions;
+} CorpusGenerator;
+
+// Function declarations
+static inline void corpusDefaults(CorpusOptions *options);
+static inline int corpusParseFunctions(const char *list, unsigned *functions);
+static inline void corpusInit(CorpusGenerator *generator, const CorpusOptions *options);
+static inline int corpusNext(CorpusGenerator *generator, char *expression, int size);
+
+// Default corpus: moderately nested expressions over every function
+static inline void corpusDefaults(CorpusOptions *options)
+{
+    options->seed = 1;
+    options->maxDepth = 6;
+    options->maxLength = 200;
+    options->functionPercent = 40;
+    options->functions = (1u << FN_COUNT) - 1;
+}
+
+// Parse a comma-separated list of function names ("sin,cos,exp") or "all" into a function mask
+// Returns 1 on success, or 0 if a name is unknown
+static inline int corpusParseFunctions(const char *list, unsigned *functions)
+{
+    if (strcmp(list, "all") == 0)
+    {
+        *functions = (1u << FN_COUNT) - 1;
+        return 1;
+    }
+    *functions = 0;
+    while (*list != '\0')
+    {
+        int length = (int)strcspn(list, ",");
+        FunctionId id = lookupFunction(list, length);
+        if (id == FN_UNKNOWN)
+            return 0;
+        *functions |= 1u << id;
+        list += length;
+        if (*list == ',')
+            list++;
+    }
+    return *functions != 0;
+}
+
+// Start a generator
+static inline void corpusInit(CorpusGenerator *generator, const CorpusOptions *options)
+{
+    generator->options = *options;
+    generator->state = options->seed ? options->seed : 1;
+    generator->numFunctions = 0;
+    for (int i = 0; i < FN_COUNT; i++)
+    {
+        if (options->functions & (1u << i))
+            generator->functionList[generator->numFunctions++] = (FunctionId)i;
+    }
+}
+
+// Next pseudo-random number in [0, bound)
+static unsigned corpusRandom(CorpusGenerator *generator, unsigned bound)
+{
+    generator->state ^= generator->state >> 12;
+    generator->state ^= generator->state << 25;
+    generator->state ^= generator->state >> 27;
+    return (unsigned)(((generator->state * 0x2545F4914F6CDD1DULL) >> 32) % bound);
+}
+
+// Append text to the expression being built, failing once it no longer fits
+static int corpusAppend(char *expression, int *length, int size, const char *text)
+{
+    int textLength = (int)strlen(text);
+    if (*length + textLength >= size)
+        return 0;
+    memcpy(expression + *length, text, textLength + 1);
+    *length += textLength;
+    return 1;
+}
+
+// Append a random number: integers, decimals and the occasional signed literal
+static int corpusNumber(CorpusGenerator *generator, char *expression, int *length, int size)
+{
+    char number[32];
+    switch (corpusRandom(generator, 4))
+    {
+    case 0:
+        snprintf(number, sizeof(number), "%u", corpusRandom(generator, 100));
+        break;
+    case 1:
+        snprintf(number, sizeof(number), "-%u.%u", corpusRandom(generator, 10), corpusRandom(generator, 1000));
+        break;
+    default:
+        snprintf(number, sizeof(number), "%u.%03u", corpusRandom(generator, 10), corpusRandom(generator, 1000));
+        break;
+    }
+    return corpusAppend(expression, length, size, number);
+}
+
+// Append a random subexpression of at most depth levels
+static int corpusNode(CorpusGenerator *generator, char *expression, int *length, int size, int depth)
+{
+    if (depth == 0 || corpusRandom(generator, 4) == 0)
+        return corpusNumber(generator, expression, length, size);
+
+    if (generator->numFunctions > 0 && (int)corpusRandom(generator, 100) < generator->options.functionPercent)
+    {
+        FunctionId id = generator->functionList[corpusRandom(generator, generator->numFunctions)];
+        const FunctionInfo *info = &functionRegistry[id];
+        if (!corpusAppend(expression, length, size, info->name) || !corpusAppend(expression, length, size, "(") ||
+            !corpusNode(generator, expression, length, size, depth - 1))
+            return 0;
+        if (info->arity == 2 && (!corpusAppend(expression, length, size, ", ") ||
+                                 !corpusNode(generator, expression, length, size, depth - 1)))
+            return 0;
+        return corpusAppend(expression, length, size, ")");
+    }
+
+    static const char *const operators[] = {" + ", " - ", " * ", " / ", "^"};
+    int parenthesised = corpusRandom(generator, 2);
+    return (!parenthesised || corpusAppend(expression, length, size, "(")) &&
+           corpusNode(generator, expression, length, size, depth - 1) &&
+           corpusAppend(expression, length, size, operators[corpusRandom(generator, 5)]) &&
+           corpusNode(generator, expression, length, size, depth - 1) &&
+           (!parenthesised || corpusAppend(expression, length, size, ")"));
+}
+
+// Write the next expression of the corpus into expression (size bytes) and return its length
+static inline int corpusNext(CorpusGenerator *generator, char *expression, int size)
+{
+    int limit = generator->options.maxLength + 1;
+    if (limit > size)
+        limit = size;
+    while (1)
+    {
+        int length = 0;
+        expression[0] = '\0';
+        if (corpusNode(generator, expression, &length, limit, generator->options.maxDepth))
+            return length;
+    }
+}
+
+#endif
@@ -0,0 +1,456 @@
+#ifndef EXPRESSION_CACHE_H
+#define EXPRESSION_CACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include "Bytecode.h"
+
+// Cache of evaluated expressions for workloads that repeat the same lines. The key is the token
+// stream in a normal form: whitespace is gone, numbers are keyed by value (so 1e3 and 1000 match),
+// and parentheses that cannot change the parse are dropped (so (1+2) and ((1 + 2)) match 1+2).
+// An expression without variables maps to its result, so a hit costs one tokenise; one with
+// variables maps to its compiled program. Entries are evicted least recently used first to keep
+// the cache within a memory budget, and an expression is only admitted the second time it misses,
+// so input that never repeats costs a key and a bit test instead of constant evictions.
+
+#define CACHE_DEFAULT_BUDGET (16 << 20) // Bytes of entries a cache may hold by default
+#define CACHE_MIN_BUCKETS 256           // Initial size of the hash table
+#define CACHE_FILTER_BITS (1 << 16)     // Bits of the admission filter (cleared once a quarter are set)
+
+// One cached expression (its key follows it in the same allocation)
+typedef struct CacheEntry
+{
+    size_t keyLength;         // Bytes of the normalised token stream
+    uint64_t hash;            // Hash of the key
+    double value;             // Result of a constant expression
+    Program *program;         // Compiled form of an expression with variables, NULL if constant
+    size_t bytes;             // Memory charged to the cache for this entry
+    struct CacheEntry *newer; // Neighbours in recency order
+    struct CacheEntry *older;
+    struct CacheEntry *chain; // Next entry in the same hash bucket
+} CacheEntry;
+
+// Least-recently-used cache of expressions keyed by their normalised tokens
+// Not thread-safe: every thread that evaluates uses its own cache
+typedef struct ExpressionCache
+{
+    CacheEntry **buckets;     // Hash table of entries
+    size_t mask;              // Number of buckets - 1
+    CacheEntry *newest;       // Most recently used entry
+    CacheEntry *oldest;       // Least recently used entry, evicted first
+    size_t count;             // Entries held
+    size_t bytes;             // Memory charged for the entries held
+    size_t budget;            // Most memory the entries may take
+    VariableTable *variables; // Variables expressions may use (NULL if none, every expression is then constant)
+    CacheEntry uncached;      // Result of the last lookup too large for the budget
+    unsigned char *key;       // Scratch space for building keys
+    size_t keyCapacity;
+    uint64_t filter[CACHE_FILTER_BITS / 64]; // Hashes of expressions that missed once (admission filter)
+    int filterCount;                         // Bits set in filter
+    unsigned long long hits;      // Lookups answered from the cache
+    unsigned long long misses;    // Lookups that had to parse the expression
+    unsigned long long evictions; // Entries dropped to stay within the budget
+} ExpressionCache;
+
+// Function declarations
+static inline void cacheInit(ExpressionCache *cache, size_t budget, VariableTable *variables);
+static inline const CacheEntry *cacheLookup(ExpressionCache *cache, const char *text, size_t length, Arena *arena,
+                                            ParseError *error);
+static inline int cacheEvaluate(ExpressionCache *cache, const char *text, size_t length, Arena *arena, double *result,
+                                ParseError *error);
+static inline void cacheAddCounters(ExpressionCache *total, const ExpressionCache *cache);
+static inline void cacheFree(ExpressionCache *cache);
+
+// Set up an empty cache whose entries take at most budget bytes
+// Expressions are compiled against variables, which must outlive the cache (NULL allows none)
+static inline void cacheInit(ExpressionCache *cache, size_t budget, VariableTable *variables)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->buckets = (CacheEntry **)calloc(CACHE_MIN_BUCKETS, sizeof(CacheEntry *));
+    cache->mask = CACHE_MIN_BUCKETS - 1;
+    cache->budget = budget;
+    cache->variables = variables;
+}
+
+static inline const unsigned char *entryKey(const CacheEntry *entry)
+{
+    return (const unsigned char *)(entry + 1);
+}
+
+// Multiplicative hash of a key, eight bytes per step
+static uint64_t cacheHash(const unsigned char *key, size_t length)
+{
+    uint64_t hash = length * 0x9E3779B97F4A7C15ULL;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, key + i, 8);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 32;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, key + i, length - i);
+    hash = (hash ^ tail) * 0xC4CEB9FE1A85EC53ULL;
+    return hash ^ (hash >> 29);
+}
+
+static int tokenStartsOperand(const Token *token)
+{
+    return token->kind == TOKEN_NUMBER || token->kind == TOKEN_IDENTIFIER || token->kind == TOKEN_LPAREN;
+}
+
+static int tokenEndsOperand(const Token *token)
+{
+    return token->kind == TOKEN_NUMBER || token->kind == TOKEN_IDENTIFIER || token->kind == TOKEN_RPAREN;
+}
+
+// Build the normalised key of a token stream in cache->key and return its length
+// A parenthesised group is a primary expression, so dropping a pair never changes the parse when:
+// - it encloses the whole expression, or directly encloses another group
+// - it holds a single number or variable and neither neighbour could join it by implicit multiplication
+//   (so 2(3) and sin(x) keep theirs)
+// Groups with a top-level comma are kept, since only function calls accept them.
+// Returns SIZE_MAX if the arena cannot hold the scratch arrays.
+static size_t cacheKey(ExpressionCache *cache, const char *source, int sourceLength, const Token *tokens, int numTokens, Arena *arena)
+{
+    int *match = (int *)arenaAlloc(arena, (size_t)numTokens * sizeof(int) + 1); // Partner of each parenthesis
+    char *comma = (char *)arenaAlloc(arena, (size_t)numTokens + 1);             // Group has a top-level comma
+    char *drop = (char *)arenaAlloc(arena, (size_t)numTokens + 1);
+    int *open = (int *)arenaAlloc(arena, (size_t)numTokens * sizeof(int) + 1);
+    if (match == NULL || comma == NULL || drop == NULL || open == NULL)
+        return SIZE_MAX;
+    memset(comma, 0, (size_t)numTokens);
+    memset(drop, 0, (size_t)numTokens);
+
+    int depth = 0, balanced = 1;
+    for (int i = 0; i < numTokens; i++)
+    {
+        match[i] = -1;
+        if (tokens[i].kind == TOKEN_LPAREN)
+            open[depth++] = i;
+        else if (tokens[i].kind == TOKEN_COMMA && depth > 0)
+            comma[open[depth - 1]] = 1;
+        else if (tokens[i].kind == TOKEN_RPAREN)
+        {
+            if (depth == 0)
+            {
+                balanced = 0;
+                break;
+            }
+            match[i] = open[--depth];
+            match[open[depth]] = i;
+        }
+    }
+
+    // Unbalanced input is an error; its tokens are keyed as they are
+    int normalise = balanced && depth == 0;
+    if (normalise)
+    {
+        for (int first = 0, last = numTokens - 1; first < last && match[first] == last && !comma[first]; first++, last--)
+            drop[first] = drop[last] = 1;
+    }
+
+    // Each token takes its kind plus a value, a function or a marker and a length, and names their text on top
+    size_t capacity = (size_t)numTokens * (2 + sizeof(double) + sizeof(int)) + (size_t)sourceLength;
+    if (capacity > cache->keyCapacity)
+    {
+        cache->keyCapacity = capacity * 2;
+        cache->key = (unsigned char *)realloc(cache->key, cache->keyCapacity);
+    }
+    unsigned char *key = cache->key;
+    const Token *previous = NULL; // Last token kept
+    for (int i = 0; i < numTokens; i++)
+    {
+        const Token *token = &tokens[i];
+        // A group is decided at its '(', so both ends are known before either is written
+        if (normalise && token->kind == TOKEN_LPAREN && !drop[i])
+        {
+            int j = match[i];
+            if (tokens[i + 1].kind == TOKEN_LPAREN && match[i + 1] == j - 1 && !comma[i + 1])
+            {
+                drop[i] = drop[j] = 1;
+            }
+            else if (j == i + 2 && (tokens[i + 1].kind == TOKEN_NUMBER ||
+                                    (tokens[i + 1].kind == TOKEN_IDENTIFIER && tokens[i + 1].function == FN_UNKNOWN)))
+            {
+                int after = j + 1;
+                while (after < numTokens && drop[after])
+                    after++;
+                if ((previous == NULL || !tokenEndsOperand(previous)) && (after == numTokens || !tokenStartsOperand(&tokens[after])))
+                    drop[i] = drop[j] = 1;
+            }
+        }
+        if (drop[i])
+            continue;
+
+        previous = token;
+        *key++ = (unsigned char)token->kind;
+        if (token->kind == TOKEN_NUMBER)
+        {
+            memcpy(key, &token->number, sizeof(token->number));
+            key += sizeof(token->number);
+        }
+        else if (token->kind == TOKEN_IDENTIFIER && token->function != FN_UNKNOWN)
+        {
+            *key++ = (unsigned char)token->function;
+        }
+        else if (token->kind == TOKEN_IDENTIFIER)
+        {
+            // Other names are variable length, so each is preceded by its length to keep keys unambiguous
+            *key++ = 0xFF;
+            memcpy(key, &token->length, sizeof(token->length));
+            memcpy(key + sizeof(token->length), source + token->offset, (size_t)token->length);
+            key += sizeof(token->length) + (size_t)token->length;
+        }
+    }
+    return (size_t)(key - cache->key);
+}
+
+// Remove an entry from the recency list
+static void cacheUnlink(ExpressionCache *cache, CacheEntry *entry)
+{
+    if (entry->newer != NULL)
+        entry->newer->older = entry->older;
+    else
+        cache->newest = entry->older;
+    if (entry->older != NULL)
+        entry->older->newer = entry->newer;
+    else
+        cache->oldest = entry->newer;
+}
+
+// Insert an entry as the most recently used one
+static void cachePushNewest(ExpressionCache *cache, CacheEntry *entry)
+{
+    entry->newer = NULL;
+    entry->older = cache->newest;
+    if (cache->newest != NULL)
+        cache->newest->newer = entry;
+    cache->newest = entry;
+    if (cache->oldest == NULL)
+        cache->oldest = entry;
+}
+
+// Drop the least recently used entry
+static void cacheEvict(ExpressionCache *cache)
+{
+    CacheEntry *entry = cache->oldest;
+    CacheEntry **link = &cache->buckets[entry->hash & cache->mask];
+    while (*link != entry)
+        link = &(*link)->chain;
+    *link = entry->chain;
+    cacheUnlink(cache, entry);
+    cache->count--;
+    cache->bytes -= entry->bytes;
+    if (entry->program != NULL)
+    {
+        freeProgram(entry->program);
+        free(entry->program);
+    }
+    free(entry);
+}
+
+// Double the hash table once it holds more entries than buckets
+static void cacheGrow(ExpressionCache *cache)
+{
+    size_t buckets = (cache->mask + 1) * 2;
+    CacheEntry **table = (CacheEntry **)calloc(buckets, sizeof(CacheEntry *));
+    if (table == NULL)
+        return; // Keep the longer chains
+    for (size_t b = 0; b <= cache->mask; b++)
+    {
+        CacheEntry *entry = cache->buckets[b];
+        while (entry != NULL)
+        {
+            CacheEntry *next = entry->chain;
+            entry->chain = table[entry->hash & (buckets - 1)];
+            table[entry->hash & (buckets - 1)] = entry;
+            entry = next;
+        }
+    }
+    free(cache->buckets);
+    cache->buckets = table;
+    cache->mask = buckets - 1;
+}
+
+// Find the entry of an expression, parsing (with arena for temporary data, reset afterwards) and
+// caching it on its second miss. Invalid expressions are never cached, since their error positions
+// depend on the exact text: they return NULL with error filled in. An expression that is not kept
+// (first miss, or too large for the budget) is returned in an entry valid until the next lookup.
+static inline const CacheEntry *cacheLookup(ExpressionCache *cache, const char *text, size_t length, Arena *arena,
+                                            ParseError *error)
+{
+    CacheEntry *uncached = &cache->uncached;
+    if (uncached->program != NULL)
+    {
+        freeProgram(uncached->program);
+        free(uncached->program);
+        uncached->program = NULL;
+    }
+    if (length > INT_MAX)
+    {
+        snprintf(error->message, sizeof(error->message), "Line too long");
+        return NULL;
+    }
+
+    int numTokens;
+    STATS_TIMER_START(tokeniseStart);
+    Token *tokens = tokenise(text, (int)length, &numTokens, arena, error);
+    STATS_TIMER_STOP(tokeniseStart, PHASE_TOKENISE);
+    if (tokens == NULL)
+    {
+        arenaReset(arena);
+        return NULL;
+    }
+
+    size_t keyLength = cacheKey(cache, text, (int)length, tokens, numTokens, arena);
+    if (keyLength == SIZE_MAX)
+    {
+        snprintf(error->message, sizeof(error->message), "Out of memory");
+        arenaReset(arena);
+        return NULL;
+    }
+    uint64_t hash = cacheHash(cache->key, keyLength);
+    CacheEntry **bucket = &cache->buckets[hash & cache->mask];
+    for (CacheEntry *entry = *bucket; entry != NULL; entry = entry->chain)
+    {
+        if (entry->hash == hash && entry->keyLength == keyLength && memcmp(entryKey(entry), cache->key, keyLength) == 0)
+        {
+            if (entry != cache->newest)
+            {
+                cacheUnlink(cache, entry);
+                cachePushNewest(cache, entry);
+            }
+            cache->hits++;
+            arenaReset(arena);
+            return entry;
+        }
+    }
+    cache->misses++;
+
+    STATS_TIMER_START(parseStart);
+    Parser parser = {text, tokens, 0, numTokens, arena, cache->variables, {0}, 0, 0};
+    ASTNode *ast = parseExpression(&parser);
+    if (!parserFailed(&parser) && parser.pos < parser.numTokens)
+        parserError(&parser, "Unexpected token");
+    STATS_TIMER_STOP(parseStart, PHASE_PARSE);
+    if (parserFailed(&parser))
+    {
+        *error = parser.error;
+        arenaReset(arena);
+        return NULL;
+    }
+
+    // Without variables every expression is constant; with them, only those that fold to a number
+    double value = 0.0;
+    Program *program = NULL;
+    PrecisionTier tier = precisionTier(); // Chosen at startup, so entries never mix tiers
+    ast = optimizeTree(ast, arena, tier);
+    if (cache->variables == NULL || ast->type == NODE_NUMBER)
+    {
+        STATS_TIMER_START(evaluateStart);
+        value = evaluateTier(ast, NULL, tier);
+        STATS_TIMER_STOP(evaluateStart, PHASE_EVALUATE);
+    }
+    else
+    {
+        program = (Program *)malloc(sizeof(Program));
+        initProgram(program);
+        if (!compileProgram(ast, program, error))
+        {
+            freeProgram(program);
+            free(program);
+            arenaReset(arena);
+            return NULL;
+        }
+    }
+    arenaReset(arena);
+
+    size_t bytes = sizeof(CacheEntry) + keyLength;
+    if (program != NULL)
+        bytes += sizeof(Program) + (size_t)program->codeCapacity * sizeof(int) + (size_t)program->constCapacity * sizeof(double);
+    uint64_t bit = (hash >> 32) % CACHE_FILTER_BITS; // The table uses the low bits, the filter high ones
+    int seen = (cache->filter[bit / 64] >> (bit % 64)) & 1;
+    if (!seen)
+    {
+        cache->filter[bit / 64] |= 1ULL << (bit % 64);
+        if (++cache->filterCount > CACHE_FILTER_BITS / 4)
+        {
+            memset(cache->filter, 0, sizeof(cache->filter));
+            cache->filterCount = 0;
+        }
+    }
+    if (!seen || bytes > cache->budget)
+    {
+        uncached->value = value;
+        uncached->program = program;
+        return uncached;
+    }
+    while (cache->bytes + bytes > cache->budget)
+    {
+        cacheEvict(cache);
+        cache->evictions++;
+    }
+    if (cache->count >= cache->mask + 1)
+    {
+        cacheGrow(cache);
+        bucket = &cache->buckets[hash & cache->mask];
+    }
+
+    CacheEntry *entry = (CacheEntry *)malloc(sizeof(CacheEntry) + keyLength);
+    memcpy(entry + 1, cache->key, keyLength);
+    entry->keyLength = keyLength;
+    entry->hash = hash;
+    entry->value = value;
+    entry->program = program;
+    entry->bytes = bytes;
+    entry->chain = *bucket;
+    *bucket = entry;
+    cachePushNewest(cache, entry);
+    cache->count++;
+    cache->bytes += bytes;
+    return entry;
+}
+
+// Evaluate an expression through the cache, like evaluateSpan
+// Only for caches without variables, whose entries are all constant
+static inline int cacheEvaluate(ExpressionCache *cache, const char *text, size_t length, Arena *arena, double *result,
+                                ParseError *error)
+{
+    const CacheEntry *entry = cacheLookup(cache, text, length, arena, error);
+    if (entry == NULL)
+        return 0;
+    *result = entry->program == NULL ? entry->value : runProgram(entry->program, NULL);
+    return 1;
+}
+
+// Add the hit, miss and eviction counts of cache to total (used to sum per-thread caches)
+static inline void cacheAddCounters(ExpressionCache *total, const ExpressionCache *cache)
+{
+    total->hits += cache->hits;
+    total->misses += cache->misses;
+    total->evictions += cache->evictions;
+}
+
+// Release every entry
+static inline void cacheFree(ExpressionCache *cache)
+{
+    while (cache->oldest != NULL)
+        cacheEvict(cache);
+    if (cache->uncached.program != NULL)
+    {
+        freeProgram(cache->uncached.program);
+        free(cache->uncached.program);
+        cache->uncached.program = NULL;
+    }
+    free(cache->buckets);
+    free(cache->key);
+    cache->buckets = NULL;
+    cache->key = NULL;
+}
+
+#endif
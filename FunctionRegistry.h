@@ -0,0 +1,239 @@
+#ifndef FUNCTION_REGISTRY_H
+#define FUNCTION_REGISTRY_H
+
+#include <string.h>
+#include <stdatomic.h>
+#include "MathFunctions.h"
+#include "MathFunctionsSIMD.h"
+#include "MathFunctionsAccurate.h"
+
+// Built-in functions
+typedef enum FunctionId
+{
+    FN_UNKNOWN = -1, // Identifier that is not a known function
+    FN_SIN,
+    FN_COS,
+    FN_TAN,
+    FN_LN,
+    FN_EXP,
+    FN_SINH,
+    FN_COSH,
+    FN_TANH,
+    FN_ASIN,
+    FN_ACOS,
+    FN_ATAN,
+    FN_ASINH,
+    FN_ACOSH,
+    FN_ATANH,
+    FN_POW,
+    FN_LOG_BASE,
+    FN_COUNT
+} FunctionId;
+
+// Registry entry: everything the parser needs to know about a function
+typedef struct FunctionInfo
+{
+    const char *name;
+    int length; // strlen(name)
+    int arity;  // Number of arguments (1 or 2)
+} FunctionInfo;
+
+// The single function registry, indexed by FunctionId
+static const FunctionInfo functionRegistry[FN_COUNT] = {
+    {"sin", 3, 1},
+    {"cos", 3, 1},
+    {"tan", 3, 1},
+    {"ln", 2, 1},
+    {"exp", 3, 1},
+    {"sinh", 4, 1},
+    {"cosh", 4, 1},
+    {"tanh", 4, 1},
+    {"asin", 4, 1},
+    {"acos", 4, 1},
+    {"atan", 4, 1},
+    {"asinh", 5, 1},
+    {"acosh", 5, 1},
+    {"atanh", 5, 1},
+    {"pow", 3, 2},
+    {"log_base", 8, 2},
+};
+
+// Two functions that one fused kernel computes together when they are called on the same argument
+typedef struct FusedPair
+{
+    FunctionId first;
+    FunctionId second;
+} FusedPair;
+
+#define NUM_FUSED_PAIRS 2
+static const FusedPair fusedPairs[NUM_FUSED_PAIRS] = {
+    {FN_SIN, FN_COS},
+    {FN_SINH, FN_COSH},
+};
+
+// Precision tiers: which set of kernels evaluates the built-in functions (see MathFunctionsFast.h and
+// MathFunctionsAccurate.h for the error bounds). The standard tier is 0 so that zeroed state uses it
+typedef enum PrecisionTier
+{
+    PRECISION_STANDARD, // The custom kernels of MathFunctions.h
+    PRECISION_FAST,     // Single-precision polynomials, at most about 3e-7 relative error
+    PRECISION_ACCURATE, // The C library, at most 2.5 ULP
+    PRECISION_TIER_COUNT
+} PrecisionTier;
+
+// Kernels of one function in one tier
+typedef struct FunctionKernels
+{
+    double (*unary)(double);          // Kernel for arity 1
+    double (*binary)(double, double); // Kernel for arity 2
+    void (*vectorUnary)(const double *x, double *out, size_t n);                   // Array kernel for arity 1
+    void (*vectorBinary)(const double *a, const double *b, double *out, size_t n); // Array kernel for arity 2
+} FunctionKernels;
+
+// Kernels of one fused pair in one tier
+typedef struct PairKernels
+{
+    void (*kernel)(double x, double *first, double *second);
+    void (*vectorKernel)(const double *x, double *first, double *second, size_t n);
+} PairKernels;
+
+// Every kernel of one tier, indexed like functionRegistry and fusedPairs
+typedef struct KernelTable
+{
+    FunctionKernels functions[FN_COUNT];
+    PairKernels pairs[NUM_FUSED_PAIRS];
+} KernelTable;
+
+// Indexed by PrecisionTier
+static const KernelTable kernelTables[PRECISION_TIER_COUNT] = {
+    {{{customSIN, NULL, vectorSIN, NULL},
+      {customCOS, NULL, vectorCOS, NULL},
+      {customTAN, NULL, vectorTAN, NULL},
+      {customLN, NULL, vectorLN, NULL},
+      {customEXP, NULL, vectorEXP, NULL},
+      {customSINH, NULL, vectorSINH, NULL},
+      {customCOSH, NULL, vectorCOSH, NULL},
+      {customTANH, NULL, vectorTANH, NULL},
+      {customASIN, NULL, vectorASIN, NULL},
+      {customACOS, NULL, vectorACOS, NULL},
+      {customATAN, NULL, vectorATAN, NULL},
+      {customASINH, NULL, vectorASINH, NULL},
+      {customACOSH, NULL, vectorACOSH, NULL},
+      {customATANH, NULL, vectorATANH, NULL},
+      {NULL, customPOW, NULL, vectorPOW},
+      {NULL, customLogBase, NULL, vectorLogBase}},
+     {{customSINCOS, vectorSINCOS}, {customSINHCOSH, vectorSINHCOSH}}},
+    {{{fastSIN, NULL, vectorFastSIN, NULL},
+      {fastCOS, NULL, vectorFastCOS, NULL},
+      {fastTAN, NULL, vectorFastTAN, NULL},
+      {fastLN, NULL, vectorFastLN, NULL},
+      {fastEXP, NULL, vectorFastEXP, NULL},
+      {fastSINH, NULL, vectorFastSINH, NULL},
+      {fastCOSH, NULL, vectorFastCOSH, NULL},
+      {fastTANH, NULL, vectorFastTANH, NULL},
+      {fastASIN, NULL, vectorFastASIN, NULL},
+      {fastACOS, NULL, vectorFastACOS, NULL},
+      {fastATAN, NULL, vectorFastATAN, NULL},
+      {fastASINH, NULL, vectorFastASINH, NULL},
+      {fastACOSH, NULL, vectorFastACOSH, NULL},
+      {fastATANH, NULL, vectorFastATANH, NULL},
+      {NULL, fastPOW, NULL, vectorFastPOW},
+      {NULL, fastLogBase, NULL, vectorFastLogBase}},
+     {{fastSINCOS, vectorFastSINCOS}, {fastSINHCOSH, vectorFastSINHCOSH}}},
+    {{{accurateSIN, NULL, vectorAccurateSIN, NULL},
+      {accurateCOS, NULL, vectorAccurateCOS, NULL},
+      {accurateTAN, NULL, vectorAccurateTAN, NULL},
+      {accurateLN, NULL, vectorAccurateLN, NULL},
+      {accurateEXP, NULL, vectorAccurateEXP, NULL},
+      {accurateSINH, NULL, vectorAccurateSINH, NULL},
+      {accurateCOSH, NULL, vectorAccurateCOSH, NULL},
+      {accurateTANH, NULL, vectorAccurateTANH, NULL},
+      {accurateASIN, NULL, vectorAccurateASIN, NULL},
+      {accurateACOS, NULL, vectorAccurateACOS, NULL},
+      {accurateATAN, NULL, vectorAccurateATAN, NULL},
+      {accurateASINH, NULL, vectorAccurateASINH, NULL},
+      {accurateACOSH, NULL, vectorAccurateACOSH, NULL},
+      {accurateATANH, NULL, vectorAccurateATANH, NULL},
+      {NULL, accuratePOW, NULL, vectorAccuratePOW},
+      {NULL, accurateLogBase, NULL, vectorAccurateLogBase}},
+     {{accurateSINCOS, vectorAccurateSINCOS}, {accurateSINHCOSH, vectorAccurateSINHCOSH}}},
+};
+
+static const char *const precisionTierNames[PRECISION_TIER_COUNT] = {"standard", "fast", "accurate"};
+
+// Function declarations
+static inline PrecisionTier precisionTier(void);
+static inline void setPrecisionTier(PrecisionTier tier);
+
+static atomic_int activePrecisionTier = PRECISION_STANDARD; // Tier of everything compiled without an explicit one
+
+// Tier used by evaluate(), optimizeTree() callers and newly compiled programs
+static inline PrecisionTier precisionTier(void)
+{
+    return (PrecisionTier)atomic_load_explicit(&activePrecisionTier, memory_order_relaxed);
+}
+
+// Choose the default tier (e.g. from --precision); programs already compiled keep theirs
+static inline void setPrecisionTier(PrecisionTier tier)
+{
+    atomic_store_explicit(&activePrecisionTier, tier, memory_order_relaxed);
+}
+
+// Find the tier with the given name, or -1
+static inline int findPrecisionTier(const char *name)
+{
+    for (int i = 0; i < PRECISION_TIER_COUNT; i++)
+    {
+        if (strcmp(precisionTierNames[i], name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+// Find the fused pair made of functions a and b (in either order), or -1
+static inline int findFusedPair(FunctionId a, FunctionId b)
+{
+    for (int i = 0; i < NUM_FUSED_PAIRS; i++)
+    {
+        if ((fusedPairs[i].first == a && fusedPairs[i].second == b) ||
+            (fusedPairs[i].first == b && fusedPairs[i].second == a))
+            return i;
+    }
+    return -1;
+}
+
+// Check whether a function belongs to any fused pair
+static inline int isFusable(FunctionId function)
+{
+    for (int i = 0; i < NUM_FUSED_PAIRS; i++)
+    {
+        if (fusedPairs[i].first == function || fusedPairs[i].second == function)
+            return 1;
+    }
+    return 0;
+}
+
+// Perfect hash of the registry names: (length + c0 + 3*c1 + 8*last) mod 32 is distinct for every name
+// When adding a function, pick new multipliers if its name collides and rebuild this table
+#define FUNCTION_HASH_SIZE 32
+static const FunctionId functionHashTable[FUNCTION_HASH_SIZE] = {
+    FN_UNKNOWN, FN_SIN, FN_ATANH, FN_UNKNOWN, FN_UNKNOWN, FN_UNKNOWN, FN_ACOS, FN_UNKNOWN,
+    FN_LN, FN_LOG_BASE, FN_TAN, FN_COS, FN_UNKNOWN, FN_UNKNOWN, FN_ASIN, FN_ACOSH,
+    FN_EXP, FN_ATAN, FN_SINH, FN_UNKNOWN, FN_COSH, FN_UNKNOWN, FN_UNKNOWN, FN_UNKNOWN,
+    FN_POW, FN_UNKNOWN, FN_UNKNOWN, FN_TANH, FN_UNKNOWN, FN_UNKNOWN, FN_UNKNOWN, FN_ASINH,
+};
+
+// Find the built-in function with the given name in O(1): one hash and one comparison
+static inline FunctionId lookupFunction(const char *name, int length)
+{
+    if (length < 2)
+        return FN_UNKNOWN;
+    unsigned hash = (unsigned)length + (unsigned char)name[0] + 3u * (unsigned char)name[1] +
+                    8u * (unsigned char)name[length - 1];
+    FunctionId id = functionHashTable[hash % FUNCTION_HASH_SIZE];
+    if (id != FN_UNKNOWN && functionRegistry[id].length == length && memcmp(functionRegistry[id].name, name, length) == 0)
+        return id;
+    return FN_UNKNOWN;
+}
+
+#endif
@@ -0,0 +1,546 @@
+#ifndef GRADIENT_H
+#define GRADIENT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Bytecode.h"
+
+// Reverse-mode automatic differentiation of compiled programs. compileTape lays out one tape entry
+// per value the program computes, with the entries it was computed from. runGradient then makes one
+// forward pass that records each value and the local partial derivatives of its operation, and one
+// reverse sweep that accumulates the derivative of the result with respect to every entry. All the
+// partial derivatives come out of the same two passes, so a gradient costs a small multiple of one
+// evaluation whatever the number of variables. Values are computed with the program's kernels, so
+// the result is the same as runProgram's.
+
+#define TAPE_BLOCK_SIZE 64     // Rows differentiated together by gradientColumns
+#define TAPE_STACK_ENTRIES 128 // Tapes up to this size are differentiated without heap allocation
+
+// Operation that produced a tape entry
+typedef enum TapeOp
+{
+    TAPE_CONST,
+    TAPE_VAR,
+    TAPE_ADD,
+    TAPE_SUB,
+    TAPE_MUL,
+    TAPE_DIV,
+    TAPE_NEG,
+    TAPE_CALL1,
+    TAPE_CALL2,
+    TAPE_PAIR,  // First result of a fused pair, which also computes the entry after it
+    TAPE_PAIRED // Second result of a fused pair, computed by the entry before it
+} TapeOp;
+
+// One value of the forward pass
+typedef struct TapeEntry
+{
+    TapeOp op;
+    int function;    // FunctionId of a call, or the fused pair index of both entries of a pair
+    int left;        // Entry of the first operand, -1 if there is none
+    int right;       // Entry of the second operand, -1 if there is none
+    int variable;    // Variable index of TAPE_VAR
+    int active;      // Whether the value depends on a variable (inactive entries need no derivatives)
+    double constant; // Value of TAPE_CONST
+} TapeEntry;
+
+// Layout of the forward pass of a program
+typedef struct Tape
+{
+    TapeEntry *entries;
+    int numEntries;
+    int result;         // Entry holding the program's result
+    int numVariables;   // Number of variables the program reads
+    PrecisionTier tier; // Kernels of the program the tape was compiled from
+} Tape;
+
+// Function declarations
+static inline int compileTape(const Program *program, Tape *tape);
+static inline void freeTape(Tape *tape);
+static inline double runGradient(const Tape *tape, const double *variables, double *gradient);
+static inline int gradientColumns(const Tape *tape, const double *const *columns, double *out, double *const *gradients,
+                                  size_t rows);
+
+// Lay out the tape of a compiled program; returns 0 if it could not be allocated
+// The tape does not refer to the program afterwards
+static inline int compileTape(const Program *program, Tape *tape)
+{
+    memset(tape, 0, sizeof(*tape));
+    tape->tier = program->tier;
+    tape->numVariables = program->numVariables;
+    // Every instruction adds at most one entry per operand word, so the code length is enough
+    tape->entries = (TapeEntry *)malloc((size_t)(program->codeLength + 1) * sizeof(TapeEntry));
+    if (tape->entries == NULL)
+        return 0;
+
+    int stack[PROGRAM_STACK_SIZE]; // Entry held by each stack slot
+    int temps[PROGRAM_TEMP_SIZE];  // Entry held by each temporary
+    int sp = 0;
+    const int *pc = program->code;
+    for (;;)
+    {
+        int op = *pc++;
+        if (op == OP_RETURN)
+            break;
+        if (op == OP_STORE)
+        {
+            temps[*pc++] = stack[sp - 1];
+            continue;
+        }
+        if (op == OP_LOAD)
+        {
+            stack[sp++] = temps[*pc++];
+            continue;
+        }
+
+        TapeEntry *entry = &tape->entries[tape->numEntries];
+        memset(entry, 0, sizeof(*entry));
+        entry->left = -1;
+        entry->right = -1;
+        switch (op)
+        {
+        case OP_CONST:
+            entry->op = TAPE_CONST;
+            entry->constant = program->constants[*pc++];
+            break;
+        case OP_VAR:
+            entry->op = TAPE_VAR;
+            entry->variable = *pc++;
+            entry->active = 1;
+            break;
+        case OP_NEG:
+            entry->op = TAPE_NEG;
+            entry->left = stack[--sp];
+            break;
+        case OP_CALL1:
+            entry->op = TAPE_CALL1;
+            entry->function = *pc++;
+            entry->left = stack[--sp];
+            break;
+        case OP_PAIR:
+            entry->op = TAPE_PAIR;
+            entry->function = pc[0];
+            entry->left = stack[--sp];
+            entry[1] = entry[0];
+            entry[1].op = TAPE_PAIRED;
+            temps[pc[1]] = tape->numEntries;
+            temps[pc[2]] = tape->numEntries + 1;
+            pc += 3;
+            break;
+        default:
+            // Binary operators, including ^ which runs the pow kernel like OP_CALL2
+            entry->op = op == OP_ADD ? TAPE_ADD : op == OP_SUB ? TAPE_SUB : op == OP_MUL ? TAPE_MUL : op == OP_DIV ? TAPE_DIV : TAPE_CALL2;
+            entry->function = op == OP_POW ? FN_POW : op == OP_CALL2 ? *pc++ : 0;
+            entry->right = stack[--sp];
+            entry->left = stack[--sp];
+            break;
+        }
+        entry->active |= (entry->left >= 0 && tape->entries[entry->left].active) ||
+                         (entry->right >= 0 && tape->entries[entry->right].active);
+        if (op == OP_PAIR)
+        {
+            entry[1].active = entry->active;
+            tape->numEntries += 2; // Pair results are only reached through their temporaries
+            continue;
+        }
+        stack[sp++] = tape->numEntries++;
+    }
+    tape->result = stack[sp - 1];
+    return 1;
+}
+
+// Release the entries of a tape
+static inline void freeTape(Tape *tape)
+{
+    free(tape->entries);
+    memset(tape, 0, sizeof(*tape));
+}
+
+// Derivative of a one-argument function at x, where v is its value there
+static double unaryDerivative(int function, double x, double v, const KernelTable *kernels)
+{
+    switch (function)
+    {
+    case FN_SIN:
+        return kernels->functions[FN_COS].unary(x);
+    case FN_COS:
+        return -kernels->functions[FN_SIN].unary(x);
+    case FN_TAN:
+        return 1.0 + v * v;
+    case FN_LN:
+        return 1.0 / x;
+    case FN_EXP:
+        return v;
+    case FN_SINH:
+        return kernels->functions[FN_COSH].unary(x);
+    case FN_COSH:
+        return kernels->functions[FN_SINH].unary(x);
+    case FN_TANH:
+        return 1.0 - v * v;
+    case FN_ASIN:
+        return 1.0 / sqrt((1.0 - x) * (1.0 + x));
+    case FN_ACOS:
+        return -1.0 / sqrt((1.0 - x) * (1.0 + x));
+    case FN_ATAN:
+        return 1.0 / (1.0 + x * x);
+    case FN_ASINH:
+        return 1.0 / hypot(x, 1.0);
+    case FN_ACOSH:
+        return 1.0 / sqrt((x - 1.0) * (x + 1.0));
+    case FN_ATANH:
+    default:
+        return 1.0 / ((1.0 - x) * (1.0 + x));
+    }
+}
+
+// Partial derivative of a^b with respect to a, where v = a^b
+static inline double powBaseDerivative(double a, double b, double v)
+{
+    if (a != 0.0)
+        return b * v / a;
+    return b == 1.0 ? 1.0 : b > 1.0 ? 0.0 : INFINITY;
+}
+
+// Partial derivative of a^b with respect to b, where v = a^b and lnA = ln(a)
+static inline double powExponentDerivative(double a, double b, double v, double lnA)
+{
+    if (a > 0.0)
+        return v * lnA;
+    return a == 0.0 && b > 0.0 ? 0.0 : NAN; // a^b is not differentiable in b for a < 0
+}
+
+// Value and local partial derivatives of one entry; the partials are only computed for active operands
+static void forwardEntry(const Tape *tape, int i, const double *variables, const KernelTable *kernels, double *values,
+                         double *dLeft, double *dRight)
+{
+    const TapeEntry *entry = &tape->entries[i];
+    int leftActive = entry->left >= 0 && tape->entries[entry->left].active;
+    int rightActive = entry->right >= 0 && tape->entries[entry->right].active;
+    double a = entry->left >= 0 ? values[entry->left] : 0.0;
+    double b = entry->right >= 0 ? values[entry->right] : 0.0;
+    double v;
+    switch (entry->op)
+    {
+    case TAPE_CONST:
+        values[i] = entry->constant;
+        return;
+    case TAPE_VAR:
+        values[i] = variables[entry->variable];
+        return;
+    case TAPE_ADD:
+        values[i] = positiveZero(a + b);
+        dLeft[i] = 1.0;
+        dRight[i] = 1.0;
+        return;
+    case TAPE_SUB:
+        values[i] = positiveZero(a - b);
+        dLeft[i] = 1.0;
+        dRight[i] = -1.0;
+        return;
+    case TAPE_MUL:
+        values[i] = positiveZero(a * b);
+        dLeft[i] = b;
+        dRight[i] = a;
+        return;
+    case TAPE_DIV:
+        values[i] = positiveZero(a / b);
+        dLeft[i] = 1.0 / b;
+        dRight[i] = -(a / b) / b;
+        return;
+    case TAPE_NEG:
+        values[i] = positiveZero(-a);
+        dLeft[i] = -1.0;
+        return;
+    case TAPE_CALL1:
+        v = values[i] = kernels->functions[entry->function].unary(a);
+        if (leftActive)
+            dLeft[i] = unaryDerivative(entry->function, a, v, kernels);
+        return;
+    case TAPE_CALL2:
+        v = values[i] = kernels->functions[entry->function].binary(a, b);
+        if (entry->function == FN_POW)
+        {
+            if (leftActive)
+                dLeft[i] = powBaseDerivative(a, b, v);
+            if (rightActive)
+                dRight[i] = powExponentDerivative(a, b, v, kernels->functions[FN_LN].unary(a));
+        }
+        else if (leftActive || rightActive)
+        {
+            // log_base(a, b) = ln(b) / ln(a)
+            double lnA = kernels->functions[FN_LN].unary(a);
+            dLeft[i] = -v / (a * lnA);
+            dRight[i] = 1.0 / (b * lnA);
+        }
+        return;
+    case TAPE_PAIR:
+        // Each function of a pair is the other's derivative, up to the sign of -sin
+        kernels->pairs[entry->function].kernel(a, &values[i], &values[i + 1]);
+        dLeft[i] = values[i + 1];
+        dLeft[i + 1] = fusedPairs[entry->function].first == FN_SIN ? -values[i] : values[i];
+        return;
+    case TAPE_PAIRED:
+    default:
+        return;
+    }
+}
+
+// Evaluate a program and its gradient: gradient[v] receives the partial derivative of the result
+// with respect to variable v (numVariables entries). Returns the value, the same as runProgram's,
+// or NaN (with a NaN gradient) if a large tape's workspace could not be allocated
+// The tape is only read, so one tape may be differentiated from several threads at once
+static inline double runGradient(const Tape *tape, const double *variables, double *gradient)
+{
+    double local[4 * TAPE_STACK_ENTRIES];
+    double *workspace = tape->numEntries <= TAPE_STACK_ENTRIES ? local : (double *)malloc((size_t)tape->numEntries * 4 * sizeof(double));
+    if (workspace == NULL)
+    {
+        for (int v = 0; v < tape->numVariables; v++)
+            gradient[v] = NAN;
+        return NAN;
+    }
+    double *values = workspace;
+    double *dLeft = values + tape->numEntries;
+    double *dRight = dLeft + tape->numEntries;
+    double *adjoints = dRight + tape->numEntries;
+    const KernelTable *kernels = &kernelTables[tape->tier];
+
+    for (int i = 0; i < tape->numEntries; i++)
+        forwardEntry(tape, i, variables, kernels, values, dLeft, dRight);
+
+    // Reverse sweep: each entry passes its adjoint on to its operands, weighted by the local partials
+    memset(adjoints, 0, tape->numEntries * sizeof(double));
+    memset(gradient, 0, tape->numVariables * sizeof(double));
+    adjoints[tape->result] = 1.0;
+    for (int i = tape->numEntries - 1; i >= 0; i--)
+    {
+        const TapeEntry *entry = &tape->entries[i];
+        if (!entry->active)
+            continue;
+        if (entry->op == TAPE_VAR)
+            gradient[entry->variable] += adjoints[i];
+        if (entry->left >= 0 && tape->entries[entry->left].active)
+            adjoints[entry->left] += adjoints[i] * dLeft[i];
+        if (entry->right >= 0 && tape->entries[entry->right].active)
+            adjoints[entry->right] += adjoints[i] * dRight[i];
+    }
+
+    double result = values[tape->result];
+    if (workspace != local)
+        free(workspace);
+    return result;
+}
+
+// Local partial derivatives of a one-argument function over a block, written to d
+static void unaryDerivatives(int function, const double *x, const double *v, double *d, const KernelTable *kernels, size_t n)
+{
+    switch (function)
+    {
+    case FN_SIN:
+    case FN_COS:
+    case FN_SINH:
+    case FN_COSH:
+        // Derivatives that are another function of the same argument: one array kernel call
+        kernels->functions[function == FN_SIN ? FN_COS : function == FN_COS ? FN_SIN : function == FN_SINH ? FN_COSH : FN_SINH].vectorUnary(x, d, n);
+        if (function == FN_COS)
+            for (size_t k = 0; k < n; k++)
+                d[k] = -d[k];
+        break;
+    case FN_TAN:
+        for (size_t k = 0; k < n; k++)
+            d[k] = 1.0 + v[k] * v[k];
+        break;
+    case FN_LN:
+        for (size_t k = 0; k < n; k++)
+            d[k] = 1.0 / x[k];
+        break;
+    case FN_EXP:
+        memcpy(d, v, n * sizeof(double));
+        break;
+    case FN_TANH:
+        for (size_t k = 0; k < n; k++)
+            d[k] = 1.0 - v[k] * v[k];
+        break;
+    default:
+        for (size_t k = 0; k < n; k++)
+            d[k] = unaryDerivative(function, x[k], v[k], kernels);
+        break;
+    }
+}
+
+// Value and local partial derivatives of one entry over a block of n rows
+static void forwardBlock(const Tape *tape, int i, const double *const *columns, size_t row, size_t n, const KernelTable *kernels,
+                         double *values, double *dLeft, double *dRight)
+{
+    const TapeEntry *entry = &tape->entries[i];
+    int leftActive = entry->left >= 0 && tape->entries[entry->left].active;
+    int rightActive = entry->right >= 0 && tape->entries[entry->right].active;
+    double *v = values + (size_t)i * TAPE_BLOCK_SIZE;
+    double *dl = dLeft + (size_t)i * TAPE_BLOCK_SIZE;
+    double *dr = dRight + (size_t)i * TAPE_BLOCK_SIZE;
+    const double *a = entry->left >= 0 ? values + (size_t)entry->left * TAPE_BLOCK_SIZE : NULL;
+    const double *b = entry->right >= 0 ? values + (size_t)entry->right * TAPE_BLOCK_SIZE : NULL;
+    switch (entry->op)
+    {
+    case TAPE_CONST:
+        for (size_t k = 0; k < n; k++)
+            v[k] = entry->constant;
+        break;
+    case TAPE_VAR:
+        memcpy(v, columns[entry->variable] + row, n * sizeof(double));
+        break;
+    case TAPE_ADD:
+        for (size_t k = 0; k < n; k++)
+        {
+            v[k] = positiveZero(a[k] + b[k]);
+            dl[k] = 1.0;
+            dr[k] = 1.0;
+        }
+        break;
+    case TAPE_SUB:
+        for (size_t k = 0; k < n; k++)
+        {
+            v[k] = positiveZero(a[k] - b[k]);
+            dl[k] = 1.0;
+            dr[k] = -1.0;
+        }
+        break;
+    case TAPE_MUL:
+        for (size_t k = 0; k < n; k++)
+        {
+            v[k] = positiveZero(a[k] * b[k]);
+            dl[k] = b[k];
+            dr[k] = a[k];
+        }
+        break;
+    case TAPE_DIV:
+        for (size_t k = 0; k < n; k++)
+        {
+            v[k] = positiveZero(a[k] / b[k]);
+            dl[k] = 1.0 / b[k];
+            dr[k] = -(a[k] / b[k]) / b[k];
+        }
+        break;
+    case TAPE_NEG:
+        for (size_t k = 0; k < n; k++)
+        {
+            v[k] = positiveZero(-a[k]);
+            dl[k] = -1.0;
+        }
+        break;
+    case TAPE_CALL1:
+        kernels->functions[entry->function].vectorUnary(a, v, n);
+        if (leftActive)
+            unaryDerivatives(entry->function, a, v, dl, kernels, n);
+        break;
+    case TAPE_CALL2:
+        kernels->functions[entry->function].vectorBinary(a, b, v, n);
+        if (entry->function == FN_POW)
+        {
+            if (leftActive)
+                for (size_t k = 0; k < n; k++)
+                    dl[k] = powBaseDerivative(a[k], b[k], v[k]);
+            if (rightActive)
+            {
+                kernels->functions[FN_LN].vectorUnary(a, dr, n);
+                for (size_t k = 0; k < n; k++)
+                    dr[k] = powExponentDerivative(a[k], b[k], v[k], dr[k]);
+            }
+        }
+        else if (leftActive || rightActive)
+        {
+            kernels->functions[FN_LN].vectorUnary(a, dr, n);
+            for (size_t k = 0; k < n; k++)
+            {
+                double lnA = dr[k];
+                dl[k] = -v[k] / (a[k] * lnA);
+                dr[k] = 1.0 / (b[k] * lnA);
+            }
+        }
+        break;
+    case TAPE_PAIR:
+    {
+        double *second = v + TAPE_BLOCK_SIZE;
+        double sign = fusedPairs[entry->function].first == FN_SIN ? -1.0 : 1.0;
+        kernels->pairs[entry->function].vectorKernel(a, v, second, n);
+        for (size_t k = 0; k < n; k++)
+        {
+            dl[k] = second[k];
+            dl[TAPE_BLOCK_SIZE + k] = sign * v[k];
+        }
+        break;
+    }
+    case TAPE_PAIRED:
+    default:
+        break;
+    }
+}
+
+// Evaluate a program and its gradient over rows of columnar data, as evaluateColumns does:
+// out[r] is the result for row r and gradients[v][r] its partial derivative with respect to
+// variable v. Each block of rows takes one forward pass of array kernels and one reverse sweep.
+// Returns 1 on success, or 0 if the workspace could not be allocated
+static inline int gradientColumns(const Tape *tape, const double *const *columns, double *out, double *const *gradients,
+                                  size_t rows)
+{
+    // Values, both partials and the adjoint of every entry, one block each
+    size_t blockEntries = (size_t)tape->numEntries * TAPE_BLOCK_SIZE;
+    double *workspace = (double *)malloc(4 * blockEntries * sizeof(double));
+    if (workspace == NULL)
+        return 0;
+    double *values = workspace;
+    double *dLeft = values + blockEntries;
+    double *dRight = dLeft + blockEntries;
+    double *adjoints = dRight + blockEntries;
+    const KernelTable *kernels = &kernelTables[tape->tier];
+
+    for (size_t row = 0; row < rows; row += TAPE_BLOCK_SIZE)
+    {
+        size_t n = rows - row < TAPE_BLOCK_SIZE ? rows - row : TAPE_BLOCK_SIZE;
+        for (int i = 0; i < tape->numEntries; i++)
+            forwardBlock(tape, i, columns, row, n, kernels, values, dLeft, dRight);
+
+        memset(adjoints, 0, blockEntries * sizeof(double));
+        for (int v = 0; v < tape->numVariables; v++)
+            memset(gradients[v] + row, 0, n * sizeof(double));
+        double *seed = adjoints + (size_t)tape->result * TAPE_BLOCK_SIZE;
+        for (size_t k = 0; k < n; k++)
+            seed[k] = 1.0;
+
+        for (int i = tape->numEntries - 1; i >= 0; i--)
+        {
+            const TapeEntry *entry = &tape->entries[i];
+            if (!entry->active)
+                continue;
+            const double *adjoint = adjoints + (size_t)i * TAPE_BLOCK_SIZE;
+            if (entry->op == TAPE_VAR)
+            {
+                double *g = gradients[entry->variable] + row;
+                for (size_t k = 0; k < n; k++)
+                    g[k] += adjoint[k];
+            }
+            if (entry->left >= 0 && tape->entries[entry->left].active)
+            {
+                double *target = adjoints + (size_t)entry->left * TAPE_BLOCK_SIZE;
+                const double *d = dLeft + (size_t)i * TAPE_BLOCK_SIZE;
+                for (size_t k = 0; k < n; k++)
+                    target[k] += adjoint[k] * d[k];
+            }
+            if (entry->right >= 0 && tape->entries[entry->right].active)
+            {
+                double *target = adjoints + (size_t)entry->right * TAPE_BLOCK_SIZE;
+                const double *d = dRight + (size_t)i * TAPE_BLOCK_SIZE;
+                for (size_t k = 0; k < n; k++)
+                    target[k] += adjoint[k] * d[k];
+            }
+        }
+        memcpy(out + row, values + (size_t)tape->result * TAPE_BLOCK_SIZE, n * sizeof(double));
+    }
+
+    free(workspace);
+    return 1;
+}
+
+#endif
@@ -0,0 +1,440 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "Bytecode.h"
+
+// Native code generation for compiled programs. The postfix code of a Program is translated into
+// x86-64 SSE2 instructions: value stack slots live in xmm registers, constants, variables and
+// temporaries are memory operands, and function calls go straight to the kernels. Results are
+// bit-identical to runProgram, which remains the fallback on other platforms, with -DCALC_NO_JIT,
+// or when the CALC_NO_JIT environment variable is set.
+
+#if (defined(__x86_64__) || defined(_M_X64)) && defined(__unix__) && !defined(CALC_NO_JIT)
+#define JIT_SUPPORTED 1
+#include <sys/mman.h>
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+#define JIT_REGISTERS 12 // Stack slots kept in xmm2-xmm13, deeper slots stay in memory
+#define JIT_SCRATCH 14   // xmm14: scratch for slots that have no register
+#define JIT_SCRATCH2 15  // xmm15: second scratch
+
+// Native function of a program: takes the variable values, returns the result
+typedef double (*JitFunction)(const double *variables);
+
+// Program translated to native code
+typedef struct JitCode
+{
+    JitFunction function; // Entry point, or NULL when the program runs in the interpreter
+    void *memory;         // Executable mapping holding the code and its constants
+    size_t size;          // Size of memory in bytes
+} JitCode;
+
+// Function declarations
+static inline int jitCompile(const Program *program, JitCode *jit);
+static inline double jitRun(const JitCode *jit, const Program *program, const double *variables);
+static inline void jitFree(JitCode *jit);
+
+#if JIT_SUPPORTED
+
+// Where the value of a stack slot currently is
+typedef enum SlotState
+{
+    SLOT_MEMORY,   // Only in the slot's frame memory
+    SLOT_REGISTER, // Only in the slot's register (the memory copy is stale)
+    SLOT_BOTH      // Register and memory agree
+} SlotState;
+
+// Machine code being generated
+typedef struct JitBuilder
+{
+    unsigned char *code;
+    size_t length;
+    size_t capacity;
+    SlotState slots[PROGRAM_STACK_SIZE];
+    int tempBase; // Frame offset of the first temporary
+} JitBuilder;
+
+// x86-64 register numbers
+enum
+{
+    REG_RAX = 0,
+    REG_RSP = 4,
+    REG_RSI = 6,
+    REG_RDI = 7,
+    REG_RBX = 3,
+    REG_R12 = 12
+};
+
+// SSE2 opcodes (second byte after 0F)
+enum
+{
+    SSE_LOAD = 0x10,  // movsd xmm, m64 (with F2)
+    SSE_STORE = 0x11, // movsd m64, xmm (with F2)
+    SSE_ADD = 0x58,
+    SSE_MUL = 0x59,
+    SSE_SUB = 0x5C,
+    SSE_DIV = 0x5E,
+    SSE_MOVE = 0x28,  // movapd xmm, xmm (with 66)
+    SSE_XOR = 0x57    // xorpd xmm, xmm (with 66)
+};
+
+// Append bytes to the code
+static void jitEmit(JitBuilder *b, const void *bytes, size_t count)
+{
+    if (b->length + count > b->capacity)
+    {
+        b->capacity = b->capacity ? b->capacity * 2 : 1024;
+        if (b->capacity < b->length + count)
+            b->capacity = b->length + count;
+        b->code = (unsigned char *)realloc(b->code, b->capacity);
+    }
+    memcpy(b->code + b->length, bytes, count);
+    b->length += count;
+}
+
+static void jitByte(JitBuilder *b, int value)
+{
+    unsigned char byte = (unsigned char)value;
+    jitEmit(b, &byte, 1);
+}
+
+static void jitInt32(JitBuilder *b, int32_t value)
+{
+    jitEmit(b, &value, 4);
+}
+
+// Scalar double instruction between two xmm registers
+static void jitSseRegister(JitBuilder *b, int prefix, int op, int reg, int rm)
+{
+    jitByte(b, prefix);
+    if (reg >= 8 || rm >= 8)
+        jitByte(b, 0x40 | ((reg >> 3) << 2) | (rm >> 3));
+    jitByte(b, 0x0F);
+    jitByte(b, op);
+    jitByte(b, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+// Scalar double instruction between an xmm register and [base + offset]
+static void jitSseMemory(JitBuilder *b, int op, int reg, int base, int32_t offset)
+{
+    jitByte(b, 0xF2);
+    if (reg >= 8 || base >= 8)
+        jitByte(b, 0x40 | ((reg >> 3) << 2) | (base >> 3));
+    jitByte(b, 0x0F);
+    jitByte(b, op);
+    jitByte(b, 0x80 | ((reg & 7) << 3) | (base & 7));
+    if ((base & 7) == REG_RSP)
+        jitByte(b, 0x24); // SIB: no index, base rsp/r12
+    jitInt32(b, offset);
+}
+
+// mov reg, imm64 (returns the offset of the immediate so it can be patched)
+static size_t jitMoveImmediate(JitBuilder *b, int reg, uint64_t value)
+{
+    jitByte(b, 0x48 | (reg >> 3));
+    jitByte(b, 0xB8 | (reg & 7));
+    size_t at = b->length;
+    jitEmit(b, &value, 8);
+    return at;
+}
+
+// call through rax
+static void jitCall(JitBuilder *b, const void *function)
+{
+    jitMoveImmediate(b, REG_RAX, (uint64_t)(uintptr_t)function);
+    jitByte(b, 0xFF);
+    jitByte(b, 0xD0);
+}
+
+// lea reg, [rsp + offset]
+static void jitLeaStack(JitBuilder *b, int reg, int32_t offset)
+{
+    jitByte(b, 0x48);
+    jitByte(b, 0x8D);
+    jitByte(b, 0x84 | ((reg & 7) << 3));
+    jitByte(b, 0x24);
+    jitInt32(b, offset);
+}
+
+// Register and frame offset of a stack slot
+static int slotRegister(int slot)
+{
+    return slot < JIT_REGISTERS ? 2 + slot : -1;
+}
+
+static int32_t slotOffset(int slot)
+{
+    return slot * 8;
+}
+
+// Make the value of slot available in a register and return it (scratch is used for slots without one)
+static int jitLoadSlot(JitBuilder *b, int slot, int scratch)
+{
+    int reg = slotRegister(slot);
+    if (reg < 0)
+    {
+        jitSseMemory(b, SSE_LOAD, scratch, REG_RSP, slotOffset(slot));
+        return scratch;
+    }
+    if (b->slots[slot] == SLOT_MEMORY)
+    {
+        jitSseMemory(b, SSE_LOAD, reg, REG_RSP, slotOffset(slot));
+        b->slots[slot] = SLOT_BOTH;
+    }
+    return reg;
+}
+
+// Make the value in reg the new value of slot
+static void jitSetSlot(JitBuilder *b, int slot, int reg)
+{
+    int home = slotRegister(slot);
+    if (home < 0)
+    {
+        jitSseMemory(b, SSE_STORE, reg, REG_RSP, slotOffset(slot));
+        return;
+    }
+    if (reg != home)
+        jitSseRegister(b, 0x66, SSE_MOVE, home, reg);
+    b->slots[slot] = SLOT_REGISTER;
+}
+
+// Push a value read from [base + offset] into slot
+static void jitPushMemory(JitBuilder *b, int slot, int base, int32_t offset)
+{
+    int home = slotRegister(slot);
+    jitSseMemory(b, SSE_LOAD, home >= 0 ? home : JIT_SCRATCH, base, offset);
+    jitSetSlot(b, slot, home >= 0 ? home : JIT_SCRATCH);
+}
+
+// Apply op to slot a with slot b as its right operand, reading b from memory when it has no register copy
+// Adding +0 afterwards turns -0 into +0 and leaves every other value unchanged, like positiveZero
+static void jitArithmetic(JitBuilder *b, int op, int slotA, int slotB, int32_t zeroOffset)
+{
+    int reg = jitLoadSlot(b, slotA, JIT_SCRATCH);
+    if (slotRegister(slotB) >= 0 && b->slots[slotB] != SLOT_MEMORY)
+        jitSseRegister(b, 0xF2, op, reg, slotRegister(slotB));
+    else
+        jitSseMemory(b, op, reg, REG_RSP, slotOffset(slotB));
+    jitSseMemory(b, SSE_ADD, reg, REG_R12, zeroOffset);
+    jitSetSlot(b, slotA, reg);
+}
+
+// Write every slot below depth to memory before a call, which clobbers all xmm registers
+static void jitSpill(JitBuilder *b, int depth)
+{
+    for (int s = 0; s < depth && s < JIT_REGISTERS; s++)
+    {
+        if (b->slots[s] == SLOT_REGISTER)
+            jitSseMemory(b, SSE_STORE, slotRegister(s), REG_RSP, slotOffset(s));
+        b->slots[s] = SLOT_MEMORY;
+    }
+}
+
+// Move slot into argument register xmm0 or xmm1
+static void jitArgument(JitBuilder *b, int slot, int argument)
+{
+    int reg = slotRegister(slot);
+    if (reg >= 0 && b->slots[slot] != SLOT_MEMORY)
+        jitSseRegister(b, 0x66, SSE_MOVE, argument, reg);
+    else
+        jitSseMemory(b, SSE_LOAD, argument, REG_RSP, slotOffset(slot));
+}
+
+// Call a kernel on the top one or two slots, leaving the result in the lowest of them
+static void jitCallKernel(JitBuilder *b, int sp, int arity, const void *function)
+{
+    int first = sp - arity;
+    // The operands are read before spilling, which only writes slots below them
+    for (int i = 0; i < arity; i++)
+        jitArgument(b, first + i, i);
+    jitSpill(b, first);
+    jitCall(b, function);
+    jitSetSlot(b, first, 0);
+}
+
+// Translate program into b; returns 0 on a construct the generator does not handle
+static int jitTranslate(JitBuilder *b, const Program *program, int32_t zeroOffset, int32_t signOffset, size_t *dataPatch)
+{
+    int frame = (program->maxStack + program->numTemps) * 8;
+    frame += (frame % 16 == 8) ? 0 : 8; // Keep rsp 16-byte aligned at calls (two pushes and the return address)
+    b->tempBase = program->maxStack * 8;
+
+    // Prologue: rbx = variables, r12 = constant data
+    static const unsigned char prologue[] = {0x53, 0x41, 0x54, 0x48, 0x89, 0xFB}; // push rbx; push r12; mov rbx, rdi
+    jitEmit(b, prologue, sizeof(prologue));
+    jitByte(b, 0x48);
+    jitByte(b, 0x81);
+    jitByte(b, 0xEC); // sub rsp, frame
+    jitInt32(b, frame);
+    *dataPatch = jitMoveImmediate(b, REG_R12, 0);
+
+    const int *pc = program->code;
+    const int *end = program->code + program->codeLength;
+    const KernelTable *kernels = &kernelTables[program->tier];
+    int sp = 0;
+    while (pc < end)
+    {
+        int op = *pc++;
+        switch (op)
+        {
+        case OP_CONST:
+            jitPushMemory(b, sp++, REG_R12, *pc++ * 8);
+            break;
+        case OP_VAR:
+            jitPushMemory(b, sp++, REG_RBX, *pc++ * 8);
+            break;
+        case OP_LOAD:
+            jitPushMemory(b, sp++, REG_RSP, b->tempBase + *pc++ * 8);
+            break;
+        case OP_STORE:
+            jitSseMemory(b, SSE_STORE, jitLoadSlot(b, sp - 1, JIT_SCRATCH), REG_RSP, b->tempBase + *pc++ * 8);
+            break;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        {
+            static const int sseOps[] = {SSE_ADD, SSE_SUB, SSE_MUL, SSE_DIV};
+            sp--;
+            jitArithmetic(b, sseOps[op - OP_ADD], sp - 1, sp, zeroOffset);
+            break;
+        }
+        case OP_NEG:
+        {
+            int reg = jitLoadSlot(b, sp - 1, JIT_SCRATCH);
+            jitSseMemory(b, SSE_LOAD, JIT_SCRATCH2, REG_R12, signOffset);
+            jitSseRegister(b, 0x66, SSE_XOR, reg, JIT_SCRATCH2);
+            jitSseMemory(b, SSE_ADD, reg, REG_R12, zeroOffset);
+            jitSetSlot(b, sp - 1, reg);
+            break;
+        }
+        case OP_POW:
+            jitCallKernel(b, sp--, 2, (const void *)kernels->functions[FN_POW].binary);
+            break;
+        case OP_CALL1:
+            jitCallKernel(b, sp, 1, (const void *)kernels->functions[*pc++].unary);
+            break;
+        case OP_CALL2:
+            jitCallKernel(b, sp--, 2, (const void *)kernels->functions[*pc++].binary);
+            break;
+        case OP_PAIR:
+            sp--;
+            jitArgument(b, sp, 0);
+            jitSpill(b, sp);
+            jitLeaStack(b, REG_RDI, b->tempBase + pc[1] * 8);
+            jitLeaStack(b, REG_RSI, b->tempBase + pc[2] * 8);
+            jitCall(b, (const void *)kernels->pairs[pc[0]].kernel);
+            pc += 3;
+            break;
+        case OP_RETURN:
+        {
+            int reg = jitLoadSlot(b, sp - 1, JIT_SCRATCH);
+            if (reg != 0)
+                jitSseRegister(b, 0x66, SSE_MOVE, 0, reg);
+            jitByte(b, 0x48);
+            jitByte(b, 0x81);
+            jitByte(b, 0xC4); // add rsp, frame
+            jitInt32(b, frame);
+            static const unsigned char epilogue[] = {0x41, 0x5C, 0x5B, 0xC3}; // pop r12; pop rbx; ret
+            jitEmit(b, epilogue, sizeof(epilogue));
+            return 1;
+        }
+        default:
+            return 0;
+        }
+    }
+    return 0; // No OP_RETURN
+}
+
+// Translate a compiled program to native code
+// Returns 1 on success, or 0 (leaving jit->function NULL) if the JIT is unavailable or disabled
+static inline int jitCompile(const Program *program, JitCode *jit)
+{
+    memset(jit, 0, sizeof(*jit));
+    if (getenv("CALC_NO_JIT") != NULL || program->codeLength == 0)
+        return 0;
+
+    // Data after the code: the constant pool, then +0 and -0 for the zero and sign fixes
+    int numData = program->numConstants + 2;
+    int32_t zeroOffset = program->numConstants * 8;
+    int32_t signOffset = zeroOffset + 8;
+
+    JitBuilder b;
+    memset(&b, 0, sizeof(b));
+    size_t dataPatch;
+    if (!jitTranslate(&b, program, zeroOffset, signOffset, &dataPatch))
+    {
+        free(b.code);
+        return 0;
+    }
+
+    size_t dataStart = (b.length + 15) & ~(size_t)15;
+    size_t size = dataStart + numData * sizeof(double);
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        free(b.code);
+        return 0;
+    }
+
+    unsigned char *bytes = (unsigned char *)memory;
+    uint64_t data = (uint64_t)(uintptr_t)(bytes + dataStart);
+    memcpy(b.code + dataPatch, &data, 8);
+    memcpy(bytes, b.code, b.length);
+    double *constants = (double *)(bytes + dataStart);
+    if (program->numConstants > 0)
+        memcpy(constants, program->constants, program->numConstants * sizeof(double));
+    constants[program->numConstants] = 0.0;
+    constants[program->numConstants + 1] = -0.0;
+    free(b.code);
+
+    // Never writable and executable at the same time
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(memory, size);
+        return 0;
+    }
+    jit->memory = memory;
+    jit->size = size;
+    jit->function = (JitFunction)memory;
+    return 1;
+}
+
+// Release the native code
+static inline void jitFree(JitCode *jit)
+{
+    if (jit->memory != NULL)
+        munmap(jit->memory, jit->size);
+    memset(jit, 0, sizeof(*jit));
+}
+
+#else
+
+static inline int jitCompile(const Program *program, JitCode *jit)
+{
+    (void)program;
+    memset(jit, 0, sizeof(*jit));
+    return 0;
+}
+
+static inline void jitFree(JitCode *jit)
+{
+    memset(jit, 0, sizeof(*jit));
+}
+
+#endif
+
+// Run a program through its native code, or the interpreter when it has none
+static inline double jitRun(const JitCode *jit, const Program *program, const double *variables)
+{
+    if (jit->function != NULL)
+        return jit->function(variables);
+    return runProgram(program, variables);
+}
+
+#endif
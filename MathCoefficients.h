@@ -0,0 +1,197 @@
+#ifndef MATH_COEFFICIENTS_H
+#define MATH_COEFFICIENTS_H
+
+// Generated by remez.c (./remez --header > MathCoefficients.h); edit the kernel list there, not this file.
+// Every kernel is the lowest-degree minimax polynomial whose error stays within 5.6e-17 in double
+// (1.2e-07 for the FAST_ kernels in float), with its coefficients rounded to that precision.
+// NAME_POLY(t, MADD, K) evaluates the polynomial by Horner's rule with the multiply-add MADD(a, b, c)
+// = a * b + c and constants K(c), so scalar and vector code expand the same definition:
+// SIN_POLY(x2, SCALAR_FMA, SCALAR_SET1) or SIN_POLY(x2, V_FMA, V_SET1). t must be a variable.
+
+#define SCALAR_FMA(a, b, c) ((a) * (b) + (c))
+#define SCALAR_SET1(c) (c)
+
+// SIN: sin(x) = x + x^3 * SIN_POLY(x^2) on [0, 0.78539816339744828]
+// 5 multiply-add(s), relative error 3.8e-18 (1.2e-16 evaluated in double)
+// Used by sinPoly(), simdSinPoly(): reduced argument in [-π/4, π/4]
+#define SIN_POLY(t, MADD, K) \
+    MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, \
+        K(1.58954175214450623e-10), \
+        K(-2.50507340863848057e-08)), \
+        K(2.75573135364524498e-06)), \
+        K(-1.98412698293527870e-04)), \
+        K(8.33333333332183547e-03)), \
+        K(-1.66666666666666297e-01))
+
+// COS: cos(x) = 1 + x^2 * COS_POLY(x^2) on [0, 0.78539816339744828]
+// 6 multiply-add(s), relative error 2.2e-19 (1.5e-16 evaluated in double)
+// Used by cosPoly(), simdCosPoly()
+#define COS_POLY(t, MADD, K) \
+    MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, \
+        K(-1.13610022293389543e-11), \
+        K(2.08757535009393474e-09)), \
+        K(-2.75573146083409560e-07)), \
+        K(2.48015872905115902e-05)), \
+        K(-1.38888888888761305e-03)), \
+        K(4.16666666666666158e-02)), \
+        K(-5.00000000000000000e-01))
+
+// EXP: exp(x) = 1 + x + x^2 * EXP_POLY(x) on [-0.34657359027997264, 0.34657359027997264]
+// 9 multiply-add(s), relative error 7.6e-18 (2.1e-16 evaluated in double)
+// Used by customEXP(), simdEXP()
+#define EXP_POLY(t, MADD, K) \
+    MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, \
+        K(2.50221032024611109e-08), \
+        K(2.76307305916656179e-07)), \
+        K(2.75575387779163553e-06)), \
+        K(2.48014918773516937e-05)), \
+        K(1.98412695479953247e-04)), \
+        K(1.38888889447504440e-03)), \
+        K(8.33333333347468196e-03)), \
+        K(4.16666666665259505e-02)), \
+        K(1.66666666666664381e-01)), \
+        K(5.00000000000001110e-01))
+
+// SINH: sinh(x) = x + x^3 * SINH_POLY(x^2) on [0, 0.34657359027997264]
+// 4 multiply-add(s), relative error 7.7e-19 (1.1e-16 evaluated in double)
+// Used by the odd half of expHalves() and simdExpHalves()
+#define SINH_POLY(t, MADD, K) \
+    MADD(t, MADD(t, MADD(t, MADD(t, \
+        K(2.51008729941663684e-08), \
+        K(2.75572682205596625e-06)), \
+        K(1.98412698619044339e-04)), \
+        K(8.33333333333110757e-03)), \
+        K(1.66666666666666657e-01))
+
+// COSH: cosh(x) = 1 + x^2 * COSH_POLY(x^2) on [0, 0.34657359027997264]
+// 4 multiply-add(s), relative error 3.6e-18 (1.2e-16 evaluated in double)
+// Used by the even half of expHalves() and simdExpHalves()
+#define COSH_POLY(t, MADD, K) \
+    MADD(t, MADD(t, MADD(t, MADD(t, \
+        K(2.76319675416588341e-07), \
+        K(2.48014881537913983e-05)), \
+        K(1.38888889485957252e-03)), \
+        K(4.16666666665099980e-02)), \
+        K(5.00000000000001332e-01))
+
+// LN: lnratio(x) = 2x + x^3 * LN_POLY(x^2) on [0, 0.17157287525380999]
+// 6 multiply-add(s), relative error 1.8e-18 (1.1e-16 evaluated in double)
+// Used by customLN(), simdLN(): ln(m) for m in [sqrt(2)/2, sqrt(2)], x = (m - 1) / (m + 1)
+#define LN_POLY(t, MADD, K) \
+    MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, \
+        K(1.47433123546130890e-01), \
+        K(1.53197130164537287e-01)), \
+        K(1.81833231375146981e-01)), \
+        K(2.22222037160054176e-01)), \
+        K(2.85714286855066668e-01)), \
+        K(3.99999999997158462e-01)), \
+        K(6.66666666666667740e-01))
+
+// ASIN: asin(x) = x + x^3 * ASIN_POLY(x^2) on [0, 0.5]
+// 11 multiply-add(s), relative error 3.4e-17 (1.4e-16 evaluated in double)
+// Used by customASIN(), customACOS(), simdASIN(), simdACOS()
+#define ASIN_POLY(t, MADD, K) \
+    MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, \
+        K(3.19076607353904196e-02), \
+        K(-1.62200014847391390e-02)), \
+        K(1.95268260763113814e-02)), \
+        K(6.52813406069290610e-03)), \
+        K(1.21692403999593829e-02)), \
+        K(1.38852236771715778e-02)), \
+        K(1.73597064854381609e-02)), \
+        K(2.23717579133302855e-02)), \
+        K(3.03819591431653928e-02)), \
+        K(4.46428568281794849e-02)), \
+        K(7.50000000033717446e-02)), \
+        K(1.66666666666654084e-01))
+
+// ATAN: atan(x) = x + x^3 * ATAN_POLY(x^2) on [0, 0.2679491924311227]
+// 7 multiply-add(s), relative error 1.6e-17 (1.2e-16 evaluated in double)
+// Used by customATAN(), simdATAN(): |x| <= tan(π/12)
+#define ATAN_POLY(t, MADD, K) \
+    MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, MADD(t, \
+        K(4.44855510135129112e-02), \
+        K(-6.48611673722331028e-02)), \
+        K(7.67973471357921433e-02)), \
+        K(-9.09039542465265166e-02)), \
+        K(1.11110988134800123e-01)), \
+        K(-1.42857141223292960e-01)), \
+        K(1.99999999989482841e-01)), \
+        K(-3.33333333333310167e-01))
+
+// FAST_SIN: sin(x) = x + x^3 * FAST_SIN_POLY(x^2) on [0, 0.78539816339744828]
+// 2 multiply-add(s), relative error 4e-09 (6.6e-08 evaluated in float)
+// Used by fastSinPoly(), fast vector kernels: [-π/4, π/4]
+#define FAST_SIN_POLY(t, MADD, K) \
+    MADD(t, MADD(t, \
+        K(-1.951829181e-04f), \
+        K(8.332189173e-03f)), \
+        K(-1.666665524e-01f))
+
+// FAST_COS: cos(x) = 1 + x^2 * FAST_COS_POLY(x^2) on [0, 0.78539816339744828]
+// 2 multiply-add(s), relative error 3.9e-08 (1.1e-07 evaluated in float)
+// Used by fastCosPoly(), fast vector kernels
+#define FAST_COS_POLY(t, MADD, K) \
+    MADD(t, MADD(t, \
+        K(-1.359101734e-03f), \
+        K(4.165571555e-02f)), \
+        K(-4.999988377e-01f))
+
+// FAST_EXP: exp(x) = 1 + x + x^2 * FAST_EXP_POLY(x) on [-0.34657359027997264, 0.34657359027997264]
+// 4 multiply-add(s), relative error 3.2e-09 (1.1e-07 evaluated in float)
+// Used by fastEXP(), fast vector kernels
+#define FAST_EXP_POLY(t, MADD, K) \
+    MADD(t, MADD(t, MADD(t, MADD(t, \
+        K(1.383890281e-03f), \
+        K(8.369192481e-03f)), \
+        K(4.166810215e-02f)), \
+        K(1.666651666e-01f)), \
+        K(4.999999404e-01f))
+
+// FAST_SINH: sinh(x) = x + x^3 * FAST_SINH_POLY(x^2) on [0, 0.34657359027997264]
+// 1 multiply-add(s), relative error 1.3e-08 (7.1e-08 evaluated in float)
+// Used by the odd half of fastExpHalves() and simdFastSINHCOSH()
+#define FAST_SINH_POLY(t, MADD, K) \
+    MADD(t, \
+        K(8.366534486e-03f), \
+        K(1.666654348e-01f))
+
+// FAST_COSH: cosh(x) = 1 + x^2 * FAST_COSH_POLY(x^2) on [0, 0.34657359027997264]
+// 1 multiply-add(s), relative error 9e-08 (1.5e-07 evaluated in float)
+// Used by the even half of fastExpHalves() and simdFastSINHCOSH()
+#define FAST_COSH_POLY(t, MADD, K) \
+    MADD(t, \
+        K(4.189842939e-02f), \
+        K(4.999914467e-01f))
+
+// FAST_LN: lnratio(x) = 2x + x^3 * FAST_LN_POLY(x^2) on [0, 0.17157287525380999]
+// 2 multiply-add(s), relative error 8.1e-10 (5.9e-08 evaluated in float)
+// Used by fastLog1pPoly(), fast vector kernels
+#define FAST_LN_POLY(t, MADD, K) \
+    MADD(t, MADD(t, \
+        K(2.987069488e-01f), \
+        K(3.997758627e-01f)), \
+        K(6.666677594e-01f))
+
+// FAST_ASIN: asin(x) = x + x^3 * FAST_ASIN_POLY(x^2) on [0, 0.5]
+// 4 multiply-add(s), relative error 4.9e-09 (6.8e-08 evaluated in float)
+// Used by fastAsinPoly(), fast vector kernels: tighter, π/2 - 2 asin(sqrt((1 - x) / 2)) doubles its error
+#define FAST_ASIN_POLY(t, MADD, K) \
+    MADD(t, MADD(t, MADD(t, MADD(t, \
+        K(4.215838760e-02f), \
+        K(2.418474294e-02f)), \
+        K(4.546915367e-02f)), \
+        K(7.495309412e-02f)), \
+        K(1.666675210e-01f))
+
+// FAST_ATAN: atan(x) = x + x^3 * FAST_ATAN_POLY(x^2) on [0, 0.41421356237309503]
+// 3 multiply-add(s), relative error 2.1e-08 (7.7e-08 evaluated in float)
+// Used by fastATAN(), fast vector kernels: |x| <= tan(π/8)
+#define FAST_ATAN_POLY(t, MADD, K) \
+    MADD(t, MADD(t, MADD(t, \
+        K(8.054275066e-02f), \
+        K(-1.387787610e-01f)), \
+        K(1.997773200e-01f)), \
+        K(-3.333294988e-01f))
+
+#endif
@@ -2,77 +2,198 @@
 #define MATH_FUNCTIONS_H
 
 #include <math.h>
+#include <stdint.h>
+#include "MathCoefficients.h"
 
 // Constants
 static const double PI = 3.14159265358979323846;
-static const double TWO_PI = 2.0 * PI;
 static const double HALF_PI = 0.5 * PI;
-static const double LN2 = 0.6931471805599453; // ln(2)
+static const double LN2 = 0.6931471805599453;            // ln(2)
+static const double LN2_HI = 6.93147180369123816490e-01; // First 32 bits of ln(2), so n * LN2_HI is exact
+static const double LN2_LO = 1.90821492927058770002e-10; // ln(2) - LN2_HI
+static const double SQRT2 = 1.41421356237309504880;
+static const double SQRT3 = 1.73205080756887729353;
+static const double TAN_PI_12 = 0.26794919243112270; // tan(π/12) = 2 - sqrt(3)
+static const double HYPERBOLIC_LARGE = 268435456.0;   // 2^28: above it sqrt(x^2 ± 1) rounds to x
+
+// π/2 split for Cody–Waite reduction: PIO2_1, PIO2_2 and PIO2_3 have 33 significant bits each, so
+// k * PIO2_n is exact for k < 2^20
+static const double PIO2_1 = 1.57079632673412561417e+00;
+static const double PIO2_1T = 6.07710050650619224932e-11; // π/2 - PIO2_1
+static const double PIO2_2 = 6.07710050630396597660e-11;
+static const double PIO2_3 = 2.02226624871116645580e-21;
+static const double PIO2_3T = 8.47842766036889956997e-32; // π/2 - PIO2_1 - PIO2_2 - PIO2_3
+static const double PIO2_LO = 6.12323399573676603587e-17; // π/2 - HALF_PI
+static const double ROUND_SHIFT = 6755399441055744.0;     // 1.5 * 2^52: (x + ROUND_SHIFT) - ROUND_SHIFT rounds x
+
+#define CODY_WAITE_LIMIT 1e6 // reduceAngle() uses Cody–Waite below this (k < 2^20), Payne–Hanek above
+
+// Bits of 2/π after the binary point, 32 per word, far enough for the largest double
+static const uint32_t TWO_OVER_PI_BITS[] = {
+    0xa2f9836e, 0x4e441529, 0xfc2757d1, 0xf534ddc0, 0xdb629599, 0x3c439041, 0xfe5163ab, 0xdebbc561,
+    0xb7246e3a, 0x424dd2e0, 0x06492eea, 0x09d1921c, 0xfe1deb1c, 0xb129a73e, 0xe88235f5, 0x2ebb4484,
+    0xe99c7026, 0xb45f7e41, 0x3991d639, 0x835339f4, 0x9c845f8b, 0xbdf9283b, 0x1ff897ff, 0xde05980f,
+    0xef2f118b, 0x5a0a6d1f, 0x6d367ecf, 0x27cb09b7, 0x4f463f66, 0x9e5fea2d, 0x7527bac7, 0xebe5f17b,
+    0x3d0739f7, 0x8a5292ea, 0x6bfb5fb1, 0x1f8d5d08, 0x56033046, 0xfc7b6bab, 0xf0cfbc20, 0x9af4361d,
+};
+
+// Bits [position, position + 64) of a number stored as 32-bit limbs, least significant first
+static inline uint64_t limbBits(const uint32_t *limbs, int position)
+{
+    int i = position >> 5, shift = position & 31;
+    uint64_t low = limbs[i] | (uint64_t)limbs[i + 1] << 32;
+    return shift == 0 ? low : low >> shift | (uint64_t)limbs[i + 2] << (64 - shift);
+}
 
-// Reduce x to [-π/4, π/4] and return quadrant
+// Payne–Hanek reduction of a finite x >= 1: x = m * 2^e with a 53-bit integer m, and only the 224 bits of 2/π
+// that can still change m * 2^e * 2/π mod 4 are multiplied in (earlier bits contribute multiples of 4).
+// Returns r ∈ [-π/4, π/4] with x = r + k * π/2, to within an ULP of r, and sets the quadrant k mod 4.
+static inline double payneHanek(double x, int *quadrant)
+{
+    int exponent;
+    uint64_t m = (uint64_t)ldexp(frexp(x, &exponent), 53);
+    int e = exponent - 53;
+    int first = e >= 2 ? (e - 2) / 32 : 0; // First word of 2/π that matters
+    int point = 224 - (e - 32 * first);    // Binary point of the product m * TWO_OVER_PI_BITS[first .. first + 6]
+
+    // 53 x 224-bit product in 32-bit limbs, padded so limbBits can read past the top
+    uint32_t product[12] = {0};
+    uint32_t mLimbs[2] = {(uint32_t)m, (uint32_t)(m >> 32)};
+    for (int i = 0; i < 7; i++)
+    {
+        uint64_t word = TWO_OVER_PI_BITS[first + 6 - i], carry = 0;
+        for (int j = 0; j < 2; j++)
+        {
+            uint64_t t = word * mLimbs[j] + product[i + j] + carry;
+            product[i + j] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        product[i + 2] = (uint32_t)carry;
+    }
+
+    // Integer part mod 4 and the top 128 bits of the fraction, rounded to the nearest quadrant
+    int k = (int)(limbBits(product, point) & 3);
+    uint64_t high = limbBits(product, point - 64), low = limbBits(product, point - 128);
+    int negative = (int)(high >> 63);
+    if (negative)
+    {
+        k = (k + 1) & 3; // fraction - 1 in two's complement
+        low = ~low + 1;
+        high = ~high + (low == 0);
+    }
+    *quadrant = k;
+
+    // Normalize and split into two doubles holding 53 bits each
+    int shift = 0;
+    if (high == 0)
+    {
+        high = low;
+        low = 0;
+        shift = 64;
+    }
+    if (high == 0)
+        return 0.0;
+    int zeros = __builtin_clzll(high);
+    if (zeros > 0)
+    {
+        high = high << zeros | low >> (64 - zeros);
+        low <<= zeros;
+    }
+    shift += zeros;
+    double hi = ldexp((double)(high >> 11), -53 - shift);
+    double lo = ldexp((double)((high & 0x7ff) << 42 | low >> 22), -106 - shift);
+
+    double r = hi * HALF_PI + (hi * PIO2_LO + lo * HALF_PI);
+    return negative ? -r : r;
+}
+
+// Reduce x to r ∈ [-π/4, π/4] with x = r + k * π/2 and return the quadrant k mod 4: Cody–Waite with π/2 in
+// four parts below CODY_WAITE_LIMIT, Payne–Hanek above, so r keeps its accuracy however large x is
 static inline double reduceAngle(double x, int *quadrant)
 {
-    x = fmod(x, TWO_PI); // Reduce to [0, 2π]
+    if (fabs(x) < CODY_WAITE_LIMIT)
+    {
+        double k = (x * (2.0 / PI) + ROUND_SHIFT) - ROUND_SHIFT;
+        *quadrant = (int)k & 3;
+        return (((x - k * PIO2_1) - k * PIO2_2) - k * PIO2_3) - k * PIO2_3T;
+    }
+    if (!isfinite(x))
+    {
+        *quadrant = 0;
+        return x - x; // NaN for infinity and NaN
+    }
+    double r = payneHanek(fabs(x), quadrant);
     if (x < 0)
-        x += TWO_PI; // Ensure x is in [0, 2π]
-
-    *quadrant = (int)(x / HALF_PI) % 4; // Determine quadrant
-    double reducedX = fmod(x, PI);      // Reduce to [0, π]
-
-    if (*quadrant == 1 || *quadrant == 3)
-        reducedX = PI - reducedX; // Reflect in quadrant 1 & 3
+    {
+        *quadrant = (4 - *quadrant) & 3;
+        r = -r;
+    }
+    return r;
+}
 
-    if (*quadrant >= 2)
-        reducedX = -reducedX; // Negate in quadrant 2 & 3
+// Sine polynomial on the reduced argument (MathCoefficients.h); the sign of x is copied back so sin(-0) is -0
+static inline double sinPoly(double x)
+{
+    double x2 = x * x;
+    return copysign(x + x * x2 * SIN_POLY(x2, SCALAR_FMA, SCALAR_SET1), x);
+}
 
-    return reducedX;
+// Cosine polynomial on the reduced argument
+static inline double cosPoly(double x)
+{
+    double x2 = x * x;
+    return 1.0 + x2 * COS_POLY(x2, SCALAR_FMA, SCALAR_SET1);
 }
 
-// Sine approximation using Remez polynomial
+// Sine approximation using Remez polynomial: sin(r + k * π/2) is ±sin(r) or ±cos(r)
 static inline double customSIN(double x)
 {
     int quadrant;
-    x = reduceAngle(x, &quadrant);
-
-    const double c1 = -1.66666666666666324348e-01;
-    const double c2 = 8.33333333332248946124e-03;
-    const double c3 = -1.98412698298579493134e-04;
-    const double c4 = 2.75573137070700676789e-06;
-    const double c5 = -2.50507602534068634195e-08;
-    const double c6 = 1.58969099521155010221e-10;
-
-    double x2 = x * x;
-    double result = x * (1.0 + x2 * (c1 + x2 * (c2 + x2 * (c3 + x2 * (c4 + x2 * (c5 + x2 * c6))))));
-
-    return result;
+    double r = reduceAngle(x, &quadrant);
+    double y = (quadrant & 1) ? cosPoly(r) : sinPoly(r);
+    return quadrant >= 2 ? -y : y;
 }
 
 // Cosine approximation using Remez polynomial
 static inline double customCOS(double x)
 {
     int quadrant;
-    x = reduceAngle(x, &quadrant);
-
-    const double c1 = -0.5;
-    const double c2 = 4.16666666666666019037e-02;
-    const double c3 = -1.38888888888741095749e-03;
-    const double c4 = 2.48015872894767294178e-05;
-    const double c5 = -2.75573143513906633035e-07;
-    const double c6 = 2.08757232129817482790e-09;
-
-    double x2 = x * x;
-    double result = 1.0 + x2 * (c1 + x2 * (c2 + x2 * (c3 + x2 * (c4 + x2 * (c5 + x2 * c6)))));
+    double r = reduceAngle(x, &quadrant);
+    double y = (quadrant & 1) ? sinPoly(r) : cosPoly(r);
+    return (quadrant == 1 || quadrant == 2) ? -y : y;
+}
 
-    return (quadrant == 1 || quadrant == 2) ? -result : result;
+// Sine and cosine of the same argument with a single range reduction
+static inline void customSINCOS(double x, double *sinX, double *cosX)
+{
+    int quadrant;
+    double r = reduceAngle(x, &quadrant);
+    double s = sinPoly(r), c = cosPoly(r);
+    *sinX = (quadrant & 1) ? c : s;
+    *cosX = (quadrant & 1) ? s : c;
+    if (quadrant >= 2)
+        *sinX = -*sinX;
+    if (quadrant == 1 || quadrant == 2)
+        *cosX = -*cosX;
 }
 
 // Tangent approximation
 static inline double customTAN(double x)
 {
-    double cos_val = customCOS(x);
+    double sin_val, cos_val;
+    customSINCOS(x, &sin_val, &cos_val);
     if (fabs(cos_val) < 1e-10)
         return INFINITY; // Avoid division by zero
-    return customSIN(x) / cos_val;
+    return sin_val / cos_val;
+}
+
+// Range reduction x = n * ln(2) + r with r ∈ [-ln(2)/2, ln(2)/2]; the two-part ln(2) keeps r exact to
+// the last bits of x
+static inline int reduceExp(double x, double *r)
+{
+    int n = round(x / LN2);
+    *r = (x - n * LN2_HI) - n * LN2_LO;
+    return n;
 }
 
 // Exponential function approximation
@@ -83,82 +204,130 @@ static inline double customEXP(double x)
     if (x < -745.13)
         return 0.0;
 
-    // Range reduction: x = n * ln(2) + r
-    const double ln2 = 0.6931471805599453;
-    int n = round(x / ln2);
-    double r = x - n * ln2;
-
-    // Polynomial approximation for exp(r) on [-0.5, 0.5]
-    const double c1 = 1.0;
-    const double c2 = 1.0;
-    const double c3 = 0.5;
-    const double c4 = 0.16666666666666666;
-    const double c5 = 0.041666666666666664;
-    const double c6 = 0.008333333333333333;
-    const double c7 = 0.001388888888888889;
-    const double c8 = 0.0001984126984126984;
-    const double c9 = 0.0000248015873015873;
-    const double c10 = 0.00000275573192239859;
-
-    double exp_r = c1 + r * (c2 + r * (c3 + r * (c4 + r * (c5 + r * (c6 + r * (c7 + r * (c8 + r * (c9 + r * c10))))))));
+    double r;
+    int n = reduceExp(x, &r);
+
+    // e^r = 1 + r + r^2 * P(r), minimax on [-ln(2)/2, ln(2)/2]
+    double r2 = r * r;
+    double exp_r = 1.0 + (r + r2 * EXP_POLY(r, SCALAR_FMA, SCALAR_SET1));
 
     return ldexp(exp_r, n);
 }
 
-// Natural logarithm approximation using minimax polynomial on [0.5, 1]
+// Natural logarithm approximation using minimax polynomial on [sqrt(2)/2, sqrt(2)]
 static inline double customLN(double x)
 {
     if (x <= 0.0)
         return NAN; // ln(x) is undefined for x <= 0
 
-    // Range reduction: x = m * 2^exp, where m ∈ [0.5, 1)
+    // Range reduction: x = m * 2^exp, where m ∈ [sqrt(2)/2, sqrt(2))
     int exp;
     double m = frexp(x, &exp); // Normalize x to [0.5, 1)
-    m *= 2.0;                  // Scale m to [1, 2)
-    exp--;                     // Adjust exponent accordingly
+    if (m < 0.5 * SQRT2)
+    {
+        m *= 2.0; // Scale m to [1, sqrt(2))
+        exp--;    // Adjust exponent accordingly
+    }
 
-    // Transform m to z ∈ [-1/3, 1/3] for better polynomial approximation
+    // Transform m to z ∈ [-0.1716, 0.1716], where ln(m) = ln((1 + z) / (1 - z)) = 2z + z^3 * P(z^2)
     double z = (m - 1) / (m + 1);
     double z2 = z * z;
+    double lnM = 2.0 * z + z * z2 * LN_POLY(z2, SCALAR_FMA, SCALAR_SET1);
 
-    // Minimax polynomial coefficients for ln((1 + z) / (1 - z))
-    const double c1 = 2.0;
-    const double c2 = 0.6666666666666735;
-    const double c3 = 0.3999999999940942;
-    const double c4 = 0.2857142874366239;
-    const double c5 = 0.2222219843214979;
-    const double c6 = 0.1818357216161805;
-    const double c7 = 0.1531383769920937;
-    const double c8 = 0.1479819860511659;
+    // Reconstruct ln(x) = ln(m) + exp * ln(2)
+    return exp * LN2_HI + (lnM + exp * LN2_LO);
+}
 
-    double lnM = z * (c1 + z2 * (c2 + z2 * (c3 + z2 * (c4 + z2 * (c5 + z2 * (c6 + z2 * (c7 + z2 * c8)))))));
+// ln(1 + u) for u > -1, without losing the low bits of u to the rounding of 1 + u. While 1 + u lies in
+// [sqrt(2)/2, sqrt(2)], the interval of customLN's polynomial, z = u / (2 + u) is formed from u itself
+// (as 2z, which does not underflow for subnormal u); outside it, the rounding error of 1 + u is added
+// back as a first-order correction. The MathCoefficients.h error bound is the polynomial's alone: the
+// inverse hyperbolic functions built on this stay within 3.5 ULP
+static inline double customLN1P(double u)
+{
+    if (u > 0.5 * SQRT2 - 1.0 && u < SQRT2 - 1.0)
+    {
+        double w = u / (1.0 + 0.5 * u); // 2z
+        double z = 0.5 * w;
+        double z2 = z * z;
+        return w + z * z2 * LN_POLY(z2, SCALAR_FMA, SCALAR_SET1);
+    }
+    double m = 1.0 + u;
+    double c = m > 2.0 ? 1.0 - (m - u) : u - (m - 1.0); // (1 + u) - m, exactly
+    return customLN(m) + c / m;
+}
 
-    // Reconstruct ln(x) = ln(m) + exp * ln(2)
-    return lnM + exp * LN2;
+// Range reduction x = n * ln(2) + r shared by e^x and e^-x: returns n and splits e^r into its even and
+// odd halves cosh(r) and sinh(r), so e^r = even + odd and e^-r = even - odd
+static inline int expHalves(double x, double *even, double *odd)
+{
+    double r;
+    int n = reduceExp(x, &r);
+
+    double r2 = r * r;
+    *even = 1.0 + r2 * COSH_POLY(r2, SCALAR_FMA, SCALAR_SET1);
+    *odd = r + r * r2 * SINH_POLY(r2, SCALAR_FMA, SCALAR_SET1);
+    return n;
+}
+
+// Hyperbolic sine and cosine of the same argument from a single exponential evaluation
+static inline void customSINHCOSH(double x, double *sinhX, double *coshX)
+{
+    if (isnan(x) || fabs(x) > 745.13)
+    {
+        // e^-|x| underflows to 0 (the same limits as customEXP)
+        *sinhX = x > 0 ? INFINITY : (x < 0 ? -INFINITY : x);
+        *coshX = isnan(x) ? x : INFINITY;
+        return;
+    }
+
+    double even, odd;
+    int n = expHalves(x, &even, &odd);
+    if (n == 0)
+    {
+        // |x| < ln(2)/2: use the halves directly, which avoids the cancellation in e^x - e^-x
+        *sinhX = odd;
+        *coshX = even;
+        return;
+    }
+
+    double ex = x > 709.78 ? INFINITY : ldexp(even + odd, n);
+    double e_minus_x = x < -709.78 ? INFINITY : ldexp(even - odd, -n);
+    *sinhX = (ex - e_minus_x) / 2.0;
+    *coshX = (ex + e_minus_x) / 2.0;
 }
 
 // Hyperbolic sine approximation
 static inline double customSINH(double x)
 {
-    double ex = customEXP(x);
-    double e_minus_x = customEXP(-x);
-    return (ex - e_minus_x) / 2.0;
+    double sinhX, coshX;
+    customSINHCOSH(x, &sinhX, &coshX);
+    return sinhX;
 }
 
 // Hyperbolic cosine approximation
 static inline double customCOSH(double x)
 {
-    double ex = customEXP(x);
-    double e_minus_x = customEXP(-x);
-    return (ex + e_minus_x) / 2.0;
+    double sinhX, coshX;
+    customSINHCOSH(x, &sinhX, &coshX);
+    return coshX;
 }
 
 // Hyperbolic tangent approximation
 static inline double customTANH(double x)
 {
-    double ex = customEXP(x);
-    double e_minus_x = customEXP(-x);
-    return (ex - e_minus_x) / (ex + e_minus_x);
+    if (fabs(x) > 22.0)
+        return x > 0 ? 1.0 : -1.0; // tanh(x) rounds to ±1, and e^x would overflow for larger x
+    double sinhX, coshX;
+    customSINHCOSH(x, &sinhX, &coshX);
+    return sinhX / coshX;
+}
+
+// Inverse sine polynomial on [-0.5, 0.5]
+static inline double asinPoly(double x)
+{
+    double x2 = x * x;
+    return x + x * x2 * ASIN_POLY(x2, SCALAR_FMA, SCALAR_SET1);
 }
 
 // Inverse sine approximation using minimax polynomial on [-1, 1]
@@ -171,23 +340,29 @@ static inline double customASIN(double x)
     if (x < 0)
         return -customASIN(-x);
 
-    // Polynomial coefficients for asin(x) on [0, 1]
-    const double c1 = 1.0;
-    const double c2 = 0.16666666666666666;
-    const double c3 = 0.075;
-    const double c4 = 0.04464285714285714;
-    const double c5 = 0.03038194444444444;
-    const double c6 = 0.02237215909090909;
-    const double c7 = 0.01735276442307692;
-
-    double x2 = x * x;
-    return x * (c1 + x2 * (c2 + x2 * (c3 + x2 * (c4 + x2 * (c5 + x2 * (c6 + x2 * c7))))));
+    if (x <= 0.5)
+        return asinPoly(x);
+    return HALF_PI - 2.0 * asinPoly(sqrt((1.0 - x) * 0.5)); // asin(x) = π/2 - 2 asin(sqrt((1 - x) / 2))
 }
 
-// Inverse cosine approximation
+// Inverse cosine approximation; near ±1, acos(x) = 2 asin(sqrt((1 - |x|) / 2)) (or π minus that)
+// avoids the cancellation in π/2 - asin(x)
 static inline double customACOS(double x)
 {
-    return HALF_PI - customASIN(x); // acos(x) = π/2 - asin(x)
+    if (x < -1.0 || x > 1.0)
+        return NAN; // acos(x) is undefined for |x| > 1
+
+    if (fabs(x) <= 0.5)
+        return HALF_PI - asinPoly(x); // acos(x) = π/2 - asin(x)
+    double y = 2.0 * asinPoly(sqrt((1.0 - fabs(x)) * 0.5));
+    return x > 0 ? y : PI - y;
+}
+
+// Inverse tangent polynomial on [-tan(π/12), tan(π/12)], keeping the sign of x like sinPoly()
+static inline double atanPoly(double x)
+{
+    double x2 = x * x;
+    return copysign(x + x * x2 * ATAN_POLY(x2, SCALAR_FMA, SCALAR_SET1), x);
 }
 
 // Inverse tangent approximation using minimax polynomial on [-1, 1]
@@ -200,39 +375,45 @@ static inline double customATAN(double x)
     if (x > 1.0)
         return HALF_PI - customATAN(1.0 / x); // atan(x) = π/2 - atan(1/x) for x > 1
 
-    // Polynomial coefficients for atan(x) on [0, 1]
-    const double c1 = 1.0;
-    const double c2 = -0.3333333333333333;
-    const double c3 = 0.2;
-    const double c4 = -0.14285714285714285;
-    const double c5 = 0.1111111111111111;
-    const double c6 = -0.09090909090909091;
-    const double c7 = 0.07692307692307693;
-
-    double x2 = x * x;
-    return x * (c1 + x2 * (c2 + x2 * (c3 + x2 * (c4 + x2 * (c5 + x2 * (c6 + x2 * c7))))));
+    if (x > TAN_PI_12)
+        return PI / 6.0 + atanPoly((SQRT3 * x - 1.0) / (x + SQRT3)); // atan(x) = π/6 + atan((sqrt(3)x - 1) / (x + sqrt(3)))
+    return atanPoly(x);
 }
 
 // Inverse hyperbolic sine approximation
+// ln(x + sqrt(x^2 + 1)) cancels for negative x and loses the low bits of small x to 1 + x, so it is
+// computed for |x| as ln(1 + u) with u = |x| + x^2 / (1 + sqrt(x^2 + 1)), then given the sign of x
 static inline double customASINH(double x)
 {
-    return customLN(x + sqrt(x * x + 1)); // asinh(x) = ln(x + sqrt(x^2 + 1))
+    double a = fabs(x);
+    double result;
+    if (a > HYPERBOLIC_LARGE)
+        result = customLN(a) + LN2; // asinh(a) = ln(2a), and a^2 may overflow
+    else
+        result = customLN1P(a + a * a / (1.0 + sqrt(a * a + 1.0)));
+    return copysign(result, x); // asinh(-x) = -asinh(x)
 }
 
 // Inverse hyperbolic cosine approximation
+// acosh(x) = ln(1 + t + sqrt(t^2 + 2t)) with t = x - 1, which is exact near 1 where x^2 - 1 cancels
 static inline double customACOSH(double x)
 {
     if (x < 1.0)
-        return NAN;                       // acosh(x) is undefined for x < 1
-    return customLN(x + sqrt(x * x - 1)); // acosh(x) = ln(x + sqrt(x^2 - 1))
+        return NAN; // acosh(x) is undefined for x < 1
+    if (x > HYPERBOLIC_LARGE)
+        return customLN(x) + LN2; // acosh(x) = ln(2x), and x^2 may overflow
+    double t = x - 1.0;
+    return customLN1P(t + sqrt(t * t + 2.0 * t));
 }
 
 // Inverse hyperbolic tangent approximation
+// atanh(x) = ln(1 + 2|x| / (1 - |x|)) / 2 with the sign of x, so small |x| keeps its low bits
 static inline double customATANH(double x)
 {
     if (x <= -1.0 || x >= 1.0)
-        return NAN;                           // atanh(x) is undefined for |x| >= 1
-    return 0.5 * customLN((1 + x) / (1 - x)); // atanh(x) = 0.5 * ln((1 + x) / (1 - x))
+        return NAN; // atanh(x) is undefined for |x| >= 1
+    double a = fabs(x);
+    return copysign(0.5 * customLN1P(2.0 * a / (1.0 - a)), x); // atanh(-x) = -atanh(x)
 }
 
 // Power function approximation
@@ -0,0 +1,160 @@
+#ifndef MATH_FUNCTIONS_ACCURATE_H
+#define MATH_FUNCTIONS_ACCURATE_H
+
+#include <stddef.h>
+#include <math.h>
+
+// Accurate precision tier: the C library's functions. With glibc, sin, cos, exp, ln and pow are
+// correctly rounded in nearly every case; the others are not. Measured maximum errors are about 2 ULP
+// for the hyperbolic functions and their inverses (tanh 2.2, sinh 1.8, asinh 1.7, atanh 1.7) and 2.5
+// ULP for log_base, which divides one logarithm by another. Arguments outside a function's domain give NaN,
+// as in the standard tier, so switching tiers changes the accuracy of results but not which arguments
+// are valid: ln(0) and 0^0 are NaN rather than -inf and 1. The array versions are plain loops over the
+// scalar functions.
+
+static inline double accurateSIN(double x)
+{
+    return sin(x);
+}
+
+static inline double accurateCOS(double x)
+{
+    return cos(x);
+}
+
+static inline void accurateSINCOS(double x, double *sinX, double *cosX)
+{
+    *sinX = sin(x);
+    *cosX = cos(x);
+}
+
+static inline double accurateTAN(double x)
+{
+    return tan(x);
+}
+
+static inline double accurateEXP(double x)
+{
+    return exp(x);
+}
+
+static inline double accurateLN(double x)
+{
+    if (!(x > 0.0) || x == INFINITY)
+        return NAN; // Like customLN
+    return log(x);
+}
+
+static inline void accurateSINHCOSH(double x, double *sinhX, double *coshX)
+{
+    *sinhX = sinh(x);
+    *coshX = cosh(x);
+}
+
+static inline double accurateSINH(double x)
+{
+    return sinh(x);
+}
+
+static inline double accurateCOSH(double x)
+{
+    return cosh(x);
+}
+
+static inline double accurateTANH(double x)
+{
+    return tanh(x);
+}
+
+static inline double accurateASIN(double x)
+{
+    return asin(x); // NaN for |x| > 1
+}
+
+static inline double accurateACOS(double x)
+{
+    return acos(x);
+}
+
+static inline double accurateATAN(double x)
+{
+    return atan(x);
+}
+
+static inline double accurateASINH(double x)
+{
+    return asinh(x);
+}
+
+static inline double accurateACOSH(double x)
+{
+    return acosh(x); // NaN for x < 1
+}
+
+static inline double accurateATANH(double x)
+{
+    if (x <= -1.0 || x >= 1.0)
+        return NAN; // Like customATANH: the library returns ±inf at ±1
+    return atanh(x);
+}
+
+static inline double accuratePOW(double a, double b)
+{
+    if (a == 0.0 && b > 0)
+        return 0.0;
+    if (!(a > 0.0) || isnan(b))
+        return NAN; // customPOW computes e^(b * ln(a)), which is NaN for a <= 0
+    return pow(a, b);
+}
+
+static inline double accurateLogBase(double a, double b)
+{
+    if (a <= 0.0 || b <= 0.0 || b == 1.0)
+        return NAN; // Same domain as customLogBase
+    return log(b) / log(a);
+}
+
+// Define vectorAccurateNAME as a loop over accurateNAME
+#define DEFINE_ACCURATE_UNARY(NAME)                                                \
+    static inline void vectorAccurate##NAME(const double *x, double *out, size_t n) \
+    {                                                                              \
+        for (size_t i = 0; i < n; i++)                                             \
+            out[i] = accurate##NAME(x[i]);                                         \
+    }
+#define DEFINE_ACCURATE_BINARY(NAME)                                                                 \
+    static inline void vectorAccurate##NAME(const double *a, const double *b, double *out, size_t n) \
+    {                                                                                                \
+        for (size_t i = 0; i < n; i++)                                                               \
+            out[i] = accurate##NAME(a[i], b[i]);                                                     \
+    }
+#define DEFINE_ACCURATE_PAIR(NAME)                                                                         \
+    static inline void vectorAccurate##NAME(const double *x, double *first, double *second, size_t n) \
+    {                                                                                                      \
+        for (size_t i = 0; i < n; i++)                                                                     \
+            accurate##NAME(x[i], first + i, second + i);                                                   \
+    }
+
+DEFINE_ACCURATE_UNARY(SIN)
+DEFINE_ACCURATE_UNARY(COS)
+DEFINE_ACCURATE_UNARY(TAN)
+DEFINE_ACCURATE_UNARY(EXP)
+DEFINE_ACCURATE_UNARY(LN)
+DEFINE_ACCURATE_UNARY(SINH)
+DEFINE_ACCURATE_UNARY(COSH)
+DEFINE_ACCURATE_UNARY(TANH)
+DEFINE_ACCURATE_UNARY(ASIN)
+DEFINE_ACCURATE_UNARY(ACOS)
+DEFINE_ACCURATE_UNARY(ATAN)
+DEFINE_ACCURATE_UNARY(ASINH)
+DEFINE_ACCURATE_UNARY(ACOSH)
+DEFINE_ACCURATE_UNARY(ATANH)
+DEFINE_ACCURATE_BINARY(POW)
+DEFINE_ACCURATE_BINARY(LogBase)
+DEFINE_ACCURATE_PAIR(SINCOS)
+DEFINE_ACCURATE_PAIR(SINHCOSH)
+
+#undef DEFINE_ACCURATE_UNARY
+#undef DEFINE_ACCURATE_BINARY
+#undef DEFINE_ACCURATE_PAIR
+
+#endif
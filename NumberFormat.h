@@ -0,0 +1,317 @@
+#ifndef NUMBER_FORMAT_H
+#define NUMBER_FORMAT_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#define FORMAT_BUFFER_SIZE 352   // Enough for any double in any format below, including the terminator
+#define FORMAT_MAX_PRECISION 30  // Largest number of decimals formatFixed accepts
+
+// Function declarations
+static inline int formatShortest(double value, char *buffer);
+static inline int formatFixed(double value, int precision, char *buffer);
+
+// Double-to-text conversion without stdio. formatShortest uses Grisu2 (Loitsch, "Printing
+// floating-point numbers quickly and accurately with integers"): the digits always read back as
+// the same double and are the shortest such digits in all but a tiny fraction of cases.
+// formatFixed prints exactly what printf("%.*f") prints.
+
+// Floating-point number f * 2^e with a 64-bit significand
+typedef struct DiyFp
+{
+    uint64_t f;
+    int e;
+} DiyFp;
+
+// Normalized 64-bit significands and binary exponents of 10^k for k = -348, -340, ..., 340
+static const DiyFp cachedPowers[] = {
+    {0xFA8FD5A0081C0288ULL, -1220}, {0xBAAEE17FA23EBF76ULL, -1193}, {0x8B16FB203055AC76ULL, -1166},
+    {0xCF42894A5DCE35EAULL, -1140}, {0x9A6BB0AA55653B2DULL, -1113}, {0xE61ACF033D1A45DFULL, -1087},
+    {0xAB70FE17C79AC6CAULL, -1060}, {0xFF77B1FCBEBCDC4FULL, -1034}, {0xBE5691EF416BD60CULL, -1007},
+    {0x8DD01FAD907FFC3CULL, -980}, {0xD3515C2831559A83ULL, -954}, {0x9D71AC8FADA6C9B5ULL, -927},
+    {0xEA9C227723EE8BCBULL, -901}, {0xAECC49914078536DULL, -874}, {0x823C12795DB6CE57ULL, -847},
+    {0xC21094364DFB5637ULL, -821}, {0x9096EA6F3848984FULL, -794}, {0xD77485CB25823AC7ULL, -768},
+    {0xA086CFCD97BF97F4ULL, -741}, {0xEF340A98172AACE5ULL, -715}, {0xB23867FB2A35B28EULL, -688},
+    {0x84C8D4DFD2C63F3BULL, -661}, {0xC5DD44271AD3CDBAULL, -635}, {0x936B9FCEBB25C996ULL, -608},
+    {0xDBAC6C247D62A584ULL, -582}, {0xA3AB66580D5FDAF6ULL, -555}, {0xF3E2F893DEC3F126ULL, -529},
+    {0xB5B5ADA8AAFF80B8ULL, -502}, {0x87625F056C7C4A8BULL, -475}, {0xC9BCFF6034C13053ULL, -449},
+    {0x964E858C91BA2655ULL, -422}, {0xDFF9772470297EBDULL, -396}, {0xA6DFBD9FB8E5B88FULL, -369},
+    {0xF8A95FCF88747D94ULL, -343}, {0xB94470938FA89BCFULL, -316}, {0x8A08F0F8BF0F156BULL, -289},
+    {0xCDB02555653131B6ULL, -263}, {0x993FE2C6D07B7FACULL, -236}, {0xE45C10C42A2B3B06ULL, -210},
+    {0xAA242499697392D3ULL, -183}, {0xFD87B5F28300CA0EULL, -157}, {0xBCE5086492111AEBULL, -130},
+    {0x8CBCCC096F5088CCULL, -103}, {0xD1B71758E219652CULL, -77}, {0x9C40000000000000ULL, -50},
+    {0xE8D4A51000000000ULL, -24}, {0xAD78EBC5AC620000ULL, 3}, {0x813F3978F8940984ULL, 30},
+    {0xC097CE7BC90715B3ULL, 56}, {0x8F7E32CE7BEA5C70ULL, 83}, {0xD5D238A4ABE98068ULL, 109},
+    {0x9F4F2726179A2245ULL, 136}, {0xED63A231D4C4FB27ULL, 162}, {0xB0DE65388CC8ADA8ULL, 189},
+    {0x83C7088E1AAB65DBULL, 216}, {0xC45D1DF942711D9AULL, 242}, {0x924D692CA61BE758ULL, 269},
+    {0xDA01EE641A708DEAULL, 295}, {0xA26DA3999AEF774AULL, 322}, {0xF209787BB47D6B85ULL, 348},
+    {0xB454E4A179DD1877ULL, 375}, {0x865B86925B9BC5C2ULL, 402}, {0xC83553C5C8965D3DULL, 428},
+    {0x952AB45CFA97A0B3ULL, 455}, {0xDE469FBD99A05FE3ULL, 481}, {0xA59BC234DB398C25ULL, 508},
+    {0xF6C69A72A3989F5CULL, 534}, {0xB7DCBF5354E9BECEULL, 561}, {0x88FCF317F22241E2ULL, 588},
+    {0xCC20CE9BD35C78A5ULL, 614}, {0x98165AF37B2153DFULL, 641}, {0xE2A0B5DC971F303AULL, 667},
+    {0xA8D9D1535CE3B396ULL, 694}, {0xFB9B7CD9A4A7443CULL, 720}, {0xBB764C4CA7A44410ULL, 747},
+    {0x8BAB8EEFB6409C1AULL, 774}, {0xD01FEF10A657842CULL, 800}, {0x9B10A4E5E9913129ULL, 827},
+    {0xE7109BFBA19C0C9DULL, 853}, {0xAC2820D9623BF429ULL, 880}, {0x80444B5E7AA7CF85ULL, 907},
+    {0xBF21E44003ACDD2DULL, 933}, {0x8E679C2F5E44FF8FULL, 960}, {0xD433179D9C8CB841ULL, 986},
+    {0x9E19DB92B4E31BA9ULL, 1013}, {0xEB96BF6EBADF77D9ULL, 1039}, {0xAF87023B9BF0EE6BULL, 1066},
+};
+
+static const uint32_t powersOfTen32[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+// Product of two DiyFps, rounded to 64 bits
+static DiyFp diyMultiply(DiyFp x, DiyFp y)
+{
+    unsigned __int128 product = (unsigned __int128)x.f * y.f;
+    uint64_t high = (uint64_t)(product >> 64);
+    uint64_t low = (uint64_t)product;
+    DiyFp result = {high + (low >> 63), x.e + y.e + 64};
+    return result;
+}
+
+static DiyFp diyNormalize(DiyFp x)
+{
+    int shift = __builtin_clzll(x.f);
+    DiyFp result = {x.f << shift, x.e - shift};
+    return result;
+}
+
+// Cached power c = 10^-k such that the product with a number of binary exponent e lands in [-60, -32]
+static DiyFp cachedPower(int e, int *k)
+{
+    double dk = (-61 - e) * 0.30102999566398114 + 347; // log10(2)
+    int ik = (int)dk;
+    if (dk - ik > 0.0)
+        ik++;
+    int index = (ik >> 3) + 1;
+    *k = -(-348 + index * 8);
+    return cachedPowers[index];
+}
+
+// Move the last digit down while the result stays within the rounding interval and gets closer to w
+static void grisuRound(char *buffer, int length, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t distance)
+{
+    while (rest < distance && delta - rest >= tenKappa &&
+           (rest + tenKappa < distance || distance - rest > rest + tenKappa - distance))
+    {
+        buffer[length - 1]--;
+        rest += tenKappa;
+    }
+}
+
+static int decimalDigits32(uint32_t n)
+{
+    int digits = 1;
+    while (digits < 10 && n >= powersOfTen32[digits])
+        digits++;
+    return digits;
+}
+
+// Generate the digits of w (scaled so that w, the upper bound high and the interval width delta share one exponent)
+static int grisuDigits(DiyFp w, DiyFp high, uint64_t delta, char *buffer, int *k)
+{
+    DiyFp one = {1ULL << -high.e, high.e};
+    uint64_t distance = high.f - w.f;
+    uint32_t p1 = (uint32_t)(high.f >> -one.e);
+    uint64_t p2 = high.f & (one.f - 1);
+    int kappa = decimalDigits32(p1);
+    int length = 0;
+
+    while (kappa > 0)
+    {
+        uint32_t divisor = powersOfTen32[kappa - 1];
+        uint32_t digit = p1 / divisor;
+        p1 %= divisor;
+        if (digit != 0 || length != 0)
+            buffer[length++] = (char)('0' + digit);
+        kappa--;
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest <= delta)
+        {
+            *k += kappa;
+            grisuRound(buffer, length, delta, rest, (uint64_t)powersOfTen32[kappa] << -one.e, distance);
+            return length;
+        }
+    }
+
+    uint64_t unit = 1; // 10^-kappa, for scaling distance
+    while (1)
+    {
+        p2 *= 10;
+        delta *= 10;
+        unit *= 10;
+        char digit = (char)(p2 >> -one.e);
+        if (digit != 0 || length != 0)
+            buffer[length++] = (char)('0' + digit);
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta)
+        {
+            *k += kappa;
+            grisuRound(buffer, length, delta, p2, one.f, distance * unit);
+            return length;
+        }
+    }
+}
+
+// Digits of a positive finite value that read back exactly, shortest in nearly all cases: value = digits * 10^k
+static int grisu2(double value, char *digits, int *k)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int biased = (int)(bits >> 52);
+    uint64_t significand = bits & ((1ULL << 52) - 1);
+    DiyFp v = biased != 0 ? (DiyFp){significand | (1ULL << 52), biased - 1075} : (DiyFp){significand, -1074};
+
+    // Boundaries halfway to the neighbouring doubles (closer below at a power of two)
+    DiyFp upper = diyNormalize((DiyFp){(v.f << 1) + 1, v.e - 1});
+    DiyFp lower = (significand == 0 && biased > 1) ? (DiyFp){(v.f << 2) - 1, v.e - 2} : (DiyFp){(v.f << 1) - 1, v.e - 1};
+    lower.f <<= lower.e - upper.e;
+    lower.e = upper.e;
+
+    DiyFp power = cachedPower(upper.e, k);
+    DiyFp w = diyMultiply(diyNormalize(v), power);
+    DiyFp high = diyMultiply(upper, power);
+    DiyFp low = diyMultiply(lower, power);
+    low.f++;
+    high.f--;
+    return grisuDigits(w, high, high.f - low.f, digits, k);
+}
+
+// Write the exponent suffix e+XX / e-XX
+static int writeExponent(int exponent, char *buffer)
+{
+    int length = 0;
+    buffer[length++] = 'e';
+    buffer[length++] = exponent < 0 ? '-' : '+';
+    if (exponent < 0)
+        exponent = -exponent;
+    if (exponent >= 100)
+        buffer[length++] = (char)('0' + exponent / 100);
+    if (exponent >= 10)
+        buffer[length++] = (char)('0' + exponent / 10 % 10);
+    buffer[length++] = (char)('0' + exponent % 10);
+    return length;
+}
+
+// Write text that reads back as value, shortest in nearly all cases: 1.5, 1200, 0.001, 1e+21, 2.5e-7, -0, inf, nan
+// The output is terminated and also valid calculator input; returns its length
+static inline int formatShortest(double value, char *buffer)
+{
+    int length = 0;
+    if (isnan(value))
+    {
+        memcpy(buffer, "nan", 4);
+        return 3;
+    }
+    if (signbit(value))
+    {
+        buffer[length++] = '-';
+        value = -value;
+    }
+    if (isinf(value))
+    {
+        memcpy(buffer + length, "inf", 4);
+        return length + 3;
+    }
+    if (value == 0)
+    {
+        memcpy(buffer + length, "0", 2);
+        return length + 1;
+    }
+
+    char digits[24];
+    int k;
+    int n = grisu2(value, digits, &k);
+    int point = n + k; // Position of the decimal point relative to the first digit
+    char *out = buffer + length;
+
+    if (k >= 0 && point <= 21)
+    {
+        // Integer: digits followed by zeros
+        memcpy(out, digits, n);
+        memset(out + n, '0', k);
+        length += point;
+    }
+    else if (point > 0 && point <= 21)
+    {
+        // Decimal point inside the digits
+        memcpy(out, digits, point);
+        out[point] = '.';
+        memcpy(out + point + 1, digits + point, n - point);
+        length += n + 1;
+    }
+    else if (point > -6 && point <= 0)
+    {
+        // Small number: 0.000ddd
+        out[0] = '0';
+        out[1] = '.';
+        memset(out + 2, '0', -point);
+        memcpy(out + 2 - point, digits, n);
+        length += 2 - point + n;
+    }
+    else
+    {
+        // Scientific: d.ddde+XX
+        out[0] = digits[0];
+        int used = 1;
+        if (n > 1)
+        {
+            out[1] = '.';
+            memcpy(out + 2, digits + 1, n - 1);
+            used = n + 1;
+        }
+        length += used + writeExponent(point - 1, out + used);
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+// Write value with precision decimals, exactly as printf("%.*f") does (0 <= precision <= FORMAT_MAX_PRECISION)
+// Values whose scaled form fits in 51 bits are rounded with integer arithmetic; the rest go to snprintf
+static inline int formatFixed(double value, int precision, char *buffer)
+{
+    static const double scales[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                    1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+    double magnitude = fabs(value);
+    if (precision > 15 || !(magnitude < 2251799813685248.0 / scales[precision])) // 2^51; also rejects nan and inf
+        return snprintf(buffer, FORMAT_BUFFER_SIZE, "%.*f", precision, value);
+
+    // scaled + error is exactly magnitude * 10^precision, so the comparison with the halfway point is exact
+    double scaled = magnitude * scales[precision];
+    uint64_t rounded = 0;
+    if (scaled >= 0.25)
+    {
+        double error = fma(magnitude, scales[precision], -scaled);
+        double whole = floor(scaled);
+        double aboveHalf = (scaled - whole) - 0.5;
+        rounded = (uint64_t)whole;
+        if (aboveHalf > -error || (aboveHalf == -error && (rounded & 1)))
+            rounded++;
+    }
+
+    char digits[24];
+    int n = 0;
+    do
+    {
+        digits[n++] = (char)('0' + rounded % 10);
+        rounded /= 10;
+    } while (rounded != 0 || n <= precision);
+
+    int length = 0;
+    if (signbit(value))
+        buffer[length++] = '-';
+    while (n > precision)
+        buffer[length++] = digits[--n];
+    if (precision > 0)
+    {
+        buffer[length++] = '.';
+        while (n > 0)
+            buffer[length++] = digits[--n];
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef NUMBER_PARSER_H
+#define NUMBER_PARSER_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#define NUMBER_MAX_EXPONENT 100000 // Exponents are clamped here; anything larger over/underflows anyway
+
+// Outcome of scanning a numeric literal
+typedef enum NumberStatus
+{
+    NUMBER_OK,
+    NUMBER_MULTIPLE_POINTS, // 1.2.3
+    NUMBER_NO_DIGITS,       // . or 0x without digits
+    NUMBER_EXPONENT_DIGITS, // 1.5e+ or 0x1p without exponent digits
+    NUMBER_EXPONENT_POINT   // 1e5.3
+} NumberStatus;
+
+// Error message of each NumberStatus
+static const char *const numberErrors[] = {
+    "",
+    "Invalid number: multiple decimal points in token",
+    "Invalid number: no digits",
+    "Invalid number: exponent has no digits",
+    "Invalid number: decimal point in exponent"};
+
+// Function declarations
+static inline NumberStatus parseNumber(const char *text, int length, int *consumed, double *value);
+
+// Powers of ten that are exact in a double
+static const double exactPowersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                          1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static int hexDigitValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Scan an optional exponent marker (e or p) followed by [+-]digits at text[*i]
+// A decimal 'e' not followed by digits is left alone (it may start an identifier, as in 2exp(1));
+// a hex 'p' must have digits, and no exponent may contain a decimal point
+static NumberStatus scanExponent(const char *text, int length, int *i, char marker, int required, int *exponent)
+{
+    *exponent = 0;
+    if (*i >= length || (text[*i] | 0x20) != marker)
+        return NUMBER_OK;
+    int j = *i + 1;
+    int negative = 0;
+    if (j < length && (text[j] == '+' || text[j] == '-'))
+        negative = text[j++] == '-';
+    if (j >= length || text[j] < '0' || text[j] > '9')
+    {
+        if (required)
+        {
+            *i = j;
+            return NUMBER_EXPONENT_DIGITS;
+        }
+        return NUMBER_OK;
+    }
+    int value = 0;
+    while (j < length && text[j] >= '0' && text[j] <= '9')
+    {
+        if (value < NUMBER_MAX_EXPONENT)
+            value = value * 10 + (text[j] - '0');
+        j++;
+    }
+    *exponent = negative ? -value : value;
+    *i = j;
+    return j < length && text[j] == '.' ? NUMBER_EXPONENT_POINT : NUMBER_OK;
+}
+
+// Correctly rounded conversion of a validated literal that the fast paths cannot handle exactly
+// strtod understands the same decimal and hex syntax; the calculator never changes the C locale
+static double slowParse(const char *text, int length)
+{
+    char buffer[256];
+    char *copy = length < (int)sizeof(buffer) ? buffer : (char *)malloc(length + 1);
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    double value = strtod(copy, NULL);
+    if (copy != buffer)
+        free(copy);
+    return value;
+}
+
+// Parse a hexadecimal literal starting after its 0x prefix
+static NumberStatus parseHexNumber(const char *text, int length, int start, int *consumed, double *value)
+{
+    uint64_t mantissa = 0;
+    int exponent = 0; // Binary exponent adjustment from fraction digits and dropped digits
+    int digits = 0, points = 0, truncated = 0;
+    int i = start;
+    for (; i < length; i++)
+    {
+        if (text[i] == '.')
+        {
+            if (++points > 1)
+            {
+                *consumed = i;
+                return NUMBER_MULTIPLE_POINTS;
+            }
+            continue;
+        }
+        int digit = hexDigitValue(text[i]);
+        if (digit < 0)
+            break;
+        digits++;
+        if (mantissa >> 60 == 0)
+        {
+            mantissa = mantissa * 16 + digit;
+            exponent -= points ? 4 : 0;
+        }
+        else
+        {
+            truncated |= digit != 0;
+            exponent += points ? 0 : 4;
+        }
+    }
+    if (digits == 0)
+    {
+        *consumed = i;
+        return NUMBER_NO_DIGITS;
+    }
+
+    int power;
+    NumberStatus status = scanExponent(text, length, &i, 'p', 1, &power);
+    *consumed = i;
+    if (status != NUMBER_OK)
+        return status;
+
+    // Up to 53 significant bits are exact, and ldexp rounds once if the result is subnormal
+    if (!truncated && mantissa < (1ULL << 53))
+        *value = ldexp((double)mantissa, exponent + power);
+    else
+        *value = slowParse(text, i);
+    return NUMBER_OK;
+}
+
+// Parse the unsigned numeric literal at the start of text (length characters): decimal with an
+// optional exponent (1.5, .5, 2e-9, 1E+300) or hexadecimal with an optional binary exponent
+// (0x1F, 0x1.8p-3). The result is correctly rounded. On success *consumed is the literal's length;
+// on failure it is the offset of the offending character.
+static inline NumberStatus parseNumber(const char *text, int length, int *consumed, double *value)
+{
+    if (length >= 2 && text[0] == '0' && (text[1] | 0x20) == 'x')
+        return parseHexNumber(text, length, 2, consumed, value);
+
+    uint64_t mantissa = 0;
+    int exponent = 0; // Decimal exponent adjustment from fraction digits and dropped digits
+    int digits = 0, significant = 0, points = 0, truncated = 0;
+    int i = 0;
+    for (; i < length; i++)
+    {
+        char c = text[i];
+        if (c == '.')
+        {
+            if (++points > 1)
+            {
+                *consumed = i;
+                return NUMBER_MULTIPLE_POINTS;
+            }
+            continue;
+        }
+        if (c < '0' || c > '9')
+            break;
+        digits++;
+        if (significant == 0 && c == '0')
+        {
+            exponent -= points; // Leading zeros only shift the exponent
+            continue;
+        }
+        if (significant < 19)
+        {
+            mantissa = mantissa * 10 + (c - '0');
+            significant++;
+            exponent -= points;
+        }
+        else
+        {
+            truncated |= c != '0';
+            exponent += points ? 0 : 1;
+        }
+    }
+    if (digits == 0)
+    {
+        *consumed = i;
+        return NUMBER_NO_DIGITS;
+    }
+
+    int power;
+    NumberStatus status = scanExponent(text, length, &i, 'e', 0, &power);
+    *consumed = i;
+    if (status != NUMBER_OK)
+        return status;
+    exponent += power;
+
+    // Clinger's fast path: both the mantissa and the power of ten are exact, so one rounding remains
+    if (mantissa == 0)
+        *value = 0.0;
+    else if (!truncated && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+        *value = exponent < 0 ? (double)mantissa / exactPowersOfTen[-exponent]
+                              : (double)mantissa * exactPowersOfTen[exponent];
+    else
+        *value = slowParse(text, i);
+    return NUMBER_OK;
+}
+
+#endif
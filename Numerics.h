@@ -0,0 +1,427 @@
+#ifndef NUMERICS_H
+#define NUMERICS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <pthread.h>
+#include "Bytecode.h"
+#include "WorkPool.h"
+
+// Integration and root finding over one variable of a compiled program, which is compiled once and
+// then run at every point. integrateProgram uses adaptive 15-point Gauss-Kronrod quadrature: each
+// round bisects every subinterval whose error estimate is above its share of the tolerance, and the
+// new subintervals are evaluated in chunks, each chunk's nodes in one evaluateColumns call, on a
+// work pool. solveProgram uses Brent's method on a bracket whose ends differ in sign.
+
+#define QUAD_CHUNK 16                // Subintervals per task (16 x 15 nodes fit one column block)
+#define QUAD_MAX_INTERVALS 100000    // Most subintervals an integral is split into
+#define QUAD_DEFAULT_TOLERANCE 1e-10 // Error allowed relative to the integral (or absolute below 1)
+#define SOLVE_DEFAULT_TOLERANCE 1e-15 // Absolute error allowed in a root, on top of 2 ULP of it
+#define SOLVE_MAX_ITERATIONS 200     // Most steps of Brent's method
+
+// Outcome of an integration or root search
+typedef struct NumericResult
+{
+    double value;     // Integral or root
+    double error;     // Estimated absolute error of value
+    long evaluations; // Points at which the program was run
+    int converged;    // Whether the error is within the tolerance
+} NumericResult;
+
+// Function declarations
+static inline int integrateProgram(const Program *program, int variable, const double *variables, double a, double b,
+                                   double tolerance, int numThreads, NumericResult *result, ParseError *error);
+static inline int solveProgram(const Program *program, int variable, const double *variables, double lo, double hi,
+                               double tolerance, NumericResult *result, ParseError *error);
+
+// Kronrod nodes on [-1, 1] (the odd ones are also the Gauss nodes) and their weights, from QUADPACK
+static const double kronrodNodes[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851, 0.864864423359769072789712788640926,
+    0.741531185599394439863864773280788, 0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.0};
+static const double kronrodWeights[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204, 0.104790010322250183839876322541518,
+    0.140653259715525918745189590510238, 0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+static const double gaussWeights[4] = {0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+                                       0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+
+// One subinterval and its 15-point estimates
+typedef struct QuadInterval
+{
+    double a;
+    double b;
+    double integral; // Kronrod estimate
+    double error;    // Estimated absolute error
+} QuadInterval;
+
+// Problem shared by every task of an integration
+typedef struct QuadShared
+{
+    const Program *program;
+    int variable;            // Column that receives the nodes
+    const double **columns;  // Columns of the other variables, each QUAD_CHUNK * 15 copies of its value
+    pthread_mutex_t lock;    // Protects the done flags
+    pthread_cond_t done;     // Signalled whenever a task completes
+} QuadShared;
+
+// A chunk of subintervals evaluated together
+typedef struct QuadTask
+{
+    QuadInterval **intervals;
+    int count;
+    int done;
+} QuadTask;
+
+// Apply the Gauss-Kronrod rule to count subintervals: lay out their nodes, run the program on all of
+// them at once, and form the estimates (error as in QUADPACK's qk15)
+static void evaluateIntervals(const QuadShared *shared, QuadInterval **intervals, int count)
+{
+    double nodes[QUAD_CHUNK * 15];
+    double values[QUAD_CHUNK * 15];
+    const double *columns[MAX_VARIABLES];
+    for (int i = 0; i < count; i++)
+    {
+        double centre = 0.5 * intervals[i]->a + 0.5 * intervals[i]->b; // Halved first, so wide limits do not overflow
+        double half = 0.5 * intervals[i]->b - 0.5 * intervals[i]->a;
+        double *x = nodes + 15 * i;
+        x[0] = centre;
+        for (int j = 0; j < 7; j++)
+        {
+            x[2 * j + 1] = centre - half * kronrodNodes[j];
+            x[2 * j + 2] = centre + half * kronrodNodes[j];
+        }
+    }
+    for (int v = 0; v < shared->program->numVariables; v++)
+        columns[v] = v == shared->variable ? nodes : shared->columns[v];
+    if (!evaluateColumns(shared->program, columns, values, (size_t)count * 15))
+    {
+        for (int i = 0; i < count; i++)
+            intervals[i]->integral = intervals[i]->error = NAN;
+        return;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        const double *f = values + 15 * i;
+        double half = 0.5 * intervals[i]->b - 0.5 * intervals[i]->a;
+        double kronrod = kronrodWeights[7] * f[0];
+        double gauss = gaussWeights[3] * f[0];
+        double absolute = fabs(kronrod);
+        for (int j = 0; j < 7; j++)
+        {
+            double sum = f[2 * j + 1] + f[2 * j + 2];
+            kronrod += kronrodWeights[j] * sum;
+            absolute += kronrodWeights[j] * (fabs(f[2 * j + 1]) + fabs(f[2 * j + 2]));
+            if (j % 2 == 1)
+                gauss += gaussWeights[j / 2] * sum;
+        }
+        double mean = 0.5 * kronrod;
+        double deviation = kronrodWeights[7] * fabs(f[0] - mean);
+        for (int j = 0; j < 7; j++)
+            deviation += kronrodWeights[j] * (fabs(f[2 * j + 1] - mean) + fabs(f[2 * j + 2] - mean));
+
+        double error = fabs((kronrod - gauss) * half);
+        deviation *= fabs(half);
+        absolute *= fabs(half);
+        if (deviation != 0.0 && error != 0.0)
+            error = deviation * fmin(1.0, pow(200.0 * error / deviation, 1.5));
+        if (absolute > DBL_MIN / (50.0 * DBL_EPSILON))
+            error = fmax(50.0 * DBL_EPSILON * absolute, error); // Rounding limits what the rule can resolve
+        intervals[i]->integral = kronrod * half;
+        intervals[i]->error = error;
+    }
+}
+
+// Worker entry point: evaluate one chunk and flag it done
+static void runQuadTask(void *item, int worker, void *context)
+{
+    (void)worker;
+    QuadTask *task = (QuadTask *)item;
+    QuadShared *shared = (QuadShared *)context;
+    evaluateIntervals(shared, task->intervals, task->count);
+    pthread_mutex_lock(&shared->lock);
+    task->done = 1;
+    pthread_cond_broadcast(&shared->done);
+    pthread_mutex_unlock(&shared->lock);
+}
+
+// Evaluate the pending subintervals, split into chunks that the pool (if any) runs in parallel
+static void evaluatePending(QuadShared *shared, WorkPool *pool, QuadInterval **pending, int numPending, QuadTask *tasks,
+                            void **items)
+{
+    int numTasks = (numPending + QUAD_CHUNK - 1) / QUAD_CHUNK;
+    if (pool == NULL || numTasks == 1)
+    {
+        for (int t = 0; t < numTasks; t++)
+        {
+            int count = numPending - t * QUAD_CHUNK < QUAD_CHUNK ? numPending - t * QUAD_CHUNK : QUAD_CHUNK;
+            evaluateIntervals(shared, pending + t * QUAD_CHUNK, count);
+        }
+        return;
+    }
+
+    for (int t = 0; t < numTasks; t++)
+    {
+        tasks[t].intervals = pending + t * QUAD_CHUNK;
+        tasks[t].count = numPending - t * QUAD_CHUNK < QUAD_CHUNK ? numPending - t * QUAD_CHUNK : QUAD_CHUNK;
+        tasks[t].done = 0;
+        items[t] = &tasks[t];
+    }
+    workPoolSubmit(pool, items, numTasks);
+    pthread_mutex_lock(&shared->lock);
+    for (int t = 0; t < numTasks; t++)
+    {
+        while (!tasks[t].done)
+            pthread_cond_wait(&shared->done, &shared->lock);
+    }
+    pthread_mutex_unlock(&shared->lock);
+}
+
+// Integrate the program over variable from a to b, with the other variables fixed at variables[]
+// (variable may be -1 if the program does not read it). tolerance is relative to the integral, or
+// absolute while the integral is below 1; 0 picks QUAD_DEFAULT_TOLERANCE. Subintervals are
+// evaluated on numThreads threads. Returns 0 and fills in error if the limits are not finite or
+// memory runs out; an integral that does not reach the tolerance is still returned, not converged
+static inline int integrateProgram(const Program *program, int variable, const double *variables, double a, double b,
+                                   double tolerance, int numThreads, NumericResult *result, ParseError *error)
+{
+    memset(result, 0, sizeof(*result));
+    if (!isfinite(a) || !isfinite(b))
+    {
+        snprintf(error->message, sizeof(error->message), "Integration limits must be finite");
+        return 0;
+    }
+    if (tolerance <= 0.0)
+        tolerance = QUAD_DEFAULT_TOLERANCE;
+    if (a == b)
+    {
+        result->converged = 1;
+        return 1;
+    }
+
+    // Columns of the fixed variables, long enough for one chunk
+    QuadShared shared;
+    shared.program = program;
+    shared.variable = variable;
+    const double *columns[MAX_VARIABLES] = {0};
+    double *constants = (double *)malloc((size_t)(program->numVariables + 1) * QUAD_CHUNK * 15 * sizeof(double));
+    QuadInterval *intervals = (QuadInterval *)malloc(QUAD_MAX_INTERVALS * sizeof(QuadInterval));
+    QuadInterval **pending = (QuadInterval **)malloc(QUAD_MAX_INTERVALS * sizeof(QuadInterval *));
+    int maxTasks = (QUAD_MAX_INTERVALS + QUAD_CHUNK - 1) / QUAD_CHUNK;
+    QuadTask *tasks = (QuadTask *)malloc(maxTasks * sizeof(QuadTask));
+    void **items = (void **)malloc(maxTasks * sizeof(void *));
+    if (constants == NULL || intervals == NULL || pending == NULL || tasks == NULL || items == NULL)
+    {
+        free(constants);
+        free(intervals);
+        free(pending);
+        free(tasks);
+        free(items);
+        snprintf(error->message, sizeof(error->message), "Out of memory");
+        return 0;
+    }
+    for (int v = 0; v < program->numVariables; v++)
+    {
+        double *column = constants + (size_t)v * QUAD_CHUNK * 15;
+        for (int i = 0; i < QUAD_CHUNK * 15; i++)
+            column[i] = v == variable || variables == NULL ? 0.0 : variables[v];
+        columns[v] = column;
+    }
+    shared.columns = columns;
+    pthread_mutex_init(&shared.lock, NULL);
+    pthread_cond_init(&shared.done, NULL);
+    WorkPool pool;
+    WorkPool *usePool = NULL;
+    int poolTried = 0;
+
+    // Integrate over [low, high] and flip the sign at the end if the limits were reversed
+    double low = a < b ? a : b;
+    double high = a < b ? b : a;
+    int count = 1;
+    intervals[0].a = low;
+    intervals[0].b = high;
+    pending[0] = &intervals[0];
+    int numPending = 1;
+    double total = 0.0;
+    double totalError = 0.0;
+    while (1)
+    {
+        // The workers start the first time a round has more than one chunk
+        if (numThreads > 1 && !poolTried && numPending > QUAD_CHUNK)
+        {
+            poolTried = 1;
+            if (workPoolInit(&pool, numThreads, runQuadTask, &shared))
+                usePool = &pool;
+        }
+        evaluatePending(&shared, usePool, pending, numPending, tasks, items);
+        result->evaluations += 15L * numPending;
+
+        total = 0.0;
+        totalError = 0.0;
+        for (int i = 0; i < count; i++)
+        {
+            total += intervals[i].integral;
+            totalError += intervals[i].error;
+        }
+        double allowed = tolerance * fmax(1.0, fabs(total));
+        if (totalError <= allowed || !isfinite(total) || isnan(totalError))
+            break; // Within tolerance, or a point where the integrand is not finite
+
+        // Bisect every subinterval whose error is above an equal share of the tolerance: while the
+        // total is above it, at least one is, and a subinterval next to a singularity still gets
+        // below its share as it narrows
+        double share = allowed / count;
+        numPending = 0;
+        int numIntervals = count;
+        for (int i = 0; i < numIntervals && count < QUAD_MAX_INTERVALS; i++)
+        {
+            QuadInterval *interval = &intervals[i];
+            double middle = 0.5 * interval->a + 0.5 * interval->b;
+            if (interval->error <= share || middle <= interval->a || middle >= interval->b)
+                continue;
+            intervals[count].a = middle;
+            intervals[count].b = interval->b;
+            interval->b = middle;
+            pending[numPending++] = interval;
+            pending[numPending++] = &intervals[count++];
+        }
+        if (numPending == 0)
+            break; // Nothing left that bisecting can improve
+    }
+
+    if (usePool != NULL)
+        workPoolFree(usePool);
+    pthread_mutex_destroy(&shared.lock);
+    pthread_cond_destroy(&shared.done);
+    free(constants);
+    free(intervals);
+    free(pending);
+    free(tasks);
+    free(items);
+
+    result->value = a < b ? total : -total;
+    result->error = totalError;
+    result->converged = isfinite(total) && totalError <= tolerance * fmax(1.0, fabs(total));
+    return 1;
+}
+
+// Run the program with variable set to x
+static inline double evaluateAt(const Program *program, int variable, double *variables, double x, long *evaluations)
+{
+    if (variable >= 0)
+        variables[variable] = x;
+    (*evaluations)++;
+    return runProgram(program, variables);
+}
+
+// Find a root of the program in variable between lo and hi, where it must change sign, with the
+// other variables fixed at variables[] (variable may be -1 if the program does not read it).
+// tolerance is the absolute error allowed on top of 2 ULP of the root; 0 picks
+// SOLVE_DEFAULT_TOLERANCE. Brent's method takes inverse quadratic or secant steps while they make
+// progress and bisects otherwise. Returns 0 and fills in error if the ends do not bracket a root
+static inline int solveProgram(const Program *program, int variable, const double *variables, double lo, double hi,
+                               double tolerance, NumericResult *result, ParseError *error)
+{
+    memset(result, 0, sizeof(*result));
+    if (tolerance <= 0.0)
+        tolerance = SOLVE_DEFAULT_TOLERANCE;
+    double values[MAX_VARIABLES] = {0};
+    if (variables != NULL)
+        memcpy(values, variables, program->numVariables * sizeof(double));
+
+    double a = lo;
+    double b = hi;
+    double fa = evaluateAt(program, variable, values, a, &result->evaluations);
+    double fb = evaluateAt(program, variable, values, b, &result->evaluations);
+    if (isnan(fa) || isnan(fb) || ((fa > 0.0) == (fb > 0.0) && fa != 0.0 && fb != 0.0))
+    {
+        snprintf(error->message, sizeof(error->message), "The function must change sign between %g and %g", lo, hi);
+        return 0;
+    }
+
+    // b is the best estimate so far and c the other end of a bracket [b, c] around the root
+    double c = a;
+    double fc = fa;
+    double step = b - a;
+    double lastStep = step;
+    for (int iteration = 0; iteration < SOLVE_MAX_ITERATIONS; iteration++)
+    {
+        if ((fb > 0.0) == (fc > 0.0))
+        {
+            c = a;
+            fc = fa;
+            step = lastStep = b - a;
+        }
+        if (fabs(fc) < fabs(fb))
+        {
+            a = b;
+            b = c;
+            c = a;
+            fa = fb;
+            fb = fc;
+            fc = fa;
+        }
+
+        double limit = 2.0 * DBL_EPSILON * fabs(b) + 0.5 * tolerance;
+        double middle = 0.5 * c - 0.5 * b; // Half the bracket, without overflow for ends near ±DBL_MAX
+        if (fabs(middle) <= limit || fb == 0.0)
+        {
+            result->converged = 1;
+            break;
+        }
+
+        if (fabs(lastStep) >= limit && fabs(fa) > fabs(fb))
+        {
+            // Interpolate: secant through a and b, or inverse quadratic through a, b and c
+            double s = fb / fa;
+            double p, q;
+            if (a == c)
+            {
+                p = 2.0 * middle * s;
+                q = 1.0 - s;
+            }
+            else
+            {
+                double r = fb / fc;
+                q = fa / fc;
+                p = s * (2.0 * middle * q * (q - r) - (b - a) * (r - 1.0));
+                q = (q - 1.0) * (r - 1.0) * (s - 1.0);
+            }
+            if (p > 0.0)
+                q = -q;
+            else
+                p = -p;
+            // Accept the step only if it stays well inside the bracket and shrinks fast enough
+            if (2.0 * p < fmin(3.0 * middle * q - fabs(limit * q), fabs(lastStep * q)))
+            {
+                lastStep = step;
+                step = p / q;
+            }
+            else
+            {
+                step = middle;
+                lastStep = step;
+            }
+        }
+        else
+        {
+            step = middle;
+            lastStep = step;
+        }
+
+        a = b;
+        fa = fb;
+        b += fabs(step) > limit ? step : copysign(limit, middle);
+        fb = evaluateAt(program, variable, values, b, &result->evaluations);
+    }
+
+    result->value = b;
+    result->error = fb == 0.0 ? 0.0 : fabs(c - b);
+    return 1;
+}
+
+#endif
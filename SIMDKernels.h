@@ -0,0 +1,395 @@
+// Vectorized kernels shared by every SIMD width
+//
+// This file has no include guard on purpose: MathFunctionsSIMD.h includes it once per instruction set,
+// after defining the vector type and operation macros (VEC, V_ADD, V_SELECT, ...) for that set.
+// Every kernel mirrors the scalar version in MathFunctions.h with the same coefficients (MathCoefficients.h), but range
+// reduction and special cases use masked selects instead of branches, fmod and recursion.
+
+#define SIMD_CONCAT_(name, suffix) name##_##suffix
+#define SIMD_CONCAT(name, suffix) SIMD_CONCAT_(name, suffix)
+#define SIMD_NAME(name) SIMD_CONCAT(name, SIMD_SUFFIX)
+
+// Compare helpers
+#define V_LT(a, b) V_CMP(a, b, _CMP_LT_OQ)
+#define V_LE(a, b) V_CMP(a, b, _CMP_LE_OQ)
+#define V_GT(a, b) V_CMP(a, b, _CMP_GT_OQ)
+#define V_GE(a, b) V_CMP(a, b, _CMP_GE_OQ)
+#define V_EQ(a, b) V_CMP(a, b, _CMP_EQ_OQ)
+#define V_NEQ(a, b) V_CMP(a, b, _CMP_NEQ_UQ)
+
+// Cody–Waite reduction x = r + k * π/2 with r ∈ [-π/4, π/4], like reduceAngle(); returns r and sets the quadrant
+// k mod 4. The products k * PIO2_1, k * PIO2_2 and k * PIO2_3 are exact for |x| < SIMD_TRIG_LIMIT, so the fused
+// steps round like the scalar ones; larger lanes are recomputed by the scalar kernel (Payne–Hanek)
+SIMD_TARGET static inline VEC SIMD_NAME(simdReduceAngle)(VEC x, VEC *quadrant)
+{
+    VEC k = V_ADD(V_ROUND(V_MUL(x, V_SET1(2.0 / PI))), V_ZERO); // +0 rather than -0, so r = -0 for x = -0 as in reduceAngle()
+    VEC r = V_FNMA(k, V_SET1(PIO2_1), x);
+    r = V_FNMA(k, V_SET1(PIO2_2), r);
+    r = V_FNMA(k, V_SET1(PIO2_3), r);
+    r = V_FNMA(k, V_SET1(PIO2_3T), r);
+    *quadrant = V_SUB(k, V_MUL(V_FLOOR(V_MUL(k, V_SET1(0.25))), V_SET1(4.0)));
+    return r;
+}
+
+// Sine polynomial on the reduced argument, with the sign of x like sinPoly()
+SIMD_TARGET static inline VEC SIMD_NAME(simdSinPoly)(VEC x)
+{
+    VEC x2 = V_MUL(x, x);
+    VEC p = SIN_POLY(x2, V_FMA, V_SET1);
+    return V_COPYSIGN(V_FMA(V_MUL(x, x2), p, x), x);
+}
+
+// Cosine polynomial on the reduced argument
+SIMD_TARGET static inline VEC SIMD_NAME(simdCosPoly)(VEC x)
+{
+    VEC x2 = V_MUL(x, x);
+    return V_FMA(x2, COS_POLY(x2, V_FMA, V_SET1), V_SET1(1.0));
+}
+
+// Sine and cosine with one range reduction, like customSINCOS(): both polynomials are evaluated and each lane
+// picks ±sin(r) or ±cos(r) from its quadrant
+SIMD_TARGET static inline void SIMD_NAME(simdSINCOS)(VEC x, VEC *sinX, VEC *cosX)
+{
+    VEC q;
+    VEC r = SIMD_NAME(simdReduceAngle)(x, &q);
+    VEC s = SIMD_NAME(simdSinPoly)(r);
+    VEC c = SIMD_NAME(simdCosPoly)(r);
+    V_MASK swap = V_MOR(V_EQ(q, V_SET1(1.0)), V_EQ(q, V_SET1(3.0)));
+    VEC sinR = V_SELECT(swap, c, s);
+    VEC cosR = V_SELECT(swap, s, c);
+    *sinX = V_SELECT(V_GE(q, V_SET1(2.0)), V_NEG(sinR), sinR);
+    *cosX = V_SELECT(V_MOR(V_EQ(q, V_SET1(1.0)), V_EQ(q, V_SET1(2.0))), V_NEG(cosR), cosR);
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(simdSIN)(VEC x)
+{
+    VEC sinX, cosX;
+    SIMD_NAME(simdSINCOS)(x, &sinX, &cosX);
+    return sinX;
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(simdCOS)(VEC x)
+{
+    VEC sinX, cosX;
+    SIMD_NAME(simdSINCOS)(x, &sinX, &cosX);
+    return cosX;
+}
+
+// Tangent: one range reduction shared by both polynomials
+SIMD_TARGET static inline VEC SIMD_NAME(simdTAN)(VEC x)
+{
+    VEC s, c;
+    SIMD_NAME(simdSINCOS)(x, &s, &c);
+    VEC t = V_DIV(s, c);
+    return V_SELECT(V_LT(V_ABS(c), V_SET1(1e-10)), V_SET1(INFINITY), t); // Avoid division by zero
+}
+
+// Range reduction x = n * ln(2) + r, like reduceExp()
+SIMD_TARGET static inline VEC SIMD_NAME(simdReduceExp)(VEC x, VEC *r)
+{
+    VEC n = V_ROUND(V_MUL(x, V_SET1(1.0 / LN2)));
+    n = V_MIN(V_MAX(n, V_SET1(-1100.0)), V_SET1(1100.0)); // Out-of-range lanes are replaced by the caller
+    *r = V_SUB(V_SUB(x, V_MUL(n, V_SET1(LN2_HI))), V_MUL(n, V_SET1(LN2_LO))); // Same rounding as the scalar kernel
+    return n;
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(simdEXP)(VEC x)
+{
+    VEC r;
+    VEC n = SIMD_NAME(simdReduceExp)(x, &r);
+    VEC r2 = V_MUL(r, r);
+    VEC p = V_ADD(V_SET1(1.0), V_FMA(r2, EXP_POLY(r, V_FMA, V_SET1), r));
+
+    VEC result = V_LDEXP(p, n);
+    result = V_SELECT(V_GT(x, V_SET1(709.78)), V_SET1(INFINITY), result);
+    return V_SELECT(V_LT(x, V_SET1(-745.13)), V_ZERO, result);
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(simdLN)(VEC x)
+{
+    // Range reduction: x = m * 2^e, where m ∈ [1, 2), then m ∈ [sqrt(2)/2, sqrt(2)) like customLN()
+    VEC m, e;
+    V_FREXP(x, m, e);
+    V_MASK high = V_GE(m, V_SET1(SQRT2));
+    m = V_SELECT(high, V_MUL(m, V_SET1(0.5)), m);
+    e = V_SELECT(high, V_ADD(e, V_SET1(1.0)), e);
+
+    VEC z = V_DIV(V_SUB(m, V_SET1(1.0)), V_ADD(m, V_SET1(1.0)));
+    VEC z2 = V_MUL(z, z);
+    VEC lnM = V_FMA(V_MUL(z, z2), LN_POLY(z2, V_FMA, V_SET1), V_MUL(V_SET1(2.0), z));
+
+    VEC result = V_ADD(V_MUL(e, V_SET1(LN2_HI)), V_ADD(lnM, V_MUL(e, V_SET1(LN2_LO))));
+    // ln(x) is undefined for x <= 0; like the scalar kernel, infinity and NaN give NaN as well
+    V_MASK valid = V_MAND(V_GT(x, V_ZERO), V_LT(x, V_SET1(INFINITY)));
+    return V_SELECT(valid, result, V_SET1(NAN));
+}
+
+// ln(1 + u) like customLN1P(): the polynomial on u itself while 1 + u is in [sqrt(2)/2, sqrt(2)], and
+// otherwise ln(1 + u) with the rounding error of 1 + u added back
+SIMD_TARGET static inline VEC SIMD_NAME(simdLN1P)(VEC u)
+{
+    VEC one = V_SET1(1.0);
+    VEC w = V_DIV(u, V_ADD(one, V_MUL(V_SET1(0.5), u))); // 2z
+    VEC z = V_MUL(V_SET1(0.5), w);
+    VEC z2 = V_MUL(z, z);
+    VEC near = V_FMA(V_MUL(z, z2), LN_POLY(z2, V_FMA, V_SET1), w);
+
+    VEC m = V_ADD(one, u);
+    VEC c = V_SELECT(V_GT(m, V_SET1(2.0)), V_SUB(one, V_SUB(m, u)), V_SUB(u, V_SUB(m, one))); // (1 + u) - m
+    VEC far = V_ADD(SIMD_NAME(simdLN)(m), V_DIV(c, m));
+    V_MASK inside = V_MAND(V_GT(u, V_SET1(0.5 * SQRT2 - 1.0)), V_LT(u, V_SET1(SQRT2 - 1.0)));
+    return V_SELECT(inside, near, far);
+}
+
+// Shared range reduction of e^x and e^-x, like expHalves(): returns n with e^±r = even ± odd
+SIMD_TARGET static inline VEC SIMD_NAME(simdExpHalves)(VEC x, VEC *even, VEC *odd)
+{
+    VEC r;
+    VEC n = SIMD_NAME(simdReduceExp)(x, &r);
+    VEC r2 = V_MUL(r, r);
+    *even = V_FMA(r2, COSH_POLY(r2, V_FMA, V_SET1), V_SET1(1.0));
+    *odd = V_FMA(V_MUL(r, r2), SINH_POLY(r2, V_FMA, V_SET1), r);
+    return n;
+}
+
+// Hyperbolic sine and cosine from one exponential evaluation, like customSINHCOSH()
+SIMD_TARGET static inline void SIMD_NAME(simdSINHCOSH)(VEC x, VEC *sinhX, VEC *coshX)
+{
+    VEC even, odd;
+    VEC n = SIMD_NAME(simdExpHalves)(x, &even, &odd);
+    VEC ex = V_LDEXP(V_ADD(even, odd), n);
+    VEC eMinusX = V_LDEXP(V_SUB(even, odd), V_NEG(n));
+    ex = V_SELECT(V_GT(x, V_SET1(709.78)), V_SET1(INFINITY), ex);
+    ex = V_SELECT(V_LT(x, V_SET1(-745.13)), V_ZERO, ex);
+    eMinusX = V_SELECT(V_LT(x, V_SET1(-709.78)), V_SET1(INFINITY), eMinusX);
+    eMinusX = V_SELECT(V_GT(x, V_SET1(745.13)), V_ZERO, eMinusX);
+
+    V_MASK small = V_EQ(n, V_ZERO); // Use the halves directly, avoiding the cancellation in e^x - e^-x
+    VEC difference = V_SELECT(small, odd, V_MUL(V_SUB(ex, eMinusX), V_SET1(0.5)));
+    *sinhX = V_COPYSIGN(difference, x); // sinh(-0) = -0, as in the scalar kernel
+    *coshX = V_SELECT(small, even, V_MUL(V_ADD(ex, eMinusX), V_SET1(0.5)));
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(simdSINH)(VEC x)
+{
+    VEC sinhX, coshX;
+    SIMD_NAME(simdSINHCOSH)(x, &sinhX, &coshX);
+    return sinhX;
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(simdCOSH)(VEC x)
+{
+    VEC sinhX, coshX;
+    SIMD_NAME(simdSINHCOSH)(x, &sinhX, &coshX);
+    return coshX;
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(simdTANH)(VEC x)
+{
+    VEC sinhX, coshX;
+    SIMD_NAME(simdSINHCOSH)(x, &sinhX, &coshX);
+    VEC result = V_DIV(sinhX, coshX);
+    return V_SELECT(V_GT(V_ABS(x), V_SET1(22.0)), V_COPYSIGN(V_SET1(1.0), x), result); // Rounds to ±1
+}
+
+// Inverse sine polynomial on [-0.5, 0.5], like asinPoly()
+SIMD_TARGET static inline VEC SIMD_NAME(simdAsinPoly)(VEC x)
+{
+    VEC x2 = V_MUL(x, x);
+    return V_FMA(V_MUL(x, x2), ASIN_POLY(x2, V_FMA, V_SET1), x);
+}
+
+// Inverse sine on |x| with the sign of x copied back (asin(-x) = -asin(x)); above 0.5,
+// asin(x) = π/2 - 2 asin(sqrt((1 - x) / 2)) selected per lane
+SIMD_TARGET static inline VEC SIMD_NAME(simdASIN)(VEC x)
+{
+    VEC ax = V_ABS(x);
+    V_MASK high = V_GT(ax, V_SET1(0.5));
+    VEC t = V_SELECT(high, V_SQRT(V_MUL(V_SUB(V_SET1(1.0), ax), V_SET1(0.5))), ax);
+    VEC p = SIMD_NAME(simdAsinPoly)(t);
+    p = V_SELECT(high, V_SUB(V_SET1(HALF_PI), V_MUL(V_SET1(2.0), p)), p);
+    VEC result = V_COPYSIGN(p, x);
+    return V_SELECT(V_GT(ax, V_SET1(1.0)), V_SET1(NAN), result); // Undefined for |x| > 1
+}
+
+// Inverse cosine, like customACOS()
+SIMD_TARGET static inline VEC SIMD_NAME(simdACOS)(VEC x)
+{
+    VEC ax = V_ABS(x);
+    V_MASK high = V_GT(ax, V_SET1(0.5));
+    VEC t = V_SELECT(high, V_SQRT(V_MUL(V_SUB(V_SET1(1.0), ax), V_SET1(0.5))), x);
+    VEC p = SIMD_NAME(simdAsinPoly)(t);
+    VEC y = V_MUL(V_SET1(2.0), p);
+    y = V_SELECT(V_LT(x, V_ZERO), V_SUB(V_SET1(PI), y), y);
+    VEC result = V_SELECT(high, y, V_SUB(V_SET1(HALF_PI), p));
+    return V_SELECT(V_GT(ax, V_SET1(1.0)), V_SET1(NAN), result); // Undefined for |x| > 1
+}
+
+// Inverse tangent: |x| > 1 uses atan(x) = π/2 - atan(1/x), and above tan(π/12)
+// atan(x) = π/6 + atan((sqrt(3)x - 1) / (x + sqrt(3))), selected per lane
+SIMD_TARGET static inline VEC SIMD_NAME(simdATAN)(VEC x)
+{
+    VEC ax = V_ABS(x);
+    V_MASK invert = V_GT(ax, V_SET1(1.0));
+    VEC t = V_SELECT(invert, V_DIV(V_SET1(1.0), ax), ax);
+    V_MASK shift = V_GT(t, V_SET1(TAN_PI_12));
+    VEC shifted = V_DIV(V_SUB(V_MUL(V_SET1(SQRT3), t), V_SET1(1.0)), V_ADD(t, V_SET1(SQRT3)));
+    t = V_SELECT(shift, shifted, t);
+
+    VEC t2 = V_MUL(t, t);
+    VEC p = V_FMA(V_MUL(t, t2), ATAN_POLY(t2, V_FMA, V_SET1), t);
+
+    p = V_SELECT(shift, V_ADD(V_SET1(PI / 6.0), p), p);
+    p = V_SELECT(invert, V_SUB(V_SET1(HALF_PI), p), p);
+    return V_COPYSIGN(p, x);
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(simdASINH)(VEC x)
+{
+    VEC a = V_ABS(x);
+    VEC root = V_SQRT(V_ADD(V_MUL(a, a), V_SET1(1.0)));
+    VEC result = SIMD_NAME(simdLN1P)(V_ADD(a, V_DIV(V_MUL(a, a), V_ADD(V_SET1(1.0), root))));
+    V_MASK large = V_GT(a, V_SET1(HYPERBOLIC_LARGE));
+    result = V_SELECT(large, V_ADD(SIMD_NAME(simdLN)(a), V_SET1(LN2)), result); // ln(2a)
+    return V_COPYSIGN(result, x);
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(simdACOSH)(VEC x)
+{
+    VEC t = V_SUB(x, V_SET1(1.0));
+    VEC root = V_SQRT(V_ADD(V_MUL(t, t), V_MUL(V_SET1(2.0), t)));
+    VEC result = SIMD_NAME(simdLN1P)(V_ADD(t, root));
+    result = V_SELECT(V_GT(x, V_SET1(HYPERBOLIC_LARGE)), V_ADD(SIMD_NAME(simdLN)(x), V_SET1(LN2)), result); // ln(2x)
+    return V_SELECT(V_LT(x, V_SET1(1.0)), V_SET1(NAN), result); // Undefined for x < 1
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(simdATANH)(VEC x)
+{
+    VEC a = V_ABS(x);
+    VEC ratio = V_DIV(V_MUL(V_SET1(2.0), a), V_SUB(V_SET1(1.0), a));
+    VEC result = V_COPYSIGN(V_MUL(V_SET1(0.5), SIMD_NAME(simdLN1P)(ratio)), x);
+    return V_SELECT(V_GE(a, V_SET1(1.0)), V_SET1(NAN), result); // Undefined for |x| >= 1
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(simdPOW)(VEC a, VEC b)
+{
+    VEC result = SIMD_NAME(simdEXP)(V_MUL(b, SIMD_NAME(simdLN)(a)));
+    result = V_SELECT(V_MAND(V_EQ(a, V_ZERO), V_GT(b, V_ZERO)), V_ZERO, result); // 0^b = 0 for b > 0
+    V_MASK fractional = V_NEQ(b, V_TRUNC(b));
+    return V_SELECT(V_MAND(V_LT(a, V_ZERO), fractional), V_SET1(NAN), result); // Undefined for a < 0 and non-integer b
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(simdLogBase)(VEC a, VEC b)
+{
+    VEC result = V_DIV(SIMD_NAME(simdLN)(b), SIMD_NAME(simdLN)(a));
+    V_MASK invalid = V_MOR(V_MOR(V_LE(a, V_ZERO), V_LE(b, V_ZERO)), V_EQ(b, V_SET1(1.0)));
+    return V_SELECT(invalid, V_SET1(NAN), result);
+}
+
+// Array loops: full vectors first, then the tail through a zero-padded vector
+// Lanes with |x| >= LIMIT are recomputed by the scalar kernel (only used by the trigonometric kernels)
+#define SIMD_UNARY_ARRAY(NAME, LIMIT)                                                      \
+    SIMD_TARGET static void SIMD_NAME(array##NAME)(const double *x, double *out, size_t n) \
+    {                                                                                      \
+        size_t i = 0;                                                                      \
+        for (; i + V_WIDTH <= n; i += V_WIDTH)                                             \
+        {                                                                                  \
+            VEC v = V_LOADU(x + i);                                                        \
+            V_STOREU(out + i, SIMD_NAME(simd##NAME)(v));                                   \
+            if (LIMIT < INFINITY && V_ANY(V_GE(V_ABS(v), V_SET1(LIMIT))))                  \
+            {                                                                              \
+                for (size_t j = i; j < i + V_WIDTH; j++)                                   \
+                    if (fabs(x[j]) >= LIMIT)                                               \
+                        out[j] = custom##NAME(x[j]);                                       \
+            }                                                                              \
+        }                                                                                  \
+        if (i < n)                                                                         \
+        {                                                                                  \
+            double in[V_WIDTH] = {0}, res[V_WIDTH];                                        \
+            memcpy(in, x + i, (n - i) * sizeof(double));                                   \
+            V_STOREU(res, SIMD_NAME(simd##NAME)(V_LOADU(in)));                             \
+            for (size_t j = i; j < n; j++)                                                 \
+                out[j] = fabs(x[j]) >= LIMIT ? custom##NAME(x[j]) : res[j - i];            \
+        }                                                                                  \
+    }
+
+#define SIMD_BINARY_ARRAY(NAME)                                                                             \
+    SIMD_TARGET static void SIMD_NAME(array##NAME)(const double *a, const double *b, double *out, size_t n) \
+    {                                                                                                       \
+        size_t i = 0;                                                                                       \
+        for (; i + V_WIDTH <= n; i += V_WIDTH)                                                              \
+            V_STOREU(out + i, SIMD_NAME(simd##NAME)(V_LOADU(a + i), V_LOADU(b + i)));                       \
+        if (i < n)                                                                                          \
+        {                                                                                                   \
+            double inA[V_WIDTH] = {0}, inB[V_WIDTH] = {0}, res[V_WIDTH];                                    \
+            memcpy(inA, a + i, (n - i) * sizeof(double));                                                   \
+            memcpy(inB, b + i, (n - i) * sizeof(double));                                                   \
+            V_STOREU(res, SIMD_NAME(simd##NAME)(V_LOADU(inA), V_LOADU(inB)));                               \
+            memcpy(out + i, res, (n - i) * sizeof(double));                                                 \
+        }                                                                                                   \
+    }
+
+// Two results per argument; neither output may overlap x
+#define SIMD_PAIR_ARRAY(NAME, LIMIT)                                                                        \
+    SIMD_TARGET static void SIMD_NAME(array##NAME)(const double *x, double *first, double *second, size_t n) \
+    {                                                                                                       \
+        size_t i = 0;                                                                                       \
+        VEC a, b;                                                                                           \
+        for (; i + V_WIDTH <= n; i += V_WIDTH)                                                              \
+        {                                                                                                   \
+            VEC v = V_LOADU(x + i);                                                                         \
+            SIMD_NAME(simd##NAME)(v, &a, &b);                                                               \
+            V_STOREU(first + i, a);                                                                         \
+            V_STOREU(second + i, b);                                                                        \
+            if (LIMIT < INFINITY && V_ANY(V_GE(V_ABS(v), V_SET1(LIMIT))))                                   \
+            {                                                                                               \
+                for (size_t j = i; j < i + V_WIDTH; j++)                                                    \
+                    if (fabs(x[j]) >= LIMIT)                                                                \
+                        custom##NAME(x[j], first + j, second + j);                                          \
+            }                                                                                               \
+        }                                                                                                   \
+        if (i < n)                                                                                          \
+        {                                                                                                   \
+            double in[V_WIDTH] = {0}, resA[V_WIDTH], resB[V_WIDTH];                                         \
+            memcpy(in, x + i, (n - i) * sizeof(double));                                                    \
+            SIMD_NAME(simd##NAME)(V_LOADU(in), &a, &b);                                                     \
+            V_STOREU(resA, a);                                                                              \
+            V_STOREU(resB, b);                                                                              \
+            for (size_t j = i; j < n; j++)                                                                  \
+            {                                                                                               \
+                first[j] = resA[j - i];                                                                     \
+                second[j] = resB[j - i];                                                                    \
+                if (fabs(x[j]) >= LIMIT)                                                                    \
+                    custom##NAME(x[j], first + j, second + j);                                              \
+            }                                                                                               \
+        }                                                                                                   \
+    }
+
+SIMD_UNARY_ARRAY(SIN, SIMD_TRIG_LIMIT)
+SIMD_UNARY_ARRAY(COS, SIMD_TRIG_LIMIT)
+SIMD_UNARY_ARRAY(TAN, SIMD_TRIG_LIMIT)
+SIMD_UNARY_ARRAY(EXP, INFINITY)
+SIMD_UNARY_ARRAY(LN, INFINITY)
+SIMD_UNARY_ARRAY(SINH, INFINITY)
+SIMD_UNARY_ARRAY(COSH, INFINITY)
+SIMD_UNARY_ARRAY(TANH, INFINITY)
+SIMD_UNARY_ARRAY(ASIN, INFINITY)
+SIMD_UNARY_ARRAY(ACOS, INFINITY)
+SIMD_UNARY_ARRAY(ATAN, INFINITY)
+SIMD_UNARY_ARRAY(ASINH, INFINITY)
+SIMD_UNARY_ARRAY(ACOSH, INFINITY)
+SIMD_UNARY_ARRAY(ATANH, INFINITY)
+SIMD_BINARY_ARRAY(POW)
+SIMD_BINARY_ARRAY(LogBase)
+SIMD_PAIR_ARRAY(SINCOS, SIMD_TRIG_LIMIT)
+SIMD_PAIR_ARRAY(SINHCOSH, INFINITY)
+
+#undef SIMD_UNARY_ARRAY
+#undef SIMD_BINARY_ARRAY
+#undef SIMD_PAIR_ARRAY
+#undef V_LT
+#undef V_LE
+#undef V_GT
+#undef V_GE
+#undef V_EQ
+#undef V_NEQ
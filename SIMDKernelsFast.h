@@ -0,0 +1,518 @@
+// Vectorized fast-tier kernels shared by every SIMD width
+//
+// Like SIMDKernels.h, this file has no include guard: MathFunctionsSIMD.h includes it once per instruction set,
+// after defining the double macros (VEC, V_ADD, ...) and their single-precision counterparts (FVEC, F_FMA, ...).
+// Every kernel mirrors the scalar version in MathFunctionsFast.h and works on two double vectors at a time:
+// range reduction and special cases run in double, and both halves are packed into one float vector
+// (F_PACK) for the polynomial, so it runs on 2 * V_WIDTH lanes.
+
+// Compare helpers
+#define V_LT(a, b) V_CMP(a, b, _CMP_LT_OQ)
+#define V_LE(a, b) V_CMP(a, b, _CMP_LE_OQ)
+#define V_GT(a, b) V_CMP(a, b, _CMP_GT_OQ)
+#define V_GE(a, b) V_CMP(a, b, _CMP_GE_OQ)
+#define V_EQ(a, b) V_CMP(a, b, _CMP_EQ_OQ)
+#define V_NEQ(a, b) V_CMP(a, b, _CMP_NEQ_UQ)
+
+// Cody–Waite reduction x = r + k * π/2, like fastReduceAngle(); returns r and sets k
+SIMD_TARGET static inline VEC SIMD_NAME(fastReduceAngle)(VEC x, VEC *k)
+{
+    *k = V_ROUND(V_MUL(x, V_SET1(2.0 / PI)));
+    VEC r = V_FNMA(*k, V_SET1(PIO2_1), x);
+    return V_FNMA(*k, V_SET1(PIO2_1T), r);
+}
+
+// Sine and cosine polynomials of two reduced vectors, evaluated in one float vector
+SIMD_TARGET static inline void SIMD_NAME(fastSinCosPoly)(VEC r0, VEC r1, VEC *s0, VEC *s1, VEC *c0, VEC *c1)
+{
+    FVEC r = F_PACK(r0, r1);
+    FVEC z = F_MUL(r, r);
+    FVEC s = F_FMA(F_MUL(r, z), FAST_SIN_POLY(z, F_FMA, F_SET1), r);
+    FVEC c = F_FMA(z, FAST_COS_POLY(z, F_FMA, F_SET1), F_SET1(1.0f));
+    *s0 = F_LOW(s);
+    *s1 = F_HIGH(s);
+    *c0 = F_LOW(c);
+    *c1 = F_HIGH(c);
+}
+
+// sin x and cos x from the polynomials of r and the quadrant k mod 4
+SIMD_TARGET static inline void SIMD_NAME(fastQuadrant)(VEC x, VEC k, VEC s, VEC c, VEC *sinX, VEC *cosX)
+{
+    VEC q = V_SUB(k, V_MUL(V_FLOOR(V_MUL(k, V_SET1(0.25))), V_SET1(4.0)));
+    V_MASK swap = V_MOR(V_EQ(q, V_SET1(1.0)), V_EQ(q, V_SET1(3.0)));
+    VEC sinR = V_SELECT(swap, c, s);
+    VEC cosR = V_SELECT(swap, s, c);
+    sinR = V_SELECT(V_GE(q, V_SET1(2.0)), V_NEG(sinR), sinR);
+    *sinX = V_SELECT(V_LT(V_ABS(x), V_SET1(FAST_TINY)), x, sinR);
+    *cosX = V_SELECT(V_MOR(V_EQ(q, V_SET1(1.0)), V_EQ(q, V_SET1(2.0))), V_NEG(cosR), cosR);
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastSINCOS)(VEC x0, VEC x1, VEC *sin0, VEC *sin1, VEC *cos0, VEC *cos1)
+{
+    VEC k0, k1, s0, s1, c0, c1;
+    VEC r0 = SIMD_NAME(fastReduceAngle)(x0, &k0);
+    VEC r1 = SIMD_NAME(fastReduceAngle)(x1, &k1);
+    SIMD_NAME(fastSinCosPoly)(r0, r1, &s0, &s1, &c0, &c1);
+    SIMD_NAME(fastQuadrant)(x0, k0, s0, c0, sin0, cos0);
+    SIMD_NAME(fastQuadrant)(x1, k1, s1, c1, sin1, cos1);
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastSIN)(VEC x0, VEC x1, VEC *y0, VEC *y1)
+{
+    VEC c0, c1;
+    SIMD_NAME(simdFastSINCOS)(x0, x1, y0, y1, &c0, &c1);
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastCOS)(VEC x0, VEC x1, VEC *y0, VEC *y1)
+{
+    VEC s0, s1;
+    SIMD_NAME(simdFastSINCOS)(x0, x1, &s0, &s1, y0, y1);
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(fastTanFinish)(VEC s, VEC c)
+{
+    return V_SELECT(V_LT(V_ABS(c), V_SET1(1e-10)), V_SET1(INFINITY), V_DIV(s, c)); // Avoid division by zero
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastTAN)(VEC x0, VEC x1, VEC *y0, VEC *y1)
+{
+    VEC s0, s1, c0, c1;
+    SIMD_NAME(simdFastSINCOS)(x0, x1, &s0, &s1, &c0, &c1);
+    *y0 = SIMD_NAME(fastTanFinish)(s0, c0);
+    *y1 = SIMD_NAME(fastTanFinish)(s1, c1);
+}
+
+// Range reduction x = n * ln(2) + r, like fastReduceExp(); out-of-range lanes are replaced by the caller
+SIMD_TARGET static inline VEC SIMD_NAME(fastReduceExp)(VEC x, VEC *n)
+{
+    *n = V_ROUND(V_MUL(x, V_SET1(1.0 / LN2)));
+    *n = V_MIN(V_MAX(*n, V_SET1(-1100.0)), V_SET1(1100.0));
+    VEC r = V_FNMA(*n, V_SET1(LN2_HI), x);
+    return V_FNMA(*n, V_SET1(LN2_LO), r);
+}
+
+// e^r * 2^n with the overflow and underflow limits of customEXP
+SIMD_TARGET static inline VEC SIMD_NAME(fastExpFinish)(VEC x, VEC n, VEC p)
+{
+    VEC result = V_LDEXP(p, n);
+    result = V_SELECT(V_GT(x, V_SET1(709.78)), V_SET1(INFINITY), result);
+    return V_SELECT(V_LT(x, V_SET1(-745.13)), V_ZERO, result);
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastEXP)(VEC x0, VEC x1, VEC *y0, VEC *y1)
+{
+    VEC n0, n1;
+    VEC r0 = SIMD_NAME(fastReduceExp)(x0, &n0);
+    VEC r1 = SIMD_NAME(fastReduceExp)(x1, &n1);
+    FVEC r = F_PACK(r0, r1);
+    FVEC r2 = F_MUL(r, r);
+    FVEC p = F_ADD(F_SET1(1.0f), F_FMA(r2, FAST_EXP_POLY(r, F_FMA, F_SET1), r));
+    *y0 = SIMD_NAME(fastExpFinish)(x0, n0, F_LOW(p));
+    *y1 = SIMD_NAME(fastExpFinish)(x1, n1, F_HIGH(p));
+}
+
+// Split x into m ∈ [sqrt(2)/2, sqrt(2)] and e, like fastFrexp(), returning f = m - 1
+SIMD_TARGET static inline VEC SIMD_NAME(fastLnReduce)(VEC x, VEC *e)
+{
+    VEC m;
+    V_FREXP(x, m, *e);
+    V_MASK high = V_GT(m, V_SET1(SQRT2));
+    m = V_SELECT(high, V_MUL(m, V_SET1(0.5)), m);
+    *e = V_SELECT(high, V_ADD(*e, V_SET1(1.0)), *e);
+    return V_SUB(m, V_SET1(1.0));
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(fastLnFinish)(VEC x, VEC e, VEC lnM)
+{
+    VEC result = V_FMA(e, V_SET1(LN2), lnM);
+    V_MASK valid = V_MAND(V_GT(x, V_ZERO), V_LT(x, V_SET1(INFINITY)));
+    return V_SELECT(valid, result, V_SET1(NAN));
+}
+
+// ln(1 + f) of two reduced vectors, like fastLog1pPoly(), evaluated in one float vector
+SIMD_TARGET static inline void SIMD_NAME(fastLog1pPoly)(VEC f0, VEC f1, VEC *p0, VEC *p1)
+{
+    FVEC f = F_PACK(f0, f1);
+    FVEC s = F_DIV(f, F_ADD(F_SET1(2.0f), f));
+    FVEC z = F_MUL(s, s);
+    FVEC r = F_MUL(z, FAST_LN_POLY(z, F_FMA, F_SET1));
+    FVEC halfSquare = F_MUL(F_MUL(F_SET1(0.5f), f), f);
+    FVEC p = F_SUB(f, F_FNMA(s, F_ADD(halfSquare, r), halfSquare));
+    *p0 = F_LOW(p);
+    *p1 = F_HIGH(p);
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastLN)(VEC x0, VEC x1, VEC *y0, VEC *y1)
+{
+    VEC e0, e1, lnM0, lnM1;
+    VEC f0 = SIMD_NAME(fastLnReduce)(x0, &e0);
+    VEC f1 = SIMD_NAME(fastLnReduce)(x1, &e1);
+    SIMD_NAME(fastLog1pPoly)(f0, f1, &lnM0, &lnM1);
+    *y0 = SIMD_NAME(fastLnFinish)(x0, e0, lnM0);
+    *y1 = SIMD_NAME(fastLnFinish)(x1, e1, lnM1);
+}
+
+// Reduce 1 + u like fastLN1P(): lanes inside the polynomial's interval keep f = u and e = 0, the others
+// split m = 1 + u and set c to the part of 1 + u that m lost
+SIMD_TARGET static inline VEC SIMD_NAME(fastLn1pReduce)(VEC u, VEC m, VEC *e, VEC *c)
+{
+    VEC one = V_SET1(1.0);
+    VEC f = SIMD_NAME(fastLnReduce)(m, e);
+    V_MASK inside = V_MAND(V_GT(u, V_SET1(0.5 * SQRT2 - 1.0)), V_LT(u, V_SET1(SQRT2 - 1.0)));
+    *c = V_SELECT(V_GT(m, V_SET1(2.0)), V_SUB(one, V_SUB(m, u)), V_SUB(u, V_SUB(m, one))); // (1 + u) - m
+    *c = V_SELECT(inside, V_ZERO, *c);
+    *e = V_SELECT(inside, V_ZERO, *e);
+    return V_SELECT(inside, u, f);
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastLN1P)(VEC u0, VEC u1, VEC *y0, VEC *y1)
+{
+    VEC m0 = V_ADD(V_SET1(1.0), u0), m1 = V_ADD(V_SET1(1.0), u1);
+    VEC e0, e1, c0, c1, p0, p1;
+    VEC f0 = SIMD_NAME(fastLn1pReduce)(u0, m0, &e0, &c0);
+    VEC f1 = SIMD_NAME(fastLn1pReduce)(u1, m1, &e1, &c1);
+    SIMD_NAME(fastLog1pPoly)(f0, f1, &p0, &p1);
+    *y0 = V_ADD(SIMD_NAME(fastLnFinish)(m0, e0, p0), V_DIV(c0, m0));
+    *y1 = V_ADD(SIMD_NAME(fastLnFinish)(m1, e1, p1), V_DIV(c1, m1));
+}
+
+// Hyperbolic sine and cosine from e^±r = even ± odd, like fastSINHCOSH()
+SIMD_TARGET static inline void SIMD_NAME(fastSinhCoshFinish)(VEC x, VEC n, VEC even, VEC odd, VEC *sinhX, VEC *coshX)
+{
+    VEC ex = V_LDEXP(V_ADD(even, odd), n);
+    VEC eMinusX = V_LDEXP(V_SUB(even, odd), V_NEG(n));
+    ex = V_SELECT(V_GT(x, V_SET1(709.78)), V_SET1(INFINITY), ex);
+    ex = V_SELECT(V_LT(x, V_SET1(-745.13)), V_ZERO, ex);
+    eMinusX = V_SELECT(V_LT(x, V_SET1(-709.78)), V_SET1(INFINITY), eMinusX);
+    eMinusX = V_SELECT(V_GT(x, V_SET1(745.13)), V_ZERO, eMinusX);
+
+    V_MASK small = V_EQ(n, V_ZERO); // Use the halves directly, avoiding the cancellation in e^x - e^-x
+    odd = V_SELECT(V_LT(V_ABS(x), V_SET1(FAST_TINY)), x, odd);
+    *sinhX = V_SELECT(small, odd, V_MUL(V_SUB(ex, eMinusX), V_SET1(0.5)));
+    *coshX = V_SELECT(small, even, V_MUL(V_ADD(ex, eMinusX), V_SET1(0.5)));
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastSINHCOSH)(VEC x0, VEC x1, VEC *sinh0, VEC *sinh1, VEC *cosh0, VEC *cosh1)
+{
+    VEC n0, n1;
+    VEC r0 = SIMD_NAME(fastReduceExp)(x0, &n0);
+    VEC r1 = SIMD_NAME(fastReduceExp)(x1, &n1);
+    FVEC r = F_PACK(r0, r1);
+    FVEC r2 = F_MUL(r, r);
+    FVEC even = F_FMA(r2, FAST_COSH_POLY(r2, F_FMA, F_SET1), F_SET1(1.0f));
+    FVEC odd = F_FMA(F_MUL(r, r2), FAST_SINH_POLY(r2, F_FMA, F_SET1), r);
+    SIMD_NAME(fastSinhCoshFinish)(x0, n0, F_LOW(even), F_LOW(odd), sinh0, cosh0);
+    SIMD_NAME(fastSinhCoshFinish)(x1, n1, F_HIGH(even), F_HIGH(odd), sinh1, cosh1);
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastSINH)(VEC x0, VEC x1, VEC *y0, VEC *y1)
+{
+    VEC c0, c1;
+    SIMD_NAME(simdFastSINHCOSH)(x0, x1, y0, y1, &c0, &c1);
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastCOSH)(VEC x0, VEC x1, VEC *y0, VEC *y1)
+{
+    VEC s0, s1;
+    SIMD_NAME(simdFastSINHCOSH)(x0, x1, &s0, &s1, y0, y1);
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(fastTanhFinish)(VEC x, VEC s, VEC c)
+{
+    return V_SELECT(V_GT(V_ABS(x), V_SET1(22.0)), V_COPYSIGN(V_SET1(1.0), x), V_DIV(s, c)); // Rounds to ±1
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastTANH)(VEC x0, VEC x1, VEC *y0, VEC *y1)
+{
+    VEC s0, s1, c0, c1;
+    SIMD_NAME(simdFastSINHCOSH)(x0, x1, &s0, &s1, &c0, &c1);
+    *y0 = SIMD_NAME(fastTanhFinish)(x0, s0, c0);
+    *y1 = SIMD_NAME(fastTanhFinish)(x1, s1, c1);
+}
+
+// asin(t) for t ∈ [-0.5, 0.5] with z = t^2, like fastAsinPoly()
+SIMD_TARGET static inline void SIMD_NAME(fastAsinPoly)(VEC t0, VEC t1, VEC z0, VEC z1, VEC *y0, VEC *y1)
+{
+    FVEC t = F_PACK(t0, t1);
+    FVEC z = F_PACK(z0, z1);
+    FVEC p = F_FMA(F_MUL(t, z), FAST_ASIN_POLY(z, F_FMA, F_SET1), t);
+    *y0 = F_LOW(p);
+    *y1 = F_HIGH(p);
+}
+
+// Argument of the polynomial for asin and acos: |x| up to 0.5, sqrt((1 - |x|) / 2) above (z is its square)
+SIMD_TARGET static inline VEC SIMD_NAME(fastAsinReduce)(VEC x, VEC *z)
+{
+    V_MASK high = V_GT(V_ABS(x), V_SET1(0.5));
+    VEC zHigh = V_MUL(V_SET1(0.5), V_SUB(V_SET1(1.0), V_ABS(x)));
+    *z = V_SELECT(high, zHigh, V_MUL(x, x));
+    return V_SELECT(high, V_SQRT(zHigh), x);
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(fastAsinFinish)(VEC x, VEC p)
+{
+    VEC ax = V_ABS(x);
+    VEC result = V_SELECT(V_GT(ax, V_SET1(0.5)), V_COPYSIGN(V_SUB(V_SET1(HALF_PI), V_ADD(p, p)), x), p);
+    result = V_SELECT(V_LT(ax, V_SET1(FAST_TINY)), x, result);
+    return V_SELECT(V_GT(ax, V_SET1(1.0)), V_SET1(NAN), result); // Undefined for |x| > 1
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastASIN)(VEC x0, VEC x1, VEC *y0, VEC *y1)
+{
+    VEC z0, z1;
+    VEC t0 = SIMD_NAME(fastAsinReduce)(x0, &z0);
+    VEC t1 = SIMD_NAME(fastAsinReduce)(x1, &z1);
+    SIMD_NAME(fastAsinPoly)(t0, t1, z0, z1, y0, y1);
+    *y0 = SIMD_NAME(fastAsinFinish)(x0, *y0);
+    *y1 = SIMD_NAME(fastAsinFinish)(x1, *y1);
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(fastAcosFinish)(VEC x, VEC p)
+{
+    VEC twice = V_ADD(p, p);
+    VEC high = V_SELECT(V_GT(x, V_ZERO), twice, V_SUB(V_SET1(PI), twice));
+    VEC result = V_SELECT(V_GT(V_ABS(x), V_SET1(0.5)), high, V_SUB(V_SET1(HALF_PI), p));
+    return V_SELECT(V_GT(V_ABS(x), V_SET1(1.0)), V_SET1(NAN), result); // Undefined for |x| > 1
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastACOS)(VEC x0, VEC x1, VEC *y0, VEC *y1)
+{
+    VEC z0, z1;
+    VEC t0 = SIMD_NAME(fastAsinReduce)(x0, &z0);
+    VEC t1 = SIMD_NAME(fastAsinReduce)(x1, &z1);
+    SIMD_NAME(fastAsinPoly)(t0, t1, z0, z1, y0, y1);
+    *y0 = SIMD_NAME(fastAcosFinish)(x0, *y0);
+    *y1 = SIMD_NAME(fastAcosFinish)(x1, *y1);
+}
+
+// Reduce |x| below tan(π/8) like fastATAN(): t = |x|, (|x| - 1) / (|x| + 1) or -1 / |x|, with one division
+SIMD_TARGET static inline VEC SIMD_NAME(fastAtanReduce)(VEC x, VEC *base)
+{
+    VEC a = V_ABS(x);
+    V_MASK high = V_GT(a, V_SET1(2.414213562373095));
+    V_MASK middle = V_GT(a, V_SET1(0.4142135623730950));
+    VEC numerator = V_SELECT(high, V_SET1(-1.0), V_SELECT(middle, V_SUB(a, V_SET1(1.0)), a));
+    VEC denominator = V_SELECT(high, a, V_SELECT(middle, V_ADD(a, V_SET1(1.0)), V_SET1(1.0)));
+    *base = V_SELECT(high, V_SET1(HALF_PI), V_SELECT(middle, V_SET1(0.25 * PI), V_ZERO));
+    return V_DIV(numerator, denominator);
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastATAN)(VEC x0, VEC x1, VEC *y0, VEC *y1)
+{
+    VEC base0, base1;
+    VEC t0 = SIMD_NAME(fastAtanReduce)(x0, &base0);
+    VEC t1 = SIMD_NAME(fastAtanReduce)(x1, &base1);
+    FVEC t = F_PACK(t0, t1);
+    FVEC z = F_MUL(t, t);
+    FVEC p = F_FMA(F_MUL(t, z), FAST_ATAN_POLY(z, F_FMA, F_SET1), t);
+    *y0 = V_COPYSIGN(V_ADD(base0, F_LOW(p)), x0);
+    *y1 = V_COPYSIGN(V_ADD(base1, F_HIGH(p)), x1);
+    *y0 = V_SELECT(V_LT(V_ABS(x0), V_SET1(FAST_TINY)), x0, *y0);
+    *y1 = V_SELECT(V_LT(V_ABS(x1), V_SET1(FAST_TINY)), x1, *y1);
+}
+
+// Replace the lanes of y where x > HYPERBOLIC_LARGE with ln(2x) = ln(x) + ln(2), as x^2 may overflow there (x >= 0)
+SIMD_TARGET static inline void SIMD_NAME(fastHyperbolicLarge)(VEC x0, VEC x1, VEC *y0, VEC *y1)
+{
+    V_MASK large0 = V_GT(x0, V_SET1(HYPERBOLIC_LARGE)), large1 = V_GT(x1, V_SET1(HYPERBOLIC_LARGE));
+    if (!V_ANY(V_MOR(large0, large1)))
+        return;
+    VEC ln0, ln1;
+    SIMD_NAME(simdFastLN)(x0, x1, &ln0, &ln1);
+    *y0 = V_SELECT(large0, V_ADD(ln0, V_SET1(LN2)), *y0);
+    *y1 = V_SELECT(large1, V_ADD(ln1, V_SET1(LN2)), *y1);
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastASINH)(VEC x0, VEC x1, VEC *y0, VEC *y1)
+{
+    VEC one = V_SET1(1.0);
+    VEC a0 = V_ABS(x0), a1 = V_ABS(x1);
+    VEC u0 = V_ADD(a0, V_DIV(V_MUL(a0, a0), V_ADD(one, V_SQRT(V_FMA(a0, a0, one)))));
+    VEC u1 = V_ADD(a1, V_DIV(V_MUL(a1, a1), V_ADD(one, V_SQRT(V_FMA(a1, a1, one)))));
+    SIMD_NAME(simdFastLN1P)(u0, u1, y0, y1);
+    SIMD_NAME(fastHyperbolicLarge)(a0, a1, y0, y1);
+    *y0 = V_SELECT(V_LT(a0, V_SET1(FAST_TINY)), x0, V_COPYSIGN(*y0, x0));
+    *y1 = V_SELECT(V_LT(a1, V_SET1(FAST_TINY)), x1, V_COPYSIGN(*y1, x1));
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastACOSH)(VEC x0, VEC x1, VEC *y0, VEC *y1)
+{
+    VEC t0 = V_SUB(x0, V_SET1(1.0)), t1 = V_SUB(x1, V_SET1(1.0));
+    SIMD_NAME(simdFastLN1P)(V_ADD(t0, V_SQRT(V_FMA(t0, t0, V_ADD(t0, t0)))),
+                            V_ADD(t1, V_SQRT(V_FMA(t1, t1, V_ADD(t1, t1)))), y0, y1);
+    SIMD_NAME(fastHyperbolicLarge)(x0, x1, y0, y1);
+    *y0 = V_SELECT(V_LT(x0, V_SET1(1.0)), V_SET1(NAN), *y0); // Undefined for x < 1
+    *y1 = V_SELECT(V_LT(x1, V_SET1(1.0)), V_SET1(NAN), *y1);
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(fastAtanhFinish)(VEC x, VEC ln)
+{
+    VEC result = V_SELECT(V_LT(V_ABS(x), V_SET1(FAST_TINY)), x, V_MUL(V_SET1(0.5), ln));
+    return V_SELECT(V_GE(V_ABS(x), V_SET1(1.0)), V_SET1(NAN), result); // Undefined for |x| >= 1
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastATANH)(VEC x0, VEC x1, VEC *y0, VEC *y1)
+{
+    VEC one = V_SET1(1.0);
+    SIMD_NAME(simdFastLN)(V_DIV(V_ADD(one, x0), V_SUB(one, x0)), V_DIV(V_ADD(one, x1), V_SUB(one, x1)), y0, y1);
+    *y0 = SIMD_NAME(fastAtanhFinish)(x0, *y0);
+    *y1 = SIMD_NAME(fastAtanhFinish)(x1, *y1);
+}
+
+// Special cases of pow, as in simdPOW()
+SIMD_TARGET static inline VEC SIMD_NAME(fastPowFinish)(VEC a, VEC b, VEC result)
+{
+    result = V_SELECT(V_MAND(V_EQ(a, V_ZERO), V_GT(b, V_ZERO)), V_ZERO, result); // 0^b = 0 for b > 0
+    V_MASK fractional = V_NEQ(b, V_TRUNC(b));
+    return V_SELECT(V_MAND(V_LT(a, V_ZERO), fractional), V_SET1(NAN), result); // Undefined for a < 0 and non-integer b
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastPOW)(VEC a0, VEC a1, VEC b0, VEC b1, VEC *y0, VEC *y1)
+{
+    VEC ln0, ln1;
+    SIMD_NAME(simdFastLN)(a0, a1, &ln0, &ln1);
+    SIMD_NAME(simdFastEXP)(V_MUL(b0, ln0), V_MUL(b1, ln1), y0, y1);
+    *y0 = SIMD_NAME(fastPowFinish)(a0, b0, *y0);
+    *y1 = SIMD_NAME(fastPowFinish)(a1, b1, *y1);
+}
+
+SIMD_TARGET static inline VEC SIMD_NAME(fastLogBaseFinish)(VEC a, VEC b, VEC lnA, VEC lnB)
+{
+    V_MASK invalid = V_MOR(V_MOR(V_LE(a, V_ZERO), V_LE(b, V_ZERO)), V_EQ(b, V_SET1(1.0)));
+    return V_SELECT(invalid, V_SET1(NAN), V_DIV(lnB, lnA));
+}
+
+SIMD_TARGET static inline void SIMD_NAME(simdFastLogBase)(VEC a0, VEC a1, VEC b0, VEC b1, VEC *y0, VEC *y1)
+{
+    VEC lnA0, lnA1, lnB0, lnB1;
+    SIMD_NAME(simdFastLN)(a0, a1, &lnA0, &lnA1);
+    SIMD_NAME(simdFastLN)(b0, b1, &lnB0, &lnB1);
+    *y0 = SIMD_NAME(fastLogBaseFinish)(a0, b0, lnA0, lnB0);
+    *y1 = SIMD_NAME(fastLogBaseFinish)(a1, b1, lnA1, lnB1);
+}
+
+// Array loops over two vectors at a time, then the tail through zero-padded vectors
+// Lanes with |x| >= LIMIT are recomputed by the scalar kernel (only used by the trigonometric kernels)
+#define FAST_UNARY_ARRAY(NAME, LIMIT)                                                                 \
+    SIMD_TARGET static void SIMD_NAME(arrayFast##NAME)(const double *x, double *out, size_t n)        \
+    {                                                                                                 \
+        size_t i = 0;                                                                                 \
+        VEC y0, y1;                                                                                   \
+        for (; i + 2 * V_WIDTH <= n; i += 2 * V_WIDTH)                                                \
+        {                                                                                             \
+            VEC v0 = V_LOADU(x + i), v1 = V_LOADU(x + i + V_WIDTH);                                   \
+            SIMD_NAME(simdFast##NAME)(v0, v1, &y0, &y1);                                              \
+            V_STOREU(out + i, y0);                                                                    \
+            V_STOREU(out + i + V_WIDTH, y1);                                                          \
+            if (LIMIT < INFINITY && V_ANY(V_MOR(V_GE(V_ABS(v0), V_SET1(LIMIT)), V_GE(V_ABS(v1), V_SET1(LIMIT))))) \
+            {                                                                                         \
+                for (size_t j = i; j < i + 2 * V_WIDTH; j++)                                          \
+                    if (fabs(x[j]) >= LIMIT)                                                          \
+                        out[j] = fast##NAME(x[j]);                                                    \
+            }                                                                                         \
+        }                                                                                             \
+        if (i < n)                                                                                    \
+        {                                                                                             \
+            double in[2 * V_WIDTH] = {0}, res[2 * V_WIDTH];                                           \
+            memcpy(in, x + i, (n - i) * sizeof(double));                                              \
+            SIMD_NAME(simdFast##NAME)(V_LOADU(in), V_LOADU(in + V_WIDTH), &y0, &y1);                  \
+            V_STOREU(res, y0);                                                                        \
+            V_STOREU(res + V_WIDTH, y1);                                                              \
+            for (size_t j = i; j < n; j++)                                                            \
+                out[j] = fabs(x[j]) >= LIMIT ? fast##NAME(x[j]) : res[j - i];                         \
+        }                                                                                             \
+    }
+
+#define FAST_BINARY_ARRAY(NAME)                                                                                 \
+    SIMD_TARGET static void SIMD_NAME(arrayFast##NAME)(const double *a, const double *b, double *out, size_t n) \
+    {                                                                                                           \
+        size_t i = 0;                                                                                           \
+        VEC y0, y1;                                                                                             \
+        for (; i + 2 * V_WIDTH <= n; i += 2 * V_WIDTH)                                                          \
+        {                                                                                                       \
+            SIMD_NAME(simdFast##NAME)(V_LOADU(a + i), V_LOADU(a + i + V_WIDTH), V_LOADU(b + i),                 \
+                                      V_LOADU(b + i + V_WIDTH), &y0, &y1);                                      \
+            V_STOREU(out + i, y0);                                                                              \
+            V_STOREU(out + i + V_WIDTH, y1);                                                                    \
+        }                                                                                                       \
+        if (i < n)                                                                                              \
+        {                                                                                                       \
+            double inA[2 * V_WIDTH] = {0}, inB[2 * V_WIDTH] = {0}, res[2 * V_WIDTH];                            \
+            memcpy(inA, a + i, (n - i) * sizeof(double));                                                       \
+            memcpy(inB, b + i, (n - i) * sizeof(double));                                                       \
+            SIMD_NAME(simdFast##NAME)(V_LOADU(inA), V_LOADU(inA + V_WIDTH), V_LOADU(inB),                       \
+                                      V_LOADU(inB + V_WIDTH), &y0, &y1);                                        \
+            V_STOREU(res, y0);                                                                                  \
+            V_STOREU(res + V_WIDTH, y1);                                                                        \
+            memcpy(out + i, res, (n - i) * sizeof(double));                                                     \
+        }                                                                                                       \
+    }
+
+// Two results per argument; neither output may overlap x
+#define FAST_PAIR_ARRAY(NAME, LIMIT)                                                                             \
+    SIMD_TARGET static void SIMD_NAME(arrayFast##NAME)(const double *x, double *first, double *second, size_t n) \
+    {                                                                                                            \
+        size_t i = 0;                                                                                            \
+        VEC a0, a1, b0, b1;                                                                                      \
+        for (; i + 2 * V_WIDTH <= n; i += 2 * V_WIDTH)                                                           \
+        {                                                                                                        \
+            VEC v0 = V_LOADU(x + i), v1 = V_LOADU(x + i + V_WIDTH);                                              \
+            SIMD_NAME(simdFast##NAME)(v0, v1, &a0, &a1, &b0, &b1);                                               \
+            V_STOREU(first + i, a0);                                                                             \
+            V_STOREU(first + i + V_WIDTH, a1);                                                                   \
+            V_STOREU(second + i, b0);                                                                            \
+            V_STOREU(second + i + V_WIDTH, b1);                                                                  \
+            if (LIMIT < INFINITY && V_ANY(V_MOR(V_GE(V_ABS(v0), V_SET1(LIMIT)), V_GE(V_ABS(v1), V_SET1(LIMIT))))) \
+            {                                                                                                    \
+                for (size_t j = i; j < i + 2 * V_WIDTH; j++)                                                     \
+                    if (fabs(x[j]) >= LIMIT)                                                                     \
+                        fast##NAME(x[j], first + j, second + j);                                                 \
+            }                                                                                                    \
+        }                                                                                                        \
+        if (i < n)                                                                                               \
+        {                                                                                                        \
+            double in[2 * V_WIDTH] = {0}, resA[2 * V_WIDTH], resB[2 * V_WIDTH];                                  \
+            memcpy(in, x + i, (n - i) * sizeof(double));                                                         \
+            SIMD_NAME(simdFast##NAME)(V_LOADU(in), V_LOADU(in + V_WIDTH), &a0, &a1, &b0, &b1);                   \
+            V_STOREU(resA, a0);                                                                                  \
+            V_STOREU(resA + V_WIDTH, a1);                                                                        \
+            V_STOREU(resB, b0);                                                                                  \
+            V_STOREU(resB + V_WIDTH, b1);                                                                        \
+            for (size_t j = i; j < n; j++)                                                                       \
+            {                                                                                                    \
+                first[j] = resA[j - i];                                                                          \
+                second[j] = resB[j - i];                                                                         \
+                if (fabs(x[j]) >= LIMIT)                                                                         \
+                    fast##NAME(x[j], first + j, second + j);                                                     \
+            }                                                                                                    \
+        }                                                                                                        \
+    }
+
+FAST_UNARY_ARRAY(SIN, FAST_TRIG_LIMIT)
+FAST_UNARY_ARRAY(COS, FAST_TRIG_LIMIT)
+FAST_UNARY_ARRAY(TAN, FAST_TRIG_LIMIT)
+FAST_UNARY_ARRAY(EXP, INFINITY)
+FAST_UNARY_ARRAY(LN, INFINITY)
+FAST_UNARY_ARRAY(SINH, INFINITY)
+FAST_UNARY_ARRAY(COSH, INFINITY)
+FAST_UNARY_ARRAY(TANH, INFINITY)
+FAST_UNARY_ARRAY(ASIN, INFINITY)
+FAST_UNARY_ARRAY(ACOS, INFINITY)
+FAST_UNARY_ARRAY(ATAN, INFINITY)
+FAST_UNARY_ARRAY(ASINH, INFINITY)
+FAST_UNARY_ARRAY(ACOSH, INFINITY)
+FAST_UNARY_ARRAY(ATANH, INFINITY)
+FAST_BINARY_ARRAY(POW)
+FAST_BINARY_ARRAY(LogBase)
+FAST_PAIR_ARRAY(SINCOS, FAST_TRIG_LIMIT)
+FAST_PAIR_ARRAY(SINHCOSH, INFINITY)
+
+#undef FAST_UNARY_ARRAY
+#undef FAST_BINARY_ARRAY
+#undef FAST_PAIR_ARRAY
+#undef V_LT
+#undef V_LE
+#undef V_GT
+#undef V_GE
+#undef V_EQ
+#undef V_NEQ
@@ -0,0 +1,619 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Batch.h"
+#include "ExpressionCache.h"
+
+// Evaluation daemon: clients connect over a Unix domain socket (or loopback TCP), send
+// newline-delimited expressions and read one result line per expression, in order. Each read
+// from a client becomes one batch of lines that a worker evaluates with its own arena and
+// expression cache; finished batches are appended to the client's output in order and
+// sent with a single write.
+
+#ifdef __linux__
+#define SERVER_SUPPORTED 1
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#else
+#define SERVER_SUPPORTED 0
+#endif
+
+#define SERVER_READ_SIZE (1 << 16)       // Bytes requested from a client per read
+#define SERVER_MAX_LINE (1 << 20)        // Longest expression accepted; a longer line closes the connection
+#define SERVER_MAX_PENDING (4 << 20)     // Unsent output above which a client's input is no longer read
+#define SERVER_MAX_EVENTS 64             // Events handled per epoll_wait call
+
+// Function declarations
+static inline int runServer(const char *address, int numThreads, OutputFormat format, int precision, ExpressionCache *cache);
+
+#if SERVER_SUPPORTED
+
+struct ServerConnection;
+
+// Complete lines from one read of a client, evaluated by a worker
+typedef struct ServerBatch
+{
+    struct ServerConnection *connection;
+    char *data;                  // Copy of the lines (the last one may lack its newline at end of input)
+    size_t length;               // Bytes in data
+    OutputBuffer out;            // Results (in memory)
+    int done;                    // Set by the event loop once the worker has finished
+    struct ServerBatch *next;    // Next batch of the same connection, in input order
+    struct ServerBatch *finished; // Next batch in the server's list of finished batches
+} ServerBatch;
+
+// One client
+typedef struct ServerConnection
+{
+    int fd;                        // Socket, or -1 once closed
+    char *input;                   // Bytes read but not yet part of a batch (an incomplete line)
+    size_t inputLength;
+    size_t inputCapacity;
+    OutputBuffer output;           // Results ready to send (in memory)
+    size_t sent;                   // Bytes of output already sent
+    ServerBatch *head;             // Oldest batch in flight
+    ServerBatch *tail;             // Newest batch in flight
+    int inFlight;                  // Batches not yet appended to output
+    int eof;                       // The client will send no more input
+    int ready;                     // Queued in the event loop's list of connections with finished batches
+    uint32_t events;               // Events registered with epoll
+    struct ServerConnection *prev; // Neighbours in the server's list of connections
+    struct ServerConnection *next;
+    struct ServerConnection *nextReady;
+} ServerConnection;
+
+// Arena and expression cache of one worker thread
+typedef struct ServerWorker
+{
+    Arena arena;
+    ExpressionCache cache;
+} ServerWorker;
+
+// State of a running server
+typedef struct Server
+{
+    int listener;                 // Listening socket
+    int epoll;
+    int wakeup;                   // eventfd written by workers when a batch is finished
+    WorkPool pool;
+    ServerWorker *workers;
+    int caching;                  // Whether the workers use their caches
+    OutputFormat format;
+    int precision;
+    ServerConnection *connections; // Every open connection (and closed ones with batches in flight)
+    ServerConnection *closed;      // Connections to release at the end of the current event round
+    pthread_mutex_t lock;         // Protects finished
+    ServerBatch *finished;        // Batches finished by workers and not yet collected
+} Server;
+
+static volatile sig_atomic_t serverStopping;
+
+static void serverSignal(int signal)
+{
+    (void)signal;
+    serverStopping = 1;
+}
+
+// Evaluate every line of a batch (run on a worker thread)
+static void runServerBatch(void *item, int worker, void *context)
+{
+    ServerBatch *batch = (ServerBatch *)item;
+    Server *server = (Server *)context;
+    ServerWorker *state = &server->workers[worker];
+    long failures = 0;
+    processLines(batch->data, batch->length, &state->arena, server->caching ? &state->cache : NULL, &batch->out, &failures);
+
+    pthread_mutex_lock(&server->lock);
+    batch->finished = server->finished;
+    server->finished = batch;
+    pthread_mutex_unlock(&server->lock);
+    // A failed write leaves the counter non-zero, so the event loop wakes up either way
+    uint64_t one = 1;
+    ssize_t written = write(server->wakeup, &one, sizeof(one));
+    (void)written;
+}
+
+// Register the events a connection currently needs: input while it is still reading and its
+// unsent output is below the limit, and writability while output is pending
+static void serverWatch(Server *server, ServerConnection *connection)
+{
+    uint32_t events = 0;
+    size_t pending = connection->output.length - connection->sent;
+    if (!connection->eof && pending < SERVER_MAX_PENDING)
+        events |= EPOLLIN;
+    if (pending > 0)
+        events |= EPOLLOUT;
+    if (events == connection->events)
+        return;
+    struct epoll_event event;
+    event.events = events;
+    event.data.ptr = connection;
+    epoll_ctl(server->epoll, EPOLL_CTL_MOD, connection->fd, &event);
+    connection->events = events;
+}
+
+static void serverFreeBatch(ServerBatch *batch)
+{
+    free(batch->data);
+    free(batch->out.data);
+    free(batch);
+}
+
+static void serverFreeConnection(ServerConnection *connection)
+{
+    while (connection->head != NULL)
+    {
+        ServerBatch *batch = connection->head;
+        connection->head = batch->next;
+        serverFreeBatch(batch);
+    }
+    if (connection->fd >= 0)
+        close(connection->fd);
+    free(connection->input);
+    free(connection->output.data);
+    free(connection);
+}
+
+// Retire a connection whose socket is closed and whose batches are all collected; it is released
+// after the current round of events, which may still name it
+static void serverRetire(Server *server, ServerConnection *connection)
+{
+    if (connection->prev != NULL)
+        connection->prev->next = connection->next;
+    else
+        server->connections = connection->next;
+    if (connection->next != NULL)
+        connection->next->prev = connection->prev;
+    connection->next = server->closed;
+    server->closed = connection;
+}
+
+// Close the socket of a connection; the connection itself lives until its batches are finished
+static void serverClose(Server *server, ServerConnection *connection)
+{
+    epoll_ctl(server->epoll, EPOLL_CTL_DEL, connection->fd, NULL);
+    close(connection->fd);
+    connection->fd = -1;
+    connection->eof = 1;
+    if (connection->inFlight == 0)
+        serverRetire(server, connection);
+}
+
+// Send as much pending output as the socket takes in one call, and close the connection once
+// the client has finished sending and every result is out
+static void serverFlush(Server *server, ServerConnection *connection)
+{
+    size_t pending = connection->output.length - connection->sent;
+    if (pending > 0)
+    {
+        ssize_t written = send(connection->fd, connection->output.data + connection->sent, pending, MSG_NOSIGNAL);
+        if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            serverClose(server, connection);
+            return;
+        }
+        if (written > 0)
+            connection->sent += (size_t)written;
+        if (connection->sent == connection->output.length)
+        {
+            connection->output.length = 0;
+            connection->sent = 0;
+        }
+    }
+
+    if (connection->eof && connection->inFlight == 0 && connection->output.length == 0)
+    {
+        serverClose(server, connection);
+        return;
+    }
+    serverWatch(server, connection);
+}
+
+// Queue a batch behind the connection's other batches
+static ServerBatch *serverNewBatch(Server *server, ServerConnection *connection, const char *data, size_t length)
+{
+    ServerBatch *batch = (ServerBatch *)calloc(1, sizeof(ServerBatch));
+    batch->connection = connection;
+    batch->data = (char *)malloc(length > 0 ? length : 1);
+    memcpy(batch->data, data, length);
+    batch->length = length;
+    outputInit(&batch->out, NULL, length + 64);
+    batch->out.format = server->format;
+    batch->out.precision = server->precision;
+    if (connection->tail != NULL)
+        connection->tail->next = batch;
+    else
+        connection->head = batch;
+    connection->tail = batch;
+    connection->inFlight++;
+    return batch;
+}
+
+// Hand the complete lines of a connection's input to the workers; at end of input the
+// remaining bytes are a final line without a newline
+static void serverSubmit(Server *server, ServerConnection *connection)
+{
+    size_t complete = connection->inputLength;
+    if (!connection->eof)
+    {
+        while (complete > 0 && connection->input[complete - 1] != '\n')
+            complete--;
+    }
+    if (complete == 0)
+        return;
+
+    void *item = serverNewBatch(server, connection, connection->input, complete);
+    workPoolSubmit(&server->pool, &item, 1);
+    connection->inputLength -= complete;
+    memmove(connection->input, connection->input + complete, connection->inputLength);
+}
+
+// Answer a line that exceeds SERVER_MAX_LINE with an error after the results before it, then close
+static void serverRejectLine(Server *server, ServerConnection *connection)
+{
+    ServerBatch *batch = serverNewBatch(server, connection, NULL, 0);
+    ParseError error = {0};
+    snprintf(error.message, sizeof(error.message), "Line too long");
+    outputError(&batch->out, &error);
+    batch->done = 1;
+    connection->eof = 1;
+    connection->inputLength = 0;
+}
+
+// Append the finished batches at the head of a connection's queue to its output, in input order
+static void serverDrain(Server *server, ServerConnection *connection)
+{
+    while (connection->head != NULL && connection->head->done)
+    {
+        ServerBatch *batch = connection->head;
+        connection->head = batch->next;
+        if (connection->head == NULL)
+            connection->tail = NULL;
+        if (connection->fd >= 0)
+            outputWrite(&connection->output, batch->out.data, batch->out.length);
+        connection->inFlight--;
+        serverFreeBatch(batch);
+    }
+
+    if (connection->fd < 0)
+    {
+        if (connection->inFlight == 0)
+            serverRetire(server, connection);
+        return;
+    }
+    serverFlush(server, connection);
+}
+
+// Take the batches finished by the workers and send what is now in order
+static void serverCollect(Server *server)
+{
+    uint64_t count;
+    if (read(server->wakeup, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        return;
+
+    pthread_mutex_lock(&server->lock);
+    ServerBatch *finished = server->finished;
+    server->finished = NULL;
+    pthread_mutex_unlock(&server->lock);
+
+    // Mark every batch first: draining frees batches, and several may belong to one connection
+    ServerConnection *ready = NULL;
+    for (ServerBatch *batch = finished; batch != NULL; batch = batch->finished)
+    {
+        batch->done = 1;
+        if (!batch->connection->ready)
+        {
+            batch->connection->ready = 1;
+            batch->connection->nextReady = ready;
+            ready = batch->connection;
+        }
+    }
+    while (ready != NULL)
+    {
+        ServerConnection *connection = ready;
+        ready = connection->nextReady;
+        connection->ready = 0;
+        serverDrain(server, connection);
+    }
+}
+
+// Read what a client has sent and submit its complete lines
+static void serverRead(Server *server, ServerConnection *connection)
+{
+    if (connection->inputCapacity - connection->inputLength < SERVER_READ_SIZE)
+    {
+        connection->inputCapacity = connection->inputLength + SERVER_READ_SIZE;
+        connection->input = (char *)realloc(connection->input, connection->inputCapacity);
+    }
+    ssize_t received = recv(connection->fd, connection->input + connection->inputLength, SERVER_READ_SIZE, 0);
+    if (received < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return;
+        serverClose(server, connection);
+        return;
+    }
+    if (received == 0)
+        connection->eof = 1;
+    connection->inputLength += (size_t)received;
+
+    serverSubmit(server, connection);
+    if (connection->inputLength > SERVER_MAX_LINE)
+        serverRejectLine(server, connection);
+    serverDrain(server, connection); // Closes the connection at end of input once nothing is in flight
+}
+
+// Accept every pending client
+static void serverAccept(Server *server)
+{
+    while (1)
+    {
+        int fd = accept(server->listener, NULL, NULL);
+        if (fd < 0)
+            return; // EAGAIN once the backlog is empty; other errors are the client's problem
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+        ServerConnection *connection = (ServerConnection *)calloc(1, sizeof(ServerConnection));
+        connection->fd = fd;
+        outputInit(&connection->output, NULL, OUTPUT_BUFFER_SIZE);
+        connection->events = EPOLLIN;
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = connection;
+        if (epoll_ctl(server->epoll, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            close(fd);
+            free(connection->output.data);
+            free(connection);
+            continue;
+        }
+        connection->next = server->connections;
+        if (server->connections != NULL)
+            server->connections->prev = connection;
+        server->connections = connection;
+    }
+}
+
+// Create the listening socket: "tcp:PORT" listens on 127.0.0.1, anything else is a Unix socket path
+// Returns the socket, or -1 after printing why it failed
+static int serverListen(const char *address)
+{
+    int fd;
+    if (strncmp(address, "tcp:", 4) == 0)
+    {
+        char *end;
+        long port = strtol(address + 4, &end, 10);
+        if (address[4] == '\0' || *end != '\0' || port < 0 || port > 65535)
+        {
+            fprintf(stderr, "Invalid TCP port in '%s'\n", address);
+            return -1;
+        }
+        struct sockaddr_in in;
+        memset(&in, 0, sizeof(in));
+        in.sin_family = AF_INET;
+        in.sin_port = htons((uint16_t)port);
+        in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int on = 1;
+        if (fd >= 0)
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (fd < 0 || bind(fd, (struct sockaddr *)&in, sizeof(in)) != 0)
+        {
+            fprintf(stderr, "Cannot listen on '%s': %s\n", address, strerror(errno));
+            if (fd >= 0)
+                close(fd);
+            return -1;
+        }
+    }
+    else
+    {
+        struct sockaddr_un un;
+        memset(&un, 0, sizeof(un));
+        un.sun_family = AF_UNIX;
+        if (strlen(address) >= sizeof(un.sun_path))
+        {
+            fprintf(stderr, "Socket path '%s' is too long\n", address);
+            return -1;
+        }
+        strcpy(un.sun_path, address);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            fprintf(stderr, "Cannot listen on '%s': %s\n", address, strerror(errno));
+            return -1;
+        }
+
+        // Replace a socket left behind by a server that did not exit cleanly, but never a live one
+        struct stat info;
+        if (lstat(address, &info) == 0 && S_ISSOCK(info.st_mode))
+        {
+            int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            int live = probe >= 0 && connect(probe, (struct sockaddr *)&un, sizeof(un)) == 0;
+            if (probe >= 0)
+                close(probe);
+            if (!live)
+                unlink(address);
+        }
+        if (bind(fd, (struct sockaddr *)&un, sizeof(un)) != 0)
+        {
+            fprintf(stderr, "Cannot listen on '%s': %s\n", address, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+
+    if (listen(fd, SOMAXCONN) != 0)
+    {
+        fprintf(stderr, "Cannot listen on '%s': %s\n", address, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Add a descriptor that only needs input events, tagged with the given pointer
+static int serverWatchInput(Server *server, int fd, void *tag)
+{
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = tag;
+    return epoll_ctl(server->epoll, EPOLL_CTL_ADD, fd, &event);
+}
+
+// Serve clients on address with numThreads workers until SIGINT or SIGTERM
+// With a cache, every worker gets its own with an equal share of its budget, and their counters
+// are added to it on shutdown. Returns 0 after a clean shutdown, or 1 if the server could not start
+static inline int runServer(const char *address, int numThreads, OutputFormat format, int precision, ExpressionCache *cache)
+{
+    Server server;
+    memset(&server, 0, sizeof(server));
+    server.format = format;
+    server.precision = precision;
+    server.caching = cache != NULL;
+    server.listener = serverListen(address);
+    if (server.listener < 0)
+        return 1;
+    int unixSocket = strncmp(address, "tcp:", 4) != 0;
+
+    server.epoll = epoll_create1(EPOLL_CLOEXEC);
+    server.wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    pthread_mutex_init(&server.lock, NULL);
+    server.workers = (ServerWorker *)malloc(numThreads * sizeof(ServerWorker));
+    for (int i = 0; i < numThreads; i++)
+    {
+        arenaInit(&server.workers[i].arena, ARENA_DEFAULT_SIZE);
+        cacheInit(&server.workers[i].cache, cache != NULL ? cache->budget / numThreads : 0, NULL);
+    }
+
+    int status = 1;
+    if (server.epoll < 0 || server.wakeup < 0 ||
+        serverWatchInput(&server, server.listener, &server.listener) != 0 ||
+        serverWatchInput(&server, server.wakeup, &server.wakeup) != 0)
+    {
+        fprintf(stderr, "Cannot set up the event loop: %s\n", strerror(errno));
+    }
+    else if (!workPoolInit(&server.pool, numThreads, runServerBatch, &server))
+    {
+        fprintf(stderr, "Cannot start worker threads\n");
+    }
+    else
+    {
+        status = 0;
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = serverSignal; // No SA_RESTART, so epoll_wait returns on a signal
+        sigaction(SIGINT, &action, NULL);
+        sigaction(SIGTERM, &action, NULL);
+        fprintf(stderr, "Listening on %s with %d worker(s)\n", address, numThreads);
+
+        struct epoll_event events[SERVER_MAX_EVENTS];
+        while (!serverStopping)
+        {
+            int count = epoll_wait(server.epoll, events, SERVER_MAX_EVENTS, -1);
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                fprintf(stderr, "epoll_wait failed: %s\n", strerror(errno));
+                status = 1;
+                break;
+            }
+
+            for (int i = 0; i < count; i++)
+            {
+                if (events[i].data.ptr == &server.wakeup)
+                    serverCollect(&server);
+            }
+            for (int i = 0; i < count; i++)
+            {
+                void *tag = events[i].data.ptr;
+                if (tag == &server.wakeup)
+                    continue;
+                if (tag == &server.listener)
+                {
+                    serverAccept(&server);
+                    continue;
+                }
+                ServerConnection *connection = (ServerConnection *)tag;
+                if (connection->fd < 0)
+                    continue; // Closed earlier in this round
+                uint32_t flags = events[i].events;
+                if (flags & (EPOLLERR | EPOLLHUP) && !(flags & EPOLLIN))
+                    serverClose(&server, connection);
+                else if (flags & EPOLLIN)
+                    serverRead(&server, connection);
+                else if (flags & EPOLLOUT)
+                    serverFlush(&server, connection);
+            }
+            while (server.closed != NULL)
+            {
+                ServerConnection *connection = server.closed;
+                server.closed = connection->next;
+                serverFreeConnection(connection);
+            }
+        }
+        workPoolFree(&server.pool); // Lets the workers finish what is queued
+    }
+
+    // Release every connection and whatever it still had in flight
+    while (server.connections != NULL)
+    {
+        ServerConnection *connection = server.connections;
+        server.connections = connection->next;
+        serverFreeConnection(connection);
+    }
+    while (server.closed != NULL)
+    {
+        ServerConnection *connection = server.closed;
+        server.closed = connection->next;
+        serverFreeConnection(connection);
+    }
+    for (int i = 0; i < numThreads; i++)
+    {
+        arenaFree(&server.workers[i].arena);
+        if (cache != NULL)
+            cacheAddCounters(cache, &server.workers[i].cache);
+        cacheFree(&server.workers[i].cache);
+    }
+    free(server.workers);
+    pthread_mutex_destroy(&server.lock);
+    if (server.wakeup >= 0)
+        close(server.wakeup);
+    if (server.epoll >= 0)
+        close(server.epoll);
+    close(server.listener);
+    if (unixSocket)
+        unlink(address);
+    return status;
+}
+
+#else
+
+static inline int runServer(const char *address, int numThreads, OutputFormat format, int precision, ExpressionCache *cache)
+{
+    (void)address;
+    (void)numThreads;
+    (void)format;
+    (void)precision;
+    (void)cache;
+    fprintf(stderr, "Server mode needs epoll and is only available on Linux\n");
+    return 1;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,507 @@
+#ifndef SHEET_H
+#define SHEET_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include "ASTFunctions.h"
+#include "Bytecode.h"
+#include "Gradient.h"
+
+// Named definitions for the interactive mode, such as `rate = 0.05` and `total = price * (1 + rate)`.
+// Each definition is compiled once and keeps its value. The definitions form a dependency graph: an
+// edge runs from every name a definition reads to the definition itself. When a name is assigned,
+// only the definitions downstream of it are visited, in topological order, and one is rerun only if
+// an input actually changed value, so an edit costs the part of the sheet it reaches rather than the
+// whole sheet. Names may be used before they are defined; such definitions are NaN until they are.
+// A gradient walks the other way: one reverse sweep over the definitions upstream of an expression
+// applies the chain rule through each definition's tape (see Gradient.h).
+
+#define SHEET_MIN_CELLS 64   // Initial capacity of the cell array
+#define SHEET_MIN_BUCKETS 64 // Initial size of the name hash table
+
+// One named value of a sheet
+typedef struct SheetCell
+{
+    char name[MAX_VARIABLE_NAME];
+    Program program;           // Compiled definition (empty while the name is only referenced)
+    Tape tape;                 // Gradient layout of the definition
+    int inputs[MAX_VARIABLES]; // Cell read by each variable of the program
+    int numInputs;
+    int *dependents;           // Cells whose definitions read this one
+    int numDependents;
+    int dependentCapacity;
+    double value;              // Cached result of the definition
+    int defined;               // Whether the name has been assigned
+    int missing;               // Undefined cell this value depends on, or -1
+    unsigned visited;          // Walk in which the cell was last reached
+    unsigned changed;          // Walk in which the cell's value last changed
+    int next;                  // Next cell in the same hash bucket, or -1
+} SheetCell;
+
+// Dependency graph of named definitions
+typedef struct Sheet
+{
+    SheetCell *cells;
+    int count;        // Cells in use (defined or referenced)
+    int capacity;     // Allocated cells
+    int *buckets;     // Hash table of names, each the first cell of a chain or -1
+    size_t mask;      // Number of buckets - 1
+    int *order;       // Scratch space for the topological order of a walk
+    int *stack;       // Scratch space for the walk itself: cell, then position in its edges
+    double *adjoints; // Scratch space for the derivative of a gradient's result by each cell
+    unsigned epoch;   // Number of walks so far
+    long recomputed;  // Definitions rerun by the last assignment
+} Sheet;
+
+// Function declarations
+static inline void sheetInit(Sheet *sheet);
+static inline void sheetFree(Sheet *sheet);
+static inline int sheetFind(const Sheet *sheet, const char *name, int length);
+static inline int sheetAssign(Sheet *sheet, const char *name, int nameLength, const char *expression, Arena *arena,
+                              ParseError *error);
+static inline int sheetEvaluate(Sheet *sheet, const char *expression, Arena *arena, double *result, ParseError *error);
+static inline int sheetGradient(Sheet *sheet, const char *expression, const char *const *names, int count, Arena *arena,
+                                double *result, double *gradient, ParseError *error);
+static inline int sheetCompileBound(Sheet *sheet, const char *expression, const char *bound, Arena *arena, Program *program,
+                                    double *values, ParseError *error);
+static inline int sheetParseAssignment(const char *line, const char **name, int *nameLength, const char **expression);
+
+// Set up an empty sheet
+static inline void sheetInit(Sheet *sheet)
+{
+    memset(sheet, 0, sizeof(*sheet));
+    sheet->buckets = (int *)malloc(SHEET_MIN_BUCKETS * sizeof(int));
+    memset(sheet->buckets, 0xff, SHEET_MIN_BUCKETS * sizeof(int));
+    sheet->mask = SHEET_MIN_BUCKETS - 1;
+}
+
+// Release every definition of a sheet
+static inline void sheetFree(Sheet *sheet)
+{
+    for (int i = 0; i < sheet->count; i++)
+    {
+        freeProgram(&sheet->cells[i].program);
+        freeTape(&sheet->cells[i].tape);
+        free(sheet->cells[i].dependents);
+    }
+    free(sheet->cells);
+    free(sheet->buckets);
+    free(sheet->order);
+    free(sheet->stack);
+    free(sheet->adjoints);
+    memset(sheet, 0, sizeof(*sheet));
+}
+
+// FNV-1a hash of a name
+static inline uint64_t hashName(const char *name, int length)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < length; i++)
+        hash = (hash ^ (unsigned char)name[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+// Find a cell by name, returning its index or -1
+static inline int sheetFind(const Sheet *sheet, const char *name, int length)
+{
+    for (int i = sheet->buckets[hashName(name, length) & sheet->mask]; i >= 0; i = sheet->cells[i].next)
+    {
+        if (strncmp(sheet->cells[i].name, name, length) == 0 && sheet->cells[i].name[length] == '\0')
+            return i;
+    }
+    return -1;
+}
+
+// Double the hash table and rechain every cell
+static void growBuckets(Sheet *sheet)
+{
+    size_t size = 2 * (sheet->mask + 1);
+    free(sheet->buckets);
+    sheet->buckets = (int *)malloc(size * sizeof(int));
+    memset(sheet->buckets, 0xff, size * sizeof(int));
+    sheet->mask = size - 1;
+    for (int i = 0; i < sheet->count; i++)
+    {
+        size_t bucket = hashName(sheet->cells[i].name, (int)strlen(sheet->cells[i].name)) & sheet->mask;
+        sheet->cells[i].next = sheet->buckets[bucket];
+        sheet->buckets[bucket] = i;
+    }
+}
+
+// Find a cell by name, adding an undefined one if there is none; returns -1 if the name is too long
+static int findOrAddCell(Sheet *sheet, const char *name, int length)
+{
+    int existing = sheetFind(sheet, name, length);
+    if (existing >= 0)
+        return existing;
+    if (length >= MAX_VARIABLE_NAME)
+        return -1;
+
+    if (sheet->count == sheet->capacity)
+    {
+        sheet->capacity = sheet->capacity ? 2 * sheet->capacity : SHEET_MIN_CELLS;
+        sheet->cells = (SheetCell *)realloc(sheet->cells, sheet->capacity * sizeof(SheetCell));
+        sheet->order = (int *)realloc(sheet->order, sheet->capacity * sizeof(int));
+        sheet->stack = (int *)realloc(sheet->stack, 2 * sheet->capacity * sizeof(int));
+        sheet->adjoints = (double *)realloc(sheet->adjoints, sheet->capacity * sizeof(double));
+    }
+    int index = sheet->count++;
+    SheetCell *cell = &sheet->cells[index];
+    memset(cell, 0, sizeof(*cell));
+    memcpy(cell->name, name, length);
+    cell->name[length] = '\0';
+    initProgram(&cell->program);
+    cell->value = NAN;
+    cell->missing = index;
+
+    if ((size_t)sheet->count > sheet->mask + 1)
+        growBuckets(sheet);
+    else
+    {
+        size_t bucket = hashName(name, length) & sheet->mask;
+        cell->next = sheet->buckets[bucket];
+        sheet->buckets[bucket] = index;
+    }
+    return index;
+}
+
+static void addDependent(SheetCell *cell, int dependent)
+{
+    if (cell->numDependents == cell->dependentCapacity)
+    {
+        cell->dependentCapacity = cell->dependentCapacity ? 2 * cell->dependentCapacity : 4;
+        cell->dependents = (int *)realloc(cell->dependents, cell->dependentCapacity * sizeof(int));
+    }
+    cell->dependents[cell->numDependents++] = dependent;
+}
+
+static void removeDependent(SheetCell *cell, int dependent)
+{
+    for (int i = 0; i < cell->numDependents; i++)
+    {
+        if (cell->dependents[i] == dependent)
+        {
+            cell->dependents[i] = cell->dependents[--cell->numDependents];
+            return;
+        }
+    }
+}
+
+// Mark every cell reachable from roots, through dependents (downstream) or inputs (upstream), and
+// store them in sheet->order so that a cell comes before the cells it reaches: for a downstream walk
+// a definition follows its inputs, for an upstream walk it precedes them. Returns the number stored
+static int walkGraph(Sheet *sheet, const int *roots, int numRoots, int upstream)
+{
+    unsigned epoch = ++sheet->epoch;
+    int *stack = sheet->stack;
+    int numOrdered = 0;
+
+    // Depth-first search without recursion, so long chains of definitions cannot overflow the stack.
+    // Cells are appended when they finish, giving the reverse of the order wanted
+    for (int r = 0; r < numRoots; r++)
+    {
+        if (sheet->cells[roots[r]].visited == epoch)
+            continue;
+        sheet->cells[roots[r]].visited = epoch;
+        stack[0] = roots[r];
+        stack[1] = 0;
+        int depth = 1;
+        while (depth > 0)
+        {
+            int *top = &stack[2 * (depth - 1)];
+            SheetCell *cell = &sheet->cells[top[0]];
+            if (top[1] < (upstream ? cell->numInputs : cell->numDependents))
+            {
+                int next = upstream ? cell->inputs[top[1]++] : cell->dependents[top[1]++];
+                if (sheet->cells[next].visited != epoch)
+                {
+                    sheet->cells[next].visited = epoch;
+                    stack[2 * depth] = next;
+                    stack[2 * depth + 1] = 0;
+                    depth++;
+                }
+            }
+            else
+            {
+                sheet->order[numOrdered++] = top[0];
+                depth--;
+            }
+        }
+    }
+
+    for (int i = 0, j = numOrdered - 1; i < j; i++, j--)
+    {
+        int swap = sheet->order[i];
+        sheet->order[i] = sheet->order[j];
+        sheet->order[j] = swap;
+    }
+    return numOrdered;
+}
+
+// Rerun one definition from the cached values of its inputs; returns whether its value changed
+static int recomputeCell(Sheet *sheet, int index)
+{
+    SheetCell *cell = &sheet->cells[index];
+    double values[MAX_VARIABLES];
+    int missing = -1;
+    for (int i = 0; i < cell->numInputs; i++)
+    {
+        const SheetCell *input = &sheet->cells[cell->inputs[i]];
+        values[i] = input->value;
+        if (missing < 0 && input->missing >= 0)
+            missing = input->missing;
+    }
+
+    double value = missing < 0 ? runProgram(&cell->program, values) : NAN;
+    // Compare bit patterns so that NaN counts as unchanged and -0 as different from 0
+    int changed = memcmp(&value, &cell->value, sizeof(value)) != 0 || missing != cell->missing;
+    cell->value = value;
+    cell->missing = missing;
+    sheet->recomputed++;
+    return changed;
+}
+
+// Define or redefine name as expression and update everything that depends on it
+// Returns 0 and fills in error if the expression does not compile or would make the name depend on itself
+static inline int sheetAssign(Sheet *sheet, const char *name, int nameLength, const char *expression, Arena *arena,
+                              ParseError *error)
+{
+    sheet->recomputed = 0;
+    if (nameLength >= MAX_VARIABLE_NAME)
+    {
+        snprintf(error->message, sizeof(error->message), "Name too long");
+        return 0;
+    }
+    if (lookupFunction(name, nameLength) != FN_UNKNOWN)
+    {
+        snprintf(error->message, sizeof(error->message), "Cannot assign to function '%.*s'", nameLength, name);
+        return 0;
+    }
+
+    Program program;
+    initProgram(&program);
+    VariableTable variables;
+    memset(&variables, 0, sizeof(variables));
+    variables.allowNew = 1;
+    Tape tape;
+    if (!compileExpression(expression, &variables, arena, &program, error) || !compileTape(&program, &tape))
+    {
+        if (error->message[0] == '\0')
+            snprintf(error->message, sizeof(error->message), "Out of memory");
+        freeProgram(&program);
+        return 0;
+    }
+
+    int index = findOrAddCell(sheet, name, nameLength);
+    int inputs[MAX_VARIABLES];
+    for (int i = 0; i < variables.count; i++)
+        inputs[i] = findOrAddCell(sheet, variables.names[i], (int)strlen(variables.names[i]));
+
+    // The graph is still acyclic here, so a walk from the name finds everything that reads it;
+    // reading any of those cells would close a cycle
+    int numOrdered = walkGraph(sheet, &index, 1, 0);
+    for (int i = 0; i < variables.count; i++)
+    {
+        if (sheet->cells[inputs[i]].visited == sheet->epoch)
+        {
+            snprintf(error->message, sizeof(error->message), "'%s' would depend on itself through '%s'", sheet->cells[index].name, variables.names[i]);
+            freeTape(&tape);
+            freeProgram(&program);
+            return 0;
+        }
+    }
+
+    // Replace the definition and its incoming edges
+    SheetCell *cell = &sheet->cells[index];
+    for (int i = 0; i < cell->numInputs; i++)
+        removeDependent(&sheet->cells[cell->inputs[i]], index);
+    freeProgram(&cell->program);
+    freeTape(&cell->tape);
+    cell->program = program;
+    cell->tape = tape;
+    cell->numInputs = variables.count;
+    memcpy(cell->inputs, inputs, variables.count * sizeof(int));
+    cell->defined = 1;
+    for (int i = 0; i < variables.count; i++)
+        addDependent(&sheet->cells[inputs[i]], index);
+
+    // Visit the walk in topological order, rerunning a definition only if one of its inputs changed
+    unsigned epoch = sheet->epoch;
+    if (recomputeCell(sheet, index))
+        cell->changed = epoch;
+    for (int k = 1; k < numOrdered; k++)
+    {
+        SheetCell *dependent = &sheet->cells[sheet->order[k]];
+        int dirty = 0;
+        for (int i = 0; i < dependent->numInputs && !dirty; i++)
+            dirty = sheet->cells[dependent->inputs[i]].changed == epoch;
+        if (dirty && recomputeCell(sheet, sheet->order[k]))
+            dependent->changed = epoch;
+    }
+    return 1;
+}
+
+// Look up the cell and current value of every variable of an expression, from index first on
+// Returns 0 and fills in error if one of them is not defined, or depends on a name that is not
+static int bindVariables(const Sheet *sheet, const VariableTable *variables, int first, int *cells, double *values, ParseError *error)
+{
+    for (int i = first; i < variables->count; i++)
+    {
+        int index = sheetFind(sheet, variables->names[i], (int)strlen(variables->names[i]));
+        int missing = index < 0 ? -1 : sheet->cells[index].missing;
+        if (index < 0 || missing >= 0)
+        {
+            const char *undefined = index < 0 ? variables->names[i] : sheet->cells[missing].name;
+            snprintf(error->message, sizeof(error->message), "Undefined variable '%s'", undefined);
+            return 0;
+        }
+        cells[i] = index;
+        values[i] = sheet->cells[index].value;
+    }
+    return 1;
+}
+
+// Evaluate an expression that may read the names of the sheet, without defining anything
+static inline int sheetEvaluate(Sheet *sheet, const char *expression, Arena *arena, double *result, ParseError *error)
+{
+    Program program;
+    initProgram(&program);
+    VariableTable variables;
+    memset(&variables, 0, sizeof(variables));
+    variables.allowNew = 1;
+    int cells[MAX_VARIABLES];
+    double values[MAX_VARIABLES];
+    int ok = compileExpression(expression, &variables, arena, &program, error) &&
+             bindVariables(sheet, &variables, 0, cells, values, error);
+    if (ok)
+        *result = runProgram(&program, values);
+    freeProgram(&program);
+    return ok;
+}
+
+// Evaluate an expression and its derivatives with respect to the named cells: gradient[i] is the
+// partial derivative by names[i], following every definition between the two (so if b = 2a, the
+// derivative of b + a by a is 3). One reverse sweep over the definitions upstream of the
+// expression gives all of them, each definition differentiated once through its tape
+static inline int sheetGradient(Sheet *sheet, const char *expression, const char *const *names, int count, Arena *arena,
+                                double *result, double *gradient, ParseError *error)
+{
+    Program program;
+    initProgram(&program);
+    Tape tape;
+    memset(&tape, 0, sizeof(tape));
+    VariableTable variables;
+    memset(&variables, 0, sizeof(variables));
+    variables.allowNew = 1;
+    int cells[MAX_VARIABLES];
+    double values[MAX_VARIABLES];
+    double partials[MAX_VARIABLES];
+    int ok = compileExpression(expression, &variables, arena, &program, error) &&
+             bindVariables(sheet, &variables, 0, cells, values, error);
+    for (int i = 0; ok && i < count; i++)
+    {
+        if (sheetFind(sheet, names[i], (int)strlen(names[i])) < 0)
+        {
+            snprintf(error->message, sizeof(error->message), "Undefined variable '%.40s'", names[i]);
+            ok = 0;
+        }
+    }
+    if (ok && !compileTape(&program, &tape))
+    {
+        snprintf(error->message, sizeof(error->message), "Out of memory");
+        ok = 0;
+    }
+    if (!ok)
+    {
+        freeProgram(&program);
+        return 0;
+    }
+    memset(partials, 0, sizeof(partials)); // Only the variables the program still reads are written
+    *result = runGradient(&tape, values, partials);
+    freeTape(&tape);
+    freeProgram(&program);
+
+    // Walk upstream from the cells the expression reads; each definition comes before its inputs,
+    // so its adjoint is complete by the time it passes it on
+    int numOrdered = walkGraph(sheet, cells, variables.count, 1);
+    for (int k = 0; k < numOrdered; k++)
+        sheet->adjoints[sheet->order[k]] = 0.0;
+    for (int i = 0; i < variables.count; i++)
+        sheet->adjoints[cells[i]] += partials[i];
+    for (int k = 0; k < numOrdered; k++)
+    {
+        int index = sheet->order[k];
+        const SheetCell *cell = &sheet->cells[index];
+        double adjoint = sheet->adjoints[index];
+        if (cell->numInputs == 0 || adjoint == 0.0)
+            continue;
+        for (int i = 0; i < cell->numInputs; i++)
+            values[i] = sheet->cells[cell->inputs[i]].value;
+        memset(partials, 0, sizeof(partials));
+        runGradient(&cell->tape, values, partials);
+        for (int i = 0; i < cell->numInputs; i++)
+            sheet->adjoints[cell->inputs[i]] += adjoint * partials[i];
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        int index = sheetFind(sheet, names[i], (int)strlen(names[i]));
+        gradient[i] = sheet->cells[index].visited == sheet->epoch ? sheet->adjoints[index] : 0.0;
+    }
+    return 1;
+}
+
+// Compile an expression for integration or root finding over the variable named bound, which is
+// variable 0 whether or not the sheet defines it; every other name takes its current value from the
+// sheet, stored in values (values[0] is left to the caller)
+static inline int sheetCompileBound(Sheet *sheet, const char *expression, const char *bound, Arena *arena, Program *program,
+                                    double *values, ParseError *error)
+{
+    VariableTable variables;
+    memset(&variables, 0, sizeof(variables));
+    variables.allowNew = 1;
+    int cells[MAX_VARIABLES];
+    int length = (int)strlen(bound);
+    int valid = isalpha((unsigned char)bound[0]) || bound[0] == '_';
+    for (int i = 1; valid && i < length; i++)
+        valid = isalnum((unsigned char)bound[i]) || bound[i] == '_';
+    if (!valid || lookupFunction(bound, length) != FN_UNKNOWN || addVariable(&variables, bound, length) < 0)
+    {
+        snprintf(error->message, sizeof(error->message), "Invalid variable name '%.40s'", bound);
+        return 0;
+    }
+    if (!compileExpression(expression, &variables, arena, program, error) ||
+        !bindVariables(sheet, &variables, 1, cells, values, error))
+    {
+        freeProgram(program);
+        return 0;
+    }
+    return 1;
+}
+
+// Recognise `name = expression`; returns 1 and sets the name, its length and the start of the
+// expression if line is an assignment, 0 otherwise
+static inline int sheetParseAssignment(const char *line, const char **name, int *nameLength, const char **expression)
+{
+    while (*line == ' ' || *line == '\t')
+        line++;
+    if (!isalpha((unsigned char)*line) && *line != '_')
+        return 0;
+    int length = 1;
+    while (isalnum((unsigned char)line[length]) || line[length] == '_')
+        length++;
+    const char *rest = line + length;
+    while (*rest == ' ' || *rest == '\t')
+        rest++;
+    if (*rest != '=')
+        return 0;
+    *name = line;
+    *nameLength = length;
+    *expression = rest + 1;
+    return 1;
+}
+
+#endif
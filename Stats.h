@@ -0,0 +1,249 @@
+#ifndef STATS_H
+#define STATS_H
+
+// Hot-path instrumentation: per-phase latency histograms and counters of tokens, nodes,
+// allocations and kernel calls, printed by --stats. Only compiled in with -DCALC_STATS;
+// otherwise every STATS_* macro expands to nothing, so the hot paths are unchanged.
+
+// Phases of evaluating one expression
+typedef enum StatsPhase
+{
+    PHASE_TOKENISE,
+    PHASE_PARSE,
+    PHASE_EVALUATE,
+    PHASE_OUTPUT,
+    PHASE_COUNT
+} StatsPhase;
+
+#ifdef CALC_STATS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "FunctionRegistry.h"
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define STATS_BUCKETS 40   // Latency histogram buckets: bucket b holds durations in [2^(b-1), 2^b) ns
+#define STATS_HW_COUNTERS 3 // Cycles, instructions, cache misses
+
+// Counters of one thread (threads never share one, so updates need no atomics)
+typedef struct Stats
+{
+    unsigned long long tokens;                 // Tokens produced by tokenise()
+    unsigned long long nodes;                  // AST nodes created
+    unsigned long long allocations;            // arenaAlloc() calls
+    unsigned long long heapAllocations;        // Arena blocks requested from malloc
+    unsigned long long calls[FN_COUNT];        // Kernel calls (array kernels count one per element)
+    unsigned long long phaseCount[PHASE_COUNT];
+    unsigned long long phaseNanoseconds[PHASE_COUNT];
+    unsigned long long histogram[PHASE_COUNT][STATS_BUCKETS];
+    struct Stats *next;                        // Next registered thread
+} Stats;
+
+// Every thread's counters, summed by statsPrint
+typedef struct StatsRegistry
+{
+    pthread_mutex_t lock;
+    Stats *threads;                             // Registered per-thread counters
+    int hwCounters[STATS_HW_COUNTERS];          // perf_event file descriptors, -1 if unavailable
+} StatsRegistry;
+
+static StatsRegistry statsRegistry = {PTHREAD_MUTEX_INITIALIZER, NULL, {-1, -1, -1}};
+static __thread Stats *threadStats;
+
+// Function declarations
+static inline Stats *statsThread(void);
+static inline void statsInit(void);
+static inline void statsRecord(StatsPhase phase, unsigned long long nanoseconds);
+static inline void statsPrint(FILE *stream, int json);
+
+// Counters of the calling thread, registered on first use (they live until the process exits,
+// so the counts of finished worker threads are kept)
+static inline Stats *statsThread(void)
+{
+    if (threadStats == NULL)
+    {
+        threadStats = (Stats *)calloc(1, sizeof(Stats));
+        pthread_mutex_lock(&statsRegistry.lock);
+        threadStats->next = statsRegistry.threads;
+        statsRegistry.threads = threadStats;
+        pthread_mutex_unlock(&statsRegistry.lock);
+    }
+    return threadStats;
+}
+
+// Monotonic time in nanoseconds
+static inline unsigned long long statsNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ull + (unsigned long long)now.tv_nsec;
+}
+
+#ifdef __linux__
+// Open one hardware counter for this process and the threads it creates later
+static int statsOpenCounter(unsigned long long config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+// Start the hardware counters when the kernel allows it (they are simply reported as unavailable otherwise)
+static inline void statsInit(void)
+{
+    statsThread();
+#ifdef __linux__
+    static const unsigned long long configs[STATS_HW_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+    for (int i = 0; i < STATS_HW_COUNTERS; i++)
+        statsRegistry.hwCounters[i] = statsOpenCounter(configs[i]);
+#endif
+}
+
+// Add one duration to a phase
+static inline void statsRecord(StatsPhase phase, unsigned long long nanoseconds)
+{
+    Stats *stats = statsThread();
+    int bucket = nanoseconds == 0 ? 0 : 64 - __builtin_clzll(nanoseconds);
+    if (bucket >= STATS_BUCKETS)
+        bucket = STATS_BUCKETS - 1;
+    stats->phaseCount[phase]++;
+    stats->phaseNanoseconds[phase] += nanoseconds;
+    stats->histogram[phase][bucket]++;
+}
+
+// Upper bound of the histogram bucket that holds the given quantile (0-1) of a phase
+static unsigned long long statsQuantile(const unsigned long long *histogram, unsigned long long count, double quantile)
+{
+    unsigned long long target = (unsigned long long)(quantile * count);
+    unsigned long long seen = 0;
+    for (int b = 0; b < STATS_BUCKETS; b++)
+    {
+        seen += histogram[b];
+        if (seen > target)
+            return 1ull << b;
+    }
+    return 1ull << (STATS_BUCKETS - 1);
+}
+
+// Print the counters of all threads, as text or as one JSON object
+static inline void statsPrint(FILE *stream, int json)
+{
+    static const char *const phaseNames[PHASE_COUNT] = {"tokenise", "parse", "evaluate", "output"};
+    static const char *const hwNames[STATS_HW_COUNTERS] = {"cycles", "instructions", "cache_misses"};
+    Stats total;
+    memset(&total, 0, sizeof(total));
+    pthread_mutex_lock(&statsRegistry.lock);
+    for (const Stats *s = statsRegistry.threads; s != NULL; s = s->next)
+    {
+        total.tokens += s->tokens;
+        total.nodes += s->nodes;
+        total.allocations += s->allocations;
+        total.heapAllocations += s->heapAllocations;
+        for (int f = 0; f < FN_COUNT; f++)
+            total.calls[f] += s->calls[f];
+        for (int p = 0; p < PHASE_COUNT; p++)
+        {
+            total.phaseCount[p] += s->phaseCount[p];
+            total.phaseNanoseconds[p] += s->phaseNanoseconds[p];
+            for (int b = 0; b < STATS_BUCKETS; b++)
+                total.histogram[p][b] += s->histogram[p][b];
+        }
+    }
+    pthread_mutex_unlock(&statsRegistry.lock);
+
+    long long hw[STATS_HW_COUNTERS];
+    for (int i = 0; i < STATS_HW_COUNTERS; i++)
+    {
+        hw[i] = -1;
+#ifdef __linux__
+        if (statsRegistry.hwCounters[i] >= 0 && read(statsRegistry.hwCounters[i], &hw[i], sizeof(hw[i])) != sizeof(hw[i]))
+            hw[i] = -1;
+#endif
+    }
+
+    fprintf(stream, json ? "{\"counters\": {\"tokens\": %llu, \"nodes\": %llu, \"allocations\": %llu, \"heap_allocations\": %llu},\n"
+                         : "Counters: %llu tokens, %llu nodes, %llu arena allocations, %llu heap allocations\n",
+            total.tokens, total.nodes, total.allocations, total.heapAllocations);
+
+    fprintf(stream, json ? " \"phases\": {" : "Phases (latency percentiles are histogram bucket upper bounds):\n");
+    for (int p = 0; p < PHASE_COUNT; p++)
+    {
+        unsigned long long count = total.phaseCount[p];
+        double mean = count ? (double)total.phaseNanoseconds[p] / count : 0.0;
+        unsigned long long p50 = statsQuantile(total.histogram[p], count, 0.5);
+        unsigned long long p99 = statsQuantile(total.histogram[p], count, 0.99);
+        if (json)
+        {
+            fprintf(stream, "%s\n  \"%s\": {\"count\": %llu, \"total_ns\": %llu, \"mean_ns\": %.1f, \"p50_ns\": %llu, \"p99_ns\": %llu, \"histogram\": [",
+                    p ? "," : "", phaseNames[p], count, total.phaseNanoseconds[p], mean, count ? p50 : 0, count ? p99 : 0);
+            for (int b = 0; b < STATS_BUCKETS; b++)
+                fprintf(stream, "%s%llu", b ? ", " : "", total.histogram[p][b]);
+            fprintf(stream, "]}");
+        }
+        else if (count > 0)
+        {
+            fprintf(stream, "  %-9s %10llu calls %12.3f ms total %10.1f ns mean   p50 < %llu ns   p99 < %llu ns\n",
+                    phaseNames[p], count, total.phaseNanoseconds[p] / 1e6, mean, p50, p99);
+        }
+    }
+
+    fprintf(stream, json ? "},\n \"kernel_calls\": {" : "Kernel calls:\n");
+    int first = 1;
+    for (int f = 0; f < FN_COUNT; f++)
+    {
+        if (json)
+            fprintf(stream, "%s\"%s\": %llu", f ? ", " : "", functionRegistry[f].name, total.calls[f]);
+        else if (total.calls[f] > 0)
+        {
+            fprintf(stream, "  %-9s %llu\n", functionRegistry[f].name, total.calls[f]);
+            first = 0;
+        }
+    }
+    if (!json && first)
+        fprintf(stream, "  none\n");
+
+    fprintf(stream, json ? "},\n \"hardware\": {" : "Hardware counters:");
+    for (int i = 0; i < STATS_HW_COUNTERS; i++)
+    {
+        if (json)
+            fprintf(stream, hw[i] >= 0 ? "%s\"%s\": %lld" : "%s\"%s\": null", i ? ", " : "", hwNames[i], hw[i]);
+        else if (hw[i] >= 0)
+            fprintf(stream, " %lld %s", hw[i], hwNames[i]);
+    }
+    if (json)
+        fprintf(stream, "}}\n");
+    else
+        fprintf(stream, hw[0] >= 0 ? "\n" : " unavailable (perf_event_open not permitted)\n");
+}
+
+#define STATS_ADD(field, n) (statsThread()->field += (n))
+#define STATS_CALLS(function, n) (statsThread()->calls[function] += (n))
+#define STATS_TIMER_START(name) unsigned long long name = statsNow()
+#define STATS_TIMER_STOP(name, phase) statsRecord(phase, statsNow() - (name))
+
+#else
+
+#define STATS_ADD(field, n) ((void)0)
+#define STATS_CALLS(function, n) ((void)0)
+#define STATS_TIMER_START(name) ((void)0)
+#define STATS_TIMER_STOP(name, phase) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Function run by a worker for each submitted item; worker is the index of the calling thread
+typedef void (*WorkFunction)(void *item, int worker, void *context);
+
+// Double-ended queue of one worker: the owner takes items from the front, idle workers steal from the back
+typedef struct WorkQueue
+{
+    pthread_mutex_t lock;
+    void **items; // Ring buffer
+    int head;     // Index of the front item
+    int count;    // Number of queued items
+    int capacity; // Size of items
+} WorkQueue;
+
+// Fixed set of threads with one queue each; a worker whose queue runs dry steals from the others
+typedef struct WorkPool
+{
+    int numWorkers;
+    pthread_t *threads;
+    WorkQueue *queues;
+    WorkFunction run;
+    void *context;         // Passed to every run call
+    atomic_int queued;     // Items waiting in any queue
+    int stop;              // Set (under lock) when the workers should exit
+    int nextQueue;         // Queue that receives the next submitted item
+    pthread_mutex_t lock;  // Protects stop and the sleep/wake-up handshake
+    pthread_cond_t wake;   // Signalled when items are submitted or the pool stops
+} WorkPool;
+
+// Argument of a worker thread
+typedef struct WorkerStart
+{
+    WorkPool *pool;
+    int worker;
+} WorkerStart;
+
+// Function declarations
+static inline int workPoolInit(WorkPool *pool, int numWorkers, WorkFunction run, void *context);
+static inline void workPoolSubmit(WorkPool *pool, void **items, int count);
+static inline void workPoolFree(WorkPool *pool);
+
+// Append an item to the back of a queue
+static void workQueuePush(WorkQueue *queue, void *item)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count == queue->capacity)
+    {
+        int capacity = queue->capacity ? queue->capacity * 2 : 64;
+        void **items = (void **)malloc(capacity * sizeof(void *));
+        for (int i = 0; i < queue->count; i++)
+            items[i] = queue->items[(queue->head + i) % queue->capacity];
+        free(queue->items);
+        queue->items = items;
+        queue->head = 0;
+        queue->capacity = capacity;
+    }
+    queue->items[(queue->head + queue->count) % queue->capacity] = item;
+    queue->count++;
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// Take an item from the front (owner) or the back (thief) of a queue, or NULL if it is empty
+static void *workQueueTake(WorkQueue *queue, int steal)
+{
+    void *item = NULL;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count > 0)
+    {
+        if (steal)
+        {
+            item = queue->items[(queue->head + queue->count - 1) % queue->capacity];
+        }
+        else
+        {
+            item = queue->items[queue->head];
+            queue->head = (queue->head + 1) % queue->capacity;
+        }
+        queue->count--;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return item;
+}
+
+// Find work for a worker: its own queue first, then the other queues in turn
+static void *workPoolFind(WorkPool *pool, int worker)
+{
+    void *item = workQueueTake(&pool->queues[worker], 0);
+    for (int i = 1; item == NULL && i < pool->numWorkers; i++)
+        item = workQueueTake(&pool->queues[(worker + i) % pool->numWorkers], 1);
+    if (item != NULL)
+        atomic_fetch_sub(&pool->queued, 1);
+    return item;
+}
+
+// Worker thread: run items until the pool stops, sleeping while every queue is empty
+static void *workPoolThread(void *argument)
+{
+    WorkerStart *start = (WorkerStart *)argument;
+    WorkPool *pool = start->pool;
+    int worker = start->worker;
+    free(start);
+
+    while (1)
+    {
+        void *item = workPoolFind(pool, worker);
+        if (item != NULL)
+        {
+            pool->run(item, worker, pool->context);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (atomic_load(&pool->queued) == 0 && !pool->stop)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        int stop = pool->stop && atomic_load(&pool->queued) == 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (stop)
+            return NULL;
+    }
+}
+
+// Stop the first numThreads workers once every queued item is done, join them, and release the
+// queues of all the workers
+static void workPoolRelease(WorkPool *pool, int numThreads)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < numThreads; i++)
+        pthread_join(pool->threads[i], NULL);
+    for (int i = 0; i < pool->numWorkers; i++)
+    {
+        pthread_mutex_destroy(&pool->queues[i].lock);
+        free(pool->queues[i].items);
+    }
+    free(pool->queues);
+    free(pool->threads);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pool->queues = NULL;
+    pool->threads = NULL;
+    pool->numWorkers = 0;
+}
+
+// Start numWorkers threads that call run(item, worker, context) for every submitted item
+// Returns 1 on success, or 0 if the threads could not be created
+static inline int workPoolInit(WorkPool *pool, int numWorkers, WorkFunction run, void *context)
+{
+    pool->numWorkers = numWorkers;
+    pool->run = run;
+    pool->context = context;
+    pool->stop = 0;
+    pool->nextQueue = 0;
+    atomic_init(&pool->queued, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pool->queues = (WorkQueue *)calloc(numWorkers, sizeof(WorkQueue));
+    pool->threads = (pthread_t *)malloc(numWorkers * sizeof(pthread_t));
+    for (int i = 0; i < numWorkers; i++)
+        pthread_mutex_init(&pool->queues[i].lock, NULL);
+
+    for (int i = 0; i < numWorkers; i++)
+    {
+        WorkerStart *start = (WorkerStart *)malloc(sizeof(WorkerStart));
+        start->pool = pool;
+        start->worker = i;
+        if (pthread_create(&pool->threads[i], NULL, workPoolThread, start) != 0)
+        {
+            free(start);
+            workPoolRelease(pool, i); // Stop the threads that did start
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Queue items round-robin over the workers and wake them up
+static inline void workPoolSubmit(WorkPool *pool, void **items, int count)
+{
+    // Counted before they are visible, so a worker that takes one can never drive the count below zero
+    atomic_fetch_add(&pool->queued, count);
+    for (int i = 0; i < count; i++)
+    {
+        workQueuePush(&pool->queues[pool->nextQueue], items[i]);
+        pool->nextQueue = (pool->nextQueue + 1) % pool->numWorkers;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Let the workers finish every queued item, then join them and release the pool
+static inline void workPoolFree(WorkPool *pool)
+{
+    workPoolRelease(pool, pool->numWorkers);
+}
+
+#endif
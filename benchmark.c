@@ -0,0 +1,470 @@
+#include "ASTFunctions.h"
+#include "Bytecode.h"
+#include "Jit.h"
+#include "CorpusGenerator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#define KERNEL_INPUTS 4096 // Arguments per kernel measurement, small enough to stay in L1
+#define MAX_RUNS 100
+#define HOT_REPEATS 16     // Consecutive evaluations of each program in the unfolded measurements
+
+// Timings of one measured operation over several runs
+typedef struct Measurement
+{
+    double nanoseconds[MAX_RUNS]; // Time per operation in each run
+    double cycles[MAX_RUNS];      // Time stamp counter ticks per operation in each run (0 if unavailable)
+    int runs;
+} Measurement;
+
+// Arguments a registry function is measured on
+typedef struct KernelInputs
+{
+    double low, high; // Range the arguments are drawn from
+} KernelInputs;
+
+// Indexed by FunctionId
+static const KernelInputs kernelInputs[FN_COUNT] = {
+    {-10, 10},     // sin
+    {-10, 10},     // cos
+    {-1.5, 1.5},   // tan
+    {1e-3, 1e3},   // ln
+    {-50, 50},     // exp
+    {-20, 20},     // sinh
+    {-20, 20},     // cosh
+    {-5, 5},       // tanh
+    {-1, 1},       // asin
+    {-1, 1},       // acos
+    {-100, 100},   // atan
+    {-100, 100},   // asinh
+    {1, 100},      // acosh
+    {-0.99, 0.99}, // atanh
+    {0.1, 10},     // pow
+    {0.1, 10},     // log_base
+};
+
+static volatile double sink; // Keeps measured results alive
+
+static double nowNanoseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static unsigned long long readCycles(void)
+{
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static int compareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Print the median and the spread (min-max) of a measurement
+static void printMeasurement(const char *name, const Measurement *m, const char *unit)
+{
+    double ns[MAX_RUNS], cycles[MAX_RUNS];
+    memcpy(ns, m->nanoseconds, m->runs * sizeof(double));
+    memcpy(cycles, m->cycles, m->runs * sizeof(double));
+    qsort(ns, m->runs, sizeof(double), compareDoubles);
+    qsort(cycles, m->runs, sizeof(double), compareDoubles);
+    double median = ns[m->runs / 2];
+    double spread = median > 0 ? 100.0 * (ns[m->runs - 1] - ns[0]) / median : 0;
+    printf("  %-28s %10.2f ns/%s  (min %.2f, max %.2f, spread %5.1f%%)", name, median, unit, ns[0], ns[m->runs - 1], spread);
+#ifdef HAVE_TSC
+    printf("  %8.1f cycles", cycles[m->runs / 2]);
+#endif
+    printf("\n");
+}
+
+// Record one run of count operations
+static void recordRun(Measurement *m, double start, unsigned long long startCycles, long count)
+{
+    if (count < 1)
+        count = 1;
+    m->nanoseconds[m->runs] = (nowNanoseconds() - start) / count;
+    m->cycles[m->runs] = (double)(readCycles() - startCycles) / count;
+    m->runs++;
+}
+
+// Measure tokenise(), parseExpression(), evaluate(), runProgram() and native code separately over a corpus
+static void benchmarkPipeline(char **corpus, int numExpressions, int runs)
+{
+    Arena arena, tokenArena, treeArena;
+    arenaInit(&arena, ARENA_DEFAULT_SIZE);
+    arenaInit(&tokenArena, ARENA_DEFAULT_SIZE);
+    arenaInit(&treeArena, ARENA_DEFAULT_SIZE);
+
+    // Tokens and trees of the whole corpus are kept so each phase can be timed on its own
+    Token **tokens = (Token **)malloc(numExpressions * sizeof(Token *));
+    int *numTokens = (int *)malloc(numExpressions * sizeof(int));
+    ASTNode **trees = (ASTNode **)malloc(numExpressions * sizeof(ASTNode *));
+    Program *programs = (Program *)malloc(numExpressions * sizeof(Program));
+    Program *unfolded = (Program *)malloc(numExpressions * sizeof(Program)); // Compiled without optimizeTree
+    JitCode *jits = (JitCode *)malloc(numExpressions * sizeof(JitCode));
+    char **expressions = (char **)malloc(numExpressions * sizeof(char *)); // The valid part of the corpus
+    long totalTokens = 0, totalBytes = 0;
+    int valid = 0, numJitted = 0;
+    for (int i = 0; i < numExpressions; i++)
+    {
+        ParseError error = {0};
+        int length = (int)strlen(corpus[i]);
+        Token *t = tokenise(corpus[i], length, &numTokens[valid], &tokenArena, &error);
+        if (t == NULL)
+            continue;
+        Parser parser = {corpus[i], t, 0, numTokens[valid], &treeArena, NULL, {0}, 0, 0};
+        ASTNode *ast = parseExpression(&parser);
+        if (parserFailed(&parser) || parser.pos < parser.numTokens)
+            continue;
+        initProgram(&programs[valid]);
+        if (!compileExpression(corpus[i], NULL, &arena, &programs[valid], &error))
+            continue;
+        initProgram(&unfolded[valid]);
+        if (!compileProgram(ast, &unfolded[valid], &error))
+        {
+            freeProgram(&programs[valid]);
+            continue;
+        }
+        numJitted += jitCompile(&unfolded[valid], &jits[valid]);
+        expressions[valid] = corpus[i];
+        tokens[valid] = t;
+        trees[valid] = ast;
+        totalTokens += numTokens[valid];
+        totalBytes += length;
+        valid++;
+    }
+    printf("Pipeline: %d valid expressions, %.1f tokens and %.1f bytes per expression, %d compiled to native code\n",
+           valid, valid ? (double)totalTokens / valid : 0.0, valid ? (double)totalBytes / valid : 0.0, numJitted);
+    corpus = expressions;
+
+    Measurement tokeniseTime = {{0}, {0}, 0}, parseTime = {{0}, {0}, 0};
+    Measurement evaluateTime = {{0}, {0}, 0}, programTime = {{0}, {0}, 0}, totalTime = {{0}, {0}, 0};
+    Measurement unfoldedTime = {{0}, {0}, 0}, jitTime = {{0}, {0}, 0};
+    for (int run = 0; run < runs; run++)
+    {
+        ParseError error = {0};
+        int count;
+        double start = nowNanoseconds();
+        unsigned long long startCycles = readCycles();
+        for (int i = 0; i < valid; i++)
+        {
+            sink = (double)(size_t)tokenise(corpus[i], (int)strlen(corpus[i]), &count, &arena, &error);
+            arenaReset(&arena);
+        }
+        recordRun(&tokeniseTime, start, startCycles, valid);
+
+        start = nowNanoseconds();
+        startCycles = readCycles();
+        for (int i = 0; i < valid; i++)
+        {
+            Parser parser = {corpus[i], tokens[i], 0, numTokens[i], &arena, NULL, {0}, 0, 0};
+            sink = (double)(size_t)parseExpression(&parser);
+            arenaReset(&arena);
+        }
+        recordRun(&parseTime, start, startCycles, valid);
+
+        start = nowNanoseconds();
+        startCycles = readCycles();
+        for (int i = 0; i < valid; i++)
+            sink = evaluate(trees[i], NULL);
+        recordRun(&evaluateTime, start, startCycles, valid);
+
+        start = nowNanoseconds();
+        startCycles = readCycles();
+        for (int i = 0; i < valid; i++)
+            sink = runProgram(&programs[i], NULL);
+        recordRun(&programTime, start, startCycles, valid);
+
+        // Unfolded programs still do all the arithmetic, like a formula run over many inputs
+        start = nowNanoseconds();
+        startCycles = readCycles();
+        for (int i = 0; i < valid; i++)
+            for (int r = 0; r < HOT_REPEATS; r++)
+                sink = runProgram(&unfolded[i], NULL);
+        recordRun(&unfoldedTime, start, startCycles, valid * HOT_REPEATS);
+
+        start = nowNanoseconds();
+        startCycles = readCycles();
+        for (int i = 0; i < valid; i++)
+            for (int r = 0; r < HOT_REPEATS; r++)
+                sink = jitRun(&jits[i], &unfolded[i], NULL);
+        recordRun(&jitTime, start, startCycles, valid * HOT_REPEATS);
+
+        start = nowNanoseconds();
+        startCycles = readCycles();
+        for (int i = 0; i < valid; i++)
+        {
+            double result = 0.0;
+            evaluateExpression(corpus[i], &arena, &result, &error);
+            sink = result;
+        }
+        recordRun(&totalTime, start, startCycles, valid);
+    }
+
+    printMeasurement("tokenise", &tokeniseTime, "expr");
+    printMeasurement("parseExpression", &parseTime, "expr");
+    printMeasurement("evaluate (tree)", &evaluateTime, "expr");
+    printMeasurement("runProgram (folded)", &programTime, "expr");
+    printMeasurement("runProgram (unfolded)", &unfoldedTime, "expr");
+    printMeasurement("jitRun (unfolded)", &jitTime, "expr");
+    printMeasurement("evaluateExpression", &totalTime, "expr");
+
+    for (int i = 0; i < valid; i++)
+    {
+        jitFree(&jits[i]);
+        freeProgram(&unfolded[i]);
+        freeProgram(&programs[i]);
+    }
+    free(jits);
+    free(unfolded);
+    free(programs);
+    free(expressions);
+    free(trees);
+    free(numTokens);
+    free(tokens);
+    arenaFree(&treeArena);
+    arenaFree(&tokenArena);
+    arenaFree(&arena);
+}
+
+// Median time per operation of a measurement
+static double medianNanoseconds(const Measurement *m)
+{
+    double ns[MAX_RUNS];
+    memcpy(ns, m->nanoseconds, m->runs * sizeof(double));
+    qsort(ns, m->runs, sizeof(double), compareDoubles);
+    return ns[m->runs / 2];
+}
+
+// Measure every kernel of every precision tier, one call at a time and as an array kernel
+static void benchmarkKernels(int runs, unsigned functions)
+{
+    static double a[KERNEL_INPUTS], b[KERNEL_INPUTS], out[KERNEL_INPUTS];
+    CorpusGenerator random;
+    CorpusOptions options;
+    corpusDefaults(&options);
+    corpusInit(&random, &options);
+    const int repeats = 64; // Passes over the inputs per run
+
+    printf("Kernels: %d arguments, %d passes per run\n", KERNEL_INPUTS, repeats);
+    for (int f = 0; f < FN_COUNT; f++)
+    {
+        if (!(functions & (1u << f)))
+            continue;
+        const FunctionInfo *info = &functionRegistry[f];
+        const KernelInputs *inputs = &kernelInputs[f];
+        for (int i = 0; i < KERNEL_INPUTS; i++)
+        {
+            a[i] = inputs->low + (inputs->high - inputs->low) * corpusRandom(&random, 1u << 30) / (double)(1u << 30);
+            b[i] = inputs->low + (inputs->high - inputs->low) * corpusRandom(&random, 1u << 30) / (double)(1u << 30);
+        }
+
+        Measurement scalar[PRECISION_TIER_COUNT], array[PRECISION_TIER_COUNT];
+        memset(scalar, 0, sizeof(scalar));
+        memset(array, 0, sizeof(array));
+        for (int run = 0; run < runs; run++)
+        {
+            for (int tier = 0; tier < PRECISION_TIER_COUNT; tier++)
+            {
+                const FunctionKernels *kernels = &kernelTables[tier].functions[f];
+                double sum = 0;
+                double start = nowNanoseconds();
+                unsigned long long startCycles = readCycles();
+                for (int r = 0; r < repeats; r++)
+                {
+                    for (int i = 0; i < KERNEL_INPUTS; i++)
+                        sum += info->arity == 1 ? kernels->unary(a[i]) : kernels->binary(a[i], b[i]);
+                }
+                recordRun(&scalar[tier], start, startCycles, (long)repeats * KERNEL_INPUTS);
+
+                start = nowNanoseconds();
+                startCycles = readCycles();
+                for (int r = 0; r < repeats; r++)
+                {
+                    if (info->arity == 1)
+                        kernels->vectorUnary(a, out, KERNEL_INPUTS);
+                    else
+                        kernels->vectorBinary(a, b, out, KERNEL_INPUTS);
+                    sum += out[r];
+                }
+                recordRun(&array[tier], start, startCycles, (long)repeats * KERNEL_INPUTS);
+                sink = sum;
+            }
+        }
+
+        char name[40];
+        for (int tier = 0; tier < PRECISION_TIER_COUNT; tier++)
+        {
+            snprintf(name, sizeof(name), "%s %s", precisionTierNames[tier], info->name);
+            printMeasurement(name, &scalar[tier], "call");
+            snprintf(name, sizeof(name), "%s %s (array)", precisionTierNames[tier], info->name);
+            printMeasurement(name, &array[tier], "call");
+        }
+        printf("  fast vs standard %s: %.2fx per call, %.2fx as an array\n", info->name,
+               medianNanoseconds(&scalar[PRECISION_STANDARD]) / medianNanoseconds(&scalar[PRECISION_FAST]),
+               medianNanoseconds(&array[PRECISION_STANDARD]) / medianNanoseconds(&array[PRECISION_FAST]));
+    }
+}
+
+static void printBenchmarkUsage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [options]\n", program);
+    fprintf(stderr, "  --count N          Expressions in the generated corpus (default 20000)\n");
+    fprintf(stderr, "  --depth N          Maximum nesting depth (default 6)\n");
+    fprintf(stderr, "  --length N         Maximum expression length in characters (default 200)\n");
+    fprintf(stderr, "  --function-mix P   Percentage of inner nodes that are function calls (default 40)\n");
+    fprintf(stderr, "  --functions LIST   Comma-separated functions to use, or 'all' (default)\n");
+    fprintf(stderr, "  --seed N           Corpus seed (default 1)\n");
+    fprintf(stderr, "  --runs N           Repetitions of every measurement (default 5)\n");
+    fprintf(stderr, "  --precision TIER   Kernels of the pipeline measurements: fast, standard (default) or accurate\n");
+    fprintf(stderr, "  --input FILE       Benchmark the expressions in FILE instead of a generated corpus\n");
+    fprintf(stderr, "  --generate         Print the generated corpus and exit\n");
+    fprintf(stderr, "  --pipeline-only, --kernels-only\n");
+}
+
+// Read one expression per line from a file
+static char **readCorpus(const char *path, int *count)
+{
+    FILE *input = fopen(path, "rb");
+    if (input == NULL)
+        return NULL;
+    int capacity = 1024;
+    char **corpus = (char **)malloc(capacity * sizeof(char *));
+    char line[CORPUS_MAX_EXPRESSION];
+    *count = 0;
+    while (fgets(line, sizeof(line), input) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (*count == capacity)
+        {
+            capacity *= 2;
+            corpus = (char **)realloc(corpus, capacity * sizeof(char *));
+        }
+        corpus[(*count)++] = strdup(line);
+    }
+    fclose(input);
+    return corpus;
+}
+
+int main(int argc, char **argv)
+{
+    CorpusOptions options;
+    corpusDefaults(&options);
+    int count = 20000, runs = 5, generate = 0, pipeline = 1, kernels = 1;
+    const char *inputPath = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        int takesValue = 1;
+        if (strcmp(arg, "--count") == 0 && value)
+            count = atoi(value);
+        else if (strcmp(arg, "--depth") == 0 && value)
+            options.maxDepth = atoi(value);
+        else if (strcmp(arg, "--length") == 0 && value)
+            options.maxLength = atoi(value);
+        else if (strcmp(arg, "--function-mix") == 0 && value)
+            options.functionPercent = atoi(value);
+        else if (strcmp(arg, "--seed") == 0 && value)
+            options.seed = strtoull(value, NULL, 10);
+        else if (strcmp(arg, "--runs") == 0 && value)
+            runs = atoi(value);
+        else if (strcmp(arg, "--input") == 0 && value)
+            inputPath = value;
+        else if (strcmp(arg, "--precision") == 0 && value)
+        {
+            int tier = findPrecisionTier(value);
+            if (tier < 0)
+            {
+                fprintf(stderr, "Unknown precision '%s'\n", value);
+                return 1;
+            }
+            setPrecisionTier((PrecisionTier)tier);
+        }
+        else if (strcmp(arg, "--functions") == 0 && value)
+        {
+            if (!corpusParseFunctions(value, &options.functions))
+            {
+                fprintf(stderr, "Unknown function in '%s'\n", value);
+                return 1;
+            }
+        }
+        else
+        {
+            takesValue = 0;
+            if (strcmp(arg, "--generate") == 0)
+                generate = 1;
+            else if (strcmp(arg, "--pipeline-only") == 0)
+                kernels = 0;
+            else if (strcmp(arg, "--kernels-only") == 0)
+                pipeline = 0;
+            else
+            {
+                printBenchmarkUsage(argv[0]);
+                return 1;
+            }
+        }
+        i += takesValue;
+    }
+    if (count < 1 || runs < 1 || runs > MAX_RUNS || options.maxDepth < 0 || options.maxLength < 8 ||
+        options.maxLength >= CORPUS_MAX_EXPRESSION)
+    {
+        printBenchmarkUsage(argv[0]);
+        return 1;
+    }
+
+    char **corpus;
+    if (inputPath != NULL)
+    {
+        corpus = readCorpus(inputPath, &count);
+        if (corpus == NULL)
+        {
+            fprintf(stderr, "Cannot open '%s'\n", inputPath);
+            return 1;
+        }
+    }
+    else
+    {
+        CorpusGenerator generator;
+        corpusInit(&generator, &options);
+        corpus = (char **)malloc(count * sizeof(char *));
+        char expression[CORPUS_MAX_EXPRESSION];
+        for (int i = 0; i < count; i++)
+        {
+            corpusNext(&generator, expression, sizeof(expression));
+            corpus[i] = strdup(expression);
+        }
+    }
+
+    if (generate)
+    {
+        for (int i = 0; i < count; i++)
+            printf("%s\n", corpus[i]);
+    }
+    else
+    {
+        if (pipeline)
+            benchmarkPipeline(corpus, count, runs);
+        if (kernels)
+            benchmarkKernels(runs, options.functions);
+    }
+
+    for (int i = 0; i < count; i++)
+        free(corpus[i]);
+    free(corpus);
+    return 0;
+}
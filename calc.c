@@ -0,0 +1,226 @@
+// Library build of the calculator engine: the only translation unit that includes the engine
+// headers. Every engine function is static, so programs that link it see nothing but the calc_*
+// functions declared in calc.h
+#include "calc.h"
+#include "Bytecode.h"
+#include "Jit.h"
+#include "Gradient.h"
+#include "Numerics.h"
+#include <limits.h>
+
+// Compiled expression: bytecode, its native translation (if any), its gradient tape and the variable
+// names it uses. Nothing in it changes after calc_compile returns, which is what makes concurrent
+// evaluation safe
+struct calc_expr
+{
+    Program program;
+    JitCode jit;
+    Tape tape;
+    VariableTable variables;
+};
+
+// Copy an engine error out (err may be NULL)
+static void setError(calc_error *err, const ParseError *error)
+{
+    if (err == NULL)
+        return;
+    err->position = error->position;
+    snprintf(err->message, sizeof(err->message), "%s", error->message);
+}
+
+// Compile text with the given variable table and tier; returns NULL and fills err on failure
+static calc_expr *compileWith(const char *text, const VariableTable *variables, PrecisionTier tier, calc_error *err)
+{
+    ParseError error = {0};
+    if (text == NULL || strlen(text) > INT_MAX)
+    {
+        snprintf(error.message, sizeof(error.message), text == NULL ? "No expression" : "Expression too long");
+        setError(err, &error);
+        return NULL;
+    }
+
+    calc_expr *expr = (calc_expr *)malloc(sizeof(calc_expr));
+    if (expr == NULL)
+    {
+        snprintf(error.message, sizeof(error.message), "Out of memory");
+        setError(err, &error);
+        return NULL;
+    }
+    initProgram(&expr->program);
+    expr->program.tier = tier;
+    expr->variables = *variables;
+
+    // The arena only holds tokens and tree nodes while compiling, so each call has its own
+    Arena arena;
+    arenaInit(&arena, 0);
+    int ok = compileExpression(text, &expr->variables, &arena, &expr->program, &error);
+    arenaFree(&arena);
+    if (ok && !compileTape(&expr->program, &expr->tape))
+    {
+        snprintf(error.message, sizeof(error.message), "Out of memory");
+        ok = 0;
+    }
+    setError(err, &error);
+    if (!ok)
+    {
+        freeProgram(&expr->program);
+        free(expr);
+        return NULL;
+    }
+    jitCompile(&expr->program, &expr->jit);
+    return expr;
+}
+
+// Compile an expression; identifiers that are not functions become variables, numbered in order
+// of first appearance (see calc_variable_index). Returns NULL and fills err (if given) on failure.
+calc_expr *calc_compile(const char *text, calc_error *err)
+{
+    return calc_compile_precision(text, NULL, 0, CALC_PRECISION_STANDARD, err);
+}
+
+// Compile an expression over a fixed list of variables: names[i] is read from vars[i] by calc_eval,
+// and any other identifier is an error
+calc_expr *calc_compile_vars(const char *text, const char *const *names, int count, calc_error *err)
+{
+    return calc_compile_precision(text, names, count, CALC_PRECISION_STANDARD, err);
+}
+
+// Compile an expression whose functions use the kernels of the given precision. names and count are
+// as for calc_compile_vars, or NULL and 0 to number variables by first appearance as calc_compile does
+calc_expr *calc_compile_precision(const char *text, const char *const *names, int count, calc_precision precision,
+                                  calc_error *err)
+{
+    ParseError error = {0};
+    if ((int)precision < 0 || (int)precision >= PRECISION_TIER_COUNT)
+    {
+        snprintf(error.message, sizeof(error.message), "Unknown precision %d", (int)precision);
+        setError(err, &error);
+        return NULL;
+    }
+
+    VariableTable variables;
+    memset(&variables, 0, sizeof(variables));
+    variables.allowNew = names == NULL;
+    for (int i = 0; names != NULL && i < count; i++)
+    {
+        int length = (int)strlen(names[i]);
+        if (findVariable(&variables, names[i], length) >= 0 || addVariable(&variables, names[i], length) < 0)
+        {
+            snprintf(error.message, sizeof(error.message), "Invalid or repeated variable name '%.40s'", names[i]);
+            setError(err, &error);
+            return NULL;
+        }
+    }
+    return compileWith(text, &variables, (PrecisionTier)precision, err);
+}
+
+// Evaluate a compiled expression; vars[i] is the value of variable i (may be NULL if there are none)
+// Safe to call from several threads on the same handle
+double calc_eval(const calc_expr *expr, const double *vars)
+{
+    return jitRun(&expr->jit, &expr->program, vars);
+}
+
+// Evaluate rows of columnar data: out[r] is the result with variable i set to columns[i][r]
+// Returns 1 on success, or 0 if the workspace could not be allocated
+int calc_eval_columns(const calc_expr *expr, const double *const *columns, double *out, size_t rows)
+{
+    return evaluateColumns(&expr->program, columns, out, rows);
+}
+
+// Evaluate a compiled expression and its gradient: gradient[i] receives the partial derivative with
+// respect to variable i (calc_variable_count entries). Returns the same value as calc_eval, from one
+// forward and one reverse pass whatever the number of variables. Safe to call from several threads
+double calc_grad(const calc_expr *expr, const double *vars, double *gradient)
+{
+    // Declared variables the expression never reads have a zero derivative
+    for (int i = expr->tape.numVariables; i < expr->variables.count; i++)
+        gradient[i] = 0.0;
+    return runGradient(&expr->tape, vars, gradient);
+}
+
+// Evaluate rows of columnar data with their gradients: out[r] is as for calc_eval_columns and
+// gradients[i][r] the partial derivative with respect to variable i in row r
+// Returns 1 on success, or 0 if the workspace could not be allocated
+int calc_grad_columns(const calc_expr *expr, const double *const *columns, double *out, double *const *gradients, size_t rows)
+{
+    for (int i = expr->tape.numVariables; i < expr->variables.count; i++)
+        memset(gradients[i], 0, rows * sizeof(double));
+    return gradientColumns(&expr->tape, columns, out, gradients, rows);
+}
+
+// Copy the outcome of an integration or root search out
+static int setResult(int ok, const NumericResult *outcome, const ParseError *error, calc_result *result, calc_error *err)
+{
+    result->value = outcome->value;
+    result->error = outcome->error;
+    result->evaluations = outcome->evaluations;
+    result->converged = outcome->converged;
+    if (!ok)
+        setError(err, error);
+    return ok;
+}
+
+// Integrate over variable from a to b, the other variables fixed at vars (as for calc_eval), to the
+// given relative tolerance (0 for the default, 1e-10) with adaptive Gauss-Kronrod quadrature on
+// threads threads. Returns 1 with the integral, its error estimate and the evaluation count in
+// result, or 0 with err filled in if the arguments are invalid. Safe to call from several threads
+int calc_integrate(const calc_expr *expr, int variable, const double *vars, double a, double b, double tolerance,
+                   int threads, calc_result *result, calc_error *err)
+{
+    ParseError error = {0};
+    NumericResult outcome = {0};
+    int ok = 0;
+    if (variable < 0 || variable >= expr->variables.count)
+        snprintf(error.message, sizeof(error.message), "No variable %d", variable);
+    else
+        ok = integrateProgram(&expr->program, variable, vars, a, b, tolerance, threads, &outcome, &error);
+    return setResult(ok, &outcome, &error, result, err);
+}
+
+// Find a root in variable between lo and hi, where the expression must change sign, with Brent's
+// method; the other variables are fixed at vars. tolerance is the absolute error allowed in the root
+// (0 for the default, 1e-15). Returns 1 with the root in result, or 0 with err filled in
+int calc_solve(const calc_expr *expr, int variable, const double *vars, double lo, double hi, double tolerance,
+               calc_result *result, calc_error *err)
+{
+    ParseError error = {0};
+    NumericResult outcome = {0};
+    int ok = 0;
+    if (variable < 0 || variable >= expr->variables.count)
+        snprintf(error.message, sizeof(error.message), "No variable %d", variable);
+    else
+        ok = solveProgram(&expr->program, variable, vars, lo, hi, tolerance, &outcome, &error);
+    return setResult(ok, &outcome, &error, result, err);
+}
+
+// Number of variables the expression reads
+int calc_variable_count(const calc_expr *expr)
+{
+    return expr->variables.count;
+}
+
+// Name of variable index, or NULL if there is no such variable
+const char *calc_variable_name(const calc_expr *expr, int index)
+{
+    if (index < 0 || index >= expr->variables.count)
+        return NULL;
+    return expr->variables.names[index];
+}
+
+// Index of a variable in the vars array of calc_eval, or -1 if the expression does not use it
+int calc_variable_index(const calc_expr *expr, const char *name)
+{
+    return findVariable(&expr->variables, name, (int)strlen(name));
+}
+
+// Release a compiled expression (NULL is ignored)
+void calc_free(calc_expr *expr)
+{
+    if (expr == NULL)
+        return;
+    jitFree(&expr->jit);
+    freeTape(&expr->tape);
+    freeProgram(&expr->program);
+    free(expr);
+}
@@ -0,0 +1,70 @@
+#ifndef CALC_H
+#define CALC_H
+
+// Embedding API of the calculator engine. Link calc.c (or libcalc.a built from it) and include
+// only this header: compile an expression once into a calc_expr handle, then evaluate it as often
+// as needed. Errors are returned, never fatal. One handle may be evaluated from any number of
+// threads at once. The process shares the SIMD level detected on first use and the engine's default
+// precision tier; each handle records its own precision when it is compiled.
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CALC_MAX_VARIABLES 32 // Most variables one expression may use
+#define CALC_ERROR_SIZE 96    // Size of calc_error.message
+
+// Kernels an expression's functions are computed with
+typedef enum calc_precision
+{
+    CALC_PRECISION_STANDARD, // The engine's own double-precision kernels (the default)
+    CALC_PRECISION_FAST,     // At most about 3e-7 relative error: six significant digits, for speed
+    CALC_PRECISION_ACCURATE  // The C library's functions: correctly rounded where it is, at most 2.5 ULP otherwise
+} calc_precision;
+
+// Compiled expression (opaque)
+typedef struct calc_expr calc_expr;
+
+// Why an expression did not compile
+typedef struct calc_error
+{
+    int position;                  // Character offset of the error in the text
+    char message[CALC_ERROR_SIZE]; // Description, empty on success
+} calc_error;
+
+// Outcome of calc_integrate and calc_solve
+typedef struct calc_result
+{
+    double value;     // Integral or root
+    double error;     // Estimated absolute error of value
+    long evaluations; // Points at which the expression was evaluated
+    int converged;    // Whether the error is within the tolerance
+} calc_result;
+
+// Function declarations
+calc_expr *calc_compile(const char *text, calc_error *err);
+calc_expr *calc_compile_vars(const char *text, const char *const *names, int count, calc_error *err);
+calc_expr *calc_compile_precision(const char *text, const char *const *names, int count, calc_precision precision,
+                                  calc_error *err);
+double calc_eval(const calc_expr *expr, const double *vars);
+int calc_eval_columns(const calc_expr *expr, const double *const *columns, double *out, size_t rows);
+double calc_grad(const calc_expr *expr, const double *vars, double *gradient);
+int calc_grad_columns(const calc_expr *expr, const double *const *columns, double *out, double *const *gradients,
+                      size_t rows);
+int calc_integrate(const calc_expr *expr, int variable, const double *vars, double a, double b, double tolerance,
+                   int threads, calc_result *result, calc_error *err);
+int calc_solve(const calc_expr *expr, int variable, const double *vars, double lo, double hi, double tolerance,
+               calc_result *result, calc_error *err);
+int calc_variable_count(const calc_expr *expr);
+const char *calc_variable_name(const calc_expr *expr, int index);
+int calc_variable_index(const calc_expr *expr, const char *name);
+void calc_free(calc_expr *expr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,7 +1,13 @@
 #include "ASTFunctions.h"
+#include "Batch.h"
+#include "Server.h"
+#include "Sheet.h"
+#include "Numerics.h"
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #define MAX_SIZE 200
 
@@ -25,16 +31,306 @@ const char *getResultColour(int count)
     return colours[count % numColours];
 }
 
-int main()
+void printUsage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [--batch] [--threads N] [--arena-stats] [--stats[=json]] [--format F] [--no-mmap] [--serve ADDRESS]\n"
+                    "       [--cache-size BYTES] [--cache-stats] [--precision TIER] [file ...]\n", program);
+    fprintf(stderr, "  --batch, -b     Evaluate one expression per line from the files (or stdin) without prompts\n");
+    fprintf(stderr, "  --threads N     Evaluate batch input on N threads (0 = one per CPU), output order is kept;\n");
+    fprintf(stderr, "                  interactive integrals also use them (default: one per CPU)\n");
+    fprintf(stderr, "  --serve ADDRESS Evaluate lines sent to a Unix socket path (or tcp:PORT on 127.0.0.1)\n");
+    fprintf(stderr, "                  on --threads workers (default: one per CPU)\n");
+    fprintf(stderr, "  --arena-stats   Print arena high-water marks to stderr on exit\n");
+    fprintf(stderr, "  --stats[=json]  Print phase timings and counters to stderr on exit (build with -DCALC_STATS)\n");
+    fprintf(stderr, "  --format F      Result format: fixed:N (N decimals, default fixed:6), shortest (round-trips),\n");
+    fprintf(stderr, "                  or binary (little-endian doubles, batch mode only)\n");
+    fprintf(stderr, "  --no-mmap       Read input files with stdio instead of mapping them into memory\n");
+    fprintf(stderr, "  --cache-size B  Memory for remembered expressions and results (k/M/G suffixes, 0 = off, default 16M)\n");
+    fprintf(stderr, "  --cache-stats   Print expression cache hits and misses to stderr on exit\n");
+    fprintf(stderr, "  --precision T   Function kernels: fast (about 3e-7 relative error), standard (default)\n");
+    fprintf(stderr, "                  or accurate (the C library, at most 2.5 ULP)\n");
+}
+
+// Report how much arena memory the largest expression needed
+void printArenaStats(const Arena *arena)
+{
+    fprintf(stderr, "Arena high-water mark: %zu bytes in %zu block(s), %zu heap allocation(s)\n",
+            arena->highWater, arena->maxBlocks, arena->heapCalls);
+}
+
+// Report how often repeated expressions were answered from the cache
+void printCacheStats(const ExpressionCache *cache)
+{
+    unsigned long long lookups = cache->hits + cache->misses;
+    fprintf(stderr, "Expression cache: %llu hit(s), %llu miss(es) (%.1f%% hits), %llu eviction(s), budget %zu bytes\n",
+            cache->hits, cache->misses, lookups ? 100.0 * cache->hits / lookups : 0.0, cache->evictions, cache->budget);
+}
+
+// Parse a byte count with an optional k, M or G suffix; returns 0 if it is invalid
+int parseByteCount(const char *text, size_t *bytes)
+{
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text || text[0] == '-')
+        return 0;
+    int shift = 0;
+    if (*end == 'k' || *end == 'K')
+        shift = 10;
+    else if (*end == 'm' || *end == 'M')
+        shift = 20;
+    else if (*end == 'g' || *end == 'G')
+        shift = 30;
+    if ((shift > 0 && end[1] != '\0') || (shift == 0 && *end != '\0') || value > (SIZE_MAX >> shift))
+        return 0;
+    *bytes = (size_t)value << shift;
+    return 1;
+}
+
+// Report the phase timings and counters collected while evaluating
+void printStats(int json)
+{
+#ifdef CALC_STATS
+    statsPrint(stderr, json);
+#else
+    (void)json;
+    fprintf(stderr, "Statistics are not compiled in; rebuild with -DCALC_STATS\n");
+#endif
+}
+
+// Parse a --format argument into format and precision; returns 0 if it is invalid
+int parseOutputFormat(const char *text, OutputFormat *format, int *precision)
+{
+    if (strcmp(text, "shortest") == 0)
+        *format = FORMAT_SHORTEST;
+    else if (strcmp(text, "binary") == 0)
+        *format = FORMAT_BINARY;
+    else if (strncmp(text, "fixed:", 6) == 0)
+    {
+        char *end;
+        long value = strtol(text + 6, &end, 10);
+        if (text[6] == '\0' || *end != '\0' || value < 0 || value > FORMAT_MAX_PRECISION)
+            return 0;
+        *format = FORMAT_FIXED;
+        *precision = (int)value;
+    }
+    else
+        return 0;
+    return 1;
+}
+
+// Evaluate one input stream, on worker threads when numThreads > 1
+long runBatchInput(FILE *input, int numThreads, Arena *arena, ExpressionCache *cache, OutputBuffer *out)
+{
+    if (numThreads > 1)
+        return runBatchThreaded(input, numThreads, cache, out);
+    return runBatch(input, arena, cache, out);
+}
+
+// Evaluate every line of the given files (or stdin) and write one result per line to stdout
+int runBatchMode(char **files, int numFiles, int numThreads, Arena *arena, ExpressionCache *cache, OutputFormat format, int precision, int mapFiles)
+{
+    OutputBuffer out;
+    outputInit(&out, stdout, OUTPUT_BUFFER_SIZE);
+    out.format = format;
+    out.precision = precision;
+    int status = 0;
+
+    if (numFiles == 0)
+        runBatchInput(stdin, numThreads, arena, cache, &out);
+
+    for (int i = 0; i < numFiles; i++)
+    {
+        if (strcmp(files[i], "-") == 0)
+        {
+            runBatchInput(stdin, numThreads, arena, cache, &out);
+            continue;
+        }
+#if BATCH_MAPPED_INPUT
+        // Regular files are evaluated straight from memory mappings; anything else goes through stdio
+        long failures;
+        int mapped = mapFiles ? runBatchMapped(files[i], numThreads, cache, &out, &failures) : 0;
+        if (mapped != 0)
+        {
+            if (mapped < 0)
+            {
+                outputFlush(&out);
+                fprintf(stderr, "Cannot open '%s'\n", files[i]);
+                status = 1;
+            }
+            continue;
+        }
+#endif
+        FILE *input = fopen(files[i], "rb");
+        if (input == NULL)
+        {
+            outputFlush(&out);
+            fprintf(stderr, "Cannot open '%s'\n", files[i]);
+            status = 1;
+            continue;
+        }
+        runBatchInput(input, numThreads, arena, cache, &out);
+        fclose(input);
+    }
+
+    outputFree(&out);
+    return status;
+}
+
+// Format a result in the chosen output format
+void formatResult(double result, OutputFormat format, int precision, char *text)
+{
+    if (format == FORMAT_SHORTEST)
+        formatShortest(result, text);
+    else
+        formatFixed(result, precision, text);
+}
+
+// Handle `name = expression`: define the name and report what the edit recomputed
+void runAssignment(Sheet *sheet, const char *name, int nameLength, const char *definition, Arena *arena, OutputFormat format, int precision, int *colourCount)
+{
+    ParseError error = {0};
+    if (!sheetAssign(sheet, name, nameLength, definition, arena, &error))
+    {
+        printf("\033[1;31mError: %s.\033[0m\n", error.message);
+        return;
+    }
+
+    const SheetCell *cell = &sheet->cells[sheetFind(sheet, name, nameLength)];
+    if (cell->missing >= 0)
+        printf("%s%s is waiting for '%s'\033[0m\n", getResultColour(*colourCount), cell->name, sheet->cells[cell->missing].name);
+    else
+    {
+        char text[FORMAT_BUFFER_SIZE];
+        formatResult(cell->value, format, precision, text);
+        printf("%s%s = %s\033[0m\n", getResultColour(*colourCount), cell->name, text);
+    }
+    if (sheet->recomputed > 1)
+        printf("(%ld dependent definition%s recomputed)\n", sheet->recomputed - 1, sheet->recomputed == 2 ? "" : "s");
+    (*colourCount)++;
+}
+
+// Recognise a call `name(piece, piece, ...)` spanning the whole line, splitting line in place at the
+// top-level commas and trimming each piece. Returns the number of pieces (maxPieces + 1 if there are
+// more than pieces can hold), or 0 if line is not such a call
+int splitCall(char *line, const char *name, char **pieces, int maxPieces)
+{
+    size_t nameLength = strlen(name);
+    while (*line == ' ' || *line == '\t')
+        line++;
+    size_t length = strlen(line);
+    while (length > 0 && (line[length - 1] == ' ' || line[length - 1] == '\t'))
+        length--;
+    if (strncmp(line, name, nameLength) != 0 || line[nameLength] != '(' || length < nameLength + 2 || line[length - 1] != ')')
+        return 0;
+    line[length - 1] = '\0';
+
+    int numPieces = 0;
+    int depth = 0;
+    pieces[numPieces++] = line + nameLength + 1;
+    for (char *c = line + nameLength + 1; *c != '\0'; c++)
+    {
+        if (*c == '(')
+            depth++;
+        else if (*c == ')')
+            depth--;
+        else if (*c == ',' && depth == 0)
+        {
+            if (numPieces == maxPieces)
+                return maxPieces + 1; // Too many pieces; the caller reports it
+            *c = '\0';
+            pieces[numPieces++] = c + 1;
+        }
+    }
+
+    for (int i = 0; i < numPieces; i++)
+    {
+        char *piece = pieces[i];
+        while (*piece == ' ' || *piece == '\t')
+            piece++;
+        char *end = piece + strlen(piece);
+        while (end > piece && (end[-1] == ' ' || end[-1] == '\t'))
+            *--end = '\0';
+        pieces[i] = piece;
+    }
+    return numPieces;
+}
+
+// Handle `grad(expression, name, ...)`: print the value and its derivative by each name
+void runGradientRequest(Sheet *sheet, char **pieces, int numPieces, Arena *arena, OutputFormat format, int precision, int *colourCount)
+{
+    if (numPieces < 2 || numPieces > MAX_VARIABLES + 1)
+    {
+        printf("\033[1;31mError: Expected grad(expression, name, ...) with 1 to %d names.\033[0m\n", MAX_VARIABLES);
+        return;
+    }
+    const char *expression = pieces[0];
+    const char *const *names = (const char *const *)pieces + 1;
+    int count = numPieces - 1;
+    double result;
+    double gradient[MAX_VARIABLES];
+    ParseError error = {0};
+    if (!sheetGradient(sheet, expression, names, count, arena, &result, gradient, &error))
+    {
+        printf("\033[1;31mError: %s.\033[0m\n", error.message);
+        return;
+    }
+    char text[FORMAT_BUFFER_SIZE];
+    formatResult(result, format, precision, text);
+    printf("%sResult: %s\n", getResultColour(*colourCount), text);
+    for (int i = 0; i < count; i++)
+    {
+        formatResult(gradient[i], format, precision, text);
+        printf("d/d%s = %s\n", names[i], text);
+    }
+    printf("\033[0m");
+    (*colourCount)++;
+}
+
+// Handle `integrate(expression, variable, from, to)` and `solve(expression, variable, lo, hi)`: the
+// expression is compiled once, and the limits and any other names are read from the sheet
+void runNumericRequest(Sheet *sheet, char **pieces, int numPieces, int solve, Arena *arena, int numThreads, OutputFormat format, int precision, int *colourCount)
+{
+    ParseError error = {0};
+    double from, to;
+    double values[MAX_VARIABLES] = {0};
+    Program program;
+    initProgram(&program);
+    if (numPieces != 4)
+        snprintf(error.message, sizeof(error.message), "Expected %s(expression, variable, %s)", solve ? "solve" : "integrate", solve ? "lo, hi" : "from, to");
+    else if (sheetEvaluate(sheet, pieces[2], arena, &from, &error) && sheetEvaluate(sheet, pieces[3], arena, &to, &error) &&
+             sheetCompileBound(sheet, pieces[0], pieces[1], arena, &program, values, &error))
+    {
+        NumericResult result;
+        int ok = solve ? solveProgram(&program, 0, values, from, to, 0.0, &result, &error)
+                       : integrateProgram(&program, 0, values, from, to, 0.0, numThreads, &result, &error);
+        freeProgram(&program);
+        if (ok)
+        {
+            char text[FORMAT_BUFFER_SIZE];
+            formatResult(result.value, format, precision, text);
+            printf("%sResult: %s\n", getResultColour(*colourCount), text);
+            printf("Error estimate: %.2e, %ld evaluations%s\033[0m\n", result.error, result.evaluations,
+                   result.converged ? "" : " (tolerance not reached)");
+            (*colourCount)++;
+            return;
+        }
+    }
+    printf("\033[1;31mError: %s.\033[0m\n", error.message);
+}
+
+int runInteractive(Arena *arena, ExpressionCache *cache, int numThreads, OutputFormat format, int precision)
 {
     char expression[MAX_SIZE];
     int colourCount = 0;
+    Sheet sheet;
+    sheetInit(&sheet);
     printWelcomeMessage();
 
     while (1)
     {
         printf(">> ");
-        fgets(expression, sizeof(expression), stdin);
+        if (fgets(expression, sizeof(expression), stdin) == NULL)
+            break;                                    // End of input
         expression[strcspn(expression, "\n")] = '\0'; // Remove newline character
 
         if (strcmp(expression, "q") == 0)
@@ -43,25 +339,185 @@ int main()
             break;
         }
 
-        int numTokens;
-        char **tokens = tokenise(expression, &numTokens);
-        Parser parser = {tokens, 0, numTokens};
-        ASTNode *ast = parseExpression(&parser);
+        const char *name;
+        const char *definition;
+        int nameLength;
+        if (sheetParseAssignment(expression, &name, &nameLength, &definition))
+        {
+            runAssignment(&sheet, name, nameLength, definition, arena, format, precision, &colourCount);
+            continue;
+        }
+        char *pieces[MAX_VARIABLES + 1];
+        int numPieces;
+        int solve = 0;
+        if ((numPieces = splitCall(expression, "grad", pieces, MAX_VARIABLES + 1)) > 0)
+        {
+            runGradientRequest(&sheet, pieces, numPieces, arena, format, precision, &colourCount);
+            continue;
+        }
+        if ((numPieces = splitCall(expression, "integrate", pieces, 4)) > 0 ||
+            (solve = (numPieces = splitCall(expression, "solve", pieces, 4)) > 0))
+        {
+            runNumericRequest(&sheet, pieces, numPieces, solve, arena, numThreads, format, precision, &colourCount);
+            continue;
+        }
 
-        if (ast)
+        // Expressions that may read defined names go through the sheet, everything else through the cache
+        double result;
+        ParseError error = {0};
+        int ok = sheet.count > 0 ? sheetEvaluate(&sheet, expression, arena, &result, &error)
+                 : cache != NULL ? cacheEvaluate(cache, expression, strlen(expression), arena, &result, &error)
+                                 : evaluateExpression(expression, arena, &result, &error);
+        if (ok)
         {
-            double result = evaluate(ast);
-            printf("%sResult: %.6f\033[0m\n", getResultColour(colourCount), result);
-            freeNode(ast);
+            STATS_TIMER_START(outputStart);
+            char text[FORMAT_BUFFER_SIZE];
+            formatResult(result, format, precision, text);
+            printf("%sResult: %s\033[0m\n", getResultColour(colourCount), text);
+            STATS_TIMER_STOP(outputStart, PHASE_OUTPUT);
             colourCount++;
         }
         else
         {
-            printf("\033[1;31mError: Invalid expression.\033[0m\n");
+            STATS_TIMER_START(outputStart);
+            printf("\033[1;31mError: %s.\033[0m\n", error.message);
+            STATS_TIMER_STOP(outputStart, PHASE_OUTPUT);
         }
-
-        freeTokens(tokens, numTokens);
     }
 
+    sheetFree(&sheet);
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char **argv)
+{
+    int batch = 0;
+    int arenaStats = 0;
+    int cacheStats = 0;
+    size_t cacheBudget = CACHE_DEFAULT_BUDGET;
+    int stats = 0; // 1 for a text summary, 2 for JSON
+    int numThreads = 1;
+    int threadsGiven = 0;
+    const char *serveAddress = NULL;
+    OutputFormat format = FORMAT_FIXED;
+    int precision = 6;
+    int mapFiles = 1;
+    char **files = (char **)malloc(argc * sizeof(char *));
+    int numFiles = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--batch") == 0 || strcmp(argv[i], "-b") == 0)
+            batch = 1;
+        else if (strcmp(argv[i], "--arena-stats") == 0)
+            arenaStats = 1;
+        else if (strcmp(argv[i], "--no-mmap") == 0)
+            mapFiles = 0;
+        else if (strcmp(argv[i], "--cache-stats") == 0)
+            cacheStats = 1;
+        else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc)
+        {
+            if (!parseByteCount(argv[++i], &cacheBudget))
+            {
+                printUsage(argv[0]);
+                free(files);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--stats") == 0)
+            stats = 1;
+        else if (strcmp(argv[i], "--stats=json") == 0)
+            stats = 2;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            char *end;
+            long value = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || value < 0 || value > 1024)
+            {
+                printUsage(argv[0]);
+                free(files);
+                return 1;
+            }
+            numThreads = value == 0 ? (int)sysconf(_SC_NPROCESSORS_ONLN) : (int)value;
+            if (numThreads < 1)
+                numThreads = 1;
+            threadsGiven = 1;
+        }
+        else if (strcmp(argv[i], "--precision") == 0 && i + 1 < argc)
+        {
+            int tier = findPrecisionTier(argv[++i]);
+            if (tier < 0)
+            {
+                printUsage(argv[0]);
+                free(files);
+                return 1;
+            }
+            setPrecisionTier((PrecisionTier)tier);
+        }
+        else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc)
+            serveAddress = argv[++i];
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            if (!parseOutputFormat(argv[++i], &format, &precision))
+            {
+                printUsage(argv[0]);
+                free(files);
+                return 1;
+            }
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0')
+        {
+            printUsage(argv[0]);
+            free(files);
+            return 1;
+        }
+        else
+            files[numFiles++] = argv[i];
+    }
+
+    if (serveAddress != NULL && (batch || numFiles > 0 || format == FORMAT_BINARY))
+    {
+        printUsage(argv[0]);
+        free(files);
+        return 1;
+    }
+    if ((numFiles > 0 || format == FORMAT_BINARY) && !batch && serveAddress == NULL)
+    {
+        printUsage(argv[0]);
+        free(files);
+        return 1;
+    }
+
+    // One arena is reused for every expression, so steady-state evaluation makes no heap calls
+#ifdef CALC_STATS
+    if (stats)
+        statsInit();
+#endif
+    Arena arena;
+    arenaInit(&arena, ARENA_DEFAULT_SIZE);
+    ExpressionCache cache;
+    cacheInit(&cache, cacheBudget, NULL);
+    ExpressionCache *useCache = cacheBudget > 0 ? &cache : NULL;
+    int status;
+    if (serveAddress != NULL)
+    {
+        if (!threadsGiven)
+            numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        status = runServer(serveAddress, numThreads > 0 ? numThreads : 1, format, precision, useCache);
+    }
+    else if (batch)
+        status = runBatchMode(files, numFiles, numThreads, &arena, useCache, format, precision, mapFiles);
+    else
+        status = runInteractive(&arena, useCache, threadsGiven ? numThreads : (int)sysconf(_SC_NPROCESSORS_ONLN), format, precision);
+    if (arenaStats)
+        printArenaStats(&arena);
+    if (cacheStats)
+        printCacheStats(&cache);
+    if (stats)
+        printStats(stats == 2);
+
+    cacheFree(&cache);
+    arenaFree(&arena);
+    free(files);
+    return status;
+}
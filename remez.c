@@ -0,0 +1,690 @@
+// Offline generator of the kernel coefficients in MathCoefficients.h
+//
+// Runs the Remez exchange algorithm in long double to find the minimax approximation of a function on
+// an interval, in the form L(x) + x^S * P(x^K) (or P/Q for a rational fit), where the fixed low-order
+// terms L keep the kernel exact near 0. It searches for the lowest degree whose error, after rounding
+// the coefficients to double (or float), is below the target, and prints them as a Horner macro.
+//
+//   gcc -O2 -o remez remez.c -lm
+//   ./remez --header > MathCoefficients.h                        # Regenerate every kernel
+//   ./remez --function asin --interval 0,0.5 --form odd --error 1e-16 --rational
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_TERMS 24       // Most coefficients of P (and of Q)
+#define MAX_LEAD 3         // Most fixed low-order terms
+#define GRID_POINTS 4000   // Samples of the error curve per exchange, each extremum then refined
+#define MAX_ITERATIONS 100 // Exchanges before giving up on convergence
+#define MAX_STALLS 4       // Exchanges in a row without improvement before stopping
+#define DIVISION_COST 4    // Multiply-adds a division counts as when a rational fit competes with a polynomial
+
+typedef long double real;
+
+static const real PI_L = 3.14159265358979323846264338327950288L;
+static const real LN2_L = 0.693147180559945309417232121458176568L;
+
+// Function to approximate
+typedef struct TargetFunction
+{
+    const char *name;
+    real (*f)(real);
+} TargetFunction;
+
+static real lnRatio(real x)
+{
+    return 2 * atanhl(x); // ln((1 + x) / (1 - x)), which is ln(m) for x = (m - 1) / (m + 1)
+}
+
+static const TargetFunction targetFunctions[] = {
+    {"sin", sinl}, {"cos", cosl}, {"tan", tanl}, {"exp", expl}, {"expm1", expm1l}, {"sinh", sinhl}, {"cosh", coshl},
+    {"tanh", tanhl}, {"asin", asinl}, {"atan", atanl}, {"log1p", log1pl}, {"lnratio", lnRatio},
+};
+
+// Shape of the approximation: L(x) + x^shift * P(x^step)
+typedef struct Form
+{
+    const char *name;
+    const char *description;
+    real lead[MAX_LEAD]; // L(x) = lead[0] + lead[1] x + lead[2] x^2
+    int shift;
+    int step;
+} Form;
+
+static const Form forms[] = {
+    {"poly", "P(x)", {0, 0, 0}, 0, 1},
+    {"odd", "x + x^3 * P(x^2)", {0, 1, 0}, 3, 2},
+    {"even", "1 + x^2 * P(x^2)", {1, 0, 0}, 2, 2},
+    {"exp", "1 + x + x^2 * P(x)", {1, 1, 0}, 2, 1},
+    {"lnratio", "2x + x^3 * P(x^2)", {0, 2, 0}, 3, 2},
+};
+
+// One approximation problem
+typedef struct Problem
+{
+    const TargetFunction *function;
+    const Form *form;
+    real low, high;
+    int relative; // Minimize the relative error (otherwise the absolute error)
+    int isFloat;  // Round the coefficients to float instead of double
+} Problem;
+
+// Coefficients of an approximation; Q is 1 + q[1] t + ... and absent for a polynomial
+typedef struct Fit
+{
+    int numP;             // Coefficients of P
+    int degreeQ;          // Degree of Q, 0 for a polynomial
+    real p[MAX_TERMS];
+    real q[MAX_TERMS + 1]; // q[0] is always 1
+    real levelled;         // |E| of the last exchange
+    real maxError;         // Largest error of the rounded coefficients, in long double
+    real evaluatedError;   // Largest error with Horner's rule evaluated in the coefficients' precision
+} Fit;
+
+// Generated kernels, in the order they appear in MathCoefficients.h
+typedef struct KernelSpec
+{
+    const char *name;     // Macro prefix: NAME_POLY (and NAME_DENOMINATOR)
+    const char *function;
+    const char *form;
+    real low, high;
+    int relative;
+    int isFloat;
+    double target;       // Largest acceptable error
+    const char *comment; // What the kernel is used for
+} KernelSpec;
+
+#define DOUBLE_TARGET 0x1p-54 // A quarter of an ULP at worst, so rounding in the evaluation dominates
+#define FLOAT_TARGET 0x1p-23  // One float ULP: a third of the fast tier's 3e-7 budget
+
+static const KernelSpec kernelSpecs[] = {
+    {"SIN", "sin", "odd", 0, 0.25L * PI_L, 1, 0, DOUBLE_TARGET, "sinPoly(), simdSinPoly(): reduced argument in [-π/4, π/4]"},
+    {"COS", "cos", "even", 0, 0.25L * PI_L, 1, 0, DOUBLE_TARGET, "cosPoly(), simdCosPoly()"},
+    {"EXP", "exp", "exp", -0.5L * LN2_L, 0.5L * LN2_L, 1, 0, DOUBLE_TARGET, "customEXP(), simdEXP()"},
+    {"SINH", "sinh", "odd", 0, 0.5L * LN2_L, 1, 0, DOUBLE_TARGET, "the odd half of expHalves() and simdExpHalves()"},
+    {"COSH", "cosh", "even", 0, 0.5L * LN2_L, 1, 0, DOUBLE_TARGET, "the even half of expHalves() and simdExpHalves()"},
+    {"LN", "lnratio", "lnratio", 0, 0.17157287525381L, 1, 0, DOUBLE_TARGET,
+     "customLN(), simdLN(): ln(m) for m in [sqrt(2)/2, sqrt(2)], x = (m - 1) / (m + 1)"},
+    {"ASIN", "asin", "odd", 0, 0.5L, 1, 0, DOUBLE_TARGET, "customASIN(), customACOS(), simdASIN(), simdACOS()"},
+    {"ATAN", "atan", "odd", 0, 0.26794919243112270L, 1, 0, DOUBLE_TARGET, "customATAN(), simdATAN(): |x| <= tan(π/12)"},
+    {"FAST_SIN", "sin", "odd", 0, 0.25L * PI_L, 1, 1, FLOAT_TARGET, "fastSinPoly(), fast vector kernels: [-π/4, π/4]"},
+    {"FAST_COS", "cos", "even", 0, 0.25L * PI_L, 1, 1, FLOAT_TARGET, "fastCosPoly(), fast vector kernels"},
+    {"FAST_EXP", "exp", "exp", -0.5L * LN2_L, 0.5L * LN2_L, 1, 1, FLOAT_TARGET, "fastEXP(), fast vector kernels"},
+    {"FAST_SINH", "sinh", "odd", 0, 0.5L * LN2_L, 1, 1, FLOAT_TARGET, "the odd half of fastExpHalves() and simdFastSINHCOSH()"},
+    {"FAST_COSH", "cosh", "even", 0, 0.5L * LN2_L, 1, 1, FLOAT_TARGET, "the even half of fastExpHalves() and simdFastSINHCOSH()"},
+    {"FAST_LN", "lnratio", "lnratio", 0, 0.17157287525381L, 1, 1, FLOAT_TARGET, "fastLog1pPoly(), fast vector kernels"},
+    {"FAST_ASIN", "asin", "odd", 0, 0.5L, 1, 1, FLOAT_TARGET / 4,
+     "fastAsinPoly(), fast vector kernels: tighter, π/2 - 2 asin(sqrt((1 - x) / 2)) doubles its error"},
+    {"FAST_ATAN", "atan", "odd", 0, 0.41421356237309505L, 1, 1, FLOAT_TARGET, "fastATAN(), fast vector kernels: |x| <= tan(π/8)"},
+};
+
+// Round a coefficient to the precision it will be stored in
+static real roundCoefficient(const Problem *problem, real c)
+{
+    return problem->isFloat ? (real)(float)c : (real)(double)c;
+}
+
+static real leadValue(const Form *form, real x)
+{
+    return form->lead[0] + x * (form->lead[1] + x * form->lead[2]);
+}
+
+static real evaluatePoly(const real *c, int n, real t)
+{
+    real sum = 0;
+    for (int j = n - 1; j >= 0; j--)
+        sum = sum * t + c[j];
+    return sum;
+}
+
+static real approximation(const Problem *problem, const Fit *fit, real x)
+{
+    real t = powl(x, problem->form->step);
+    real r = evaluatePoly(fit->p, fit->numP, t);
+    if (fit->degreeQ > 0)
+        r /= evaluatePoly(fit->q, fit->degreeQ + 1, t);
+    return leadValue(problem->form, x) + powl(x, problem->form->shift) * r;
+}
+
+// Weighted error at x (0 where a relative error is undefined)
+static real errorAt(const Problem *problem, const Fit *fit, real x)
+{
+    real f = problem->function->f(x);
+    real difference = approximation(problem, fit, x) - f;
+    if (!problem->relative)
+        return difference;
+    return f == 0 ? 0 : difference / fabsl(f);
+}
+
+// The same error with Horner's rule in the precision of the coefficients, for an argument in that precision
+static real evaluatedErrorAt(const Problem *problem, const Fit *fit, real x)
+{
+    x = roundCoefficient(problem, x);
+    real f = problem->function->f(x);
+    real value;
+    if (problem->isFloat)
+    {
+        float xf = (float)x, t = problem->form->step == 2 ? xf * xf : xf, p = 0, q = 0;
+        for (int j = fit->numP - 1; j >= 0; j--)
+            p = p * t + (float)fit->p[j];
+        for (int j = fit->degreeQ; j >= 0 && fit->degreeQ > 0; j--)
+            q = q * t + (float)fit->q[j];
+        float s = fit->degreeQ > 0 ? p / q : p;
+        for (int j = 0; j < problem->form->shift; j++)
+            s *= xf;
+        value = (float)problem->form->lead[0] + xf * ((float)problem->form->lead[1] + xf * (float)problem->form->lead[2]) + s;
+    }
+    else
+    {
+        double xd = (double)x, t = problem->form->step == 2 ? xd * xd : xd, p = 0, q = 0;
+        for (int j = fit->numP - 1; j >= 0; j--)
+            p = p * t + (double)fit->p[j];
+        for (int j = fit->degreeQ; j >= 0 && fit->degreeQ > 0; j--)
+            q = q * t + (double)fit->q[j];
+        double s = fit->degreeQ > 0 ? p / q : p;
+        for (int j = 0; j < problem->form->shift; j++)
+            s *= xd;
+        value = (double)problem->form->lead[0] + xd * ((double)problem->form->lead[1] + xd * (double)problem->form->lead[2]) + s;
+    }
+    real difference = value - f;
+    if (!problem->relative)
+        return difference;
+    return f == 0 ? 0 : difference / fabsl(f);
+}
+
+// Solve the n x n system a * x = a[.][n] in place by Gaussian elimination with partial pivoting
+static int solveLinear(real a[][MAX_TERMS * 2 + 3], int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        int pivot = i;
+        for (int r = i + 1; r < n; r++)
+            if (fabsl(a[r][i]) > fabsl(a[pivot][i]))
+                pivot = r;
+        if (a[pivot][i] == 0)
+            return 0;
+        for (int c = 0; c <= n; c++)
+        {
+            real swap = a[i][c];
+            a[i][c] = a[pivot][c];
+            a[pivot][c] = swap;
+        }
+        for (int r = 0; r < n; r++)
+        {
+            if (r == i)
+                continue;
+            real factor = a[r][i] / a[i][i];
+            for (int c = i; c <= n; c++)
+                a[r][c] -= factor * a[i][c];
+        }
+    }
+    for (int i = 0; i < n; i++)
+        a[i][n] /= a[i][i];
+    return 1;
+}
+
+// Point of the grid used to scan the error curve, clustered towards the ends like Chebyshev nodes
+static real gridPoint(const Problem *problem, int k)
+{
+    return problem->low + (problem->high - problem->low) * (1 - cosl(PI_L * k / GRID_POINTS)) / 2;
+}
+
+// Move x to the local maximum of |error| between a and b (golden section search)
+static real refineExtremum(const Problem *problem, const Fit *fit, real a, real b)
+{
+    const real ratio = 0.618033988749894848L;
+    for (int i = 0; i < 60; i++)
+    {
+        real c = b - ratio * (b - a), d = a + ratio * (b - a);
+        if (fabsl(errorAt(problem, fit, c)) > fabsl(errorAt(problem, fit, d)))
+            b = d;
+        else
+            a = c;
+    }
+    return (a + b) / 2;
+}
+
+// Find the extrema of alternating sign of the error curve; returns their number
+static int findExtrema(const Problem *problem, const Fit *fit, real *points, real *errors, real *maxError)
+{
+    static real grid[GRID_POINTS + 1], values[GRID_POINTS + 1];
+    for (int k = 0; k <= GRID_POINTS; k++)
+    {
+        grid[k] = gridPoint(problem, k);
+        values[k] = errorAt(problem, fit, grid[k]);
+    }
+
+    int count = 0;
+    *maxError = 0;
+    for (int k = 0; k <= GRID_POINTS;)
+    {
+        int sign = values[k] >= 0;
+        int best = k;
+        while (k <= GRID_POINTS && (values[k] >= 0) == sign)
+        {
+            if (fabsl(values[k]) > fabsl(values[best]))
+                best = k;
+            k++;
+        }
+        real x = grid[best];
+        if (best > 0 && best < GRID_POINTS)
+            x = refineExtremum(problem, fit, grid[best - 1], grid[best + 1]);
+        points[count] = x;
+        errors[count] = errorAt(problem, fit, x);
+        if (fabsl(errors[count]) < fabsl(values[best]))
+        {
+            points[count] = grid[best];
+            errors[count] = values[best];
+        }
+        if (fabsl(errors[count]) > *maxError)
+            *maxError = fabsl(errors[count]);
+        count++;
+    }
+    return count;
+}
+
+// Drop extrema until exactly `needed` remain, keeping the largest errors and the alternation
+static int selectExtrema(real *points, real *errors, int count, int needed)
+{
+    while (count > needed)
+    {
+        int drop;
+        if (count - needed >= 2)
+        {
+            drop = 0;
+            for (int i = 1; i < count; i++)
+                if (fabsl(errors[i]) < fabsl(errors[drop]))
+                    drop = i;
+        }
+        else
+            drop = fabsl(errors[0]) < fabsl(errors[count - 1]) ? 0 : count - 1;
+
+        if (drop > 0 && drop < count - 1)
+        {
+            // Removing an inner extremum leaves two neighbours of the same sign: keep the larger
+            int keep = fabsl(errors[drop - 1]) >= fabsl(errors[drop + 1]) ? drop - 1 : drop + 1;
+            points[drop - 1] = points[keep];
+            errors[drop - 1] = errors[keep];
+            memmove(points + drop, points + drop + 2, (count - drop - 2) * sizeof(real));
+            memmove(errors + drop, errors + drop + 2, (count - drop - 2) * sizeof(real));
+            count -= 2;
+        }
+        else
+        {
+            memmove(points + drop, points + drop + 1, (count - drop - 1) * sizeof(real));
+            memmove(errors + drop, errors + drop + 1, (count - drop - 1) * sizeof(real));
+            count--;
+        }
+    }
+    return count;
+}
+
+// Remez exchange for the coefficients p[fixed..numP-1] and q[1..degreeQ] of fit; p[0..fixed-1] stay as given
+// Keeps the iterate with the smallest error: near the limits of long double the exchange stops converging
+// Returns 0 if the linear system was singular
+static int remez(const Problem *problem, Fit *fit, int fixed)
+{
+    int unknowns = fit->numP - fixed + fit->degreeQ;
+    int needed = unknowns + 1;
+    static real extremaPoints[GRID_POINTS + 1], extremaErrors[GRID_POINTS + 1];
+
+    real reference[MAX_TERMS * 2 + 3];
+    for (int i = 0; i < needed; i++)
+        reference[i] = problem->low + (problem->high - problem->low) * (1 - cosl(PI_L * (i + 0.5L) / needed)) / 2;
+    for (int j = 1; j <= fit->degreeQ; j++)
+        fit->q[j] = 0;
+    fit->q[0] = 1;
+    Fit best = *fit;
+    real bestError = INFINITY;
+    int stalls = 0;
+
+    for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++)
+    {
+        // Levelled error equations: x^S P(t) - g Q(t) - s w E Q'(t) = 0, with Q' the previous denominator
+        real a[MAX_TERMS * 2 + 3][MAX_TERMS * 2 + 3];
+        for (int i = 0; i < needed; i++)
+        {
+            real x = reference[i];
+            real f = problem->function->f(x);
+            real g = f - leadValue(problem->form, x);
+            real u = powl(x, problem->form->shift);
+            real t = powl(x, problem->form->step);
+            real w = problem->relative ? fabsl(f) : 1;
+            real sign = (i & 1) ? -1 : 1;
+            real fixedPart = 0, power = 1;
+            int column = 0;
+            for (int j = 0; j < fit->numP; j++, power *= t)
+            {
+                if (j < fixed)
+                    fixedPart += fit->p[j] * power;
+                else
+                    a[i][column++] = u * power;
+            }
+            power = t;
+            for (int j = 1; j <= fit->degreeQ; j++, power *= t)
+                a[i][column++] = -g * power;
+            a[i][column++] = -sign * w * evaluatePoly(fit->q, fit->degreeQ + 1, t);
+            a[i][column] = g - u * fixedPart;
+        }
+        if (!solveLinear(a, needed))
+            return 0;
+        int column = 0;
+        for (int j = fixed; j < fit->numP; j++)
+            fit->p[j] = a[column++][needed];
+        for (int j = 1; j <= fit->degreeQ; j++)
+            fit->q[j] = a[column++][needed];
+        fit->levelled = fabsl(a[column][needed]);
+
+        real maxError;
+        int count = findExtrema(problem, fit, extremaPoints, extremaErrors, &maxError);
+        if (maxError < bestError)
+        {
+            best = *fit;
+            bestError = maxError;
+            stalls = 0;
+        }
+        else if (++stalls >= MAX_STALLS)
+            break;
+        if (count < needed)
+            break; // Fewer alternations than unknowns: the fit is as good as the grid can tell
+        selectExtrema(extremaPoints, extremaErrors, count, needed);
+        memcpy(reference, extremaPoints, needed * sizeof(real));
+        if (maxError <= fit->levelled * (1 + 1e-4L) && iteration > 0)
+            break;
+    }
+    *fit = best;
+    return bestError < INFINITY;
+}
+
+// Largest error of the fit over the interval
+static real measureError(const Problem *problem, const Fit *fit, int evaluated)
+{
+    real worst = 0;
+    for (int k = 0; k <= GRID_POINTS * 4; k++)
+    {
+        real x = problem->low + (problem->high - problem->low) * k / (GRID_POINTS * 4);
+        real e = fabsl(evaluated ? evaluatedErrorAt(problem, fit, x) : errorAt(problem, fit, x));
+        if (e > worst)
+            worst = e;
+    }
+    if (!evaluated)
+    {
+        static real points[GRID_POINTS + 1], errors[GRID_POINTS + 1];
+        real extremum;
+        findExtrema(problem, fit, points, errors, &extremum);
+        if (extremum > worst)
+            worst = extremum;
+    }
+    return worst;
+}
+
+// Fit numP coefficients of P over a denominator of degree degreeQ, then round them: polynomial
+// coefficients one at a time from the lowest, refitting the higher ones after each rounding
+static int fitRounded(const Problem *problem, int numP, int degreeQ, Fit *fit)
+{
+    memset(fit, 0, sizeof(*fit));
+    fit->numP = numP;
+    fit->degreeQ = degreeQ;
+    if (!remez(problem, fit, 0))
+        return 0;
+    real levelled = fit->levelled;
+    for (int j = 0; j < numP; j++)
+    {
+        fit->p[j] = roundCoefficient(problem, fit->p[j]);
+        if (degreeQ == 0 && j + 1 < numP && !remez(problem, fit, j + 1))
+            return 0;
+    }
+    for (int j = 1; j <= degreeQ; j++)
+        fit->q[j] = roundCoefficient(problem, fit->q[j]);
+    fit->levelled = levelled;
+    fit->maxError = measureError(problem, fit, 0);
+    fit->evaluatedError = measureError(problem, fit, 1);
+    return 1;
+}
+
+// Multiply-adds needed to evaluate P (and Q) by Horner's rule, divisions counted as DIVISION_COST
+static int fitCost(const Fit *fit)
+{
+    return fit->numP - 1 + (fit->degreeQ > 0 ? fit->degreeQ + DIVISION_COST : 0);
+}
+
+// Find the cheapest fit whose rounded error is within target; returns 0 if none is
+static int searchFit(const Problem *problem, double target, int rational, int maxTerms, Fit *best)
+{
+    int found = 0;
+    for (int numP = 1; numP <= maxTerms && !found; numP++)
+    {
+        Fit fit;
+        if (fitRounded(problem, numP, 0, &fit) && fit.maxError <= target)
+        {
+            *best = fit;
+            found = 1;
+        }
+    }
+    if (!rational)
+        return found;
+
+    for (int cost = 1 + DIVISION_COST; cost < (found ? fitCost(best) : maxTerms + DIVISION_COST); cost++)
+    {
+        for (int degreeQ = 1; degreeQ <= cost - DIVISION_COST; degreeQ++)
+        {
+            int numP = cost - DIVISION_COST - degreeQ + 1;
+            Fit fit;
+            if (numP >= 1 && numP <= maxTerms && fitRounded(problem, numP, degreeQ, &fit) && fit.maxError <= target)
+            {
+                *best = fit;
+                return 1;
+            }
+        }
+    }
+    return found;
+}
+
+// Print a coefficient so that it reads back exactly
+static void printCoefficient(FILE *out, const Problem *problem, real c)
+{
+    if (problem->isFloat)
+        fprintf(out, "K(%.9ef)", (double)(float)c);
+    else
+        fprintf(out, "K(%.17e)", (double)c);
+}
+
+// Print c[0] + t * (c[1] + t * (...)) as nested MADD(t, ..., K(c[0])) for any multiply-add and constant
+static void printHorner(FILE *out, const Problem *problem, const char *name, const real *c, int n)
+{
+    fprintf(out, "#define %s(t, MADD, K) \\\n    ", name);
+    if (n == 1)
+    {
+        printCoefficient(out, problem, c[0]);
+        fprintf(out, "\n");
+        return;
+    }
+    for (int j = 1; j < n; j++)
+        fprintf(out, "MADD(t, ");
+    fprintf(out, "\\\n        ");
+    printCoefficient(out, problem, c[n - 1]);
+    fprintf(out, ", \\\n");
+    for (int j = n - 2; j >= 0; j--)
+    {
+        fprintf(out, "        ");
+        printCoefficient(out, problem, c[j]);
+        fprintf(out, j > 0 ? "), \\\n" : ")\n");
+    }
+}
+
+// Print the macros of one kernel with a comment describing it
+static void printKernel(FILE *out, const char *name, const Problem *problem, const Fit *fit, const char *comment)
+{
+    const char *variable = problem->form->step == 2 ? "x^2" : "x";
+    fprintf(out, "// %s: %s(x) = ", name, problem->function->name);
+    if (fit->degreeQ > 0)
+    {
+        char description[64];
+        snprintf(description, sizeof(description), "%s", problem->form->description);
+        char *p = strstr(description, "P(");
+        if (p != NULL)
+            *p = '\0';
+        fprintf(out, "%s%s_POLY(%s) / %s_DENOMINATOR(%s)", description, name, variable, name, variable);
+    }
+    else
+    {
+        const char *p = strstr(problem->form->description, "P(");
+        fprintf(out, "%.*s%s_POLY(%s)", (int)(p - problem->form->description), problem->form->description, name, variable);
+    }
+    fprintf(out, " on [%.17g, %.17g]\n", (double)problem->low, (double)problem->high);
+    fprintf(out, "// %d multiply-add(s)%s, %s error %.2Lg (%.2Lg evaluated in %s)\n", fitCost(fit),
+            fit->degreeQ > 0 ? " and a division" : "", problem->relative ? "relative" : "absolute", fit->maxError,
+            fit->evaluatedError, problem->isFloat ? "float" : "double");
+    if (comment != NULL)
+        fprintf(out, "// Used by %s\n", comment);
+
+    char macro[64];
+    snprintf(macro, sizeof(macro), "%s_POLY", name);
+    printHorner(out, problem, macro, fit->p, fit->numP);
+    if (fit->degreeQ > 0)
+    {
+        snprintf(macro, sizeof(macro), "%s_DENOMINATOR", name);
+        printHorner(out, problem, macro, fit->q, fit->degreeQ + 1);
+    }
+}
+
+static const TargetFunction *findFunction(const char *name)
+{
+    for (size_t i = 0; i < sizeof(targetFunctions) / sizeof(targetFunctions[0]); i++)
+        if (strcmp(targetFunctions[i].name, name) == 0)
+            return &targetFunctions[i];
+    return NULL;
+}
+
+static const Form *findForm(const char *name)
+{
+    for (size_t i = 0; i < sizeof(forms) / sizeof(forms[0]); i++)
+        if (strcmp(forms[i].name, name) == 0)
+            return &forms[i];
+    return NULL;
+}
+
+// Write MathCoefficients.h for every kernel in kernelSpecs
+static int printHeader(FILE *out, int maxTerms)
+{
+    fprintf(out, "#ifndef MATH_COEFFICIENTS_H\n#define MATH_COEFFICIENTS_H\n\n");
+    fprintf(out, "// Generated by remez.c (./remez --header > MathCoefficients.h); edit the kernel list there, not this file.\n");
+    fprintf(out, "// Every kernel is the lowest-degree minimax polynomial whose error stays within %.2g in double\n",
+            DOUBLE_TARGET);
+    fprintf(out, "// (%.2g for the FAST_ kernels in float), with its coefficients rounded to that precision.\n", FLOAT_TARGET);
+    fprintf(out, "// NAME_POLY(t, MADD, K) evaluates the polynomial by Horner's rule with the multiply-add MADD(a, b, c)\n");
+    fprintf(out, "// = a * b + c and constants K(c), so scalar and vector code expand the same definition:\n");
+    fprintf(out, "// SIN_POLY(x2, SCALAR_FMA, SCALAR_SET1) or SIN_POLY(x2, V_FMA, V_SET1). t must be a variable.\n\n");
+    fprintf(out, "#define SCALAR_FMA(a, b, c) ((a) * (b) + (c))\n#define SCALAR_SET1(c) (c)\n");
+
+    for (size_t i = 0; i < sizeof(kernelSpecs) / sizeof(kernelSpecs[0]); i++)
+    {
+        const KernelSpec *spec = &kernelSpecs[i];
+        Problem problem = {findFunction(spec->function), findForm(spec->form), spec->low, spec->high, spec->relative,
+                           spec->isFloat};
+        Fit fit;
+        if (!searchFit(&problem, spec->target, 0, maxTerms, &fit))
+        {
+            fprintf(stderr, "%s: no fit within %g with up to %d terms\n", spec->name, spec->target, maxTerms);
+            return 0;
+        }
+        fprintf(out, "\n");
+        printKernel(out, spec->name, &problem, &fit, spec->comment);
+    }
+    fprintf(out, "\n#endif\n");
+    return 1;
+}
+
+static void printRemezUsage(const char *program)
+{
+    fprintf(stderr, "Usage: %s --header [--max-terms N]\n", program);
+    fprintf(stderr, "       %s --function F --interval LOW,HIGH --error E [options]\n", program);
+    fprintf(stderr, "  --header           Print MathCoefficients.h for every kernel the engine uses\n");
+    fprintf(stderr, "  --function F       sin, cos, tan, exp, expm1, sinh, cosh, tanh, asin, atan, log1p or\n");
+    fprintf(stderr, "                     lnratio (ln((1 + x) / (1 - x)))\n");
+    fprintf(stderr, "  --interval L,H     Interval to approximate on\n");
+    fprintf(stderr, "  --error E          Largest acceptable error after rounding the coefficients\n");
+    fprintf(stderr, "  --form F           poly: P(x) (default), odd: x + x^3 P(x^2), even: 1 + x^2 P(x^2),\n");
+    fprintf(stderr, "                     exp: 1 + x + x^2 P(x), lnratio: 2x + x^3 P(x^2)\n");
+    fprintf(stderr, "  --absolute         Minimize the absolute error instead of the relative error\n");
+    fprintf(stderr, "  --float            Round the coefficients to float instead of double\n");
+    fprintf(stderr, "  --rational         Also try P/Q, a division counting as %d multiply-adds\n", DIVISION_COST);
+    fprintf(stderr, "  --name NAME        Macro prefix (default: the function name in capitals)\n");
+    fprintf(stderr, "  --max-terms N      Most coefficients to try (default 20)\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *functionName = NULL, *formName = "poly", *name = NULL;
+    double low = 0, high = 0, target = 0;
+    int header = 0, relative = 1, isFloat = 0, rational = 0, maxTerms = 20, haveInterval = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        int takesValue = 1;
+        if (strcmp(arg, "--function") == 0 && value)
+            functionName = value;
+        else if (strcmp(arg, "--interval") == 0 && value)
+            haveInterval = sscanf(value, "%lf,%lf", &low, &high) == 2;
+        else if (strcmp(arg, "--error") == 0 && value)
+            target = atof(value);
+        else if (strcmp(arg, "--form") == 0 && value)
+            formName = value;
+        else if (strcmp(arg, "--name") == 0 && value)
+            name = value;
+        else if (strcmp(arg, "--max-terms") == 0 && value)
+            maxTerms = atoi(value);
+        else
+        {
+            takesValue = 0;
+            if (strcmp(arg, "--header") == 0)
+                header = 1;
+            else if (strcmp(arg, "--absolute") == 0)
+                relative = 0;
+            else if (strcmp(arg, "--float") == 0)
+                isFloat = 1;
+            else if (strcmp(arg, "--rational") == 0)
+                rational = 1;
+            else
+            {
+                printRemezUsage(argv[0]);
+                return 1;
+            }
+        }
+        i += takesValue;
+    }
+    if (maxTerms < 1 || maxTerms > MAX_TERMS)
+    {
+        printRemezUsage(argv[0]);
+        return 1;
+    }
+    if (header)
+        return printHeader(stdout, maxTerms) ? 0 : 1;
+
+    const TargetFunction *function = functionName ? findFunction(functionName) : NULL;
+    const Form *form = findForm(formName);
+    if (function == NULL || form == NULL || !haveInterval || !(low < high) || !(target > 0))
+    {
+        printRemezUsage(argv[0]);
+        return 1;
+    }
+
+    Problem problem = {function, form, low, high, relative, isFloat};
+    Fit fit;
+    if (!searchFit(&problem, target, rational, maxTerms, &fit))
+    {
+        fprintf(stderr, "No fit within %g with up to %d terms\n", target, maxTerms);
+        return 1;
+    }
+    char upper[64];
+    snprintf(upper, sizeof(upper), "%s", name ? name : function->name);
+    for (char *c = upper; *c; c++)
+        if (*c >= 'a' && *c <= 'z')
+            *c = (char)(*c - 'a' + 'A');
+    printKernel(stdout, upper, &problem, &fit, NULL);
+    return 0;
+}
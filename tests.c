@@ -0,0 +1,1353 @@
+#include "ASTFunctions.h"
+#include "Bytecode.h"
+#include "Jit.h"
+#include "Gradient.h"
+#include "Numerics.h"
+#include "Batch.h"
+#include "Sheet.h"
+#include "ExpressionCache.h"
+#include "NumberFormat.h"
+#include "calc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+// Regression tests for the engine, the batch and interactive front ends and the library.
+// Build with calc.c, which provides the library; pass the path of a built calculator to also
+// run it in batch and interactive mode:
+//   gcc -O2 -pthread -o tests tests.c calc.c -lm && ./tests ./calculator
+
+#define COLUMN_ROWS 1003 // Rows of the columnar checks, not a multiple of any block size
+#define MAX_REPORTS 50   // Failures printed before the rest are only counted
+
+static long checks;
+static long failures;
+static const char *calculatorPath;   // Calculator to run, or NULL to test the engine only
+static const char *scratchDirectory; // Where temporary input files go
+
+// Count a check and report it if it failed
+static void expect(int ok, const char *format, ...)
+{
+    checks++;
+    if (ok)
+        return;
+    if (failures++ < MAX_REPORTS)
+    {
+        va_list args;
+        va_start(args, format);
+        printf("FAIL: ");
+        vprintf(format, args);
+        printf("\n");
+        va_end(args);
+    }
+}
+
+// Distance in units in the last place between two doubles (0 for two NaNs, huge for NaN against a number)
+static inline double ulpDistance(double a, double b)
+{
+    if (isnan(a) || isnan(b))
+        return isnan(a) && isnan(b) ? 0.0 : INFINITY;
+    if (a == b)
+        return signbit(a) == signbit(b) ? 0.0 : 1.0; // +0 against -0 counts as one step
+    int64_t ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    if (ia < 0)
+        ia = INT64_MIN - ia; // Order negative doubles below positive ones
+    if (ib < 0)
+        ib = INT64_MIN - ib;
+    return ia > ib ? (double)((uint64_t)ia - (uint64_t)ib) : (double)((uint64_t)ib - (uint64_t)ia);
+}
+
+// Whether two doubles are the same value, NaNs included (any NaN matches any NaN)
+static inline int sameValue(double a, double b)
+{
+    return isnan(a) ? isnan(b) : memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+static inline double randomIn(double low, double high)
+{
+    return low + (high - low) * drand48();
+}
+
+// Path of the temporary input file of this process
+static void scratchPath(char *path, size_t size)
+{
+    snprintf(path, size, "%s/calc-tests-%d.txt", scratchDirectory, (int)getpid());
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Kernels
+//
+// Scalar kernels are checked against the accurate tier (the C library) within each tier's documented
+// error, and vector kernels against the scalar ones.
+
+#define KERNEL_SAMPLES 20000 // Random arguments per kernel, tier and SIMD level
+
+// Arguments each registry function is tested on: a linear range, or a logarithmic one when log is set
+typedef struct KernelDomain
+{
+    double low, high;
+    int log;
+} KernelDomain;
+
+// Indexed by FunctionId; binary functions use the domain for both arguments
+static const KernelDomain kernelDomains[FN_COUNT] = {
+    {-1e3, 1e3, 0},      // sin
+    {-1e3, 1e3, 0},      // cos
+    {-1e3, 1e3, 0},      // tan
+    {1e-300, 1e300, 1},  // ln
+    {-700, 700, 0},      // exp
+    {-700, 700, 0},      // sinh
+    {-700, 700, 0},      // cosh
+    {-20, 20, 0},        // tanh
+    {-1, 1, 0},          // asin
+    {-1, 1, 0},          // acos
+    {-1e3, 1e3, 0},      // atan
+    {-1e10, 1e10, 0},    // asinh
+    {1, 1e300, 1},       // acosh
+    {-1, 1, 0},          // atanh
+    {0.01, 10, 0},       // pow
+    {1.5, 1e6, 1},       // log_base (a away from 1, where ln(a) ~ 0 amplifies the error)
+};
+
+// Standard kernels against the C library, in ULP (pow: per unit of |b * ln(a)|)
+static const double standardUlps[FN_COUNT] = {2, 2, 3, 2, 1, 4, 2, 4, 2, 1, 3, 2, 1, 3, 3, 4};
+
+// Standard vector kernels against the scalar ones, as listed in MathFunctionsSIMD.h
+static const double vectorUlps[FN_COUNT] = {1, 1, 3, 1, 1, 4, 4, 4, 2, 1, 1, 1, 1, 1, 2, 2};
+
+// Fast kernels against the C library, relative, as listed in MathFunctionsFast.h
+static const double fastErrors[FN_COUNT] = {1.4e-7, 1.4e-7, 2.1e-7, 1.3e-7, 8.2e-8, 3.6e-7, 2.4e-7, 2.3e-7,
+                                            1.7e-7, 1.7e-7, 1.7e-7, 1.3e-7, 1.3e-7, 1.3e-7, 1.4e-7, 1.6e-7};
+
+static const char *const simdNames[] = {"scalar", "AVX2", "AVX-512"};
+static const char *const tierNames[] = {"standard", "fast", "accurate"};
+
+static double randomArgument(FunctionId function)
+{
+    const KernelDomain *domain = &kernelDomains[function];
+    if (domain->log)
+        return exp(randomIn(log(domain->low), log(domain->high)));
+    return randomIn(domain->low, domain->high);
+}
+
+// Error growth of pow: its error is relative to b * ln(a), not to the result
+static double errorScale(FunctionId function, double a, double b)
+{
+    return function == FN_POW ? fmax(1.0, fabs(b * log(fabs(a)))) : 1.0;
+}
+
+// Whether value is within allowed of the C library's result for a kernel of the given tier
+static int closeToReference(PrecisionTier tier, FunctionId function, double reference, double value, double allowed)
+{
+    if (isnan(reference) || isinf(reference) || reference == 0.0)
+        return sameValue(reference, value);
+    if (tier == PRECISION_FAST)
+        return fabs(value - reference) <= allowed * fabs(reference) ||
+               (function == FN_LN && fabs(value - reference) <= 4e-8); // Absolute near x = 1
+    return ulpDistance(reference, value) <= allowed;
+}
+
+// Whether a vector result agrees with the scalar kernel of the same tier
+static int closeToScalar(PrecisionTier tier, FunctionId function, double scalar, double vector, double scale)
+{
+    if (tier == PRECISION_ACCURATE || isnan(scalar) || isinf(scalar) || scalar == 0.0)
+        return sameValue(scalar, vector);
+    if (tier == PRECISION_FAST)
+        return fabs(vector - scalar) <= 2 * fastErrors[function] * scale * fabs(scalar) ||
+               (function == FN_LN && fabs(vector - scalar) <= 8e-8);
+    return ulpDistance(scalar, vector) <= vectorUlps[function] * scale;
+}
+
+// Random arguments of one function: scalar kernels against the C library, vector kernels against the scalar ones
+static void testKernelSamples(PrecisionTier tier, FunctionId function, SimdLevel level)
+{
+    const FunctionKernels *kernels = &kernelTables[tier].functions[function];
+    const FunctionKernels *reference = &kernelTables[PRECISION_ACCURATE].functions[function];
+    int binary = functionRegistry[function].arity == 2;
+    double *a = (double *)malloc(KERNEL_SAMPLES * sizeof(double));
+    double *b = (double *)malloc(KERNEL_SAMPLES * sizeof(double));
+    double *out = (double *)malloc(KERNEL_SAMPLES * sizeof(double));
+    srand48(1000 * function + tier);
+    for (int i = 0; i < KERNEL_SAMPLES; i++)
+    {
+        a[i] = randomArgument(function);
+        b[i] = binary ? randomArgument(function) : 0.0;
+    }
+    if (binary)
+        kernels->vectorBinary(a, b, out, KERNEL_SAMPLES);
+    else
+        kernels->vectorUnary(a, out, KERNEL_SAMPLES);
+
+    int reported = 0;
+    for (int i = 0; i < KERNEL_SAMPLES && reported < 3; i++)
+    {
+        double scale = errorScale(function, a[i], b[i]);
+        double scalar = binary ? kernels->binary(a[i], b[i]) : kernels->unary(a[i]);
+        double expected = binary ? reference->binary(a[i], b[i]) : reference->unary(a[i]);
+        double allowed = tier == PRECISION_FAST ? fastErrors[function] * 1.25 * scale
+                                                : tier == PRECISION_STANDARD ? standardUlps[function] * scale : 0.0;
+        int scalarOk = closeToReference(tier, function, expected, scalar, allowed);
+        int vectorOk = closeToScalar(tier, function, scalar, out[i], scale);
+        expect(scalarOk, "%s %s(%.17g, %.17g): scalar %.17g, C library %.17g", tierNames[tier],
+               functionRegistry[function].name, a[i], b[i], scalar, expected);
+        expect(vectorOk, "%s %s %s(%.17g, %.17g): vector %.17g, scalar %.17g", simdNames[level], tierNames[tier],
+               functionRegistry[function].name, a[i], b[i], out[i], scalar);
+        reported += !scalarOk + !vectorOk;
+    }
+    free(a);
+    free(b);
+    free(out);
+}
+
+// Arguments at which kernels are most likely to diverge: signed zeros, infinities, NaN, domain edges,
+// subnormals and the overflow thresholds
+static const double specialArguments[] = {0.0, -0.0, INFINITY, -INFINITY, NAN, 1.0, -1.0, 0.5, -0.5, 2.0, -2.0, 3.0,
+                                          1e-310, -1e-310, 0x1p-1022, 1e-20, -1e-20, 1e22, -1e22, 1e308, -1e308,
+                                          709.7, 710.0, -745.0, -746.0, 1.0000000000000002, 0.9999999999999999};
+#define NUM_SPECIAL_ARGUMENTS ((int)(sizeof(specialArguments) / sizeof(specialArguments[0])))
+
+// Special arguments: every vector result agrees with the scalar one, including the sign of zero and NaN
+static void testKernelSpecials(PrecisionTier tier, FunctionId function, SimdLevel level)
+{
+    const FunctionKernels *kernels = &kernelTables[tier].functions[function];
+    int binary = functionRegistry[function].arity == 2;
+    int count = binary ? NUM_SPECIAL_ARGUMENTS * NUM_SPECIAL_ARGUMENTS : NUM_SPECIAL_ARGUMENTS;
+    double *a = (double *)malloc(count * sizeof(double));
+    double *b = (double *)malloc(count * sizeof(double));
+    double *out = (double *)malloc(count * sizeof(double));
+    for (int i = 0; i < count; i++)
+    {
+        a[i] = specialArguments[binary ? i / NUM_SPECIAL_ARGUMENTS : i];
+        b[i] = binary ? specialArguments[i % NUM_SPECIAL_ARGUMENTS] : 0.0;
+    }
+    if (binary)
+        kernels->vectorBinary(a, b, out, count);
+    else
+        kernels->vectorUnary(a, out, count);
+    for (int i = 0; i < count; i++)
+    {
+        double scalar = binary ? kernels->binary(a[i], b[i]) : kernels->unary(a[i]);
+        expect(closeToScalar(tier, function, scalar, out[i], errorScale(function, a[i], b[i])),
+               "%s %s %s(%g, %g): vector %.17g, scalar %.17g", simdNames[level], tierNames[tier],
+               functionRegistry[function].name, a[i], b[i], out[i], scalar);
+    }
+    free(a);
+    free(b);
+    free(out);
+}
+
+// Known values far outside the random domains, such as arguments whose squares overflow
+static const struct
+{
+    FunctionId function;
+    double x, expected;
+} kernelValues[] = {
+    {FN_ASINH, 1e200, 461.2101657793691},
+    {FN_ASINH, -1e160, -369.10676205960726},
+    {FN_ASINH, 1.7976931348623157e308, 710.475860073944},
+    {FN_ACOSH, 1e200, 461.2101657793691},
+    {FN_ACOSH, 1e160, 369.10676205960726},
+    {FN_ACOSH, -1e160, NAN},
+};
+#define NUM_KERNEL_VALUES ((int)(sizeof(kernelValues) / sizeof(kernelValues[0])))
+
+// The known values, from the scalar and the vector kernel, within the tier's error
+static void testKernelValues(PrecisionTier tier, SimdLevel level)
+{
+    for (int i = 0; i < NUM_KERNEL_VALUES; i++)
+    {
+        FunctionId function = kernelValues[i].function;
+        const FunctionKernels *kernels = &kernelTables[tier].functions[function];
+        double x = kernelValues[i].x;
+        double scalar = kernels->unary(x);
+        double vector;
+        kernels->vectorUnary(&x, &vector, 1);
+        double allowed = tier == PRECISION_FAST       ? fastErrors[function]
+                         : tier == PRECISION_STANDARD ? standardUlps[function]
+                                                      : 1.0;
+        expect(closeToReference(tier, function, kernelValues[i].expected, scalar, allowed) &&
+                   closeToReference(tier, function, kernelValues[i].expected, vector, allowed),
+               "%s %s %s(%g): scalar %.17g, vector %.17g, expected %.17g", simdNames[level], tierNames[tier],
+               functionRegistry[function].name, x, scalar, vector, kernelValues[i].expected);
+    }
+}
+
+// Fused pairs: the pair kernels agree with the separate kernels of their functions, scalar and vector
+static void testPairKernels(PrecisionTier tier, SimdLevel level)
+{
+    for (int p = 0; p < NUM_FUSED_PAIRS; p++)
+    {
+        const PairKernels *pair = &kernelTables[tier].pairs[p];
+        FunctionId ids[2] = {fusedPairs[p].first, fusedPairs[p].second};
+        int count = KERNEL_SAMPLES + NUM_SPECIAL_ARGUMENTS;
+        double *x = (double *)malloc(count * sizeof(double));
+        double *first = (double *)malloc(count * sizeof(double));
+        double *second = (double *)malloc(count * sizeof(double));
+        srand48(77 + p);
+        for (int i = 0; i < count; i++)
+            x[i] = i < NUM_SPECIAL_ARGUMENTS ? specialArguments[i] : randomArgument(ids[0]);
+        pair->vectorKernel(x, first, second, count);
+        for (int i = 0; i < count; i++)
+        {
+            double scalar[2];
+            pair->kernel(x[i], &scalar[0], &scalar[1]);
+            double vector[2] = {first[i], second[i]};
+            for (int k = 0; k < 2; k++)
+            {
+                double single = kernelTables[tier].functions[ids[k]].unary(x[i]);
+                expect(closeToScalar(tier, ids[k], single, scalar[k], 1.0), "%s pair %s(%.17g): %.17g, alone %.17g",
+                       tierNames[tier], functionRegistry[ids[k]].name, x[i], scalar[k], single);
+                expect(closeToScalar(tier, ids[k], scalar[k], vector[k], 1.0),
+                       "%s %s pair %s(%.17g): vector %.17g, scalar %.17g", simdNames[level], tierNames[tier],
+                       functionRegistry[ids[k]].name, x[i], vector[k], scalar[k]);
+            }
+        }
+        free(x);
+        free(first);
+        free(second);
+    }
+}
+
+// Every kernel of every tier at every SIMD level the CPU supports
+static void testKernels(void)
+{
+    SimdLevel original = simdLevel();
+    for (int level = SIMD_SCALAR; level <= (int)detectSimdLevel(); level++)
+    {
+        setSimdLevel((SimdLevel)level);
+        for (int tier = 0; tier < PRECISION_TIER_COUNT; tier++)
+        {
+            for (int f = 0; f < FN_COUNT; f++)
+            {
+                testKernelSamples((PrecisionTier)tier, (FunctionId)f, (SimdLevel)level);
+                testKernelSpecials((PrecisionTier)tier, (FunctionId)f, (SimdLevel)level);
+            }
+            testKernelValues((PrecisionTier)tier, (SimdLevel)level);
+            testPairKernels((PrecisionTier)tier, (SimdLevel)level);
+        }
+    }
+    setSimdLevel(original);
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Evaluation
+
+// Expression with a known value
+typedef struct Example
+{
+    const char *text;
+    double value;
+} Example;
+
+static const Example examples[] = {
+    {"1+2*3", 7.0},
+    {"2^3^2", 512.0},
+    {"2-3^2", -7.0},
+    {"(1+2)*(3+4)", 21.0},
+    {"10/4-1", 1.5},
+    {"sin(0.5)^2+cos(0.5)^2", 1.0},
+    {"ln(exp(2))", 2.0},
+    {"pow(2, 10)", 1024.0},
+    {"log_base(2, 8)", 3.0},
+    {"atan(1)*4", 3.141592653589793},
+    {"0x1F + 0x1.8p-3", 31.1875},
+    {"2e-9*1E+9", 2.0},
+    {".5+1.5", 2.0},
+    {"sinh(1)*cosh(1)", 1.8134302039235095},
+    {"tanh(0.5)", 0.46211715726000974},
+    {"asinh(-100000)", -12.206072645555174},
+    {"acosh(1)", 0.0},
+    {"atanh(1e-17)", 1e-17},
+    {"asin(1)+acos(1)", 1.5707963267948966},
+    {"tan(1)", 1.5574077246549023},
+    {"exp(-745.2)", 4.9406564584124654e-324},
+};
+
+// Malformed expressions: each must fail with a message and a position inside the text
+static const char *const malformed[] = {"1+", "(1+2", "1+2)", "sin(", "foo(1)", "sin 1", "pow(1)", "1.2.3", "0x1p",
+                                        "1e5.3", "", "2**3", "log_base(1,2,3)", "x+1"};
+
+// The tree, bytecode, JIT and cache paths give the same results and the same errors
+static void testExamples(void)
+{
+    Arena arena;
+    arenaInit(&arena, ARENA_DEFAULT_SIZE);
+    ExpressionCache cache;
+    cacheInit(&cache, CACHE_DEFAULT_BUDGET, NULL);
+    for (size_t i = 0; i < sizeof(examples) / sizeof(examples[0]); i++)
+    {
+        const Example *example = &examples[i];
+        double tree = NAN;
+        ParseError error = {0};
+        int ok = evaluateExpression(example->text, &arena, &tree, &error);
+        arenaReset(&arena);
+        expect(ok && ulpDistance(tree, example->value) <= 2, "%s = %.17g, expected %.17g (%s)", example->text, tree,
+               example->value, error.message);
+
+        Program program;
+        initProgram(&program);
+        ok = compileExpression(example->text, NULL, &arena, &program, &error);
+        arenaReset(&arena);
+        expect(ok, "%s does not compile: %s", example->text, error.message);
+        if (!ok)
+            continue;
+        double interpreted = runProgram(&program, NULL);
+        expect(sameValue(interpreted, tree), "%s: program %.17g, tree %.17g", example->text, interpreted, tree);
+        JitCode jit;
+        jitCompile(&program, &jit);
+        double native = jitRun(&jit, &program, NULL);
+        expect(sameValue(native, tree), "%s: JIT %.17g, tree %.17g", example->text, native, tree);
+        jitFree(&jit);
+        freeProgram(&program);
+
+        for (int pass = 0; pass < 2; pass++) // Miss, then hit
+        {
+            double cached = NAN;
+            ok = cacheEvaluate(&cache, example->text, strlen(example->text), &arena, &cached, &error);
+            expect(ok && sameValue(cached, tree), "%s: cache pass %d %.17g, tree %.17g", example->text, pass, cached,
+                   tree);
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++)
+    {
+        const char *text = malformed[i];
+        int length = (int)strlen(text);
+        double result;
+        ParseError treeError = {0};
+        ParseError cacheError = {0};
+        int ok = evaluateExpression(text, &arena, &result, &treeError);
+        arenaReset(&arena);
+        expect(!ok && treeError.message[0] != '\0' && treeError.position >= 0 && treeError.position <= length,
+               "'%s' should fail, got %d '%s' at %d", text, ok, treeError.message, treeError.position);
+        ok = cacheEvaluate(&cache, text, (size_t)length, &arena, &result, &cacheError);
+        expect(!ok && strcmp(treeError.message, cacheError.message) == 0 && treeError.position == cacheError.position,
+               "'%s': cache error '%s' at %d, tree '%s' at %d", text, cacheError.message, cacheError.position,
+               treeError.message, treeError.position);
+    }
+    cacheFree(&cache);
+    arenaFree(&arena);
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Columns
+
+// Expressions of x and y (each reads both) evaluated by every path in every tier
+static const char *const formulas[] = {
+    "x*y + sin(x)",
+    "sin(x)*cos(x) - sinh(y)*cosh(y)",
+    "pow(y, x/4) + log_base(y + 1, 3)",
+    "(x*x + y)^3 / (1 + x^2)",
+    "exp(-x*x) * tanh(y) + atan(x/y)",
+    "asinh(x*1e3) + acosh(y + 1) + atanh(x/10)",
+    "asin(x/5) * acos(-x/5) + ln(y)",
+    "tan(x) - -y",
+};
+#define NUM_FORMULAS ((int)(sizeof(formulas) / sizeof(formulas[0])))
+
+// Rows of x and y the formulas are evaluated on, including both signed zeros
+static void fillColumns(double *x, double *y)
+{
+    srand48(5);
+    for (int i = 0; i < COLUMN_ROWS; i++)
+    {
+        x[i] = randomIn(-5, 5);
+        y[i] = randomIn(0.1, 4);
+    }
+    x[0] = 0.0;
+    x[1] = -0.0;
+}
+
+// Compile one of the formulas with x as variable 0 and y as variable 1
+static int compileFormula(int f, PrecisionTier tier, Arena *arena, Program *program)
+{
+    VariableTable variables;
+    memset(&variables, 0, sizeof(variables));
+    addVariable(&variables, "x", 1);
+    addVariable(&variables, "y", 1);
+    initProgram(program);
+    program->tier = tier;
+    ParseError error = {0};
+    int ok = compileExpression(formulas[f], &variables, arena, program, &error);
+    arenaReset(arena);
+    expect(ok, "%s does not compile: %s", formulas[f], error.message);
+    return ok;
+}
+
+// Largest difference allowed between the scalar kernels and the vector kernels the columns use, relative
+static double columnTolerance(PrecisionTier tier)
+{
+    return tier == PRECISION_FAST ? 1e-5 : tier == PRECISION_STANDARD ? 1e-12 : 0.0;
+}
+
+// Whether a columnar result agrees with the scalar one
+static int closeToRow(PrecisionTier tier, double row, double column)
+{
+    return sameValue(row, column) || fabs(column - row) <= columnTolerance(tier) * fmax(1.0, fabs(row));
+}
+
+// runProgram, the JIT and evaluateColumns agree on every row
+static void testColumns(void)
+{
+    double *x = (double *)malloc(COLUMN_ROWS * sizeof(double));
+    double *y = (double *)malloc(COLUMN_ROWS * sizeof(double));
+    double *out = (double *)malloc(COLUMN_ROWS * sizeof(double));
+    fillColumns(x, y);
+    const double *columns[2] = {x, y};
+    Arena arena;
+    arenaInit(&arena, ARENA_DEFAULT_SIZE);
+
+    for (int tier = 0; tier < PRECISION_TIER_COUNT; tier++)
+    {
+        for (int f = 0; f < NUM_FORMULAS; f++)
+        {
+            Program program;
+            if (!compileFormula(f, (PrecisionTier)tier, &arena, &program))
+                continue;
+            JitCode jit;
+            jitCompile(&program, &jit);
+            expect(evaluateColumns(&program, columns, out, COLUMN_ROWS), "evaluateColumns failed");
+            int reported = 0;
+            for (int i = 0; i < COLUMN_ROWS && reported < 3; i++)
+            {
+                double values[2] = {x[i], y[i]};
+                double interpreted = runProgram(&program, values);
+                double native = jitRun(&jit, &program, values);
+                int ok1 = sameValue(native, interpreted);
+                int ok2 = closeToRow((PrecisionTier)tier, interpreted, out[i]);
+                expect(ok1, "%s %s at (%g, %g): program %.17g, JIT %.17g", tierNames[tier], formulas[f], x[i], y[i],
+                       interpreted, native);
+                expect(ok2, "%s %s at (%g, %g): columns %.17g, program %.17g", tierNames[tier], formulas[f], x[i],
+                       y[i], out[i], interpreted);
+                reported += !ok1 + !ok2;
+            }
+            jitFree(&jit);
+            freeProgram(&program);
+        }
+    }
+    arenaFree(&arena);
+    free(x);
+    free(y);
+    free(out);
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Gradients
+
+// runGradient and gradientColumns agree with each other, with runProgram and with central differences
+static void testGradients(void)
+{
+    double *x = (double *)malloc(COLUMN_ROWS * sizeof(double));
+    double *y = (double *)malloc(COLUMN_ROWS * sizeof(double));
+    double *out = (double *)malloc(COLUMN_ROWS * sizeof(double));
+    double *gx = (double *)malloc(COLUMN_ROWS * sizeof(double));
+    double *gy = (double *)malloc(COLUMN_ROWS * sizeof(double));
+    fillColumns(x, y);
+    const double *columns[2] = {x, y};
+    double *gradients[2] = {gx, gy};
+    Arena arena;
+    arenaInit(&arena, ARENA_DEFAULT_SIZE);
+
+    for (int tier = 0; tier < PRECISION_TIER_COUNT; tier++)
+    {
+        for (int f = 0; f < NUM_FORMULAS; f++)
+        {
+            Program program;
+            if (!compileFormula(f, (PrecisionTier)tier, &arena, &program))
+                continue;
+            Tape tape;
+            expect(compileTape(&program, &tape), "%s has no tape", formulas[f]);
+            expect(gradientColumns(&tape, columns, out, gradients, COLUMN_ROWS), "gradientColumns failed");
+            int reported = 0;
+            for (int i = 0; i < COLUMN_ROWS && reported < 3; i++)
+            {
+                double values[2] = {x[i], y[i]};
+                double interpreted = runProgram(&program, values);
+                double gradient[2];
+                double value = runGradient(&tape, values, gradient);
+                int ok1 = sameValue(value, interpreted) && closeToRow((PrecisionTier)tier, interpreted, out[i]);
+                int ok2 = closeToRow((PrecisionTier)tier, gradient[0], gx[i]) &&
+                          closeToRow((PrecisionTier)tier, gradient[1], gy[i]);
+                expect(ok1, "%s %s at (%g, %g): tape %.17g, column tape %.17g, program %.17g", tierNames[tier],
+                       formulas[f], x[i], y[i], value, out[i], interpreted);
+                expect(ok2, "%s %s at (%g, %g): column gradient (%.17g, %.17g), scalar (%.17g, %.17g)",
+                       tierNames[tier], formulas[f], x[i], y[i], gx[i], gy[i], gradient[0], gradient[1]);
+                reported += !ok1 + !ok2;
+
+                // Central differences, skipping the rows near a singular point of the formula
+                double h = 1e-6;
+                for (int v = 0; v < 2 && tier == PRECISION_ACCURATE && i % 10 == 0; v++)
+                {
+                    double up[2] = {x[i], y[i]};
+                    double down[2] = {x[i], y[i]};
+                    up[v] += h;
+                    down[v] -= h;
+                    double estimate = (runProgram(&program, up) - runProgram(&program, down)) / (2 * h);
+                    if (!isfinite(estimate) || fabs(estimate) > 1e6)
+                        continue;
+                    int ok3 = fabs(estimate - gradient[v]) <= 1e-5 * fmax(1.0, fabs(gradient[v]));
+                    expect(ok3, "%s d/d%c at (%g, %g): %.17g, finite difference %.17g", formulas[f], "xy"[v], x[i],
+                           y[i], gradient[v], estimate);
+                    reported += !ok3;
+                }
+            }
+            freeTape(&tape);
+            freeProgram(&program);
+        }
+    }
+
+    // grad(total, price, rate) of the interactive mode, through the definition of total
+    Sheet sheet;
+    sheetInit(&sheet);
+    ParseError error = {0};
+    sheetAssign(&sheet, "total", 5, "price * qty * (1 + rate)", &arena, &error);
+    sheetAssign(&sheet, "price", 5, "10", &arena, &error);
+    sheetAssign(&sheet, "qty", 3, "3", &arena, &error);
+    sheetAssign(&sheet, "rate", 4, "0.05", &arena, &error);
+    const char *names[2] = {"price", "rate"};
+    double result = NAN;
+    double gradient[2] = {0};
+    expect(sheetGradient(&sheet, "total", names, 2, &arena, &result, gradient, &error) && fabs(result - 31.5) < 1e-12 &&
+               fabs(gradient[0] - 3.15) < 1e-12 && fabs(gradient[1] - 30.0) < 1e-12,
+           "grad(total, price, rate) = %.17g, %.17g, %.17g (%s)", result, gradient[0], gradient[1], error.message);
+    sheetFree(&sheet);
+
+    arenaFree(&arena);
+    free(x);
+    free(y);
+    free(out);
+    free(gx);
+    free(gy);
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Number literals
+
+// Literals convert exactly like strtod, including the cases that miss the fast path
+static void testLiterals(void)
+{
+    static const char *const literals[] = {"0.1", "123456789012345678901234567890", "1e-320", "2.2250738585072011e-308",
+                                           "9007199254740993", "0x1.fffffffffffff8p1023", "0x1.8p-3", "1e400", ".5e1",
+                                           "0x1F", "1E+300", "2e-9", "4.9e-324", "1e-400"};
+    Arena arena;
+    arenaInit(&arena, ARENA_DEFAULT_SIZE);
+    for (size_t i = 0; i < sizeof(literals) / sizeof(literals[0]); i++)
+    {
+        double result = NAN;
+        ParseError error = {0};
+        int ok = evaluateExpression(literals[i], &arena, &result, &error);
+        arenaReset(&arena);
+        expect(ok && sameValue(result, strtod(literals[i], NULL)), "%s reads as %.17g, strtod %.17g", literals[i],
+               result, strtod(literals[i], NULL));
+    }
+
+    // Random decimal literals, some of them long enough to need strtod
+    char text[64];
+    srand48(13);
+    for (int i = 0; i < 100000; i++)
+    {
+        snprintf(text, sizeof(text), "%.*e", (int)(lrand48() % 20), randomIn(0, 10) * pow(10.0, lrand48() % 600 - 300));
+        double result = NAN;
+        ParseError error = {0};
+        int ok = evaluateExpression(text, &arena, &result, &error);
+        arenaReset(&arena);
+        expect(ok && sameValue(result, strtod(text, NULL)), "%s reads as %.17g, strtod %.17g", text, result,
+               strtod(text, NULL));
+    }
+    arenaFree(&arena);
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Result formats
+
+// formatShortest reads back as the same double, and formatFixed prints the digits of printf
+static void testFormatting(void)
+{
+    char buffer[FORMAT_BUFFER_SIZE];
+    char expected[FORMAT_BUFFER_SIZE];
+    srand48(11);
+    for (int i = 0; i < 200000; i++)
+    {
+        uint64_t bits = ((uint64_t)lrand48() << 33) ^ ((uint64_t)lrand48() << 2) ^ (uint64_t)lrand48();
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if (isnan(value))
+            continue;
+        buffer[formatShortest(value, buffer)] = '\0';
+        expect(sameValue(strtod(buffer, NULL), value), "formatShortest(%.17g) = %s does not read back", value, buffer);
+
+        double moderate = randomIn(-1e6, 1e6) * pow(10.0, (double)(lrand48() % 12) - 6);
+        int precision = (int)(lrand48() % 16);
+        buffer[formatFixed(moderate, precision, buffer)] = '\0';
+        snprintf(expected, sizeof(expected), "%.*f", precision, moderate);
+        expect(strcmp(buffer, expected) == 0, "formatFixed(%.17g, %d) = %s, printf %s", moderate, precision, buffer,
+               expected);
+    }
+    static const struct
+    {
+        double value;
+        const char *text;
+    } shortest[] = {{0.1, "0.1"}, {1e-9, "1e-9"}, {1.0 / 3.0, "0.3333333333333333"}, {-0.0, "-0"}, {100.0, "100"}};
+    for (size_t i = 0; i < sizeof(shortest) / sizeof(shortest[0]); i++)
+    {
+        buffer[formatShortest(shortest[i].value, buffer)] = '\0';
+        expect(strcmp(buffer, shortest[i].text) == 0, "formatShortest(%.17g) = %s, expected %s", shortest[i].value,
+               buffer, shortest[i].text);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Batch
+
+static const char batchInput[] = "1+2\nsin(1)\n\n1+\r\n0.1\r\n2^0.5\nfoo(2)\n1/0\n-1/0\nln(-1)\nlast";
+static const char batchExpected[] = "3\n0.8414709848078965\nError: Expected a number, got 'end of input' (at 0)\n"
+                                    "Error: Expected a number, got 'end of input' (at 2)\n0.1\n1.414213562373095\n"
+                                    "Error: Unknown function, got 'foo' (at 0)\ninf\n-inf\nnan\n"
+                                    "Error: Unknown variable, got 'last' (at 0)\n";
+
+// Run the in-memory batch of input through every reader and return the output of the single-threaded one
+static char *runAllReaders(const char *input, size_t length, OutputFormat format, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    fwrite(input, 1, length, file);
+    fclose(file);
+
+    char *results[4];
+    size_t lengths[4];
+    long failures[4];
+    for (int reader = 0; reader < 4; reader++)
+    {
+        Arena arena;
+        arenaInit(&arena, ARENA_DEFAULT_SIZE);
+        ExpressionCache cache;
+        cacheInit(&cache, CACHE_DEFAULT_BUDGET, NULL);
+        OutputBuffer out;
+        outputInit(&out, NULL, OUTPUT_BUFFER_SIZE);
+        out.format = format;
+        out.precision = 6;
+        file = fopen(path, "rb");
+        if (reader == 0)
+        {
+            failures[reader] = runBatch(file, &arena, NULL, &out);
+        }
+        else if (reader == 1)
+        {
+            failures[reader] = runBatch(file, &arena, &cache, &out);
+        }
+        else if (reader == 2)
+        {
+            failures[reader] = runBatchThreaded(file, 3, &cache, &out);
+        }
+        else
+        {
+            int status = runBatchMapped(path, 3, &cache, &out, &failures[reader]);
+            expect(status == 1, "runBatchMapped returned %d", status);
+        }
+        fclose(file);
+        results[reader] = (char *)malloc(out.length + 1);
+        memcpy(results[reader], out.data, out.length);
+        results[reader][out.length] = '\0';
+        lengths[reader] = out.length;
+        outputFree(&out);
+        cacheFree(&cache);
+        arenaFree(&arena);
+    }
+    for (int reader = 1; reader < 4; reader++)
+    {
+        expect(lengths[reader] == lengths[0] && memcmp(results[reader], results[0], lengths[0]) == 0 &&
+                   failures[reader] == failures[0],
+               "batch reader %d differs from runBatch (%zu bytes, %ld failures, against %zu and %ld)", reader,
+               lengths[reader], failures[reader], lengths[0], failures[0]);
+        free(results[reader]);
+    }
+    return results[0];
+}
+
+// runBatch with and without the cache, runBatchThreaded and runBatchMapped give the same output
+static void testBatch(void)
+{
+    char path[512];
+    scratchPath(path, sizeof(path));
+
+    char *result = runAllReaders(batchInput, strlen(batchInput), FORMAT_SHORTEST, path);
+    expect(strcmp(result, batchExpected) == 0, "batch output:\n%s\nexpected:\n%s", result, batchExpected);
+    free(result);
+
+    // Large enough for several tasks of the threaded reader, with lines that repeat
+    size_t capacity = 4 * BATCH_TASK_SIZE * 8;
+    char *input = (char *)malloc(capacity);
+    size_t length = 0;
+    srand48(3);
+    while (length + 64 < capacity)
+        length += (size_t)snprintf(input + length, 64, "sin(%ld)*x%ld+%ld.25\n", lrand48() % 1000, lrand48() % 2,
+                                   lrand48() % 100);
+    for (int format = FORMAT_FIXED; format <= FORMAT_BINARY; format++)
+        free(runAllReaders(input, length, (OutputFormat)format, path));
+    free(input);
+    remove(path);
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Interactive definitions
+
+// Assignments, forward references, recomputation and cycles
+static void testSheet(void)
+{
+    Sheet sheet;
+    sheetInit(&sheet);
+    Arena arena;
+    arenaInit(&arena, ARENA_DEFAULT_SIZE);
+    ParseError error = {0};
+    double result;
+
+    expect(sheetAssign(&sheet, "total", 5, "price * qty * (1 + rate)", &arena, &error), "total: %s", error.message);
+    expect(!sheetEvaluate(&sheet, "total", &arena, &result, &error) && strstr(error.message, "price") != NULL,
+           "total was evaluated before price was defined: '%s'", error.message);
+    // recomputed counts the assigned definition itself
+    expect(sheetAssign(&sheet, "price", 5, "10", &arena, &error) && sheet.recomputed == 2, "price: %s, %ld recomputed",
+           error.message, sheet.recomputed);
+    expect(sheetAssign(&sheet, "qty", 3, "3", &arena, &error), "qty: %s", error.message);
+    expect(sheetAssign(&sheet, "rate", 4, "0.05", &arena, &error), "rate: %s", error.message);
+    expect(sheetEvaluate(&sheet, "total", &arena, &result, &error) && fabs(result - 31.5) < 1e-12, "total = %.17g",
+           result);
+    expect(sheetAssign(&sheet, "rate", 4, "0.05", &arena, &error) && sheet.recomputed == 1,
+           "unchanged rate recomputed %ld definitions", sheet.recomputed);
+    expect(sheetAssign(&sheet, "price", 5, "12", &arena, &error) && sheet.recomputed == 2,
+           "price = 12 recomputed %ld definitions", sheet.recomputed);
+    expect(sheetEvaluate(&sheet, "total", &arena, &result, &error) && fabs(result - 37.8) < 1e-12, "total = %.17g",
+           result);
+    expect(!sheetAssign(&sheet, "price", 5, "total / 3", &arena, &error) && error.message[0] != '\0',
+           "a cycle was accepted");
+    expect(sheetEvaluate(&sheet, "price", &arena, &result, &error) && result == 12.0,
+           "a rejected cycle changed price to %g", result);
+
+    const char *name;
+    const char *definition;
+    int nameLength;
+    expect(sheetParseAssignment("  k = 2", &name, &nameLength, &definition) && nameLength == 1 && *name == 'k',
+           "k = 2 is not an assignment");
+
+    arenaFree(&arena);
+    sheetFree(&sheet);
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Numerics
+
+// Known integrals and roots, the same integrals on one and several threads, and failures
+static void testNumerics(void)
+{
+    static const struct
+    {
+        const char *text;
+        double a, b, value;
+    } integrals[] = {
+        {"x^2", 0, 1, 1.0 / 3.0},
+        {"sin(x)", 0, PI, 2.0},
+        {"1/pow(x, 0.5)", 0, 1, 2.0},
+        {"exp(-x*x)", 10, -10, -1.7724538509055159},
+        {"x * ln(x)", 0, 1, -0.25},
+        {"1e-300", -1e308, 1e308, 2e8}, // Limits whose difference overflows
+    };
+    Arena arena;
+    arenaInit(&arena, ARENA_DEFAULT_SIZE);
+    for (size_t i = 0; i < sizeof(integrals) / sizeof(integrals[0]); i++)
+    {
+        Program program;
+        initProgram(&program);
+        ParseError error = {0};
+        VariableTable variables;
+        memset(&variables, 0, sizeof(variables));
+        variables.allowNew = 1;
+        compileExpression(integrals[i].text, &variables, &arena, &program, &error);
+        arenaReset(&arena);
+        NumericResult one, many;
+        int ok = integrateProgram(&program, 0, NULL, integrals[i].a, integrals[i].b, 1e-12, 1, &one, &error) &&
+                 integrateProgram(&program, 0, NULL, integrals[i].a, integrals[i].b, 1e-12, 4, &many, &error);
+        expect(ok && one.converged && fabs(one.value - integrals[i].value) <= 1e-11 * fmax(1.0, fabs(one.value)),
+               "integral of %s = %.17g, expected %.17g", integrals[i].text, one.value, integrals[i].value);
+        expect(sameValue(one.value, many.value) && one.evaluations == many.evaluations,
+               "integral of %s depends on the thread count: %.17g and %.17g", integrals[i].text, one.value,
+               many.value);
+        freeProgram(&program);
+    }
+
+    static const struct
+    {
+        const char *text;
+        double lo, hi, root;
+    } roots[] = {
+        {"x^2 - 2", 0, 5, 1.4142135623730951},
+        {"cos(x) - x", 0, 1, 0.73908513321516067},
+        {"exp(x) - 10", -5, 5, 2.3025850929940459},
+        {"x*x*x", -1, 2, 0.0},
+        {"x", -1e308, 1e308, 0.0},
+        {"x - 1e308", -1.7e308, 1.7e308, 1e308},
+    };
+    for (size_t i = 0; i < sizeof(roots) / sizeof(roots[0]); i++)
+    {
+        Program program;
+        initProgram(&program);
+        ParseError error = {0};
+        VariableTable variables;
+        memset(&variables, 0, sizeof(variables));
+        variables.allowNew = 1;
+        compileExpression(roots[i].text, &variables, &arena, &program, &error);
+        arenaReset(&arena);
+        NumericResult result;
+        int ok = solveProgram(&program, 0, NULL, roots[i].lo, roots[i].hi, SOLVE_DEFAULT_TOLERANCE, &result, &error);
+        expect(ok && result.converged && fabs(result.value - roots[i].root) <= 1e-15 + 4e-16 * fabs(roots[i].root),
+               "root of %s = %.17g, expected %.17g (%s)", roots[i].text, result.value, roots[i].root, error.message);
+        freeProgram(&program);
+    }
+
+    // No sign change, and a pole where the integral diverges
+    Program program;
+    initProgram(&program);
+    ParseError error = {0};
+    VariableTable variables;
+    memset(&variables, 0, sizeof(variables));
+    variables.allowNew = 1;
+    compileExpression("x^2 + 1", &variables, &arena, &program, &error);
+    NumericResult result;
+    expect(!solveProgram(&program, 0, NULL, -1, 1, SOLVE_DEFAULT_TOLERANCE, &result, &error) &&
+               error.message[0] != '\0',
+           "x^2 + 1 has a root");
+    freeProgram(&program);
+    compileExpression("1/x", &variables, &arena, &program, &error);
+    error.message[0] = '\0';
+    int ok = integrateProgram(&program, 0, NULL, -1, 2, 1e-10, 2, &result, &error);
+    expect(!ok || !result.converged, "the integral of 1/x over [-1, 2] converged to %g", result.value);
+    freeProgram(&program);
+
+    // integrate(exp(-k*t*t), t, -10, 10) and solve(x^2 - k, x, 0, 5) of the interactive mode, with k = 2
+    Sheet sheet;
+    sheetInit(&sheet);
+    sheetAssign(&sheet, "k", 1, "2", &arena, &error);
+    double values[MAX_VARIABLES];
+    NumericResult numeric;
+    expect(sheetCompileBound(&sheet, "exp(-k*t*t)", "t", &arena, &program, values, &error), "%s", error.message);
+    expect(integrateProgram(&program, 0, values, -10, 10, QUAD_DEFAULT_TOLERANCE, 2, &numeric, &error) &&
+               numeric.converged && fabs(numeric.value - sqrt(PI / 2)) < 1e-10,
+           "integral %.17g, expected %.17g", numeric.value, sqrt(PI / 2));
+    freeProgram(&program);
+    expect(sheetCompileBound(&sheet, "x^2 - k", "x", &arena, &program, values, &error), "%s", error.message);
+    expect(solveProgram(&program, 0, values, 0, 5, SOLVE_DEFAULT_TOLERANCE, &numeric, &error) &&
+               numeric.converged && ulpDistance(numeric.value, sqrt(2.0)) <= 2,
+           "root %.17g, expected %.17g", numeric.value, sqrt(2.0));
+    freeProgram(&program);
+    expect(!sheetCompileBound(&sheet, "x", "sin", &arena, &program, values, &error), "sin was accepted as a variable");
+    sheetFree(&sheet);
+    arenaFree(&arena);
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Nesting
+
+// Expression of the given shape repeated count times: "(" ... "1" ... ")", "-" ... "1", "1+1+...+1" or "1^1^...^1"
+static char *nestedExpression(char shape, int count)
+{
+    char *text = (char *)malloc(2 * (size_t)count + 2);
+    size_t length = 0;
+    if (shape == '(' || shape == '-')
+    {
+        memset(text, shape, count);
+        length = count;
+        text[length++] = '1';
+        if (shape == '(')
+        {
+            memset(text + length, ')', count);
+            length += count;
+        }
+    }
+    else
+    {
+        for (int i = 0; i < count; i++)
+        {
+            text[length++] = '1';
+            text[length++] = shape;
+        }
+        text[length++] = '1';
+    }
+    text[length] = '\0';
+    return text;
+}
+
+// Inputs nested past MAX_NESTING fail with an error through every entry point instead of overflowing the stack
+static void testNesting(void)
+{
+    static const char shapes[] = {'(', '-', '+', '^'};
+    Arena arena;
+    arenaInit(&arena, ARENA_DEFAULT_SIZE);
+    ExpressionCache cache;
+    cacheInit(&cache, CACHE_DEFAULT_BUDGET, NULL);
+    for (int s = 0; s < 4; s++)
+    {
+        // At the limit (a chain of MAX_NESTING operators has MAX_NESTING + 1 levels) and far past it
+        static const int counts[] = {MAX_NESTING - 1, 300000};
+        for (int c = 0; c < 2; c++)
+        {
+            char *text = nestedExpression(shapes[s], counts[c]);
+            double result = NAN;
+            ParseError error = {0};
+            int ok = evaluateExpression(text, &arena, &result, &error);
+            arenaReset(&arena);
+            int deep = c == 1;
+            expect(ok != deep && (!deep || strcmp(error.message, "Expression too deeply nested") == 0),
+                   "%d nested '%c': %d, '%s'", counts[c], shapes[s], ok, error.message);
+            ParseError cacheError = {0};
+            ok = cacheEvaluate(&cache, text, strlen(text), &arena, &result, &cacheError);
+            expect(ok != deep && strcmp(error.message, cacheError.message) == 0, "%d nested '%c' in the cache: '%s'",
+                   counts[c], shapes[s], cacheError.message);
+            Program program;
+            initProgram(&program);
+            VariableTable variables;
+            memset(&variables, 0, sizeof(variables));
+            ParseError compileError = {0};
+            ok = compileExpression(text, &variables, &arena, &program, &compileError);
+            expect(!deep || (!ok && strcmp(error.message, compileError.message) == 0),
+                   "%d nested '%c' compiled: '%s'", counts[c], shapes[s], compileError.message);
+            freeProgram(&program);
+            free(text);
+        }
+    }
+    cacheFree(&cache);
+    arenaFree(&arena);
+
+    // One bad line gives an error line and the batch goes on
+    char *text = nestedExpression('(', 200000);
+    size_t length = strlen(text);
+    char *input = (char *)malloc(length + 16);
+    snprintf(input, length + 16, "1+1\n%s\n2+2\n", text);
+    char path[512];
+    scratchPath(path, sizeof(path));
+    char *output = runAllReaders(input, strlen(input), FORMAT_SHORTEST, path);
+    remove(path);
+    expect(strcmp(output, "2\nError: Expression too deeply nested (at 1000)\n4\n") == 0, "batch printed:\n%s", output);
+    free(output);
+    free(input);
+    free(text);
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Library
+
+// Every calc_* function, against the engine and known values
+static void testLibrary(void)
+{
+    calc_error err;
+    calc_expr *expr = calc_compile("x*y + sin(x)", &err);
+    expect(expr != NULL && calc_variable_count(expr) == 2, "calc_compile: %s", err.message);
+    if (expr == NULL)
+        return;
+    int x = calc_variable_index(expr, "x");
+    int y = calc_variable_index(expr, "y");
+    expect(x >= 0 && y >= 0 && x != y && calc_variable_index(expr, "z") < 0, "variable indices %d, %d", x, y);
+    expect(strcmp(calc_variable_name(expr, x), "x") == 0, "calc_variable_name(%d) = %s", x,
+           calc_variable_name(expr, x));
+
+    double vars[2];
+    vars[x] = 0.5;
+    vars[y] = 3.0;
+    double value = calc_eval(expr, vars);
+    expect(ulpDistance(value, 1.5 + sin(0.5)) <= 2, "calc_eval = %.17g", value);
+    double gradient[2];
+    double graded = calc_grad(expr, vars, gradient);
+    expect(sameValue(graded, value) && ulpDistance(gradient[x], 3.0 + cos(0.5)) <= 2 && gradient[y] == 0.5,
+           "calc_grad = %.17g, (%.17g, %.17g)", graded, gradient[x], gradient[y]);
+
+    double xs[COLUMN_ROWS], ys[COLUMN_ROWS], out[COLUMN_ROWS], gx[COLUMN_ROWS], gy[COLUMN_ROWS], values[COLUMN_ROWS];
+    srand48(9);
+    for (int i = 0; i < COLUMN_ROWS; i++)
+    {
+        xs[i] = randomIn(-3, 3);
+        ys[i] = randomIn(-3, 3);
+    }
+    const double *columns[2];
+    double *gradients[2];
+    columns[x] = xs;
+    columns[y] = ys;
+    gradients[x] = gx;
+    gradients[y] = gy;
+    expect(calc_eval_columns(expr, columns, out, COLUMN_ROWS) == 1, "calc_eval_columns failed");
+    expect(calc_grad_columns(expr, columns, values, gradients, COLUMN_ROWS) == 1, "calc_grad_columns failed");
+    for (int i = 0; i < COLUMN_ROWS; i++)
+    {
+        vars[x] = xs[i];
+        vars[y] = ys[i];
+        double scalar = calc_grad(expr, vars, gradient);
+        expect(fabs(out[i] - scalar) <= 1e-12 * fmax(1.0, fabs(scalar)) && sameValue(values[i], out[i]) &&
+                   fabs(gx[i] - gradient[x]) <= 1e-12 * fmax(1.0, fabs(gradient[x])) && gy[i] == gradient[y],
+               "row %d: columns %.17g, %.17g, %.17g, scalar %.17g, %.17g, %.17g", i, out[i], gx[i], gy[i], scalar,
+               gradient[x], gradient[y]);
+    }
+    calc_free(expr);
+
+    // Fixed variable lists, precision tiers and errors
+    const char *names[2] = {"a", "b"};
+    expr = calc_compile_vars("a - b", names, 2, &err);
+    vars[0] = 5.0;
+    vars[1] = 3.0;
+    expect(expr != NULL && calc_eval(expr, vars) == 2.0, "calc_compile_vars: %s", err.message);
+    calc_free(expr);
+    expr = calc_compile_vars("a - c", names, 2, &err);
+    expect(expr == NULL && err.message[0] != '\0' && err.position == 4, "unknown variable accepted: '%s' at %d",
+           err.message, err.position);
+    expr = calc_compile("1 +", &err);
+    expect(expr == NULL && err.message[0] != '\0', "calc_compile accepted '1 +'");
+    char *deep = nestedExpression('(', 200000);
+    expr = calc_compile(deep, &err);
+    expect(expr == NULL && strcmp(err.message, "Expression too deeply nested") == 0 && err.position == MAX_NESTING,
+           "calc_compile on 200000 parentheses: '%s' at %d", err.message, err.position);
+    calc_free(expr);
+    free(deep);
+    static const calc_precision precisions[] = {CALC_PRECISION_STANDARD, CALC_PRECISION_FAST, CALC_PRECISION_ACCURATE};
+    for (int p = 0; p < 3; p++)
+    {
+        expr = calc_compile_precision("exp(a) * sin(b)", names, 2, precisions[p], &err);
+        vars[0] = 1.0;
+        vars[1] = 2.0;
+        double expected = exp(1.0) * sin(2.0);
+        value = calc_eval(expr, vars);
+        expect(expr != NULL && fabs(value - expected) <= (p == 1 ? 1e-6 : 1e-15) * expected,
+               "precision %d: %.17g, expected %.17g", p, value, expected);
+        calc_free(expr);
+    }
+
+    calc_result result;
+    expr = calc_compile("exp(-k*t*t)", &err);
+    int t = calc_variable_index(expr, "t");
+    vars[calc_variable_index(expr, "k")] = 2.0;
+    expect(calc_integrate(expr, t, vars, -10, 10, 0, 2, &result, &err) == 1 && result.converged &&
+               fabs(result.value - sqrt(PI / 2)) < 1e-10,
+           "calc_integrate = %.17g (%s)", result.value, err.message);
+    expect(calc_integrate(expr, 5, vars, -10, 10, 0, 2, &result, &err) == 0 && err.message[0] != '\0',
+           "calc_integrate accepted variable 5");
+    calc_free(expr);
+    expr = calc_compile("x^2 - 2", &err);
+    expect(calc_solve(expr, 0, NULL, 0, 5, 0, &result, &err) == 1 && ulpDistance(result.value, sqrt(2.0)) <= 2,
+           "calc_solve = %.17g (%s)", result.value, err.message);
+    expect(calc_integrate(expr, 0, NULL, 0, 3, 0, 1, &result, &err) == 1 && fabs(result.value - 3.0) < 1e-12,
+           "calc_integrate with no vars = %.17g (%s)", result.value, err.message);
+    expect(calc_solve(expr, 0, NULL, 2, 5, 0, &result, &err) == 0 && err.message[0] != '\0',
+           "calc_solve found a root without a sign change");
+    calc_free(expr);
+}
+
+// ---------------------------------------------------------------------------------------------------
+// The calculator program
+
+// Run command and return everything it writes to stdout
+static char *capture(const char *command)
+{
+    FILE *pipe = popen(command, "r");
+    if (pipe == NULL)
+        return NULL;
+    size_t capacity = 1 << 16;
+    size_t length = 0;
+    char *output = (char *)malloc(capacity);
+    size_t got;
+    while ((got = fread(output + length, 1, capacity - length - 1, pipe)) > 0)
+    {
+        length += got;
+        if (length + 1 == capacity)
+            output = (char *)realloc(output, capacity *= 2);
+    }
+    output[length] = '\0';
+    pclose(pipe);
+    return output;
+}
+
+// Write text to the scratch file and run the calculator with arguments, in which %s stands for the file
+static char *runCalculator(const char *arguments, const char *text)
+{
+    char path[512];
+    char expanded[1024];
+    char command[1536];
+    scratchPath(path, sizeof(path));
+    FILE *file = fopen(path, "w");
+    fputs(text, file);
+    fclose(file);
+    snprintf(expanded, sizeof(expanded), arguments, path);
+    snprintf(command, sizeof(command), "%s %s 2>/dev/null", calculatorPath, expanded);
+    char *output = capture(command);
+    remove(path);
+    return output;
+}
+
+// Batch mode prints what runBatch does, from a mapped file, from a pipe and on several threads
+static void testCalculatorBatch(void)
+{
+    static const char *const modes[] = {"--batch --format shortest %s", "--batch --format shortest < %s",
+                                        "--batch --format shortest --threads 3 --no-mmap < %s"};
+    for (int m = 0; m < 3; m++)
+    {
+        char *output = runCalculator(modes[m], batchInput);
+        expect(output != NULL && strcmp(output, batchExpected) == 0, "%s printed:\n%s", modes[m],
+               output ? output : "(nothing)");
+        free(output);
+    }
+}
+
+// The interactive session of the README, with stdin from a file
+static void testCalculatorSession(void)
+{
+    char *output = runCalculator("< %s", "total = price * qty * (1 + rate)\nprice = 10\nqty = 3\nrate = 0.05\n"
+                                         "total\ngrad(total, price, rate)\nk = 2\n"
+                                         "integrate(exp(-k*t*t), t, -10, 10)\nsolve(x^2 - k, x, 0, 5)\n"
+                                         "price = \n1+\nq\n");
+    static const char *const lines[] = {"total is waiting for 'price'", "(1 dependent definition recomputed)",
+                                        "Result: 31.500000", "d/dprice = 3.150000", "d/drate = 30.000000",
+                                        "k = 2.000000", "Result: 1.253314", "Result: 1.414214", "Error:",
+                                        "Goodbye"};
+    for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++)
+        expect(output != NULL && strstr(output, lines[i]) != NULL, "interactive output lacks '%s'", lines[i]);
+    free(output);
+}
+
+// Connect to the server at path, send length bytes of data, shut down the sending side and return every byte
+// the server writes back, or NULL if the connection fails
+static char *serverExchange(const char *path, const char *data, size_t length)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return NULL;
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    for (size_t sent = 0; sent < length;)
+    {
+        ssize_t wrote = write(fd, data + sent, length - sent);
+        if (wrote <= 0)
+            break;
+        sent += (size_t)wrote;
+    }
+    shutdown(fd, SHUT_WR);
+    size_t capacity = 1 << 12;
+    size_t received = 0;
+    char *output = (char *)malloc(capacity);
+    ssize_t got;
+    while ((got = read(fd, output + received, capacity - received - 1)) > 0)
+    {
+        received += (size_t)got;
+        if (received + 1 == capacity)
+            output = (char *)realloc(output, capacity *= 2);
+    }
+    output[received] = '\0';
+    close(fd);
+    return output;
+}
+
+// The daemon answers a line nested far past the parser's limit with an error and keeps serving
+static void testCalculatorServer(void)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/calc-tests-%d.sock", scratchDirectory, (int)getpid());
+    if (strlen(path) >= sizeof(((struct sockaddr_un *)NULL)->sun_path))
+    {
+        expect(0, "socket path %s is too long", path);
+        return;
+    }
+    pid_t server = fork();
+    if (server == 0)
+    {
+        freopen("/dev/null", "w", stdout);
+        freopen("/dev/null", "w", stderr);
+        execl(calculatorPath, calculatorPath, "--serve", path, (char *)NULL);
+        _exit(127);
+    }
+    expect(server > 0, "could not start the server");
+    if (server < 0)
+        return;
+
+    // Wait for the server to listen
+    char *output = NULL;
+    for (int attempt = 0; attempt < 200 && output == NULL; attempt++)
+    {
+        output = serverExchange(path, "1+2\n", 4);
+        if (output == NULL)
+            usleep(10000);
+    }
+    expect(output != NULL && strcmp(output, "3.000000\n") == 0, "server answered '1+2' with %s",
+           output ? output : "(no connection)");
+    free(output);
+
+    size_t count = 300000;
+    char *deep = (char *)malloc(count + 5);
+    memset(deep, '(', count);
+    memcpy(deep + count, "\n2*3\n", 5);
+    output = serverExchange(path, deep, count + 5);
+    expect(output != NULL && strcmp(output, "Error: Expression too deeply nested (at 1000)\n6.000000\n") == 0,
+           "server answered a line of 300000 '(' with %s", output ? output : "(no connection)");
+    free(output);
+    free(deep);
+
+    output = serverExchange(path, "8/2\n", 4);
+    expect(output != NULL && strcmp(output, "4.000000\n") == 0, "server answered '8/2' afterwards with %s",
+           output ? output : "(no connection)");
+    free(output);
+
+    int status = 0;
+    kill(server, SIGTERM);
+    waitpid(server, &status, 0);
+    expect(WIFEXITED(status), "server did not exit cleanly on SIGTERM");
+    remove(path);
+}
+
+int main(int argc, char **argv)
+{
+    calculatorPath = argc > 1 ? argv[1] : NULL;
+    scratchDirectory = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+
+    // Groups of checks; the ones that run the calculator are skipped when no path is given
+    static const struct
+    {
+        const char *name;
+        void (*run)(void);
+        int needsCalculator;
+    } groups[] = {
+        {"kernels", testKernels, 0},
+        {"evaluation", testExamples, 0},
+        {"columns", testColumns, 0},
+        {"gradients", testGradients, 0},
+        {"literals", testLiterals, 0},
+        {"formats", testFormatting, 0},
+        {"batch", testBatch, 0},
+        {"nesting", testNesting, 0},
+        {"definitions", testSheet, 0},
+        {"integration and roots", testNumerics, 0},
+        {"library", testLibrary, 0},
+        {"calculator batch", testCalculatorBatch, 1},
+        {"interactive session", testCalculatorSession, 1},
+        {"server", testCalculatorServer, 1},
+    };
+    for (size_t g = 0; g < sizeof(groups) / sizeof(groups[0]); g++)
+    {
+        if (groups[g].needsCalculator && calculatorPath == NULL)
+        {
+            printf("%-24s skipped\n", groups[g].name);
+            continue;
+        }
+        long before = failures;
+        groups[g].run();
+        printf("%-24s %s\n", groups[g].name, failures == before ? "ok" : "FAILED");
+    }
+
+    printf("%ld checks, %ld failed\n", checks, failures);
+    return failures == 0 ? 0 : 1;
+}